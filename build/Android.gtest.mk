@@ -38,6 +38,9 @@ GTEST_DEX_DIRECTORIES := \
   Statics \
   StaticsFromCode \
   Transaction \
+  VerifierDeps \
+  VerifierDepsLib \
+  VerifierDepsLib2 \
   XandY
 
 # Create build rules for each dex file recording the dependency.
@@ -46,22 +49,30 @@ $(foreach dir,$(GTEST_DEX_DIRECTORIES), $(eval $(call build-art-test-dex,art-gte
   ART_TEST_HOST_GTEST_$(dir)_DEX)))
 
 # Dex file dependencies for each gtest.
-ART_GTEST_class_linker_test_DEX_DEPS := Interfaces MyClass Nested Statics StaticsFromCode
-ART_GTEST_compiler_driver_test_DEX_DEPS := AbstractMethod
-ART_GTEST_dex_file_test_DEX_DEPS := GetMethodSignature Main Nested
+ART_GTEST_class_linker_test_DEX_DEPS := Interfaces MyClass MyClassNatives Nested Statics StaticsFromCode
+ART_GTEST_class_preloader_test_DEX_DEPS := Interfaces
+ART_GTEST_compiled_method_cache_test_DEX_DEPS := StaticLeafMethods
+ART_GTEST_compiler_driver_test_DEX_DEPS := AbstractMethod StaticLeafMethods Statics VerifierDeps VerifierDepsLib VerifierDepsLib2
+ART_GTEST_dex_file_test_DEX_DEPS := GetMethodSignature Main MyClassNatives Nested
 ART_GTEST_exception_test_DEX_DEPS := ExceptionHandle
 ART_GTEST_jni_compiler_test_DEX_DEPS := MyClassNatives
-ART_GTEST_jni_internal_test_DEX_DEPS := AllFields StaticLeafMethods
+ART_GTEST_jni_internal_test_DEX_DEPS := AllFields MyClassNatives StaticLeafMethods
+ART_GTEST_lookup_cache_test_DEX_DEPS := Main
 ART_GTEST_object_test_DEX_DEPS := ProtoCompare ProtoCompare2 StaticsFromCode XandY
 ART_GTEST_proxy_test_DEX_DEPS := Interfaces
 ART_GTEST_reflection_test_DEX_DEPS := Main NonStaticLeafMethods StaticLeafMethods
 ART_GTEST_stub_test_DEX_DEPS := AllFields
 ART_GTEST_transaction_test_DEX_DEPS := Transaction
+ART_GTEST_type_lookup_table_test_DEX_DEPS := Interfaces
 
 # The elf writer test has dependencies on core.oat.
 ART_GTEST_elf_writer_test_HOST_DEPS := $(HOST_CORE_IMAGE_default_no-pic_64) $(HOST_CORE_IMAGE_default_no-pic_32)
 ART_GTEST_elf_writer_test_TARGET_DEPS := $(TARGET_CORE_IMAGE_default_no-pic_64) $(TARGET_CORE_IMAGE_default_no-pic_32)
 
+# The image test relocates the images it writes with patchoat.
+ART_GTEST_image_test_HOST_DEPS := $(HOST_OUT_EXECUTABLES)/patchoatd
+ART_GTEST_image_test_TARGET_DEPS := $(TARGET_OUT_EXECUTABLES)/patchoatd
+
 # TODO: document why this is needed.
 ART_GTEST_proxy_test_HOST_DEPS := $(HOST_CORE_IMAGE_default_no-pic_64) $(HOST_CORE_IMAGE_default_no-pic_32)
 
@@ -91,6 +102,7 @@ RUNTIME_GTEST_COMMON_SRC_FILES := \
   runtime/base/timing_logger_test.cc \
   runtime/base/unix_file/fd_file_test.cc \
   runtime/class_linker_test.cc \
+  runtime/class_preloader_test.cc \
   runtime/dex_file_test.cc \
   runtime/dex_file_verifier_test.cc \
   runtime/dex_instruction_visitor_test.cc \
@@ -117,18 +129,24 @@ RUNTIME_GTEST_COMMON_SRC_FILES := \
   runtime/interpreter/safe_math_test.cc \
   runtime/java_vm_ext_test.cc \
   runtime/leb128_test.cc \
+  runtime/lookup_cache_test.cc \
   runtime/mem_map_test.cc \
   runtime/mirror/dex_cache_test.cc \
   runtime/mirror/object_test.cc \
+  runtime/monitor_contention_profiler_test.cc \
   runtime/monitor_pool_test.cc \
   runtime/monitor_test.cc \
   runtime/parsed_options_test.cc \
   runtime/reference_table_test.cc \
+  runtime/safepoint_log_test.cc \
+  runtime/thread_list_test.cc \
   runtime/thread_pool_test.cc \
   runtime/transaction_test.cc \
+  runtime/type_lookup_table_test.cc \
   runtime/utils_test.cc \
   runtime/verifier/method_verifier_test.cc \
   runtime/verifier/reg_type_test.cc \
+  runtime/verifier/verifier_deps_test.cc \
   runtime/zip_archive_test.cc
 
 COMPILER_GTEST_COMMON_SRC_FILES := \
@@ -139,6 +157,7 @@ COMPILER_GTEST_COMMON_SRC_FILES := \
   compiler/dex/local_value_numbering_test.cc \
   compiler/dex/mir_graph_test.cc \
   compiler/dex/mir_optimization_test.cc \
+  compiler/driver/compiled_method_cache_test.cc \
   compiler/driver/compiler_driver_test.cc \
   compiler/elf_writer_test.cc \
   compiler/image_test.cc \
@@ -167,6 +186,7 @@ COMPILER_GTEST_COMMON_SRC_FILES := \
   compiler/output_stream_test.cc \
   compiler/utils/arena_allocator_test.cc \
   compiler/utils/dedupe_set_test.cc \
+  compiler/utils/swap_space_test.cc \
   compiler/utils/arm/managed_register_arm_test.cc \
   compiler/utils/arm64/managed_register_arm64_test.cc \
   compiler/utils/x86/managed_register_x86_test.cc \
@@ -532,13 +552,17 @@ ART_TEST_TARGET_GTEST$(2ND_ART_PHONY_TEST_TARGET_SUFFIX)_RULES :=
 ART_TEST_TARGET_GTEST_RULES :=
 ART_GTEST_TARGET_ANDROID_ROOT :=
 ART_GTEST_class_linker_test_DEX_DEPS :=
+ART_GTEST_compiled_method_cache_test_DEX_DEPS :=
 ART_GTEST_compiler_driver_test_DEX_DEPS :=
 ART_GTEST_dex_file_test_DEX_DEPS :=
 ART_GTEST_exception_test_DEX_DEPS :=
 ART_GTEST_elf_writer_test_HOST_DEPS :=
 ART_GTEST_elf_writer_test_TARGET_DEPS :=
+ART_GTEST_image_test_HOST_DEPS :=
+ART_GTEST_image_test_TARGET_DEPS :=
 ART_GTEST_jni_compiler_test_DEX_DEPS :=
 ART_GTEST_jni_internal_test_DEX_DEPS :=
+ART_GTEST_lookup_cache_test_DEX_DEPS :=
 ART_GTEST_object_test_DEX_DEPS :=
 ART_GTEST_proxy_test_DEX_DEPS :=
 ART_GTEST_reflection_test_DEX_DEPS :=
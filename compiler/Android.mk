@@ -75,8 +75,12 @@ LIBART_COMPILER_SRC_FILES := \
 	dex/verification_results.cc \
 	dex/vreg_analysis.cc \
 	dex/quick_compiler_callbacks.cc \
+	driver/compiled_method_cache.cc \
 	driver/compiler_driver.cc \
 	driver/dex_compilation_unit.cc \
+	driver/dex_file_dependencies.cc \
+	driver/method_compile_stats.cc \
+	driver/reusable_oat_file.cc \
 	jni/quick/arm/calling_convention_arm.cc \
 	jni/quick/arm64/calling_convention_arm64.cc \
 	jni/quick/mips/calling_convention_mips.cc \
@@ -127,6 +131,7 @@ LIBART_COMPILER_SRC_FILES := \
 	utils/x86_64/assembler_x86_64.cc \
 	utils/x86_64/managed_register_x86_64.cc \
 	utils/scoped_arena_allocator.cc \
+	utils/swap_space.cc \
 	buffered_output_stream.cc \
 	compiler.cc \
 	elf_writer.cc \
@@ -25,8 +25,7 @@ BufferedOutputStream::BufferedOutputStream(OutputStream* out)
 
 bool BufferedOutputStream::WriteFully(const void* buffer, size_t byte_count) {
   if (byte_count > kBufferSize) {
-    Flush();
-    return out_->WriteFully(buffer, byte_count);
+    return Flush() && out_->WriteFully(buffer, byte_count);
   }
   if (used_ + byte_count > kBufferSize) {
     bool success = Flush();
@@ -50,6 +49,11 @@ bool BufferedOutputStream::Flush() {
 }
 
 off_t BufferedOutputStream::Seek(off_t offset, Whence whence) {
+  if (offset == 0 && whence == kSeekCurrent) {
+    // Just querying the position, no need to write out the buffer.
+    off_t position = out_->Seek(0, kSeekCurrent);
+    return (position == static_cast<off_t>(-1)) ? position : position + used_;
+  }
   if (!Flush()) {
     return -1;
   }
@@ -35,11 +35,12 @@ class BufferedOutputStream FINAL : public OutputStream {
 
   virtual off_t Seek(off_t offset, Whence whence);
 
+  // Writes out the buffered data.
+  bool Flush();
+
  private:
   static const size_t kBufferSize = 8 * KB;
 
-  bool Flush();
-
   OutputStream* const out_;
 
   uint8_t buffer_[kBufferSize];
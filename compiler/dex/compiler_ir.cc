@@ -18,6 +18,7 @@
 
 #include "base/dumpable.h"
 #include "backend.h"
+#include "driver/method_compile_stats.h"
 #include "frontend.h"
 #include "mir_graph.h"
 
@@ -45,6 +46,7 @@ CompilationUnit::CompilationUnit(ArenaPool* pool)
     mir_graph(nullptr),
     cg(nullptr),
     timings("QuickCompiler", true, false),
+    method_stats(nullptr),
     print_pass(false) {
 }
 
@@ -53,21 +55,24 @@ CompilationUnit::~CompilationUnit() {
 }
 
 void CompilationUnit::StartTimingSplit(const char* label) {
-  if (compiler_driver->GetDumpPasses()) {
+  if (compiler_driver->GetDumpPasses() || method_stats != nullptr) {
     timings.StartTiming(label);
   }
 }
 
 void CompilationUnit::NewTimingSplit(const char* label) {
-  if (compiler_driver->GetDumpPasses()) {
+  if (compiler_driver->GetDumpPasses() || method_stats != nullptr) {
     timings.EndTiming();
     timings.StartTiming(label);
   }
 }
 
 void CompilationUnit::EndTiming() {
-  if (compiler_driver->GetDumpPasses()) {
+  if (compiler_driver->GetDumpPasses() || method_stats != nullptr) {
     timings.EndTiming();
+    if (method_stats != nullptr) {
+      method_stats->AddPassTimes(timings);
+    }
     if (enable_debug & (1 << kDebugTimings)) {
       LOG(INFO) << "TIMINGS " << PrettyMethod(method_idx, *dex_file);
       LOG(INFO) << Dumpable<TimingLogger>(timings);
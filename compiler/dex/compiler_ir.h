@@ -31,6 +31,7 @@ namespace art {
 class Backend;
 class ClassLinker;
 class MIRGraph;
+struct MethodCompileStats;
 
 /*
  * TODO: refactoring pass to move these (and other) typedefs towards usage style of runtime to
@@ -84,6 +85,7 @@ struct CompilationUnit {
   std::unique_ptr<MIRGraph> mir_graph;   // MIR container.
   std::unique_ptr<Backend> cg;           // Target-specific codegen.
   TimingLogger timings;
+  MethodCompileStats* method_stats;  // Statistics to collect for the method, or nullptr.
   bool print_pass;                 // Do we want to print a pass or not?
 
   /**
@@ -24,6 +24,7 @@
 #include "compiler_internals.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
+#include "driver/method_compile_stats.h"
 #include "mirror/object.h"
 #include "pass_driver_me_opts.h"
 #include "runtime.h"
@@ -84,7 +85,12 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
                                      jobject class_loader, const DexFile& dex_file,
                                      void* llvm_compilation_unit) {
   VLOG(compiler) << "Compiling " << PrettyMethod(method_idx, dex_file) << "...";
+  MethodCompileStats* method_stats = driver.GetMethodStats();
+  if (method_stats != nullptr) {
+    method_stats->backend = compiler->IsPortable() ? "portable" : "quick";
+  }
   if (Compiler::IsPathologicalCase(*code_item, method_idx, dex_file)) {
+    RecordFallbackReason(method_stats, "pathological case");
     return nullptr;
   }
 
@@ -101,6 +107,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
   }
   cu.target64 = Is64BitInstructionSet(cu.instruction_set);
   cu.compiler = compiler;
+  cu.method_stats = method_stats;
   // TODO: Mips64 is not yet implemented.
   CHECK((cu.instruction_set == kThumb2) ||
         (cu.instruction_set == kArm64) ||
@@ -157,6 +164,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
   if (!compiler->CanCompileMethod(method_idx, dex_file, &cu)) {
     VLOG(compiler)  << cu.instruction_set << ": Cannot compile method : "
         << PrettyMethod(method_idx, dex_file);
+    RecordFallbackReason(method_stats, "unsupported by the backend");
     return nullptr;
   }
 
@@ -165,6 +173,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
   if (cu.mir_graph->SkipCompilation(&skip_message)) {
     VLOG(compiler) << cu.instruction_set << ": Skipping method : "
                    << PrettyMethod(method_idx, dex_file) << "  Reason = " << skip_message;
+    RecordFallbackReason(method_stats, skip_message);
     return nullptr;
   }
 
@@ -176,6 +185,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
   if (cu.compiler_driver->ProfilePresent()
       && !cu.mir_graph->MethodIsLeaf()
       && cu.mir_graph->SkipCompilationByName(PrettyMethod(method_idx, dex_file))) {
+    RecordFallbackReason(method_stats, "skipped by profile");
     return nullptr;
   }
 
@@ -197,6 +207,9 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
       LOG(INFO) << PrettyMethod(method_idx, dex_file) << " " << Dumpable<MemStats>(stack_stats);
     }
   }
+  if (method_stats != nullptr) {
+    method_stats->arena_bytes += cu.arena_stack.PeakBytesAllocated();
+  }
   cu.arena_stack.Reset();
 
   CompiledMethod* result = NULL;
@@ -204,6 +217,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
   if (cu.mir_graph->PuntToInterpreter()) {
     VLOG(compiler) << cu.instruction_set << ": Punted method to interpreter: "
         << PrettyMethod(method_idx, dex_file);
+    RecordFallbackReason(method_stats, "punted to interpreter");
     return nullptr;
   }
 
@@ -217,6 +231,10 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
     VLOG(compiler) << cu.instruction_set << ": Compiled " << PrettyMethod(method_idx, dex_file);
   } else {
     VLOG(compiler) << cu.instruction_set << ": Deferred " << PrettyMethod(method_idx, dex_file);
+    RecordFallbackReason(method_stats, "code generation failed");
+  }
+  if (method_stats != nullptr) {
+    method_stats->arena_bytes += cu.arena.BytesAllocated();
   }
 
   if (cu.enable_debug & (1 << kDebugShowMemoryUsage)) {
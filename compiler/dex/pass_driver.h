@@ -17,6 +17,7 @@
 #ifndef ART_COMPILER_DEX_PASS_DRIVER_H_
 #define ART_COMPILER_DEX_PASS_DRIVER_H_
 
+#include <algorithm>
 #include <vector>
 #include "pass.h"
 #include "safe_map.h"
@@ -172,6 +173,25 @@ class PassDriver {
     overridden_pass_options_list_ = s;
   }
 
+  /**
+   * @brief Describes the settings that change the code the passes generate.
+   * @return the names of the disabled passes followed by the overridden pass options.
+   */
+  static std::string GetSettingsKey() {
+    std::string key = "disabled=";
+    for (uint16_t i = 0; i < PassDriver<PassDriverType>::g_passes_size; ++i) {
+      const Pass* pass = PassDriver<PassDriverType>::g_passes[i];
+      const std::vector<const Pass*>& default_passes = PassDriverType::g_default_pass_list;
+      if (std::find(default_passes.begin(), default_passes.end(), pass) == default_passes.end()) {
+        key += pass->GetName();
+        key += ',';
+      }
+    }
+    key += " options=";
+    key += overridden_pass_options_list_;
+    return key;
+  }
+
   void SetDefaultPasses() {
     pass_list_ = PassDriver<PassDriverType>::g_default_pass_list;
   }
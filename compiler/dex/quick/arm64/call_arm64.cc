@@ -150,11 +150,12 @@ void Arm64Mir2Lir::GenLargePackedSwitch(MIR* mir, uint32_t table_offset, RegLoca
 
 /*
  * Handle unlocked -> thin locked transition inline or else call out to quick entrypoint. For more
- * details see monitor.cc.
+ * details see monitor.cc. The lock word stored is the thread's acquire word, which may bias the
+ * lock towards the thread; the entrypoint handles re-locking a biased lock without ldrex/strex.
  */
 void Arm64Mir2Lir::GenMonitorEnter(int opt_flags, RegLocation rl_src) {
   // x0/w0 = object
-  // w1    = thin lock thread id
+  // w1    = thin lock acquire word
   // x2    = address of lock word
   // w3    = lock word / store failure
   // TUNING: How much performance we get when we inline this?
@@ -171,7 +172,7 @@ void Arm64Mir2Lir::GenMonitorEnter(int opt_flags, RegLocation rl_src) {
       null_check_branch = OpCmpImmBranch(kCondEq, rs_x0, 0, NULL);
     }
   }
-  Load32Disp(rs_xSELF, Thread::ThinLockIdOffset<8>().Int32Value(), rs_w1);
+  Load32Disp(rs_xSELF, Thread::ThinLockAcquireWordOffset<8>().Int32Value(), rs_w1);
   OpRegRegImm(kOpAdd, rs_x2, rs_x0, mirror::Object::MonitorOffset().Int32Value());
   NewLIR2(kA64Ldxr2rX, rw3, rx2);
   MarkPossibleNullPointerException(opt_flags);
@@ -34,7 +34,9 @@ VerificationResults::VerificationResults(const CompilerOptions* compiler_options
       verified_methods_lock_("compiler verified methods lock"),
       verified_methods_(),
       rejected_classes_lock_("compiler rejected classes lock"),
-      rejected_classes_() {
+      rejected_classes_(),
+      class_deps_lock_("compiler class dependencies lock"),
+      class_deps_() {
   UNUSED(compiler_options);
 }
 
@@ -48,6 +50,7 @@ VerificationResults::~VerificationResults() {
 
 bool VerificationResults::ProcessVerifiedMethod(verifier::MethodVerifier* method_verifier) {
   DCHECK(method_verifier != NULL);
+  RecordClassDependencies(method_verifier);
   MethodReference ref = method_verifier->GetMethodReference();
   bool compile = IsCandidateForCompilation(ref, method_verifier->GetAccessFlags());
   // TODO: Check also for virtual/interface invokes when DEX-to-DEX supports devirtualization.
@@ -106,6 +109,42 @@ bool VerificationResults::IsClassRejected(ClassReference ref) {
   return (rejected_classes_.find(ref) != rejected_classes_.end());
 }
 
+void VerificationResults::RecordClassDependencies(verifier::MethodVerifier* method_verifier) {
+  verifier::VerifierDeps::ClassDeps method_deps;
+  verifier::VerifierDeps::RecordMethodDependencies(method_verifier, &method_deps);
+  const DexFile* dex_file = method_verifier->GetMethodReference().dex_file;
+  const uint16_t class_def_index = method_verifier->GetClassDefIndex();
+  MutexLock mu(Thread::Current(), class_deps_lock_);
+  auto dex_it = class_deps_.lower_bound(dex_file);
+  if (dex_it == class_deps_.end() || dex_it->first != dex_file) {
+    dex_it = class_deps_.PutBefore(dex_it, dex_file, verifier::VerifierDeps::DexFileDeps());
+  }
+  verifier::VerifierDeps::DexFileDeps& dex_file_deps = dex_it->second;
+  auto class_it = dex_file_deps.lower_bound(class_def_index);
+  if (class_it == dex_file_deps.end() || class_it->first != class_def_index) {
+    dex_file_deps.PutBefore(class_it, class_def_index, method_deps);
+    return;
+  }
+  verifier::VerifierDeps::ClassDeps& class_deps = class_it->second;
+  class_deps.has_soft_failures |= method_deps.has_soft_failures;
+  class_deps.is_recordable &= method_deps.is_recordable;
+  if (class_deps.is_recordable) {
+    class_deps.unresolved_types.insert(method_deps.unresolved_types.begin(),
+                                       method_deps.unresolved_types.end());
+    class_deps.resolved_types.insert(method_deps.resolved_types.begin(),
+                                     method_deps.resolved_types.end());
+  }
+}
+
+void VerificationResults::GetClassDependencies(const DexFile* dex_file,
+                                               verifier::VerifierDeps::DexFileDeps* deps) {
+  MutexLock mu(Thread::Current(), class_deps_lock_);
+  auto it = class_deps_.find(dex_file);
+  if (it != class_deps_.end()) {
+    *deps = it->second;
+  }
+}
+
 bool VerificationResults::IsCandidateForCompilation(MethodReference& method_ref,
                                                     const uint32_t access_flags) {
 #ifdef ART_SEA_IR_MODE
@@ -26,6 +26,7 @@
 #include "class_reference.h"
 #include "method_reference.h"
 #include "safe_map.h"
+#include "verifier/verifier_deps.h"
 
 namespace art {
 
@@ -56,6 +57,11 @@ class VerificationResults {
     bool IsCandidateForCompilation(MethodReference& method_ref,
                                    const uint32_t access_flags);
 
+    // Returns the class resolution assumptions made while verifying the classes of dex_file.
+    void GetClassDependencies(const DexFile* dex_file,
+                              verifier::VerifierDeps::DexFileDeps* deps)
+        LOCKS_EXCLUDED(class_deps_lock_);
+
   private:
     const CompilerOptions* const compiler_options_;
 
@@ -68,6 +74,15 @@ class VerificationResults {
     // Rejected classes.
     ReaderWriterMutex rejected_classes_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
     std::set<ClassReference> rejected_classes_ GUARDED_BY(rejected_classes_lock_);
+
+    void RecordClassDependencies(verifier::MethodVerifier* method_verifier)
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+        LOCKS_EXCLUDED(class_deps_lock_);
+
+    // Class resolution assumptions of the verified classes, by dex file.
+    Mutex class_deps_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+    SafeMap<const DexFile*, verifier::VerifierDeps::DexFileDeps> class_deps_
+        GUARDED_BY(class_deps_lock_);
 };
 
 }  // namespace art
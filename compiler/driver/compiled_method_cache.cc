@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compiled_method_cache.h"
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <memory>
+
+#include "arch/instruction_set_features.h"
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "class_linker.h"
+#include "compiled_method.h"
+#include "compiler_driver.h"
+#include "dex_file-inl.h"
+#include "dex_file_dependencies.h"
+#include "driver/compiler_options.h"
+#include "elf_file.h"
+#include "gc/heap.h"
+#include "gc/space/image_space.h"
+#include "image.h"
+#include "leb128.h"
+#include "oat.h"
+#include "os.h"
+#include "runtime.h"
+#include "utils.h"
+
+namespace art {
+
+static constexpr uint8_t kEntryMagic[] = { 'c', 'm', 'c', '\n' };
+
+// The kinds of CompiledMethod that can be stored, differing in the tables they have.
+enum EntryKind : uint32_t {
+  kEntryQuick,       // Quick code and JNI stubs, with a native GC map.
+  kEntryOptimizing,  // Optimizing code, with stack maps in place of the vmap table.
+};
+
+// Returns the size of the code item including its tries and catch handlers.
+static size_t CodeItemSize(const DexFile::CodeItem& code_item) {
+  const uint8_t* start = reinterpret_cast<const uint8_t*>(&code_item);
+  if (code_item.tries_size_ == 0) {
+    return reinterpret_cast<const uint8_t*>(code_item.insns_ + code_item.insns_size_in_code_units_) -
+        start;
+  }
+  const uint8_t* ptr = DexFile::GetCatchHandlerData(code_item, 0);
+  for (uint32_t i = 0, num_lists = DecodeUnsignedLeb128(&ptr); i != num_lists; ++i) {
+    int32_t num_handlers = DecodeSignedLeb128(&ptr);
+    for (int32_t j = 0, end = std::abs(num_handlers); j != end; ++j) {
+      DecodeUnsignedLeb128(&ptr);  // Type index.
+      DecodeUnsignedLeb128(&ptr);  // Handler address.
+    }
+    if (num_handlers <= 0) {
+      DecodeUnsignedLeb128(&ptr);  // Catch-all handler address.
+    }
+  }
+  return ptr - start;
+}
+
+// 64-bit FNV-1a, collisions are caught by comparing the stored key.
+static constexpr uint64_t kFnvOffsetBasis = UINT64_C(14695981039346656037);
+
+static uint64_t HashBytes(uint64_t hash, const uint8_t* data, size_t size) {
+  for (size_t i = 0; i != size; ++i) {
+    hash = (hash ^ data[i]) * UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+// The note type of the build-id, NT_GNU_BUILD_ID.
+static constexpr uint32_t kGnuBuildIdNoteType = 3u;
+
+// Appends the GNU build-id note of the ELF binary at `path` to `build_id` in hex.
+static bool AppendBuildId(const char* path, std::string* build_id, std::string* error_msg) {
+  std::unique_ptr<File> file(OS::OpenFileForReading(path));
+  if (file.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to open '%s'", path);
+    return false;
+  }
+  std::unique_ptr<ElfFile> elf_file(ElfFile::Open(file.get(), false, false, error_msg));
+  if (elf_file.get() == nullptr) {
+    return false;
+  }
+  uint64_t offset;
+  uint64_t size;
+  if (!elf_file->GetSectionOffsetAndSize(".note.gnu.build-id", &offset, &size) ||
+      offset > elf_file->Size() || size > elf_file->Size() - offset) {
+    *error_msg = StringPrintf("'%s' has no build-id note", path);
+    return false;
+  }
+  // The note header is three 32-bit words for both ELF classes: the name size, the descriptor
+  // size and the type, followed by the "GNU" name and the build-id, each padded to 4 bytes.
+  const uint8_t* note = elf_file->Begin() + offset;
+  uint32_t header[3];
+  if (size < sizeof(header)) {
+    *error_msg = StringPrintf("Truncated build-id note in '%s'", path);
+    return false;
+  }
+  memcpy(header, note, sizeof(header));
+  const uint64_t desc_offset = sizeof(header) + RoundUp(header[0], 4u);
+  if (header[2] != kGnuBuildIdNoteType || header[1] == 0u || desc_offset + header[1] > size) {
+    *error_msg = StringPrintf("Invalid build-id note in '%s'", path);
+    return false;
+  }
+  for (uint32_t i = 0; i != header[1]; ++i) {
+    StringAppendF(build_id, "%02x", note[desc_offset + i]);
+  }
+  return true;
+}
+
+// Identifies the builds of the compiler and of the runtime it runs on, so that entries written by
+// a compiler built from different sources aren't used even if the options and oat version match.
+// The build-id notes are computed by the linker from the contents of the binaries.
+static bool GetCompilerBuildId(std::string* build_id, std::string* error_msg) {
+  const void* compiler_address = reinterpret_cast<const void*>(&GetCompilerBuildId);
+  const void* runtime_address = reinterpret_cast<const void*>(&Runtime::Abort);
+  Dl_info compiler_info;
+  Dl_info runtime_info;
+  if (dladdr(compiler_address, &compiler_info) == 0 || compiler_info.dli_fname == nullptr ||
+      dladdr(runtime_address, &runtime_info) == 0 || runtime_info.dli_fname == nullptr) {
+    *error_msg = "Failed to find the binaries holding the compiler and the runtime";
+    return false;
+  }
+  build_id->clear();
+  if (!AppendBuildId(compiler_info.dli_fname, build_id, error_msg)) {
+    return false;
+  }
+  // Statically linked compilers hold the runtime in the same binary.
+  if (runtime_info.dli_fbase != compiler_info.dli_fbase) {
+    build_id->push_back(',');
+    if (!AppendBuildId(runtime_info.dli_fname, build_id, error_msg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void Append32(std::vector<uint8_t>* data, uint32_t value) {
+  for (size_t i = 0; i != sizeof(value); ++i) {
+    data->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+template <typename Vector>
+static void AppendBlob(std::vector<uint8_t>* data, const Vector& blob) {
+  Append32(data, blob.size());
+  data->insert(data->end(), blob.begin(), blob.end());
+}
+
+// Reads the data written by Append32 and AppendBlob, failing once past the end.
+class EntryReader {
+ public:
+  EntryReader(const uint8_t* begin, const uint8_t* end) : ptr_(begin), end_(end) {}
+
+  bool Read32(uint32_t* value) {
+    if (static_cast<size_t>(end_ - ptr_) < sizeof(*value)) {
+      return false;
+    }
+    *value = 0u;
+    for (size_t i = 0; i != sizeof(*value); ++i) {
+      *value |= static_cast<uint32_t>(*ptr_++) << (8 * i);
+    }
+    return true;
+  }
+
+  bool ReadBlob(std::vector<uint8_t>* blob) {
+    uint32_t size;
+    if (!Read32(&size) || static_cast<size_t>(end_ - ptr_) < size) {
+      return false;
+    }
+    blob->assign(ptr_, ptr_ + size);
+    ptr_ += size;
+    return true;
+  }
+
+  bool AtEnd() const {
+    return ptr_ == end_;
+  }
+
+ private:
+  const uint8_t* ptr_;
+  const uint8_t* const end_;
+};
+
+CompiledMethodCache* CompiledMethodCache::Create(const std::string& directory,
+                                                 const CompilerDriver& driver,
+                                                 std::string* error_msg) {
+  if (driver.GetCompilerKind() == Compiler::kPortable) {
+    *error_msg = "Caching compiled methods is not supported with the portable compiler";
+    return nullptr;
+  }
+  if (driver.IsImage()) {
+    // Boot image code is linked with patches against the image being written.
+    *error_msg = "Caching compiled methods is not supported when compiling an image";
+    return nullptr;
+  }
+  struct stat st;
+  if (stat(directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    *error_msg = StringPrintf("'%s' is not a directory", directory.c_str());
+    return nullptr;
+  }
+  std::string build_id;
+  if (!GetCompilerBuildId(&build_id, error_msg)) {
+    return nullptr;
+  }
+  // Non-PIC code embeds pointers into the boot image, and all code depends on its classes.
+  // Without an image, the code depends on the classes of the boot class path dex files.
+  std::string boot_key;
+  gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+  if (image_space != nullptr) {
+    const ImageHeader& image_header = image_space->GetImageHeader();
+    boot_key = StringPrintf("image=%08x,%08x,%d",
+                            image_header.GetOatChecksum(),
+                            static_cast<uint32_t>(
+                                reinterpret_cast<uintptr_t>(image_header.GetOatDataBegin())),
+                            static_cast<int>(image_header.GetPatchDelta()));
+  } else {
+    boot_key = "boot=";
+    for (const DexFile* dex_file : Runtime::Current()->GetClassLinker()->GetBootClassPath()) {
+      const DexFile::Header& header = dex_file->GetHeader();
+      boot_key.append(reinterpret_cast<const char*>(header.signature_), sizeof(header.signature_));
+    }
+  }
+  std::string options_key = StringPrintf(
+      "%s %s %s %s %d %s ",
+      reinterpret_cast<const char*>(OatHeader::kOatVersion),
+      build_id.c_str(),
+      GetInstructionSetString(driver.GetInstructionSet()),
+      driver.GetInstructionSetFeatures()->GetFeatureString().c_str(),
+      kIsDebugBuild,
+      driver.GetCompilerOptionsKey().c_str()) + boot_key;
+  return new CompiledMethodCache(directory, options_key);
+}
+
+CompiledMethodCache::CompiledMethodCache(const std::string& directory,
+                                         const std::string& options_key)
+    : directory_(directory),
+      options_key_(options_key),
+      num_hits_(0u),
+      num_misses_(0u),
+      num_stored_(0u) {
+}
+
+CompiledMethodCache::~CompiledMethodCache() {
+}
+
+void CompiledMethodCache::SelectDexFiles(const std::vector<const DexFile*>& dex_files,
+                                         const std::vector<const DexFile*>& class_path) {
+  std::vector<const DexFile*> all_dex_files(class_path);
+  for (const DexFile* dex_file : dex_files) {
+    if (std::find(all_dex_files.begin(), all_dex_files.end(), dex_file) == all_dex_files.end()) {
+      all_dex_files.push_back(dex_file);
+    }
+  }
+  const std::vector<std::vector<size_t>> dependencies = FindDexFileDependencies(all_dex_files);
+
+  dex_file_keys_.clear();
+  for (const DexFile* dex_file : dex_files) {
+    size_t index = std::find(all_dex_files.begin(), all_dex_files.end(), dex_file) -
+        all_dex_files.begin();
+    // Collect the transitive dependencies, starting with the dex file itself.
+    std::vector<bool> visited(all_dex_files.size(), false);
+    std::vector<size_t> work_list(1u, index);
+    visited[index] = true;
+    std::vector<std::string> signatures;
+    while (!work_list.empty()) {
+      size_t current = work_list.back();
+      work_list.pop_back();
+      const DexFile::Header& header = all_dex_files[current]->GetHeader();
+      signatures.emplace_back(reinterpret_cast<const char*>(header.signature_),
+                              sizeof(header.signature_));
+      for (size_t dependency : dependencies[current]) {
+        if (!visited[dependency]) {
+          visited[dependency] = true;
+          work_list.push_back(dependency);
+        }
+      }
+    }
+    // The dex file's own signature first, then its dependencies in an order independent of the
+    // class path.
+    std::sort(signatures.begin() + 1, signatures.end());
+    std::string key = options_key_;
+    for (const std::string& signature : signatures) {
+      key += signature;
+    }
+    dex_file_keys_.Put(dex_file, key);
+  }
+}
+
+bool CompiledMethodCache::MakeKey(const DexFile& dex_file, const DexFile::CodeItem* code_item,
+                                  uint32_t method_idx, uint32_t access_flags,
+                                  std::vector<uint8_t>* key) const {
+  auto it = dex_file_keys_.find(&dex_file);
+  if (it == dex_file_keys_.end()) {
+    return false;
+  }
+  key->assign(it->second.begin(), it->second.end());
+  Append32(key, method_idx);
+  Append32(key, access_flags);
+  if (code_item != nullptr) {
+    const uint8_t* code_item_data = reinterpret_cast<const uint8_t*>(code_item);
+    key->insert(key->end(), code_item_data, code_item_data + CodeItemSize(*code_item));
+  }
+  return true;
+}
+
+std::string CompiledMethodCache::GetEntryPath(const std::vector<uint8_t>& key) const {
+  uint64_t hash = HashBytes(kFnvOffsetBasis, key.data(), key.size());
+  return StringPrintf("%s/%016" PRIx64 ".cmc", directory_.c_str(), hash);
+}
+
+CompiledMethod* CompiledMethodCache::Lookup(CompilerDriver* driver, const DexFile& dex_file,
+                                            const DexFile::CodeItem* code_item,
+                                            uint32_t method_idx, uint32_t access_flags) const {
+  std::vector<uint8_t> key;
+  if (!MakeKey(dex_file, code_item, method_idx, access_flags, &key)) {
+    return nullptr;
+  }
+  const std::string path = GetEntryPath(key);
+  std::unique_ptr<File> file(OS::OpenFileForReading(path.c_str()));
+  std::vector<uint8_t> data;
+  if (file.get() != nullptr) {
+    int64_t length = file->GetLength();
+    if (length > 0) {
+      data.resize(length);
+      if (!file->ReadFully(&data[0], data.size())) {
+        data.clear();
+      }
+    }
+  }
+  if (data.size() < sizeof(kEntryMagic) ||
+      memcmp(&data[0], kEntryMagic, sizeof(kEntryMagic)) != 0) {
+    num_misses_.FetchAndAddSequentiallyConsistent(1u);
+    return nullptr;
+  }
+
+  EntryReader reader(&data[0] + sizeof(kEntryMagic), &data[0] + data.size());
+  std::vector<uint8_t> stored_key;
+  uint32_t kind;
+  std::vector<uint8_t> quick_code;
+  uint32_t frame_size_in_bytes;
+  uint32_t core_spill_mask;
+  uint32_t fp_spill_mask;
+  std::vector<uint8_t> mapping_table;
+  std::vector<uint8_t> vmap_table;
+  bool ok = reader.ReadBlob(&stored_key) && stored_key == key &&
+      reader.Read32(&kind) && (kind == kEntryQuick || kind == kEntryOptimizing) &&
+      reader.ReadBlob(&quick_code) &&
+      reader.Read32(&frame_size_in_bytes) &&
+      reader.Read32(&core_spill_mask) &&
+      reader.Read32(&fp_spill_mask) &&
+      reader.ReadBlob(&mapping_table) &&
+      reader.ReadBlob(&vmap_table);
+  CompiledMethod* compiled_method = nullptr;
+  if (ok && kind == kEntryOptimizing && reader.AtEnd()) {
+    compiled_method = new CompiledMethod(driver, driver->GetInstructionSet(), quick_code,
+                                         frame_size_in_bytes, core_spill_mask, fp_spill_mask,
+                                         mapping_table, vmap_table);
+  } else if (ok && kind == kEntryQuick) {
+    uint32_t src_map_size;
+    ok = reader.Read32(&src_map_size);
+    SrcMap src_mapping_table;
+    for (uint32_t i = 0; ok && i != src_map_size; ++i) {
+      uint32_t from;
+      uint32_t to;
+      ok = reader.Read32(&from) && reader.Read32(&to);
+      src_mapping_table.push_back(SrcMapElem({from, static_cast<int32_t>(to)}));
+    }
+    std::vector<uint8_t> gc_map;
+    uint32_t has_cfi_info;
+    std::vector<uint8_t> cfi_info;
+    ok = ok && reader.ReadBlob(&gc_map) && reader.Read32(&has_cfi_info) &&
+        reader.ReadBlob(&cfi_info) && reader.AtEnd();
+    if (ok) {
+      compiled_method = new CompiledMethod(driver, driver->GetInstructionSet(), quick_code,
+                                           frame_size_in_bytes, core_spill_mask, fp_spill_mask,
+                                           &src_mapping_table, mapping_table, vmap_table, gc_map,
+                                           (has_cfi_info != 0u) ? &cfi_info : nullptr);
+    }
+  }
+  if (compiled_method == nullptr) {
+    LOG(WARNING) << "Ignoring malformed or colliding compiled method cache entry " << path;
+    num_misses_.FetchAndAddSequentiallyConsistent(1u);
+    return nullptr;
+  }
+  num_hits_.FetchAndAddSequentiallyConsistent(1u);
+  return compiled_method;
+}
+
+void CompiledMethodCache::Store(const DexFile& dex_file, const DexFile::CodeItem* code_item,
+                                uint32_t method_idx, uint32_t access_flags,
+                                const CompiledMethod& compiled_method) const {
+  if (!compiled_method.GetPatches().empty()) {
+    // Patch targets refer to DexFile objects of this compilation.
+    return;
+  }
+  std::vector<uint8_t> key;
+  if (!MakeKey(dex_file, code_item, method_idx, access_flags, &key)) {
+    return;
+  }
+  std::vector<uint8_t> data(kEntryMagic, kEntryMagic + sizeof(kEntryMagic));
+  AppendBlob(&data, key);
+  const SwapVector<uint8_t>* gc_map = compiled_method.GetGcMap();
+  Append32(&data, (gc_map != nullptr) ? kEntryQuick : kEntryOptimizing);
+  AppendBlob(&data, *compiled_method.GetQuickCode());
+  Append32(&data, compiled_method.GetFrameSizeInBytes());
+  Append32(&data, compiled_method.GetCoreSpillMask());
+  Append32(&data, compiled_method.GetFpSpillMask());
+  AppendBlob(&data, compiled_method.GetMappingTable());
+  AppendBlob(&data, compiled_method.GetVmapTable());
+  if (gc_map != nullptr) {
+    const SrcMap& src_mapping_table = compiled_method.GetSrcMappingTable();
+    Append32(&data, src_mapping_table.size());
+    for (const SrcMapElem& elem : src_mapping_table) {
+      Append32(&data, elem.from_);
+      Append32(&data, static_cast<uint32_t>(elem.to_));
+    }
+    AppendBlob(&data, *gc_map);
+    const SwapVector<uint8_t>* cfi_info = compiled_method.GetCFIInfo();
+    Append32(&data, (cfi_info != nullptr) ? 1u : 0u);
+    if (cfi_info != nullptr) {
+      AppendBlob(&data, *cfi_info);
+    } else {
+      AppendBlob(&data, std::vector<uint8_t>());
+    }
+  }
+
+  // Write to a file private to this thread and rename it into place, so that readers never see
+  // a partial entry.
+  const std::string path = GetEntryPath(key);
+  const std::string temp_path = StringPrintf("%s.%d.%d.tmp", path.c_str(), getpid(), GetTid());
+  std::unique_ptr<File> file(OS::CreateEmptyFile(temp_path.c_str()));
+  if (file.get() == nullptr) {
+    PLOG(WARNING) << "Failed to create compiled method cache entry " << temp_path;
+    return;
+  }
+  if (!file->WriteFully(&data[0], data.size())) {
+    PLOG(WARNING) << "Failed to write compiled method cache entry " << temp_path;
+    file->Erase();
+    unlink(temp_path.c_str());
+    return;
+  }
+  if (file->FlushCloseOrErase() != 0) {
+    PLOG(WARNING) << "Failed to flush compiled method cache entry " << temp_path;
+    unlink(temp_path.c_str());
+    return;
+  }
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    PLOG(WARNING) << "Failed to rename compiled method cache entry to " << path;
+    unlink(temp_path.c_str());
+    return;
+  }
+  num_stored_.FetchAndAddSequentiallyConsistent(1u);
+}
+
+}  // namespace art
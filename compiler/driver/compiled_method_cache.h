@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_COMPILED_METHOD_CACHE_H_
+#define ART_COMPILER_DRIVER_COMPILED_METHOD_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "dex_file.h"
+#include "safe_map.h"
+
+namespace art {
+
+class CompiledMethod;
+class CompilerDriver;
+
+// An on-disk cache of compiled methods shared between compilations, such as the builds of a
+// build farm. Each method is stored in its own file named after the hash of its key, which is
+// also stored in the file and compared on lookup.
+//
+// The key holds the code item and access flags of the method, a hash of the compiler binary, the
+// target and compiler options, the boot image or boot class path, and the signatures of the
+// method's dex file and of the dex files it depends on, directly or through those dex files.
+// Compiled code refers to the method's dex file by index and depends on the classes of its
+// dependencies, so the same code item in a different dex file does not share an entry.
+//
+// Entries are written to a temporary file that is renamed into place, so several compilations
+// can share a cache directory.
+class CompiledMethodCache {
+ public:
+  // Opens the cache in directory for use by driver. Returns nullptr and sets error_msg if the
+  // directory doesn't exist or the compilation cannot use a cache.
+  static CompiledMethodCache* Create(const std::string& directory, const CompilerDriver& driver,
+                                     std::string* error_msg);
+
+  ~CompiledMethodCache();
+
+  // Computes the part of the keys shared by the methods of each of dex_files, given the
+  // class_path their types are resolved against. Must be called before compilation starts.
+  void SelectDexFiles(const std::vector<const DexFile*>& dex_files,
+                      const std::vector<const DexFile*>& class_path);
+
+  // Returns the cached CompiledMethod for the given method, or nullptr if it must be compiled.
+  CompiledMethod* Lookup(CompilerDriver* driver, const DexFile& dex_file,
+                         const DexFile::CodeItem* code_item, uint32_t method_idx,
+                         uint32_t access_flags) const;
+
+  // Stores the freshly compiled_method of the given method. Failures are not fatal, the method
+  // is just compiled again next time.
+  void Store(const DexFile& dex_file, const DexFile::CodeItem* code_item, uint32_t method_idx,
+             uint32_t access_flags, const CompiledMethod& compiled_method) const;
+
+  const std::string& GetDirectory() const {
+    return directory_;
+  }
+
+  size_t GetNumHits() const {
+    return num_hits_.LoadRelaxed();
+  }
+
+  size_t GetNumMisses() const {
+    return num_misses_.LoadRelaxed();
+  }
+
+  size_t GetNumStored() const {
+    return num_stored_.LoadRelaxed();
+  }
+
+ private:
+  CompiledMethodCache(const std::string& directory, const std::string& options_key);
+
+  // Returns false if the methods of dex_file are not cached.
+  bool MakeKey(const DexFile& dex_file, const DexFile::CodeItem* code_item, uint32_t method_idx,
+               uint32_t access_flags, std::vector<uint8_t>* key) const;
+
+  std::string GetEntryPath(const std::vector<uint8_t>& key) const;
+
+  const std::string directory_;
+  // The compiler build, instruction set, options and boot image or boot class path the code was
+  // compiled for.
+  const std::string options_key_;
+  // The options key followed by the dex file signatures, for each dex file being compiled.
+  SafeMap<const DexFile*, std::string> dex_file_keys_;
+
+  mutable Atomic<size_t> num_hits_;
+  mutable Atomic<size_t> num_misses_;
+  mutable Atomic<size_t> num_stored_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledMethodCache);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_COMPILED_METHOD_CACHE_H_
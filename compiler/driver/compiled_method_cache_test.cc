@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/compiled_method_cache.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arch/instruction_set_features.h"
+#include "base/unix_file/fd_file.h"
+#include "common_compiler_test.h"
+#include "compiled_method.h"
+#include "dex/pass_driver_me_opts.h"
+#include "dex/verification_results.h"
+#include "dex/quick/dex_file_to_method_inliner_map.h"
+#include "driver/compiler_driver.h"
+#include "driver/compiler_options.h"
+#include "os.h"
+#include "scoped_thread_state_change.h"
+#include "utils.h"
+
+namespace art {
+
+class CompiledMethodCacheTest : public CommonCompilerTest {
+ protected:
+  struct Method {
+    uint32_t method_idx;
+    uint32_t access_flags;
+    const DexFile::CodeItem* code_item;
+  };
+
+  void SetUp() OVERRIDE {
+    CommonCompilerTest::SetUp();
+    cache_dir_ = dalvik_cache_ + "/compiled-method-cache";
+    ASSERT_EQ(0, mkdir(cache_dir_.c_str(), 0700));
+    {
+      ScopedObjectAccess soa(Thread::Current());
+      dex_file_ = OpenTestDexFile("StaticLeafMethods");
+    }
+    for (size_t i = 0; i != dex_file_->NumClassDefs(); ++i) {
+      const uint8_t* class_data = dex_file_->GetClassData(dex_file_->GetClassDef(i));
+      if (class_data == nullptr) {
+        continue;
+      }
+      ClassDataItemIterator it(*dex_file_, class_data);
+      while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+        it.Next();
+      }
+      for (; it.HasNext(); it.Next()) {
+        if (it.GetMethodCodeItem() != nullptr) {
+          methods_.push_back(Method {
+              it.GetMemberIndex(), it.GetMethodAccessFlags(), it.GetMethodCodeItem() });
+        }
+      }
+    }
+    ASSERT_LE(2u, methods_.size());
+    driver_.reset(CreateApplicationDriver(compiler_options_.get()));
+  }
+
+  void TearDown() OVERRIDE {
+    driver_.reset();
+    CommonCompilerTest::TearDown();
+  }
+
+  CompilerDriver* CreateApplicationDriver(const CompilerOptions* compiler_options,
+                                          const std::string& profile_file = "") {
+    return new CompilerDriver(compiler_options, verification_results_.get(),
+                              method_inliner_map_.get(), Compiler::kQuick, kRuntimeISA,
+                              instruction_set_features_.get(), false, nullptr, nullptr, 1, false,
+                              false, timer_.get(), profile_file);
+  }
+
+  // Stores a method with the default driver, then looks it up with `other_driver`.
+  void ExpectMissWith(const CompilerDriver& other_driver) {
+    std::unique_ptr<CompiledMethodCache> cache(CreateCache(*driver_));
+    std::unique_ptr<CompiledMethod> compiled_method(CreateCompiledMethod());
+    Store(*cache, methods_[0], *compiled_method);
+    ASSERT_EQ(1u, cache->GetNumStored());
+
+    std::unique_ptr<CompiledMethodCache> other_cache(CreateCache(other_driver));
+    EXPECT_TRUE(Lookup(*other_cache, methods_[0]) == nullptr);
+    EXPECT_EQ(1u, other_cache->GetNumMisses());
+  }
+
+  CompiledMethodCache* CreateCache(const CompilerDriver& driver) {
+    std::string error_msg;
+    CompiledMethodCache* cache = CompiledMethodCache::Create(cache_dir_, driver, &error_msg);
+    CHECK(cache != nullptr) << error_msg;
+    std::vector<const DexFile*> dex_files(1u, dex_file_);
+    cache->SelectDexFiles(dex_files, dex_files);
+    return cache;
+  }
+
+  CompiledMethod* CreateCompiledMethod(
+      const ArrayRef<LinkerPatch>& patches = ArrayRef<LinkerPatch>()) {
+    SrcMap src_mapping_table;
+    src_mapping_table.push_back(SrcMapElem({2u, 7}));
+    return new CompiledMethod(driver_.get(), kRuntimeISA, quick_code_, 64u, 0x4010u, 0x3u,
+                              &src_mapping_table, mapping_table_, vmap_table_, gc_map_, nullptr,
+                              patches);
+  }
+
+  void Store(const CompiledMethodCache& cache, const Method& method,
+             const CompiledMethod& compiled_method) {
+    cache.Store(*dex_file_, method.code_item, method.method_idx, method.access_flags,
+                compiled_method);
+  }
+
+  CompiledMethod* Lookup(const CompiledMethodCache& cache, const Method& method) {
+    return cache.Lookup(driver_.get(), *dex_file_, method.code_item, method.method_idx,
+                        method.access_flags);
+  }
+
+  // Returns the paths of the entries in the cache directory.
+  std::vector<std::string> GetEntryPaths() {
+    std::vector<std::string> paths;
+    DIR* dir = opendir(cache_dir_.c_str());
+    CHECK(dir != nullptr);
+    while (dirent* e = readdir(dir)) {
+      std::string name(e->d_name);
+      if (EndsWith(name, ".cmc")) {
+        paths.push_back(cache_dir_ + "/" + name);
+      }
+    }
+    closedir(dir);
+    return paths;
+  }
+
+  static std::vector<uint8_t> ToVector(const SwapVector<uint8_t>* data) {
+    return (data != nullptr) ? std::vector<uint8_t>(data->begin(), data->end())
+                             : std::vector<uint8_t>();
+  }
+
+  std::string cache_dir_;
+  const DexFile* dex_file_;
+  std::vector<Method> methods_;
+  std::unique_ptr<CompilerDriver> driver_;
+
+  const std::vector<uint8_t> quick_code_ = { 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0 };
+  const std::vector<uint8_t> mapping_table_ = { 1u, 2u, 3u };
+  const std::vector<uint8_t> vmap_table_ = { 4u, 5u };
+  const std::vector<uint8_t> gc_map_ = { 6u, 7u, 8u, 9u };
+};
+
+TEST_F(CompiledMethodCacheTest, StoreAndLookup) {
+  std::unique_ptr<CompiledMethodCache> cache(CreateCache(*driver_));
+  EXPECT_TRUE(Lookup(*cache, methods_[0]) == nullptr);
+  EXPECT_EQ(1u, cache->GetNumMisses());
+
+  std::unique_ptr<CompiledMethod> compiled_method(CreateCompiledMethod());
+  Store(*cache, methods_[0], *compiled_method);
+  EXPECT_EQ(1u, cache->GetNumStored());
+  EXPECT_EQ(1u, GetEntryPaths().size());
+
+  std::unique_ptr<CompiledMethod> cached(Lookup(*cache, methods_[0]));
+  ASSERT_TRUE(cached.get() != nullptr);
+  EXPECT_EQ(1u, cache->GetNumHits());
+  EXPECT_EQ(quick_code_, ToVector(cached->GetQuickCode()));
+  EXPECT_EQ(64u, cached->GetFrameSizeInBytes());
+  EXPECT_EQ(0x4010u, cached->GetCoreSpillMask());
+  EXPECT_EQ(0x3u, cached->GetFpSpillMask());
+  EXPECT_EQ(mapping_table_, ToVector(&cached->GetMappingTable()));
+  EXPECT_EQ(vmap_table_, ToVector(&cached->GetVmapTable()));
+  EXPECT_EQ(gc_map_, ToVector(cached->GetGcMap()));
+  ASSERT_EQ(1u, cached->GetSrcMappingTable().size());
+  EXPECT_EQ(2u, cached->GetSrcMappingTable()[0].from_);
+  EXPECT_EQ(7, cached->GetSrcMappingTable()[0].to_);
+  EXPECT_TRUE(cached->GetPatches().empty());
+
+  // A cache opened by another compilation with the same options finds the entry.
+  std::unique_ptr<CompiledMethodCache> other_cache(CreateCache(*driver_));
+  std::unique_ptr<CompiledMethod> other_cached(Lookup(*other_cache, methods_[0]));
+  ASSERT_TRUE(other_cached.get() != nullptr);
+  EXPECT_EQ(quick_code_, ToVector(other_cached->GetQuickCode()));
+}
+
+TEST_F(CompiledMethodCacheTest, MethodWithPatchesIsNotStored) {
+  std::unique_ptr<CompiledMethodCache> cache(CreateCache(*driver_));
+  LinkerPatch patches[] = {
+      LinkerPatch::RelativeCodePatch(4u, dex_file_, methods_[1].method_idx) };
+  std::unique_ptr<CompiledMethod> compiled_method(
+      CreateCompiledMethod(ArrayRef<LinkerPatch>(patches)));
+  Store(*cache, methods_[0], *compiled_method);
+  EXPECT_EQ(0u, cache->GetNumStored());
+  EXPECT_TRUE(GetEntryPaths().empty());
+  EXPECT_TRUE(Lookup(*cache, methods_[0]) == nullptr);
+}
+
+TEST_F(CompiledMethodCacheTest, ChangedMethodMisses) {
+  std::unique_ptr<CompiledMethodCache> cache(CreateCache(*driver_));
+  std::unique_ptr<CompiledMethod> compiled_method(CreateCompiledMethod());
+  Store(*cache, methods_[0], *compiled_method);
+  ASSERT_EQ(1u, cache->GetNumStored());
+
+  // The same method index with different code.
+  Method changed_code = methods_[0];
+  changed_code.code_item = methods_[1].code_item;
+  EXPECT_TRUE(Lookup(*cache, changed_code) == nullptr);
+  // The same code with different access flags.
+  Method changed_flags = methods_[0];
+  changed_flags.access_flags ^= kAccFinal;
+  EXPECT_TRUE(Lookup(*cache, changed_flags) == nullptr);
+  EXPECT_EQ(0u, cache->GetNumHits());
+  EXPECT_EQ(2u, cache->GetNumMisses());
+}
+
+TEST_F(CompiledMethodCacheTest, ChangedOptionsMiss) {
+  CompilerOptions other_options;
+  other_options.SetCompilerFilter(
+      (compiler_options_->GetCompilerFilter() != CompilerOptions::kEverything)
+          ? CompilerOptions::kEverything
+          : CompilerOptions::kSpace);
+  std::unique_ptr<CompilerDriver> other_driver(CreateApplicationDriver(&other_options));
+  ExpectMissWith(*other_driver);
+}
+
+TEST_F(CompiledMethodCacheTest, ChangedProfileMisses) {
+  // Each driver uses a profile differing from the one of the previous driver.
+  for (const char* contents : { "10/0/0\nLStaticLeafMethods;.method/10/20\n",
+                                "10/0/0\nLStaticLeafMethods;.method/5/20\n" }) {
+    ScratchFile profile_file;
+    ASSERT_TRUE(profile_file.GetFile()->WriteFully(contents, strlen(contents)));
+    ASSERT_EQ(0, profile_file.GetFile()->Flush());
+    std::unique_ptr<CompilerDriver> other_driver(
+        CreateApplicationDriver(compiler_options_.get(), profile_file.GetFilename()));
+    ASSERT_TRUE(other_driver->ProfilePresent());
+    ExpectMissWith(*other_driver);
+    driver_.reset(other_driver.release());
+  }
+}
+
+TEST_F(CompiledMethodCacheTest, ChangedPassSettingsMiss) {
+  PassDriverMEOpts::SetOverriddenPassOptions("BBOptimizations:PassOption:1");
+  std::unique_ptr<CompilerDriver> other_driver(CreateApplicationDriver(compiler_options_.get()));
+  ExpectMissWith(*other_driver);
+  PassDriverMEOpts::SetOverriddenPassOptions("");
+
+  PassDriverMEOpts::CreateDefaultPassList("BBOptimizations");
+  other_driver.reset(CreateApplicationDriver(compiler_options_.get()));
+  ExpectMissWith(*other_driver);
+  PassDriverMEOpts::CreateDefaultPassList("");
+}
+
+TEST_F(CompiledMethodCacheTest, TruncatedEntryMisses) {
+  std::unique_ptr<CompiledMethodCache> cache(CreateCache(*driver_));
+  std::unique_ptr<CompiledMethod> compiled_method(CreateCompiledMethod());
+  Store(*cache, methods_[0], *compiled_method);
+  std::vector<std::string> paths = GetEntryPaths();
+  ASSERT_EQ(1u, paths.size());
+  struct stat st;
+  ASSERT_EQ(0, stat(paths[0].c_str(), &st));
+  // Drop the last byte, then everything but part of the magic.
+  ASSERT_EQ(0, truncate(paths[0].c_str(), st.st_size - 1));
+  EXPECT_TRUE(Lookup(*cache, methods_[0]) == nullptr);
+  ASSERT_EQ(0, truncate(paths[0].c_str(), 2));
+  EXPECT_TRUE(Lookup(*cache, methods_[0]) == nullptr);
+  EXPECT_EQ(2u, cache->GetNumMisses());
+
+  // Storing the method again replaces the broken entry.
+  Store(*cache, methods_[0], *compiled_method);
+  std::unique_ptr<CompiledMethod> cached(Lookup(*cache, methods_[0]));
+  ASSERT_TRUE(cached.get() != nullptr);
+  EXPECT_EQ(quick_code_, ToVector(cached->GetQuickCode()));
+}
+
+TEST_F(CompiledMethodCacheTest, CorruptEntryMisses) {
+  std::unique_ptr<CompiledMethodCache> cache(CreateCache(*driver_));
+  std::unique_ptr<CompiledMethod> compiled_method(CreateCompiledMethod());
+  Store(*cache, methods_[0], *compiled_method);
+  std::vector<std::string> paths = GetEntryPaths();
+  ASSERT_EQ(1u, paths.size());
+
+  // Flip a byte of the magic, then one of the stored key, then the length of the last table.
+  for (off_t offset : { static_cast<off_t>(0), static_cast<off_t>(8), static_cast<off_t>(-4) }) {
+    Store(*cache, methods_[0], *compiled_method);
+    std::unique_ptr<File> file(OS::OpenFileReadWrite(paths[0].c_str()));
+    ASSERT_TRUE(file.get() != nullptr);
+    if (offset < 0) {
+      offset += file->GetLength();
+    }
+    char byte;
+    ASSERT_EQ(1, file->Read(&byte, 1, offset));
+    byte ^= 0x40;
+    ASSERT_EQ(1, file->Write(&byte, 1, offset));
+    ASSERT_EQ(0, file->FlushCloseOrErase());
+    EXPECT_TRUE(Lookup(*cache, methods_[0]) == nullptr) << offset;
+  }
+  EXPECT_EQ(0u, cache->GetNumHits());
+  EXPECT_EQ(3u, cache->GetNumMisses());
+}
+
+}  // namespace art
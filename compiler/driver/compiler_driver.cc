@@ -26,8 +26,10 @@
 #ifndef __APPLE__
 #include <malloc.h>  // For mallinfo
 #endif
+#include <zlib.h>
 
 #include "base/stl_util.h"
+#include "base/stringprintf.h"
 #include "base/timing_logger.h"
 #include "class_linker.h"
 #include "compiled_class.h"
@@ -37,8 +39,12 @@
 #include "dex_file-inl.h"
 #include "dex/verification_results.h"
 #include "dex/verified_method.h"
+#include "dex/pass_driver_me_opts.h"
 #include "dex/quick/dex_file_method_inliner.h"
 #include "driver/compiler_options.h"
+#include "driver/compiled_method_cache.h"
+#include "driver/method_compile_stats.h"
+#include "driver/reusable_oat_file.h"
 #include "jni_internal.h"
 #include "object_lock.h"
 #include "profiler.h"
@@ -339,10 +345,11 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
                                bool image, std::set<std::string>* image_classes,
                                std::set<std::string>* compiled_classes, size_t thread_count,
                                bool dump_stats, bool dump_passes, CumulativeLogger* timer,
-                               const std::string& profile_file)
-    : profile_present_(false), compiler_options_(compiler_options),
+                               const std::string& profile_file, int swap_fd)
+    : profile_present_(false), profile_checksum_(0u), compiler_options_(compiler_options),
       verification_results_(verification_results),
       method_inliner_map_(method_inliner_map),
+      compiler_kind_(compiler_kind),
       compiler_(Compiler::Create(this, compiler_kind)),
       instruction_set_(instruction_set),
       instruction_set_features_(instruction_set_features),
@@ -351,27 +358,37 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
       compiled_methods_lock_("compiled method lock"),
       compiled_methods_(),
       non_relative_linker_patch_count_(0u),
+      linker_patch_count_(0u),
       image_(image),
       image_classes_(image_classes),
       classes_to_compile_(compiled_classes),
       thread_count_(thread_count),
       stats_(new AOTCompilationStats),
+      methods_to_compile_lock_("methods to compile lock"),
+      slowest_methods_lock_("slowest methods lock"),
+      min_slow_method_ns_(0u),
+      compile_tail_ns_(0u),
+      collect_method_stats_(false),
+      method_stats_lock_("method stats lock"),
       dump_stats_(dump_stats),
       dump_passes_(dump_passes),
       timings_logger_(timer),
       compiler_context_(nullptr),
       support_boot_image_fixup_(instruction_set != kMips),
-      dedupe_code_("dedupe code"),
+      swap_space_(swap_fd == -1 ? nullptr : new SwapSpace(swap_fd, 10 * MB)),
+      swap_space_allocator_(new SwapAllocator<void>(swap_space_.get())),
+      dedupe_code_("dedupe code", *swap_space_allocator_),
       dedupe_src_mapping_table_("dedupe source mapping table"),
-      dedupe_mapping_table_("dedupe mapping table"),
-      dedupe_vmap_table_("dedupe vmap table"),
-      dedupe_gc_map_("dedupe gc map"),
-      dedupe_cfi_info_("dedupe cfi info") {
+      dedupe_mapping_table_("dedupe mapping table", *swap_space_allocator_),
+      dedupe_vmap_table_("dedupe vmap table", *swap_space_allocator_),
+      dedupe_gc_map_("dedupe gc map", *swap_space_allocator_),
+      dedupe_cfi_info_("dedupe cfi info", *swap_space_allocator_) {
   DCHECK(compiler_options_ != nullptr);
   DCHECK(verification_results_ != nullptr);
   DCHECK(method_inliner_map_ != nullptr);
 
   CHECK_PTHREAD_CALL(pthread_key_create, (&tls_key_, nullptr), "compiler tls key");
+  CHECK_PTHREAD_CALL(pthread_key_create, (&method_stats_key_, nullptr), "method stats key");
 
   dex_to_dex_compiler_ = reinterpret_cast<DexToDexCompilerFn>(ArtCompileDEX);
 
@@ -387,6 +404,12 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
   // Read the profile file if one is provided.
   if (!profile_file.empty()) {
     profile_present_ = profile_file_.LoadFile(profile_file);
+    std::string profile_contents;
+    if (profile_present_ && ReadFileToString(profile_file, &profile_contents)) {
+      profile_checksum_ = adler32(adler32(0L, Z_NULL, 0),
+                                  reinterpret_cast<const Bytef*>(profile_contents.data()),
+                                  profile_contents.size());
+    }
     if (profile_present_) {
       LOG(INFO) << "Using profile data form file " << profile_file;
     } else {
@@ -395,7 +418,7 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
   }
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateCode(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateCode(const ArrayRef<const uint8_t>& code) {
   return dedupe_code_.Add(Thread::Current(), code);
 }
 
@@ -403,23 +426,23 @@ SrcMap* CompilerDriver::DeduplicateSrcMappingTable(const SrcMap& src_map) {
   return dedupe_src_mapping_table_.Add(Thread::Current(), src_map);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateMappingTable(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateMappingTable(const ArrayRef<const uint8_t>& code) {
   return dedupe_mapping_table_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateVMapTable(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateVMapTable(const ArrayRef<const uint8_t>& code) {
   return dedupe_vmap_table_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateGCMap(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateGCMap(const ArrayRef<const uint8_t>& code) {
   return dedupe_gc_map_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateCFIInfo(const std::vector<uint8_t>* cfi_info) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateCFIInfo(const std::vector<uint8_t>* cfi_info) {
   if (cfi_info == nullptr) {
     return nullptr;
   }
-  return dedupe_cfi_info_.Add(Thread::Current(), *cfi_info);
+  return dedupe_cfi_info_.Add(Thread::Current(), ArrayRef<const uint8_t>(*cfi_info));
 }
 
 CompilerDriver::~CompilerDriver() {
@@ -433,6 +456,7 @@ CompilerDriver::~CompilerDriver() {
     STLDeleteValues(&compiled_methods_);
   }
   CHECK_PTHREAD_CALL(pthread_key_delete, (tls_key_), "delete tls key");
+  CHECK_PTHREAD_CALL(pthread_key_delete, (method_stats_key_), "delete method stats key");
   compiler_->UnInit();
 }
 
@@ -503,7 +527,30 @@ void CompilerDriver::CompileAll(jobject class_loader,
   std::unique_ptr<ThreadPool> thread_pool(new ThreadPool("Compiler driver thread pool", thread_count_ - 1));
   VLOG(compiler) << "Before precompile " << GetMemoryUsageString();
   PreCompile(class_loader, dex_files, thread_pool.get(), timings);
+  if (reusable_oat_file_.get() != nullptr || compiled_method_cache_.get() != nullptr) {
+    TimingLogger::ScopedTiming t("Select reusable dex files", timings);
+    const std::vector<const DexFile*>& class_path = (class_loader != nullptr)
+        ? Runtime::Current()->GetCompileTimeClassPath(class_loader)
+        : dex_files;
+    if (reusable_oat_file_.get() != nullptr) {
+      reusable_oat_file_->SelectDexFiles(dex_files, class_path);
+    }
+    if (compiled_method_cache_.get() != nullptr) {
+      compiled_method_cache_->SelectDexFiles(dex_files, class_path);
+    }
+  }
   Compile(class_loader, dex_files, thread_pool.get(), timings);
+  if (reusable_oat_file_.get() != nullptr) {
+    VLOG(compiler) << "Reused the code of " << reusable_oat_file_->GetNumReusedMethods()
+                   << " methods in " << reusable_oat_file_->GetNumReusableDexFiles() << "/"
+                   << dex_files.size() << " dex files from " << reusable_oat_file_->GetLocation();
+  }
+  if (compiled_method_cache_.get() != nullptr) {
+    VLOG(compiler) << "Compiled method cache " << compiled_method_cache_->GetDirectory() << ": "
+                   << compiled_method_cache_->GetNumHits() << " hits, "
+                   << compiled_method_cache_->GetNumMisses() << " misses, "
+                   << compiled_method_cache_->GetNumStored() << " stored";
+  }
   if (dump_stats_) {
     stats_->Dump();
   }
@@ -586,15 +633,6 @@ void CompilerDriver::CompileOne(mirror::ArtMethod* method, TimingLogger* timings
   self->TransitionFromSuspendedToRunnable();
 }
 
-void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                             ThreadPool* thread_pool, TimingLogger* timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != nullptr);
-    ResolveDexFile(class_loader, *dex_file, dex_files, thread_pool, timings);
-  }
-}
-
 void CompilerDriver::PreCompile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                                 ThreadPool* thread_pool, TimingLogger* timings) {
   LoadImageClasses(timings);
@@ -917,7 +955,7 @@ void CompilerDriver::UpdateImageClasses(TimingLogger* timings) {
     Runtime* current = Runtime::Current();
 
     // Suspend all threads.
-    current->GetThreadList()->SuspendAll();
+    current->GetThreadList()->SuspendAll("image classes update");
 
     std::string error_msg;
     std::unique_ptr<ClinitImageUpdate> update(ClinitImageUpdate::Create(image_classes_.get(),
@@ -1471,15 +1509,13 @@ class ParallelCompilationManager {
                              jobject class_loader,
                              CompilerDriver* compiler,
                              const DexFile* dex_file,
-                             const std::vector<const DexFile*>& dex_files,
-                             ThreadPool* thread_pool)
+                             const std::vector<const DexFile*>& dex_files)
     : index_(0),
       class_linker_(class_linker),
       class_loader_(class_loader),
       compiler_(compiler),
       dex_file_(dex_file),
-      dex_files_(dex_files),
-      thread_pool_(thread_pool) {}
+      dex_files_(dex_files) {}
 
   ClassLinker* GetClassLinker() const {
     CHECK(class_linker_ != nullptr);
@@ -1504,45 +1540,65 @@ class ParallelCompilationManager {
     return dex_files_;
   }
 
-  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
+  size_t NextIndex() {
+    return index_.FetchAndAddSequentiallyConsistent(1);
+  }
+
+  // Runs callback on work_units threads of the pool for the indices [0, (dex_file->*num_indices)())
+  // of each of dex_files in turn. Workers move on to the next dex file as soon as all indices of
+  // the current one have been handed out instead of waiting for its stragglers, so there is no
+  // barrier between dex files. With a single worker the dex files are processed strictly in order.
+  static void ForAllDexFiles(ClassLinker* class_linker, jobject class_loader,
+                             CompilerDriver* compiler,
+                             const std::vector<const DexFile*>& dex_files,
+                             ThreadPool* thread_pool, uint32_t (DexFile::*num_indices)() const,
+                             Callback callback, size_t work_units) {
     Thread* self = Thread::Current();
     self->AssertNoPendingException();
     CHECK_GT(work_units, 0U);
 
-    index_.StoreRelaxed(begin);
+    std::vector<std::unique_ptr<ParallelCompilationManager>> managers;
+    std::vector<size_t> ends;
+    for (const DexFile* dex_file : dex_files) {
+      CHECK(dex_file != nullptr);
+      managers.emplace_back(new ParallelCompilationManager(class_linker, class_loader, compiler,
+                                                           dex_file, dex_files));
+      ends.push_back((dex_file->*num_indices)());
+    }
     for (size_t i = 0; i < work_units; ++i) {
-      thread_pool_->AddTask(self, new ForAllClosure(this, end, callback));
+      thread_pool->AddTask(self, new ForAllDexFilesClosure(&managers, &ends, callback));
     }
-    thread_pool_->StartWorkers(self);
+    thread_pool->StartWorkers(self);
 
     // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
     // thread destructor's called below perform join).
     CHECK_NE(self->GetState(), kRunnable);
 
     // Wait for all the worker threads to finish.
-    thread_pool_->Wait(self, true, false);
-  }
-
-  size_t NextIndex() {
-    return index_.FetchAndAddSequentiallyConsistent(1);
+    thread_pool->Wait(self, true, false);
   }
 
  private:
-  class ForAllClosure : public Task {
+  class ForAllDexFilesClosure : public Task {
    public:
-    ForAllClosure(ParallelCompilationManager* manager, size_t end, Callback* callback)
-        : manager_(manager),
-          end_(end),
+    ForAllDexFilesClosure(const std::vector<std::unique_ptr<ParallelCompilationManager>>* managers,
+                          const std::vector<size_t>* ends, Callback* callback)
+        : managers_(managers),
+          ends_(ends),
           callback_(callback) {}
 
     virtual void Run(Thread* self) {
-      while (true) {
-        const size_t index = manager_->NextIndex();
-        if (UNLIKELY(index >= end_)) {
-          break;
+      for (size_t i = 0; i != managers_->size(); ++i) {
+        ParallelCompilationManager* manager = (*managers_)[i].get();
+        const size_t end = (*ends_)[i];
+        while (true) {
+          const size_t index = manager->NextIndex();
+          if (UNLIKELY(index >= end)) {
+            break;
+          }
+          callback_(manager, index);
+          self->AssertNoPendingException();
         }
-        callback_(manager_, index);
-        self->AssertNoPendingException();
       }
     }
 
@@ -1551,8 +1607,8 @@ class ParallelCompilationManager {
     }
 
    private:
-    ParallelCompilationManager* const manager_;
-    const size_t end_;
+    const std::vector<std::unique_ptr<ParallelCompilationManager>>* const managers_;
+    const std::vector<size_t>* const ends_;
     Callback* const callback_;
   };
 
@@ -1562,7 +1618,6 @@ class ParallelCompilationManager {
   CompilerDriver* const compiler_;
   const DexFile* const dex_file_;
   const std::vector<const DexFile*>& dex_files_;
-  ThreadPool* const thread_pool_;
 
   DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
 };
@@ -1742,43 +1797,26 @@ static void ResolveType(const ParallelCompilationManager* manager, size_t type_i
   }
 }
 
-void CompilerDriver::ResolveDexFile(jobject class_loader, const DexFile& dex_file,
-                                    const std::vector<const DexFile*>& dex_files,
-                                    ThreadPool* thread_pool, TimingLogger* timings) {
+void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
+                             ThreadPool* thread_pool, TimingLogger* timings) {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
 
   // TODO: we could resolve strings here, although the string table is largely filled with class
   //       and method names.
 
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
   if (IsImage()) {
     // For images we resolve all types, such as array, whereas for applications just those with
     // classdefs are resolved by ResolveClassFieldsAndMethods.
     TimingLogger::ScopedTiming t("Resolve Types", timings);
-    context.ForAll(0, dex_file.NumTypeIds(), ResolveType, thread_count_);
+    ParallelCompilationManager::ForAllDexFiles(class_linker, class_loader, this, dex_files,
+                                               thread_pool, &DexFile::NumTypeIds, ResolveType,
+                                               thread_count_);
   }
 
   TimingLogger::ScopedTiming t("Resolve MethodsAndFields", timings);
-  context.ForAll(0, dex_file.NumClassDefs(), ResolveClassFieldsAndMethods, thread_count_);
-}
-
-void CompilerDriver::SetVerified(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                                 ThreadPool* thread_pool, TimingLogger* timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != nullptr);
-    SetVerifiedDexFile(class_loader, *dex_file, dex_files, thread_pool, timings);
-  }
-}
-
-void CompilerDriver::Verify(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                            ThreadPool* thread_pool, TimingLogger* timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != nullptr);
-    VerifyDexFile(class_loader, *dex_file, dex_files, thread_pool, timings);
-  }
+  ParallelCompilationManager::ForAllDexFiles(class_linker, class_loader, this, dex_files,
+                                             thread_pool, &DexFile::NumClassDefs,
+                                             ResolveClassFieldsAndMethods, thread_count_);
 }
 
 static void VerifyClass(const ParallelCompilationManager* manager, size_t class_def_index)
@@ -1828,14 +1866,13 @@ static void VerifyClass(const ParallelCompilationManager* manager, size_t class_
   soa.Self()->AssertNoPendingException();
 }
 
-void CompilerDriver::VerifyDexFile(jobject class_loader, const DexFile& dex_file,
-                                   const std::vector<const DexFile*>& dex_files,
-                                   ThreadPool* thread_pool, TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Verify Dex File", timings);
+void CompilerDriver::Verify(jobject class_loader, const std::vector<const DexFile*>& dex_files,
+                            ThreadPool* thread_pool, TimingLogger* timings) {
+  TimingLogger::ScopedTiming t("Verify Dex Files", timings);
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), VerifyClass, thread_count_);
+  ParallelCompilationManager::ForAllDexFiles(class_linker, class_loader, this, dex_files,
+                                             thread_pool, &DexFile::NumClassDefs, VerifyClass,
+                                             thread_count_);
 }
 
 static void SetVerifiedClass(const ParallelCompilationManager* manager, size_t class_def_index)
@@ -1872,14 +1909,13 @@ static void SetVerifiedClass(const ParallelCompilationManager* manager, size_t c
   }
 }
 
-void CompilerDriver::SetVerifiedDexFile(jobject class_loader, const DexFile& dex_file,
-                                        const std::vector<const DexFile*>& dex_files,
-                                        ThreadPool* thread_pool, TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Verify Dex File", timings);
+void CompilerDriver::SetVerified(jobject class_loader, const std::vector<const DexFile*>& dex_files,
+                                 ThreadPool* thread_pool, TimingLogger* timings) {
+  TimingLogger::ScopedTiming t("Verify Dex Files", timings);
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), SetVerifiedClass, thread_count_);
+  ParallelCompilationManager::ForAllDexFiles(class_linker, class_loader, this, dex_files,
+                                             thread_pool, &DexFile::NumClassDefs,
+                                             SetVerifiedClass, thread_count_);
 }
 
 static void InitializeClass(const ParallelCompilationManager* manager, size_t class_def_index)
@@ -1974,30 +2010,22 @@ static void InitializeClass(const ParallelCompilationManager* manager, size_t cl
   soa.Self()->ClearException();
 }
 
-void CompilerDriver::InitializeClasses(jobject jni_class_loader, const DexFile& dex_file,
-                                       const std::vector<const DexFile*>& dex_files,
-                                       ThreadPool* thread_pool, TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("InitializeNoClinit", timings);
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, jni_class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
-  size_t thread_count;
-  if (IsImage()) {
-    // TODO: remove this when transactional mode supports multithreading.
-    thread_count = 1U;
-  } else {
-    thread_count = thread_count_;
-  }
-  context.ForAll(0, dex_file.NumClassDefs(), InitializeClass, thread_count);
-}
-
 void CompilerDriver::InitializeClasses(jobject class_loader,
                                        const std::vector<const DexFile*>& dex_files,
                                        ThreadPool* thread_pool, TimingLogger* timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != nullptr);
-    InitializeClasses(class_loader, *dex_file, dex_files, thread_pool, timings);
+  {
+    TimingLogger::ScopedTiming t("InitializeNoClinit", timings);
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    size_t thread_count;
+    if (IsImage()) {
+      // TODO: remove this when transactional mode supports multithreading.
+      thread_count = 1U;
+    } else {
+      thread_count = thread_count_;
+    }
+    ParallelCompilationManager::ForAllDexFiles(class_linker, class_loader, this, dex_files,
+                                               thread_pool, &DexFile::NumClassDefs,
+                                               InitializeClass, thread_count);
   }
   if (IsImage()) {
     // Prune garbage objects created during aborted transactions.
@@ -2007,15 +2035,32 @@ void CompilerDriver::InitializeClasses(jobject class_loader,
 
 void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                              ThreadPool* thread_pool, TimingLogger* timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != nullptr);
-    CompileDexFile(class_loader, *dex_file, dex_files, thread_pool, timings);
+  {
+    TimingLogger::ScopedTiming t("Collect Methods", timings);
+    ParallelCompilationManager::ForAllDexFiles(Runtime::Current()->GetClassLinker(), class_loader,
+                                               this, dex_files, thread_pool,
+                                               &DexFile::NumClassDefs,
+                                               CompilerDriver::CollectClassMethods, thread_count_);
   }
+  {
+    TimingLogger::ScopedTiming t("Compile Methods", timings);
+    CompileMethods(class_loader, thread_pool);
+  }
+  if (VLOG_IS_ON(compiler)) {
+    std::ostringstream latency_oss;
+    DumpCompileTailLatency(latency_oss);
+    VLOG(compiler) << latency_oss.str();
+    std::ostringstream arena_oss;
+    arena_pool_.DumpThreadStats(arena_oss);
+    VLOG(compiler) << "Compile arena usage:\n" << arena_oss.str();
+  }
+  // Hand the memory of the arenas back, it is not needed for writing the oat file.
+  arena_pool_.TrimMaps();
   VLOG(compiler) << "Compile: " << GetMemoryUsageString();
 }
 
-void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t class_def_index) {
+void CompilerDriver::CollectClassMethods(const ParallelCompilationManager* manager,
+                                         size_t class_def_index) {
   ATRACE_CALL();
   const DexFile& dex_file = *manager->GetDexFile();
   const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
@@ -2071,7 +2116,8 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
   bool compilation_enabled = driver->IsClassToCompile(
       dex_file.StringByTypeIdx(class_def.class_idx_));
 
-  // Compile direct methods
+  std::vector<MethodToCompile> methods;
+  // Collect direct methods
   int64_t previous_direct_method_idx = -1;
   while (it.HasNextDirectMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
@@ -2082,13 +2128,13 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
       continue;
     }
     previous_direct_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMethodAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level,
-                          compilation_enabled);
+    methods.push_back(MethodToCompile {
+        &dex_file, it.GetMethodCodeItem(), method_idx, it.GetMethodAccessFlags(),
+        static_cast<uint16_t>(class_def_index), it.GetMethodInvokeType(class_def),
+        dex_to_dex_compilation_level, compilation_enabled });
     it.Next();
   }
-  // Compile virtual methods
+  // Collect virtual methods
   int64_t previous_virtual_method_idx = -1;
   while (it.HasNextVirtualMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
@@ -2099,22 +2145,142 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
       continue;
     }
     previous_virtual_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMethodAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level,
-                          compilation_enabled);
+    methods.push_back(MethodToCompile {
+        &dex_file, it.GetMethodCodeItem(), method_idx, it.GetMethodAccessFlags(),
+        static_cast<uint16_t>(class_def_index), it.GetMethodInvokeType(class_def),
+        dex_to_dex_compilation_level, compilation_enabled });
     it.Next();
   }
   DCHECK(!it.HasNext());
+
+  MutexLock mu(Thread::Current(), driver->methods_to_compile_lock_);
+  driver->methods_to_compile_.insert(driver->methods_to_compile_.end(), methods.begin(),
+                                     methods.end());
+}
+
+class CompilerDriver::CompileMethodsTask : public Task {
+ public:
+  CompileMethodsTask(CompilerDriver* driver, jobject class_loader,
+                     const std::vector<MethodToCompile>* methods, AtomicInteger* next_index,
+                     Atomic<uint64_t>* first_idle_ns)
+      : driver_(driver),
+        class_loader_(class_loader),
+        methods_(methods),
+        next_index_(next_index),
+        first_idle_ns_(first_idle_ns) {}
+
+  virtual void Run(Thread* self) {
+    while (true) {
+      const size_t index = next_index_->FetchAndAddSequentiallyConsistent(1);
+      if (UNLIKELY(index >= methods_->size())) {
+        // Record when the first thread ran out of work, the rest is the tail.
+        first_idle_ns_->CompareExchangeStrongSequentiallyConsistent(0u, NanoTime());
+        break;
+      }
+      const MethodToCompile& method = (*methods_)[index];
+      driver_->CompileMethod(method.code_item, method.access_flags, method.invoke_type,
+                             method.class_def_idx, method.method_idx, class_loader_,
+                             *method.dex_file, method.dex_to_dex_compilation_level,
+                             method.compilation_enabled);
+      self->AssertNoPendingException();
+    }
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  CompilerDriver* const driver_;
+  const jobject class_loader_;
+  const std::vector<MethodToCompile>* const methods_;
+  AtomicInteger* const next_index_;
+  Atomic<uint64_t>* const first_idle_ns_;
+};
+
+static size_t CodeSize(const DexFile::CodeItem* code_item) {
+  return (code_item != nullptr) ? code_item->insns_size_in_code_units_ : 0u;
+}
+
+void CompilerDriver::CompileMethods(jobject class_loader, ThreadPool* thread_pool) {
+  Thread* self = Thread::Current();
+  std::vector<MethodToCompile> methods;
+  {
+    MutexLock mu(self, methods_to_compile_lock_);
+    methods.swap(methods_to_compile_);
+  }
+  // Start with the largest methods, so that a huge method picked up late does not keep one
+  // thread busy long after the others have run out of work. The rest of the order just keeps
+  // the schedule independent of the order in which the classes were collected.
+  std::sort(methods.begin(), methods.end(),
+            [](const MethodToCompile& lhs, const MethodToCompile& rhs) {
+    size_t lhs_size = CodeSize(lhs.code_item);
+    size_t rhs_size = CodeSize(rhs.code_item);
+    if (lhs_size != rhs_size) {
+      return lhs_size > rhs_size;
+    }
+    if (lhs.dex_file != rhs.dex_file) {
+      return lhs.dex_file->GetLocation() < rhs.dex_file->GetLocation();
+    }
+    return lhs.method_idx < rhs.method_idx;
+  });
+
+  AtomicInteger next_index(0);
+  Atomic<uint64_t> first_idle_ns(0u);
+  for (size_t i = 0; i < thread_count_; ++i) {
+    thread_pool->AddTask(self, new CompileMethodsTask(this, class_loader, &methods, &next_index,
+                                                      &first_idle_ns));
+  }
+  thread_pool->StartWorkers(self);
+
+  // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
+  // thread destructor's called below perform join).
+  CHECK_NE(self->GetState(), kRunnable);
+
+  // Wait for all the worker threads to finish.
+  thread_pool->Wait(self, true, false);
+  compile_tail_ns_ = NanoTime() - first_idle_ns.LoadSequentiallyConsistent();
+}
+
+void CompilerDriver::RecordMethodCompileTime(const MethodReference& method_ref,
+                                             uint64_t duration_ns) {
+  if (duration_ns <= min_slow_method_ns_.LoadRelaxed()) {
+    return;
+  }
+  typedef std::pair<uint64_t, MethodReference> Entry;
+  auto greater = [](const Entry& lhs, const Entry& rhs) { return lhs.first > rhs.first; };
+  MutexLock mu(Thread::Current(), slowest_methods_lock_);
+  if (slowest_methods_.size() == kNumSlowestMethods) {
+    if (duration_ns <= slowest_methods_.front().first) {
+      return;
+    }
+    std::pop_heap(slowest_methods_.begin(), slowest_methods_.end(), greater);
+    slowest_methods_.pop_back();
+  }
+  slowest_methods_.push_back(Entry(duration_ns, method_ref));
+  std::push_heap(slowest_methods_.begin(), slowest_methods_.end(), greater);
+  if (slowest_methods_.size() == kNumSlowestMethods) {
+    min_slow_method_ns_.StoreRelaxed(slowest_methods_.front().first);
+  }
 }
 
-void CompilerDriver::CompileDexFile(jobject class_loader, const DexFile& dex_file,
-                                    const std::vector<const DexFile*>& dex_files,
-                                    ThreadPool* thread_pool, TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Compile Dex File", timings);
-  ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
-                                     &dex_file, dex_files, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CompileClass, thread_count_);
+void CompilerDriver::DumpCompileTailLatency(std::ostream& os) const {
+  std::vector<std::pair<uint64_t, MethodReference>> slowest_methods;
+  {
+    MutexLock mu(Thread::Current(), slowest_methods_lock_);
+    slowest_methods = slowest_methods_;
+  }
+  std::sort(slowest_methods.begin(), slowest_methods.end(),
+            [](const std::pair<uint64_t, MethodReference>& lhs,
+               const std::pair<uint64_t, MethodReference>& rhs) {
+    return lhs.first > rhs.first;
+  });
+  os << "Compilation tail with idle threads: " << PrettyDuration(compile_tail_ns_) << "\n";
+  os << "Slowest methods to compile:\n";
+  for (const auto& entry : slowest_methods) {
+    os << "  " << PrettyDuration(entry.first) << " "
+       << PrettyMethod(entry.second.dex_method_index, *entry.second.dex_file) << "\n";
+  }
 }
 
 // Does the runtime for the InstructionSet provide an implementation returned by
@@ -2138,16 +2304,35 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
                                    DexToDexCompilationLevel dex_to_dex_compilation_level,
                                    bool compilation_enabled) {
   CompiledMethod* compiled_method = nullptr;
-  uint64_t start_ns = kTimeCompileMethod ? NanoTime() : 0;
   MethodReference method_ref(&dex_file, method_idx);
+  std::unique_ptr<MethodCompileStats> method_stats;
+  if (collect_method_stats_ && (access_flags & kAccAbstract) == 0) {
+    method_stats.reset(new MethodCompileStats(method_ref));
+    CHECK_PTHREAD_CALL(pthread_setspecific, (method_stats_key_, method_stats.get()),
+                       "method stats");
+  }
+  uint64_t start_ns = (kTimeCompileMethod || method_stats.get() != nullptr) ? NanoTime() : 0;
 
   if ((access_flags & kAccNative) != 0) {
+    // Compile the stub for the same fast or critical native mode the class linker picks.
+    access_flags |= ClassLinker::GetNativeMethodAnnotationFlags(
+        dex_file, dex_file.GetClassDef(class_def_idx), method_idx, access_flags);
     // Are we interpreting only and have support for generic JNI down calls?
     if (!compiler_options_->IsCompilationEnabled() &&
         InstructionSetHasGenericJniStub(instruction_set_)) {
       // Leaving this empty will trigger the generic JNI version
+      if (method_stats.get() != nullptr) {
+        method_stats->backend = "generic-jni";
+      }
     } else {
-      compiled_method = compiler_->JniCompile(access_flags, method_idx, dex_file);
+      compiled_method = ReuseMethod(code_item, class_def_idx, method_idx, access_flags, dex_file);
+      if (compiled_method == nullptr) {
+        if (method_stats.get() != nullptr) {
+          method_stats->backend = "jni";
+        }
+        compiled_method = compiler_->JniCompile(access_flags, method_idx, dex_file);
+        CacheMethod(code_item, method_idx, access_flags, dex_file, compiled_method);
+      }
       CHECK(compiled_method != nullptr);
     }
   } else if ((access_flags & kAccAbstract) != 0) {
@@ -2156,23 +2341,40 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
     bool compile = compilation_enabled &&
                    verification_results_->IsCandidateForCompilation(method_ref, access_flags);
     if (compile) {
+      compiled_method = ReuseMethod(code_item, class_def_idx, method_idx, access_flags, dex_file);
+    } else {
+      RecordFallbackReason(method_stats.get(), "not a compilation candidate");
+    }
+    if (compile && compiled_method == nullptr) {
       // NOTE: if compiler declines to compile this method, it will return nullptr.
       compiled_method = compiler_->Compile(code_item, access_flags, invoke_type, class_def_idx,
                                            method_idx, class_loader, dex_file);
+      CacheMethod(code_item, method_idx, access_flags, dex_file, compiled_method);
     }
     if (compiled_method == nullptr && dex_to_dex_compilation_level != kDontDexToDexCompile) {
+      if (method_stats.get() != nullptr) {
+        method_stats->backend = "dex-to-dex";
+      }
       // TODO: add a command-line option to disable DEX-to-DEX compilation ?
       (*dex_to_dex_compiler_)(*this, code_item, access_flags,
                               invoke_type, class_def_idx,
                               method_idx, class_loader, dex_file,
                               dex_to_dex_compilation_level);
+    } else if (compiled_method == nullptr && method_stats.get() != nullptr) {
+      method_stats->backend = "interpreter";
     }
   }
-  if (kTimeCompileMethod) {
+  if (kTimeCompileMethod || method_stats.get() != nullptr) {
     uint64_t duration_ns = NanoTime() - start_ns;
-    if (duration_ns > MsToNs(compiler_->GetMaximumCompilationTimeBeforeWarning())) {
-      LOG(WARNING) << "Compilation of " << PrettyMethod(method_idx, dex_file)
-                   << " took " << PrettyDuration(duration_ns);
+    if (kTimeCompileMethod) {
+      if (duration_ns > MsToNs(compiler_->GetMaximumCompilationTimeBeforeWarning())) {
+        LOG(WARNING) << "Compilation of " << PrettyMethod(method_idx, dex_file)
+                     << " took " << PrettyDuration(duration_ns);
+      }
+      RecordMethodCompileTime(method_ref, duration_ns);
+    }
+    if (method_stats.get() != nullptr) {
+      method_stats->total_ns = duration_ns;
     }
   }
 
@@ -2194,10 +2396,23 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
       MutexLock mu(self, compiled_methods_lock_);
       compiled_methods_.Put(method_ref, compiled_method);
       non_relative_linker_patch_count_ += non_relative_linker_patch_count;
+      linker_patch_count_ += compiled_method->GetPatches().size();
     }
     DCHECK(GetCompiledMethod(method_ref) != nullptr) << PrettyMethod(method_idx, dex_file);
   }
 
+  if (method_stats.get() != nullptr) {
+    CHECK_PTHREAD_CALL(pthread_setspecific, (method_stats_key_, nullptr), "method stats");
+    if (compiled_method != nullptr) {
+      const SwapVector<uint8_t>* code = compiled_method->GetQuickCode();
+      method_stats->code_bytes = (code != nullptr) ? code->size() : 0u;
+      method_stats->spill_count = POPCOUNT(compiled_method->GetCoreSpillMask()) +
+          POPCOUNT(compiled_method->GetFpSpillMask());
+    }
+    MutexLock mu(self, method_stats_lock_);
+    method_stats_.push_back(std::move(method_stats));
+  }
+
   // Done compiling, delete the verified method to reduce native memory usage.
   verification_results_->RemoveVerifiedMethod(method_ref);
 
@@ -2208,6 +2423,63 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
   }
 }
 
+CompiledMethod* CompilerDriver::ReuseMethod(const DexFile::CodeItem* code_item,
+                                            uint16_t class_def_idx, uint32_t method_idx,
+                                            uint32_t access_flags, const DexFile& dex_file) {
+  CompiledMethod* compiled_method = nullptr;
+  if (reusable_oat_file_.get() != nullptr) {
+    compiled_method = reusable_oat_file_->ReuseMethod(this, dex_file, class_def_idx, method_idx,
+                                                      access_flags);
+  }
+  MethodCompileStats* method_stats = GetMethodStats();
+  if (compiled_method != nullptr && method_stats != nullptr) {
+    method_stats->backend = "reused";
+  }
+  if (compiled_method == nullptr && compiled_method_cache_.get() != nullptr) {
+    compiled_method = compiled_method_cache_->Lookup(this, dex_file, code_item, method_idx,
+                                                     access_flags);
+    if (compiled_method != nullptr && method_stats != nullptr) {
+      method_stats->backend = "cached";
+    }
+  }
+  return compiled_method;
+}
+
+void CompilerDriver::CacheMethod(const DexFile::CodeItem* code_item, uint32_t method_idx,
+                                 uint32_t access_flags, const DexFile& dex_file,
+                                 const CompiledMethod* compiled_method) {
+  if (compiled_method != nullptr && compiled_method_cache_.get() != nullptr) {
+    compiled_method_cache_->Store(dex_file, code_item, method_idx, access_flags, *compiled_method);
+  }
+}
+
+void CompilerDriver::SetReusableOatFile(ReusableOatFile* reusable_oat_file) {
+  reusable_oat_file_.reset(reusable_oat_file);
+}
+
+void CompilerDriver::SetCompiledMethodCache(CompiledMethodCache* compiled_method_cache) {
+  compiled_method_cache_.reset(compiled_method_cache);
+}
+
+void CompilerDriver::EnableMethodStats() {
+  collect_method_stats_ = true;
+}
+
+MethodCompileStats* CompilerDriver::GetMethodStats() const {
+  if (!collect_method_stats_) {
+    return nullptr;
+  }
+  return static_cast<MethodCompileStats*>(pthread_getspecific(method_stats_key_));
+}
+
+void CompilerDriver::DumpMethodStats(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), method_stats_lock_);
+  MethodCompileStats::DumpCsvHeader(os);
+  for (const std::unique_ptr<MethodCompileStats>& method_stats : method_stats_) {
+    method_stats->DumpCsv(os);
+  }
+}
+
 CompiledClass* CompilerDriver::GetCompiledClass(ClassReference ref) const {
   MutexLock mu(Thread::Current(), compiled_classes_lock_);
   ClassTable::const_iterator it = compiled_classes_.find(ref);
@@ -2254,11 +2526,42 @@ CompiledMethod* CompilerDriver::GetCompiledMethod(MethodReference ref) const {
   return it->second;
 }
 
+std::string CompilerDriver::GetCompilerOptionsKey() const {
+  const CompilerOptions& options = GetCompilerOptions();
+  // The profile decides which methods are compiled, and the pass settings change the code of
+  // the Quick compiler.
+  return StringPrintf("kind=%d filter=%d thresholds=%zu,%zu,%zu,%zu,%zu,%f debug=%d,%d patch=%d "
+                      "implicit=%d,%d,%d pic=%d profile=%d,%08x passes=%s",
+                      static_cast<int>(compiler_kind_),
+                      static_cast<int>(options.GetCompilerFilter()),
+                      options.GetHugeMethodThreshold(),
+                      options.GetLargeMethodThreshold(),
+                      options.GetSmallMethodThreshold(),
+                      options.GetTinyMethodThreshold(),
+                      options.GetNumDexMethodsThreshold(),
+                      options.GetTopKProfileThreshold(),
+                      options.GetIncludeDebugSymbols(),
+                      options.GetGenerateGDBInformation(),
+                      options.GetIncludePatchInformation(),
+                      options.GetImplicitNullChecks(),
+                      options.GetImplicitStackOverflowChecks(),
+                      options.GetImplicitSuspendChecks(),
+                      options.GetCompilePic(),
+                      profile_present_,
+                      profile_checksum_,
+                      PassDriverMEOpts::GetSettingsKey().c_str());
+}
+
 size_t CompilerDriver::GetNonRelativeLinkerPatchCount() const {
   MutexLock mu(Thread::Current(), compiled_methods_lock_);
   return non_relative_linker_patch_count_;
 }
 
+size_t CompilerDriver::GetLinkerPatchCount() const {
+  MutexLock mu(Thread::Current(), compiled_methods_lock_);
+  return linker_patch_count_;
+}
+
 void CompilerDriver::AddRequiresConstructorBarrier(Thread* self, const DexFile* dex_file,
                                                    uint16_t class_def_index) {
   WriterMutexLock mu(self, freezing_constructor_lock_);
@@ -39,6 +39,7 @@
 #include "thread_pool.h"
 #include "utils/arena_allocator.h"
 #include "utils/dedupe_set.h"
+#include "utils/swap_space.h"
 #include "dex/verified_method.h"
 
 namespace art {
@@ -55,6 +56,9 @@ struct InlineIGetIPutData;
 class InstructionSetFeatures;
 class OatWriter;
 class ParallelCompilationManager;
+class CompiledMethodCache;
+struct MethodCompileStats;
+class ReusableOatFile;
 class ScopedObjectAccess;
 template<class T> class Handle;
 class TimingLogger;
@@ -95,7 +99,8 @@ class CompilerDriver {
                           bool image, std::set<std::string>* image_classes,
                           std::set<std::string>* compiled_classes,
                           size_t thread_count, bool dump_stats, bool dump_passes,
-                          CumulativeLogger* timer, const std::string& profile_file);
+                          CumulativeLogger* timer, const std::string& profile_file,
+                          int swap_fd = -1);
 
   ~CompilerDriver();
 
@@ -131,6 +136,14 @@ class CompilerDriver {
     return compiler_.get();
   }
 
+  Compiler::Kind GetCompilerKind() const {
+    return compiler_kind_;
+  }
+
+  // Returns a description of the options the generated code depends on. Code compiled by an
+  // earlier compilation is only used if that one had the same.
+  std::string GetCompilerOptionsKey() const;
+
   bool ProfilePresent() const {
     return profile_present_;
   }
@@ -144,6 +157,14 @@ class CompilerDriver {
     return image_classes_.get();
   }
 
+  // Reuse the compiled code of unchanged dex files from a previous compilation. Takes ownership
+  // of reusable_oat_file.
+  void SetReusableOatFile(ReusableOatFile* reusable_oat_file);
+
+  // Look up methods in compiled_method_cache before compiling them and store the ones compiled.
+  // Takes ownership of compiled_method_cache.
+  void SetCompiledMethodCache(CompiledMethodCache* compiled_method_cache);
+
   CompilerTls* GetTls();
 
   // Generate the trampolines that are invoked by unresolved direct methods.
@@ -175,6 +196,8 @@ class CompilerDriver {
       LOCKS_EXCLUDED(compiled_methods_lock_);
   size_t GetNonRelativeLinkerPatchCount() const
       LOCKS_EXCLUDED(compiled_methods_lock_);
+  size_t GetLinkerPatchCount() const
+      LOCKS_EXCLUDED(compiled_methods_lock_);
 
   void AddRequiresConstructorBarrier(Thread* self, const DexFile* dex_file,
                                      uint16_t class_def_index);
@@ -386,15 +409,17 @@ class CompilerDriver {
   void RecordClassStatus(ClassReference ref, mirror::Class::Status status)
       LOCKS_EXCLUDED(compiled_classes_lock_);
 
-  std::vector<uint8_t>* DeduplicateCode(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateCode(const ArrayRef<const uint8_t>& code);
   SrcMap* DeduplicateSrcMappingTable(const SrcMap& src_map);
-  std::vector<uint8_t>* DeduplicateMappingTable(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateVMapTable(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateGCMap(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateCFIInfo(const std::vector<uint8_t>* cfi_info);
+  SwapVector<uint8_t>* DeduplicateMappingTable(const ArrayRef<const uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateVMapTable(const ArrayRef<const uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateGCMap(const ArrayRef<const uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateCFIInfo(const std::vector<uint8_t>* cfi_info);
 
   ProfileFile profile_file_;
   bool profile_present_;
+  // Checksum of the contents of the profile file, part of the compiler options key.
+  uint32_t profile_checksum_;
 
   // Should the compiler run on this method given profile information?
   bool SkipCompilation(const std::string& method_name);
@@ -402,6 +427,20 @@ class CompilerDriver {
   // Get memory usage during compilation.
   std::string GetMemoryUsageString() const;
 
+  // Dumps the slowest methods to compile and how long the compilation phase ran with idle
+  // threads waiting for the last methods to finish.
+  void DumpCompileTailLatency(std::ostream& os) const LOCKS_EXCLUDED(slowest_methods_lock_);
+
+  // Collect the statistics of every method compiled, for DumpMethodStats.
+  void EnableMethodStats();
+
+  // Returns the statistics of the method being compiled by the calling thread, or nullptr if they
+  // are not being collected.
+  MethodCompileStats* GetMethodStats() const;
+
+  // Writes the statistics of the methods compiled as CSV, one row per method.
+  void DumpMethodStats(std::ostream& os) const LOCKS_EXCLUDED(method_stats_lock_);
+
  private:
   // These flags are internal to CompilerDriver for collecting INVOKE resolution statistics.
   // The only external contract is that unresolved method has flags 0 and resolved non-0.
@@ -447,31 +486,17 @@ class CompilerDriver {
   void Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                ThreadPool* thread_pool, TimingLogger* timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
-  void ResolveDexFile(jobject class_loader, const DexFile& dex_file,
-                      const std::vector<const DexFile*>& dex_files,
-                      ThreadPool* thread_pool, TimingLogger* timings)
-      LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   void Verify(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-              ThreadPool* thread_pool, TimingLogger* timings);
-  void VerifyDexFile(jobject class_loader, const DexFile& dex_file,
-                     const std::vector<const DexFile*>& dex_files,
-                     ThreadPool* thread_pool, TimingLogger* timings)
+              ThreadPool* thread_pool, TimingLogger* timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   void SetVerified(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                   ThreadPool* thread_pool, TimingLogger* timings);
-  void SetVerifiedDexFile(jobject class_loader, const DexFile& dex_file,
-                          const std::vector<const DexFile*>& dex_files,
-                          ThreadPool* thread_pool, TimingLogger* timings)
+                   ThreadPool* thread_pool, TimingLogger* timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   void InitializeClasses(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                          ThreadPool* thread_pool, TimingLogger* timings)
-      LOCKS_EXCLUDED(Locks::mutator_lock_);
-  void InitializeClasses(jobject class_loader, const DexFile& dex_file,
-                         const std::vector<const DexFile*>& dex_files,
-                         ThreadPool* thread_pool, TimingLogger* timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_, compiled_classes_lock_);
 
   void UpdateImageClasses(TimingLogger* timings) LOCKS_EXCLUDED(Locks::mutator_lock_);
@@ -479,10 +504,7 @@ class CompilerDriver {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void Compile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-               ThreadPool* thread_pool, TimingLogger* timings);
-  void CompileDexFile(jobject class_loader, const DexFile& dex_file,
-                      const std::vector<const DexFile*>& dex_files,
-                      ThreadPool* thread_pool, TimingLogger* timings)
+               ThreadPool* thread_pool, TimingLogger* timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
   void CompileMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
                      InvokeType invoke_type, uint16_t class_def_idx, uint32_t method_idx,
@@ -491,13 +513,45 @@ class CompilerDriver {
                      bool compilation_enabled)
       LOCKS_EXCLUDED(compiled_methods_lock_);
 
-  static void CompileClass(const ParallelCompilationManager* context, size_t class_def_index)
-      LOCKS_EXCLUDED(Locks::mutator_lock_);
+  // A method of a class to compile, collected by CollectClassMethods.
+  struct MethodToCompile {
+    const DexFile* dex_file;
+    const DexFile::CodeItem* code_item;
+    uint32_t method_idx;
+    uint32_t access_flags;
+    uint16_t class_def_idx;
+    InvokeType invoke_type;
+    DexToDexCompilationLevel dex_to_dex_compilation_level;
+    bool compilation_enabled;
+  };
+  class CompileMethodsTask;
+
+  // Adds the methods of the class to methods_to_compile_, unless the class is to be skipped.
+  static void CollectClassMethods(const ParallelCompilationManager* context,
+                                  size_t class_def_index)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, methods_to_compile_lock_);
+
+  // Compiles the collected methods, largest first.
+  void CompileMethods(jobject class_loader, ThreadPool* thread_pool)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, methods_to_compile_lock_);
+
+  void RecordMethodCompileTime(const MethodReference& method_ref, uint64_t duration_ns)
+      LOCKS_EXCLUDED(slowest_methods_lock_);
+
+  // Returns a copy of the method's code from the reusable oat file or the compiled method cache,
+  // or nullptr if there is none.
+  CompiledMethod* ReuseMethod(const DexFile::CodeItem* code_item, uint16_t class_def_idx,
+                              uint32_t method_idx, uint32_t access_flags, const DexFile& dex_file);
+
+  // Stores a freshly compiled method in the compiled method cache, if any.
+  void CacheMethod(const DexFile::CodeItem* code_item, uint32_t method_idx, uint32_t access_flags,
+                   const DexFile& dex_file, const CompiledMethod* compiled_method);
 
   const CompilerOptions* const compiler_options_;
   VerificationResults* const verification_results_;
   DexFileToMethodInlinerMap* const method_inliner_map_;
 
+  const Compiler::Kind compiler_kind_;
   std::unique_ptr<Compiler> compiler_;
 
   const InstructionSet instruction_set_;
@@ -519,6 +573,8 @@ class CompilerDriver {
   // Number of non-relative patches in all compiled methods. These patches need space
   // in the .oat_patches ELF section if requested in the compiler options.
   size_t non_relative_linker_patch_count_ GUARDED_BY(compiled_methods_lock_);
+  // Number of patches of any kind in all compiled methods.
+  size_t linker_patch_count_ GUARDED_BY(compiled_methods_lock_);
 
   const bool image_;
 
@@ -534,9 +590,35 @@ class CompilerDriver {
 
   size_t thread_count_;
 
+  // The previous oat file to copy the code of unchanged methods from, if any.
+  std::unique_ptr<ReusableOatFile> reusable_oat_file_;
+
+  // The cache shared with other compilations to look up compiled methods in, if any.
+  std::unique_ptr<CompiledMethodCache> compiled_method_cache_;
+
   class AOTCompilationStats;
   std::unique_ptr<AOTCompilationStats> stats_;
 
+  Mutex methods_to_compile_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<MethodToCompile> methods_to_compile_ GUARDED_BY(methods_to_compile_lock_);
+
+  // The slowest methods to compile so far as a min-heap of the compile time, so that the fastest
+  // of them is replaced first. min_slow_method_ns_ caches the smallest time of a full heap to
+  // avoid taking the lock for the vast majority of methods.
+  static constexpr size_t kNumSlowestMethods = 10u;
+  mutable Mutex slowest_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<std::pair<uint64_t, MethodReference>> slowest_methods_
+      GUARDED_BY(slowest_methods_lock_);
+  Atomic<uint64_t> min_slow_method_ns_;
+  // Time from when the first thread ran out of methods to compile until the last one was done.
+  uint64_t compile_tail_ns_;
+
+  bool collect_method_stats_;
+  // Holds the MethodCompileStats of the method each thread is compiling.
+  pthread_key_t method_stats_key_;
+  mutable Mutex method_stats_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<std::unique_ptr<MethodCompileStats>> method_stats_ GUARDED_BY(method_stats_lock_);
+
   bool dump_stats_;
   const bool dump_passes_;
 
@@ -562,6 +644,11 @@ class CompilerDriver {
 
   bool support_boot_image_fixup_;
 
+  // Swap space for the deduplicated byte arrays below, or nullptr to keep them on the native heap.
+  // Must outlive the DedupeSets allocating from it.
+  std::unique_ptr<SwapSpace> swap_space_;
+  std::unique_ptr<SwapAllocator<void>> swap_space_allocator_;
+
   // DeDuplication data structures, these own the corresponding byte arrays.
   template <typename ByteArray>
   class DedupeHashFunc {
@@ -598,12 +685,14 @@ class CompilerDriver {
     }
   };
 
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc<std::vector<uint8_t>>, 4> dedupe_code_;
-  DedupeSet<SrcMap, size_t, DedupeHashFunc<SrcMap>, 4> dedupe_src_mapping_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc<std::vector<uint8_t>>, 4> dedupe_mapping_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc<std::vector<uint8_t>>, 4> dedupe_vmap_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc<std::vector<uint8_t>>, 4> dedupe_gc_map_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc<std::vector<uint8_t>>, 4> dedupe_cfi_info_;
+  typedef DedupeSet<ArrayRef<const uint8_t>, SwapVector<uint8_t>, size_t,
+                    DedupeHashFunc<ArrayRef<const uint8_t>>, 4> DedupeByteArraySet;
+  DedupeByteArraySet dedupe_code_;
+  DedupeSet<SrcMap, SrcMap, size_t, DedupeHashFunc<SrcMap>, 4> dedupe_src_mapping_table_;
+  DedupeByteArraySet dedupe_mapping_table_;
+  DedupeByteArraySet dedupe_vmap_table_;
+  DedupeByteArraySet dedupe_gc_map_;
+  DedupeByteArraySet dedupe_cfi_info_;
 
   DISALLOW_COPY_AND_ASSIGN(CompilerDriver);
 };
@@ -18,11 +18,24 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <sstream>
 
+#include <ScopedLocalRef.h>
+
+#include "arch/instruction_set_features.h"
 #include "class_linker.h"
 #include "common_compiler_test.h"
-#include "dex_file.h"
+#include "compiled_class.h"
+#include "compiled_method.h"
+#include "dex/verification_results.h"
+#include "dex/quick/dex_file_to_method_inliner_map.h"
+#include "dex_file-inl.h"
+#include "dex_instruction.h"
+#include "driver/compiler_options.h"
+#include "driver/reusable_oat_file.h"
 #include "gc/heap.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
@@ -31,7 +44,13 @@
 #include "mirror/object_array-inl.h"
 #include "mirror/object-inl.h"
 #include "handle_scope-inl.h"
+#include "oat_file.h"
+#include "oat_writer.h"
 #include "scoped_thread_state_change.h"
+#include "utf.h"
+#include "verifier/method_verifier.h"
+#include "verifier/verifier_deps.h"
+#include "well_known_classes.h"
 
 namespace art {
 
@@ -95,9 +114,180 @@ class CompilerDriverTest : public CommonCompilerTest {
     }
   }
 
+  // Returns a class loader for dex_files, which are compiled against the boot class path only.
+  jobject CreateClassLoader(const std::vector<const DexFile*>& dex_files)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    for (const DexFile* dex_file : dex_files) {
+      class_linker_->RegisterDexFile(*dex_file);
+    }
+    JNIEnv* env = Thread::Current()->GetJniEnv();
+    ScopedLocalRef<jobject> class_loader_local(env,
+        env->AllocObject(WellKnownClasses::dalvik_system_PathClassLoader));
+    jobject class_loader = env->NewGlobalRef(class_loader_local.get());
+    std::vector<const DexFile*> class_path(dex_files);
+    Runtime::Current()->SetCompileTimeClassPath(class_loader, class_path);
+    return class_loader;
+  }
+
+  // Returns a driver compiling an application rather than an image, with options that allow
+  // reusing its output.
+  CompilerDriver* CreateApplicationCompilerDriver(
+      size_t thread_count = 2u,
+      CompilerOptions::CompilerFilter compiler_filter = CompilerOptions::kDefaultCompilerFilter) {
+    reusable_compiler_options_.emplace_back(new CompilerOptions(
+        compiler_filter,
+        CompilerOptions::kDefaultHugeMethodThreshold,
+        CompilerOptions::kDefaultLargeMethodThreshold,
+        CompilerOptions::kDefaultSmallMethodThreshold,
+        CompilerOptions::kDefaultTinyMethodThreshold,
+        CompilerOptions::kDefaultNumDexMethodsThreshold,
+        false,  // generate_gdb_information
+        false,  // include_patch_information
+        CompilerOptions::kDefaultTopKProfileThreshold,
+        false,  // include_debug_symbols
+        false,  // implicit_null_checks
+        false,  // implicit_so_checks
+        false,  // implicit_suspend_checks
+        false,  // compile_pic
+#ifdef ART_SEA_IR_MODE
+        false,  // sea_ir_mode
+#endif
+        nullptr,  // verbose_methods
+        nullptr));  // init_failure_output
+    CompilerDriver* driver = new CompilerDriver(reusable_compiler_options_.back().get(),
+                                                verification_results_.get(),
+                                                method_inliner_map_.get(),
+                                                Compiler::kQuick, kRuntimeISA,
+                                                instruction_set_features_.get(),
+                                                false, nullptr, nullptr, thread_count, false,
+                                                false, timer_.get(), "");
+    if (kRuntimeISA == kArm || kRuntimeISA == kThumb2) {
+      // Without a boot image calls into the boot class path are linked with patches, as if
+      // compiling one, and Thumb2 code would need the code addresses of an image for them.
+      driver->SetSupportBootImageFixup(false);
+    }
+    return driver;
+  }
+
+  void CompileAllWith(CompilerDriver* driver, jobject class_loader)
+      LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    TimingLogger timings("CompilerDriverTest::CompileAllWith", false, false);
+    driver->CompileAll(class_loader, Runtime::Current()->GetCompileTimeClassPath(class_loader),
+                       &timings);
+  }
+
+  void WriteOatFile(CompilerDriver* driver, const std::vector<const DexFile*>& dex_files,
+                    File* file) {
+    TimingLogger timings("CompilerDriverTest::WriteOatFile", false, false);
+    SafeMap<std::string, std::string> key_value_store;
+    key_value_store.Put(OatHeader::kImageLocationKey, "");
+    OatWriter oat_writer(dex_files, 0u, 0u, 0, driver, nullptr, &timings, &key_value_store);
+    ASSERT_TRUE(driver->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild, dex_files, &oat_writer,
+                                 file));
+  }
+
+  // Returns a copy of dex_file in which the literal of the first const/4 of the named method
+  // is incremented. The copy has a new checksum and signature, as a rebuilt dex file would.
+  const DexFile* CopyWithChangedMethod(const DexFile& dex_file, const char* class_descriptor,
+                                       const char* method_name) {
+    changed_dex_data_.assign(dex_file.Begin(), dex_file.Begin() + dex_file.Size());
+    const DexFile::ClassDef* class_def =
+        dex_file.FindClassDef(class_descriptor, ComputeModifiedUtf8Hash(class_descriptor));
+    CHECK(class_def != nullptr) << class_descriptor;
+    ClassDataItemIterator it(dex_file, dex_file.GetClassData(*class_def));
+    while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+      it.Next();
+    }
+    while (it.HasNext() &&
+           strcmp(dex_file.GetMethodName(dex_file.GetMethodId(it.GetMemberIndex())),
+                  method_name) != 0) {
+      it.Next();
+    }
+    CHECK(it.HasNext()) << method_name;
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    const uint16_t* insn = code_item->insns_;
+    while (Instruction::At(insn)->Opcode() != Instruction::CONST_4) {
+      insn += Instruction::At(insn)->SizeInCodeUnits();
+    }
+    uint16_t* changed_insn = reinterpret_cast<uint16_t*>(
+        &changed_dex_data_[reinterpret_cast<const uint8_t*>(insn) - dex_file.Begin()]);
+    *changed_insn += 1u << 12;  // vB of the 11n format.
+    DexFile::Header* header = reinterpret_cast<DexFile::Header*>(&changed_dex_data_[0]);
+    header->checksum_ = ~header->checksum_;
+    header->signature_[0] = ~header->signature_[0];
+    std::string error_msg;
+    changed_dex_file_.reset(DexFile::Open(&changed_dex_data_[0], changed_dex_data_.size(),
+                                          dex_file.GetLocation() + "-changed",
+                                          header->checksum_, &error_msg));
+    CHECK(changed_dex_file_.get() != nullptr) << error_msg;
+    return changed_dex_file_.get();
+  }
+
+  static std::vector<uint8_t> ToVector(const SwapVector<uint8_t>* data) {
+    return (data != nullptr) ? std::vector<uint8_t>(data->begin(), data->end())
+                             : std::vector<uint8_t>();
+  }
+
+  // Checks that the method compiled by driver for dex_file and the one compiled by
+  // expected_driver for expected_dex_file have the same code and maps.
+  void ExpectSameCompiledMethods(CompilerDriver* expected_driver,
+                                 const DexFile& expected_dex_file,
+                                 CompilerDriver* driver, const DexFile& dex_file) {
+    ASSERT_EQ(expected_dex_file.NumMethodIds(), dex_file.NumMethodIds());
+    for (uint32_t i = 0; i != dex_file.NumMethodIds(); ++i) {
+      const CompiledMethod* expected =
+          expected_driver->GetCompiledMethod(MethodReference(&expected_dex_file, i));
+      const CompiledMethod* actual = driver->GetCompiledMethod(MethodReference(&dex_file, i));
+      ASSERT_EQ(expected == nullptr, actual == nullptr) << PrettyMethod(i, dex_file);
+      if (expected == nullptr) {
+        continue;
+      }
+      EXPECT_EQ(ToVector(expected->GetQuickCode()), ToVector(actual->GetQuickCode()))
+          << PrettyMethod(i, dex_file);
+      EXPECT_EQ(expected->GetFrameSizeInBytes(), actual->GetFrameSizeInBytes());
+      EXPECT_EQ(expected->GetCoreSpillMask(), actual->GetCoreSpillMask());
+      EXPECT_EQ(expected->GetFpSpillMask(), actual->GetFpSpillMask());
+      EXPECT_EQ(ToVector(&expected->GetMappingTable()), ToVector(&actual->GetMappingTable()))
+          << PrettyMethod(i, dex_file);
+      EXPECT_EQ(ToVector(&expected->GetVmapTable()), ToVector(&actual->GetVmapTable()))
+          << PrettyMethod(i, dex_file);
+      EXPECT_EQ(ToVector(expected->GetGcMap()), ToVector(actual->GetGcMap()))
+          << PrettyMethod(i, dex_file);
+      EXPECT_EQ(expected->GetPatches().size(), actual->GetPatches().size())
+          << PrettyMethod(i, dex_file);
+    }
+  }
+
+  // Verifies LVerifierDeps; of a fresh VerifierDeps dex file, with the library dex file lib
+  // ahead of it in the class path. Like the runtime, the verifier doesn't allow soft failures
+  // other than those of resolution. Sets *deps_hold to whether the dependencies recorded at
+  // compile time hold for this class path.
+  verifier::MethodVerifier::FailureKind VerifyAgainst(const char* lib,
+                                                      const verifier::VerifierDeps::ClassDeps& deps,
+                                                      bool* deps_hold) {
+    Thread* self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    std::vector<const DexFile*> dex_files;
+    dex_files.push_back(OpenTestDexFile(lib));
+    dex_files.push_back(OpenTestDexFile("VerifierDeps"));
+    jobject class_loader = CreateClassLoader(dex_files);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ClassLoader> loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader)));
+    *deps_hold = verifier::VerifierDeps::DependenciesHold(self, *dex_files[1], loader, deps);
+    mirror::Class* klass = class_linker_->FindClass(self, "LVerifierDeps;", loader);
+    CHECK(klass != nullptr);
+    std::string error_msg;
+    return verifier::MethodVerifier::VerifyClass(self, klass, false, &error_msg);
+  }
+
   JNIEnv* env_;
   jclass class_;
   jmethodID mid_;
+
+  std::vector<std::unique_ptr<CompilerOptions>> reusable_compiler_options_;
+  std::vector<uint8_t> changed_dex_data_;
+  std::unique_ptr<const DexFile> changed_dex_file_;
 };
 
 // Disabled due to 10 second runtime on host
@@ -180,6 +370,228 @@ TEST_F(CompilerDriverTest, AbstractMethodErrorStub) {
   }
 }
 
+TEST_F(CompilerDriverTest, ReuseOatFile) {
+  TEST_DISABLED_FOR_PORTABLE();
+  Thread* self = Thread::Current();
+  std::vector<const DexFile*> old_dex_files;
+  jobject old_class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    old_dex_files.push_back(OpenTestDexFile("StaticLeafMethods"));
+    old_dex_files.push_back(OpenTestDexFile("Statics"));
+    old_class_loader = CreateClassLoader(old_dex_files);
+  }
+  std::unique_ptr<CompilerDriver> old_driver(CreateApplicationCompilerDriver());
+  CompileAllWith(old_driver.get(), old_class_loader);
+  ScratchFile oat_file;
+  WriteOatFile(old_driver.get(), old_dex_files, oat_file.GetFile());
+
+  // Compile fresh copies of the same dex files, except that a method of Statics has changed.
+  std::vector<const DexFile*> new_dex_files;
+  jobject new_class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    new_dex_files.push_back(OpenTestDexFile("StaticLeafMethods"));
+    new_dex_files.push_back(CopyWithChangedMethod(*OpenTestDexFile("Statics"), "LStatics;",
+                                                  "getS1"));
+    new_class_loader = CreateClassLoader(new_dex_files);
+  }
+  std::unique_ptr<CompilerDriver> new_driver(CreateApplicationCompilerDriver());
+  std::string error_msg;
+  ReusableOatFile* reusable_oat_file =
+      ReusableOatFile::Open(oat_file.GetFilename(), *new_driver, &error_msg);
+  ASSERT_TRUE(reusable_oat_file != nullptr) << error_msg;
+  new_driver->SetReusableOatFile(reusable_oat_file);
+  CompileAllWith(new_driver.get(), new_class_loader);
+
+  // Reuse is decided per dex file, only StaticLeafMethods is unchanged. Its constructor calls
+  // Object.<init>, with the old oat file having linker patches it is compiled again.
+  EXPECT_EQ(1u, reusable_oat_file->GetNumReusableDexFiles());
+  const bool may_have_linker_patches = old_driver->GetLinkerPatchCount() != 0u;
+  size_t num_compiled_methods = 0u;
+  size_t num_compiled_constructors = 0u;
+  for (uint32_t i = 0; i != new_dex_files[0]->NumMethodIds(); ++i) {
+    if (new_driver->GetCompiledMethod(MethodReference(new_dex_files[0], i)) != nullptr) {
+      ++num_compiled_methods;
+      if (strcmp(new_dex_files[0]->GetMethodName(new_dex_files[0]->GetMethodId(i)),
+                 "<init>") == 0) {
+        ++num_compiled_constructors;
+      }
+    }
+  }
+  EXPECT_NE(0u, num_compiled_methods);
+  EXPECT_EQ(1u, num_compiled_constructors);
+  EXPECT_EQ(may_have_linker_patches ? num_compiled_methods - 1u : num_compiled_methods,
+            reusable_oat_file->GetNumReusedMethods());
+  ExpectSameCompiledMethods(old_driver.get(), *old_dex_files[0],
+                            new_driver.get(), *new_dex_files[0]);
+
+  // The changed method was compiled again and returns a different constant.
+  uint32_t method_idx = 0u;
+  while (strcmp(old_dex_files[1]->GetMethodName(old_dex_files[1]->GetMethodId(method_idx)),
+                "getS1") != 0) {
+    ++method_idx;
+  }
+  const CompiledMethod* old_method =
+      old_driver->GetCompiledMethod(MethodReference(old_dex_files[1], method_idx));
+  const CompiledMethod* new_method =
+      new_driver->GetCompiledMethod(MethodReference(new_dex_files[1], method_idx));
+  ASSERT_TRUE(old_method != nullptr);
+  ASSERT_TRUE(new_method != nullptr);
+  EXPECT_NE(ToVector(old_method->GetQuickCode()), ToVector(new_method->GetQuickCode()));
+}
+
+TEST_F(CompilerDriverTest, ReuseOatFileWithDifferentOptions) {
+  TEST_DISABLED_FOR_PORTABLE();
+  std::vector<const DexFile*> dex_files;
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    dex_files.push_back(OpenTestDexFile("StaticLeafMethods"));
+    class_loader = CreateClassLoader(dex_files);
+  }
+  std::unique_ptr<CompilerDriver> old_driver(CreateApplicationCompilerDriver());
+  CompileAllWith(old_driver.get(), class_loader);
+  ScratchFile oat_file;
+  WriteOatFile(old_driver.get(), dex_files, oat_file.GetFile());
+
+  // The code of the old oat file was compiled with a different filter.
+  CompilerOptions::CompilerFilter other_filter =
+      (CompilerOptions::kDefaultCompilerFilter == CompilerOptions::kSpace)
+          ? CompilerOptions::kSpeed
+          : CompilerOptions::kSpace;
+  std::unique_ptr<CompilerDriver> new_driver(CreateApplicationCompilerDriver(2u, other_filter));
+  std::string error_msg;
+  std::unique_ptr<ReusableOatFile> reusable_oat_file(
+      ReusableOatFile::Open(oat_file.GetFilename(), *new_driver, &error_msg));
+  EXPECT_TRUE(reusable_oat_file.get() == nullptr);
+  EXPECT_NE(std::string::npos, error_msg.find("different options")) << error_msg;
+}
+
+TEST_F(CompilerDriverTest, VerifierDepsOfChangedSuperclass) {
+  TEST_DISABLED_FOR_PORTABLE();
+  std::vector<const DexFile*> dex_files;
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    dex_files.push_back(OpenTestDexFile("VerifierDepsLib"));
+    dex_files.push_back(OpenTestDexFile("VerifierDeps"));
+    class_loader = CreateClassLoader(dex_files);
+  }
+  std::unique_ptr<CompilerDriver> driver(CreateApplicationCompilerDriver());
+  CompileAllWith(driver.get(), class_loader);
+  ScratchFile oat_file;
+  WriteOatFile(driver.get(), dex_files, oat_file.GetFile());
+
+  // The class soft failed on Broken, its dependencies are in the oat file.
+  const DexFile& dex_file = *dex_files[1];
+  const char* descriptor = "LVerifierDeps;";
+  const DexFile::ClassDef* class_def =
+      dex_file.FindClassDef(descriptor, ComputeModifiedUtf8Hash(descriptor));
+  ASSERT_TRUE(class_def != nullptr);
+  const uint16_t class_def_index = dex_file.GetIndexForClassDef(*class_def);
+  CompiledClass* compiled_class =
+      driver->GetCompiledClass(ClassReference(&dex_file, class_def_index));
+  ASSERT_TRUE(compiled_class != nullptr);
+  EXPECT_EQ(mirror::Class::kStatusRetryVerificationAtRuntime, compiled_class->GetStatus());
+  std::string error_msg;
+  std::unique_ptr<OatFile> oat(OatFile::Open(oat_file.GetFilename(), oat_file.GetFilename(),
+                                             nullptr, nullptr, false, &error_msg));
+  ASSERT_TRUE(oat.get() != nullptr) << error_msg;
+  const OatFile::OatDexFile* oat_dex_file =
+      oat->GetOatDexFile(dex_file.GetLocation().c_str(), nullptr);
+  ASSERT_TRUE(oat_dex_file != nullptr);
+  ASSERT_TRUE(oat_dex_file->GetVerifierDepsData() != nullptr);
+  verifier::VerifierDeps::ClassDeps deps;
+  ASSERT_TRUE(verifier::VerifierDeps::Decode(oat_dex_file->GetVerifierDepsData(),
+                                             class_def_index, &deps));
+  EXPECT_TRUE(deps.has_soft_failures);
+
+  // Sub is defined by the same dex file as the class, but its superclass is not.
+  auto sub = std::find_if(deps.resolved_types.begin(), deps.resolved_types.end(),
+                          [&dex_file](const verifier::VerifierDeps::ResolvedType& type) {
+                            return strcmp(dex_file.StringByTypeIdx(type.type_idx), "LSub;") == 0;
+                          });
+  ASSERT_TRUE(sub != deps.resolved_types.end());
+  ASSERT_EQ(2u, sub->hierarchy.size());
+  EXPECT_EQ("LSub;", sub->hierarchy[0].descriptor);
+  EXPECT_EQ(dex_file.GetLocationChecksum(), sub->hierarchy[0].location_checksum);
+  EXPECT_EQ("LBase;", sub->hierarchy[1].descriptor);
+  EXPECT_EQ(dex_files[0]->GetLocationChecksum(), sub->hierarchy[1].location_checksum);
+
+  // With the same library the dependencies hold, and verifying again gives the same result.
+  bool deps_hold = false;
+  EXPECT_EQ(verifier::MethodVerifier::kSoftFailure,
+            VerifyAgainst("VerifierDepsLib", deps, &deps_hold));
+  EXPECT_TRUE(deps_hold);
+
+  // Once Base is no longer an Exception they don't, and the class is rejected when verified.
+  deps_hold = true;
+  EXPECT_EQ(verifier::MethodVerifier::kHardFailure,
+            VerifyAgainst("VerifierDepsLib2", deps, &deps_hold));
+  EXPECT_FALSE(deps_hold);
+}
+
+TEST_F(CompilerDriverTest, CompileMethodsOnce) {
+  TEST_DISABLED_FOR_PORTABLE();
+  std::vector<const DexFile*> dex_files;
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    dex_files.push_back(OpenTestDexFile("AbstractMethod"));
+    dex_files.push_back(OpenTestDexFile("StaticLeafMethods"));
+    dex_files.push_back(OpenTestDexFile("Statics"));
+    class_loader = CreateClassLoader(dex_files);
+  }
+  // More threads than the small dex files have classes, so that they race for the methods.
+  std::unique_ptr<CompilerDriver> driver(CreateApplicationCompilerDriver(8u));
+  driver->EnableMethodStats();
+  CompileAllWith(driver.get(), class_loader);
+
+  // The method statistics have a row for each call to CompileMethod, except for abstract methods.
+  std::ostringstream stats;
+  driver->DumpMethodStats(stats);
+  std::istringstream rows(stats.str());
+  std::string row;
+  ASSERT_TRUE(std::getline(rows, row));  // Header.
+  std::map<std::string, size_t> times_compiled;
+  while (std::getline(rows, row)) {
+    ASSERT_EQ('"', row[0]) << row;
+    size_t end = row.find("\",", 1u);
+    ASSERT_NE(std::string::npos, end) << row;
+    ++times_compiled[row.substr(1u, end - 1u)];
+  }
+
+  size_t num_methods = 0u;
+  for (const DexFile* dex_file : dex_files) {
+    for (size_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+      const uint8_t* class_data = dex_file->GetClassData(dex_file->GetClassDef(i));
+      if (class_data == nullptr) {
+        continue;
+      }
+      ClassDataItemIterator it(*dex_file, class_data);
+      while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+        it.Next();
+      }
+      for (; it.HasNext(); it.Next()) {
+        if ((it.GetMethodAccessFlags() & kAccAbstract) != 0) {
+          continue;
+        }
+        std::string method = PrettyMethod(it.GetMemberIndex(), *dex_file);
+        auto found = times_compiled.find(method);
+        ASSERT_TRUE(found != times_compiled.end()) << method;
+        EXPECT_EQ(1u, found->second) << method;
+        ++num_methods;
+      }
+    }
+  }
+  EXPECT_EQ(num_methods, times_compiled.size());
+
+  std::ostringstream tail_latency;
+  driver->DumpCompileTailLatency(tail_latency);
+  EXPECT_NE(std::string::npos, tail_latency.str().find("Compilation tail with idle threads: "));
+}
+
 // TODO: need check-cast test (when stub complete & we can throw/catch
 
 }  // namespace art
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dex_file_dependencies.h"
+
+#include "dex_file-inl.h"
+#include "utf.h"
+
+namespace art {
+
+std::vector<std::vector<size_t>> FindDexFileDependencies(
+    const std::vector<const DexFile*>& dex_files) {
+  const size_t num_dex_files = dex_files.size();
+  std::vector<std::vector<size_t>> dependencies(num_dex_files);
+  for (size_t i = 0; i != num_dex_files; ++i) {
+    const DexFile& dex_file = *dex_files[i];
+    std::vector<bool> depends_on(num_dex_files, false);
+    for (size_t type_idx = 0, num_types = dex_file.NumTypeIds(); type_idx != num_types;
+         ++type_idx) {
+      const char* descriptor = dex_file.StringByTypeIdx(type_idx);
+      while (*descriptor == '[') {
+        ++descriptor;
+      }
+      if (*descriptor != 'L') {
+        continue;
+      }
+      const size_t hash = ComputeModifiedUtf8Hash(descriptor);
+      for (size_t j = 0; j != num_dex_files; ++j) {
+        if (j != i && !depends_on[j] && dex_files[j]->FindClassDef(descriptor, hash) != nullptr) {
+          depends_on[j] = true;
+          dependencies[i].push_back(j);
+        }
+      }
+    }
+  }
+  return dependencies;
+}
+
+}  // namespace art
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_DEX_FILE_DEPENDENCIES_H_
+#define ART_COMPILER_DRIVER_DEX_FILE_DEPENDENCIES_H_
+
+#include <vector>
+
+namespace art {
+
+class DexFile;
+
+// Returns, for each of dex_files, the indices of the other dex files defining a type it refers
+// to. Compiled code depends on the dex files it has dependencies on, as it inlines callees and
+// embeds field offsets and vtable indices of the classes it uses.
+std::vector<std::vector<size_t>> FindDexFileDependencies(
+    const std::vector<const DexFile*>& dex_files);
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_DEX_FILE_DEPENDENCIES_H_
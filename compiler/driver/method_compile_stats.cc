@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "method_compile_stats.h"
+
+#include "base/timing_logger.h"
+#include "dex_file.h"
+
+namespace art {
+
+// Quotes a CSV field, as method signatures contain commas.
+static std::string CsvQuote(const std::string& field) {
+  std::string quoted = "\"";
+  for (char c : field) {
+    if (c == '"') {
+      quoted += '"';
+    }
+    quoted += c;
+  }
+  quoted += '"';
+  return quoted;
+}
+
+void MethodCompileStats::AddPassTimes(const TimingLogger& timings) {
+  TimingLogger::TimingData timing_data = timings.CalculateTimingData();
+  const std::vector<TimingLogger::Timing>& timing_points = timings.GetTimings();
+  size_t depth = 0u;
+  for (size_t i = 0; i != timing_points.size(); ++i) {
+    if (timing_points[i].IsStartTiming()) {
+      if (depth == 0u) {
+        AddPassTime(timing_points[i].GetName(), timing_data.GetTotalTime(i));
+      }
+      ++depth;
+    } else {
+      --depth;
+    }
+  }
+}
+
+void MethodCompileStats::DumpCsvHeader(std::ostream& os) {
+  os << "method,backend,total_ns,arena_bytes,code_bytes,spill_count,fallback_reason,pass_ns\n";
+}
+
+void MethodCompileStats::DumpCsv(std::ostream& os) const {
+  // Passes as "name:ns" separated by semicolons, to keep one row per method.
+  std::string passes;
+  for (const std::pair<const char*, uint64_t>& pass : pass_ns) {
+    if (!passes.empty()) {
+      passes += ';';
+    }
+    passes += pass.first;
+    passes += ':';
+    passes += std::to_string(pass.second);
+  }
+  os << CsvQuote(PrettyMethod(method_ref.dex_method_index, *method_ref.dex_file)) << ","
+     << backend << ","
+     << total_ns << ","
+     << arena_bytes << ","
+     << code_bytes << ","
+     << spill_count << ","
+     << CsvQuote(fallback_reason) << ","
+     << CsvQuote(passes) << "\n";
+}
+
+}  // namespace art
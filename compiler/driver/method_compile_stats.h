@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_METHOD_COMPILE_STATS_H_
+#define ART_COMPILER_DRIVER_METHOD_COMPILE_STATS_H_
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "method_reference.h"
+#include "utils.h"
+
+namespace art {
+
+class TimingLogger;
+
+// Statistics of the compilation of one method, collected by the CompilerDriver for the report
+// written with dex2oat --dump-method-stats. The backends fill in what they know about through
+// CompilerDriver::GetMethodStats().
+struct MethodCompileStats {
+  explicit MethodCompileStats(MethodReference method_ref_in)
+      : method_ref(method_ref_in), backend("none"), total_ns(0u), arena_bytes(0u),
+        code_bytes(0u), spill_count(0u) {
+  }
+
+  void AddPassTime(const char* pass_name, uint64_t ns) {
+    pass_ns.emplace_back(pass_name, ns);
+  }
+
+  // Adds the time of each outermost split of timings.
+  void AddPassTimes(const TimingLogger& timings);
+
+  static void DumpCsvHeader(std::ostream& os);
+  void DumpCsv(std::ostream& os) const;
+
+  MethodReference method_ref;
+  // The backend that produced the code, or what was done instead of compiling the method.
+  const char* backend;
+  uint64_t total_ns;
+  size_t arena_bytes;
+  size_t code_bytes;
+  // The number of callee-save registers spilled by the code.
+  size_t spill_count;
+  // Why the method was not compiled, empty if it was.
+  std::string fallback_reason;
+  // The time spent in each pass, in the order they ran. Pass names are static strings.
+  std::vector<std::pair<const char*, uint64_t>> pass_ns;
+};
+
+// Records the time spent in a pass of the method being compiled, if its statistics are being
+// collected.
+class ScopedPassTiming {
+ public:
+  ScopedPassTiming(MethodCompileStats* stats, const char* pass_name)
+      : stats_(stats), pass_name_(pass_name), start_ns_((stats != nullptr) ? NanoTime() : 0u) {
+  }
+
+  ~ScopedPassTiming() {
+    if (stats_ != nullptr) {
+      stats_->AddPassTime(pass_name_, NanoTime() - start_ns_);
+    }
+  }
+
+ private:
+  MethodCompileStats* const stats_;
+  const char* const pass_name_;
+  const uint64_t start_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedPassTiming);
+};
+
+// Records why the method being compiled was not compiled, if its statistics are being collected.
+inline void RecordFallbackReason(MethodCompileStats* stats, const std::string& reason) {
+  if (stats != nullptr) {
+    stats->fallback_reason = reason;
+  }
+}
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_METHOD_COMPILE_STATS_H_
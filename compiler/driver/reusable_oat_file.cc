@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reusable_oat_file.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "arch/instruction_set_features.h"
+#include "base/stringprintf.h"
+#include "compiled_method.h"
+#include "compiler_driver.h"
+#include "dex_file-inl.h"
+#include "dex_file_dependencies.h"
+#include "dex_instruction-inl.h"
+#include "driver/compiler_options.h"
+#include "gc/heap.h"
+#include "gc/space/image_space.h"
+#include "gc_map.h"
+#include "image.h"
+#include "leb128.h"
+#include "mirror/art_method-inl.h"
+#include "oat_file-inl.h"
+#include "runtime.h"
+#include "stack_map.h"
+
+namespace art {
+
+// Returns whether the code has an invoke, the only instructions that can get linker patches
+// when compiling an application without patch information.
+static bool HasInvoke(const DexFile::CodeItem* code_item) {
+  const uint16_t* insns = code_item->insns_;
+  const uint16_t* end = insns + code_item->insns_size_in_code_units_;
+  while (insns < end) {
+    const Instruction* inst = Instruction::At(insns);
+    if (inst->IsInvoke()) {
+      return true;
+    }
+    insns += inst->SizeInCodeUnits();
+  }
+  return false;
+}
+
+// Returns the size of the encoded MappingTable starting at table.
+static size_t MappingTableSize(const uint8_t* table) {
+  const uint8_t* ptr = table;
+  uint32_t total_size = DecodeUnsignedLeb128(&ptr);
+  DecodeUnsignedLeb128(&ptr);  // pc_to_dex_size, the dex_to_pc entries follow directly.
+  for (uint32_t i = 0; i != total_size; ++i) {
+    DecodeUnsignedLeb128(&ptr);  // Native PC delta.
+    DecodeSignedLeb128(&ptr);  // Dex PC delta.
+  }
+  return ptr - table;
+}
+
+// Returns the size of the encoded VmapTable starting at table.
+static size_t VmapTableSize(const uint8_t* table) {
+  const uint8_t* ptr = table;
+  for (uint32_t i = 0, size = DecodeUnsignedLeb128(&ptr); i != size; ++i) {
+    DecodeUnsignedLeb128(&ptr);
+  }
+  return ptr - table;
+}
+
+// Returns the size of the native GC map starting at gc_map.
+static size_t NativeGcMapSize(const uint8_t* gc_map) {
+  return NativePcOffsetToReferenceMap(gc_map).Size();
+}
+
+static std::vector<uint8_t> CopyTable(const uint8_t* table, size_t (*size_fn)(const uint8_t*)) {
+  if (table == nullptr) {
+    return std::vector<uint8_t>();
+  }
+  return std::vector<uint8_t>(table, table + size_fn(table));
+}
+
+ReusableOatFile* ReusableOatFile::Open(const std::string& filename, const CompilerDriver& driver,
+                                       std::string* error_msg) {
+  if (kUsePortableCompiler) {
+    *error_msg = "Reusing compiled code is not supported with the portable compiler";
+    return nullptr;
+  }
+  if (driver.IsImage()) {
+    // Boot image code is linked with patches against the image being written.
+    *error_msg = "Reusing compiled code is not supported when compiling an image";
+    return nullptr;
+  }
+  const CompilerOptions& compiler_options = driver.GetCompilerOptions();
+  if (compiler_options.GetIncludePatchInformation() || compiler_options.GetIncludeDebugSymbols()) {
+    // Neither the linker patches nor the debug information of a method can be recovered from
+    // the oat file.
+    *error_msg = "Reusing compiled code is not supported with patch information or debug symbols";
+    return nullptr;
+  }
+  std::unique_ptr<OatFile> oat_file(OatFile::Open(filename, filename, nullptr, nullptr, false,
+                                                  error_msg));
+  if (oat_file.get() == nullptr) {
+    return nullptr;
+  }
+  const OatHeader& header = oat_file->GetOatHeader();
+  if (header.GetInstructionSet() != driver.GetInstructionSet() ||
+      header.GetInstructionSetFeaturesBitmap() != driver.GetInstructionSetFeatures()->AsBitmap()) {
+    *error_msg = StringPrintf("'%s' was compiled for a different instruction set or features",
+                              filename.c_str());
+    return nullptr;
+  }
+  const char* options_key = header.GetStoreValueByKey(OatHeader::kCompilerOptionsKey);
+  if (options_key == nullptr || driver.GetCompilerOptionsKey() != options_key) {
+    *error_msg = StringPrintf("'%s' was compiled with different options", filename.c_str());
+    return nullptr;
+  }
+  // Non-PIC code embeds pointers into the boot image. Without a boot image, as in tests, the
+  // previous oat file must not have been compiled against one either.
+  gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+  if (image_space == nullptr) {
+    if (header.GetImageFileLocationOatChecksum() != 0u ||
+        header.GetImageFileLocationOatDataBegin() != 0u) {
+      *error_msg = StringPrintf("'%s' was compiled against a boot image, but there is none",
+                                filename.c_str());
+      return nullptr;
+    }
+  } else {
+    const ImageHeader& image_header = image_space->GetImageHeader();
+    if (header.GetImageFileLocationOatChecksum() != image_header.GetOatChecksum() ||
+        header.GetImageFileLocationOatDataBegin() !=
+            reinterpret_cast<uintptr_t>(image_header.GetOatDataBegin()) ||
+        header.GetImagePatchDelta() != image_header.GetPatchDelta()) {
+      *error_msg = StringPrintf("'%s' was compiled against a different boot image",
+                                filename.c_str());
+      return nullptr;
+    }
+  }
+  const bool may_have_linker_patches = header.MayHaveLinkerPatches();
+  return new ReusableOatFile(oat_file.release(), may_have_linker_patches);
+}
+
+ReusableOatFile::ReusableOatFile(const OatFile* oat_file, bool may_have_linker_patches)
+    : oat_file_(oat_file),
+      may_have_linker_patches_(may_have_linker_patches),
+      num_reused_methods_(0u) {
+}
+
+ReusableOatFile::~ReusableOatFile() {
+}
+
+const std::string& ReusableOatFile::GetLocation() const {
+  return oat_file_->GetLocation();
+}
+
+const OatDexFile* ReusableOatFile::FindOatDexFile(const DexFile& dex_file) const {
+  // Match by contents rather than location, which usually differs between builds. The dex file
+  // stored in the oat file may have been quickened, but its header is left alone.
+  const DexFile::Header& header = dex_file.GetHeader();
+  for (const OatDexFile* oat_dex_file : oat_file_->GetOatDexFiles()) {
+    if (oat_dex_file->GetDexFileLocationChecksum() == dex_file.GetLocationChecksum() &&
+        oat_dex_file->FileSize() == dex_file.Size()) {
+      const DexFile::Header* oat_header =
+          reinterpret_cast<const DexFile::Header*>(oat_dex_file->GetDexFilePointer());
+      if (memcmp(oat_header->signature_, header.signature_, sizeof(header.signature_)) == 0) {
+        return oat_dex_file;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void ReusableOatFile::SelectDexFiles(const std::vector<const DexFile*>& dex_files,
+                                     const std::vector<const DexFile*>& class_path) {
+  std::vector<const DexFile*> all_dex_files(class_path);
+  for (const DexFile* dex_file : dex_files) {
+    if (std::find(all_dex_files.begin(), all_dex_files.end(), dex_file) == all_dex_files.end()) {
+      all_dex_files.push_back(dex_file);
+    }
+  }
+  const size_t num_dex_files = all_dex_files.size();
+
+  const std::vector<std::vector<size_t>> dependencies = FindDexFileDependencies(all_dex_files);
+
+  std::vector<const OatDexFile*> oat_dex_files(num_dex_files);
+  for (size_t i = 0; i != num_dex_files; ++i) {
+    oat_dex_files[i] = FindOatDexFile(*all_dex_files[i]);
+  }
+  // Propagate changes to the dex files depending on them until nothing changes.
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (size_t i = 0; i != num_dex_files; ++i) {
+      if (oat_dex_files[i] == nullptr) {
+        continue;
+      }
+      for (size_t j : dependencies[i]) {
+        if (oat_dex_files[j] == nullptr) {
+          VLOG(compiler) << "Not reusing compiled code of " << all_dex_files[i]->GetLocation()
+                         << " as it depends on " << all_dex_files[j]->GetLocation();
+          oat_dex_files[i] = nullptr;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  reusable_dex_files_.clear();
+  for (size_t i = 0; i != num_dex_files; ++i) {
+    const DexFile* dex_file = all_dex_files[i];
+    if (oat_dex_files[i] != nullptr &&
+        std::find(dex_files.begin(), dex_files.end(), dex_file) != dex_files.end()) {
+      reusable_dex_files_.Put(dex_file, oat_dex_files[i]);
+    }
+  }
+}
+
+CompiledMethod* ReusableOatFile::ReuseMethod(CompilerDriver* driver, const DexFile& dex_file,
+                                             uint16_t class_def_idx, uint32_t method_idx,
+                                             uint32_t access_flags) const {
+  // Image compilations and those with patch information patch more than calls, Open() refuses
+  // them.
+  CHECK(!driver->IsImage());
+  CHECK(!driver->GetCompilerOptions().GetIncludePatchInformation());
+  auto it = reusable_dex_files_.find(&dex_file);
+  if (it == reusable_dex_files_.end()) {
+    return nullptr;
+  }
+  // Find the index of the method within its class, as used by the OatClass.
+  const uint8_t* class_data = dex_file.GetClassData(dex_file.GetClassDef(class_def_idx));
+  if (class_data == nullptr) {
+    return nullptr;
+  }
+  ClassDataItemIterator cdit(dex_file, class_data);
+  while (cdit.HasNextStaticField() || cdit.HasNextInstanceField()) {
+    cdit.Next();
+  }
+  size_t class_def_method_index = 0u;
+  while (cdit.HasNext() && cdit.GetMemberIndex() != method_idx) {
+    ++class_def_method_index;
+    cdit.Next();
+  }
+  if (!cdit.HasNext()) {
+    return nullptr;
+  }
+  if (may_have_linker_patches_ && (access_flags & kAccNative) == 0 &&
+      HasInvoke(cdit.GetMethodCodeItem())) {
+    // The calls were linked to where their targets were in the previous oat file.
+    return nullptr;
+  }
+
+  const OatFile::OatClass oat_class = it->second->GetOatClass(class_def_idx);
+  const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_def_method_index);
+  const uint8_t* code = reinterpret_cast<const uint8_t*>(
+      mirror::ArtMethod::EntryPointToCodePointer(oat_method.GetQuickCode()));
+  if (code == nullptr) {
+    return nullptr;
+  }
+  std::vector<uint8_t> quick_code(code, code + oat_method.GetQuickCodeSize());
+  const InstructionSet instruction_set = driver->GetInstructionSet();
+  CompiledMethod* compiled_method;
+  if ((access_flags & kAccNative) != 0) {
+    compiled_method = new CompiledMethod(driver, instruction_set, quick_code,
+                                         oat_method.GetFrameSizeInBytes(),
+                                         oat_method.GetCoreSpillMask(),
+                                         oat_method.GetFpSpillMask(),
+                                         nullptr);
+  } else if (oat_method.GetGcMap() == nullptr) {
+    // Optimizing doesn't create a GC map, its vmap table holds the stack maps instead.
+    const uint8_t* stack_map = oat_method.GetVmapTable();
+    if (stack_map == nullptr) {
+      return nullptr;
+    }
+    std::vector<uint8_t> stack_map_copy(stack_map,
+                                        stack_map + CodeInfo(stack_map).GetOverallSize());
+    compiled_method = new CompiledMethod(driver, instruction_set, quick_code,
+                                         oat_method.GetFrameSizeInBytes(),
+                                         oat_method.GetCoreSpillMask(),
+                                         oat_method.GetFpSpillMask(),
+                                         CopyTable(oat_method.GetMappingTable(), MappingTableSize),
+                                         stack_map_copy);
+  } else {
+    SrcMap src_mapping_table;
+    compiled_method = new CompiledMethod(driver, instruction_set, quick_code,
+                                         oat_method.GetFrameSizeInBytes(),
+                                         oat_method.GetCoreSpillMask(),
+                                         oat_method.GetFpSpillMask(),
+                                         &src_mapping_table,
+                                         CopyTable(oat_method.GetMappingTable(), MappingTableSize),
+                                         CopyTable(oat_method.GetVmapTable(), VmapTableSize),
+                                         CopyTable(oat_method.GetGcMap(), NativeGcMapSize),
+                                         nullptr);
+  }
+  num_reused_methods_.FetchAndAddSequentiallyConsistent(1u);
+  return compiled_method;
+}
+
+}  // namespace art
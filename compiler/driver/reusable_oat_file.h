@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_REUSABLE_OAT_FILE_H_
+#define ART_COMPILER_DRIVER_REUSABLE_OAT_FILE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "safe_map.h"
+
+namespace art {
+
+class CompiledMethod;
+class CompilerDriver;
+class DexFile;
+class OatDexFile;
+class OatFile;
+
+// An oat file produced by an earlier compilation of the same application whose compiled code can
+// be copied into the oat file being written instead of compiling it again.
+//
+// Compiled code refers to its dex file by index, inlines callees and embeds field offsets and
+// vtable indices of the classes it uses, so a method can only be reused if neither its own dex
+// file nor any dex file defining a type it refers to, directly or through those dex files, has
+// changed. Reuse is therefore decided per dex file: a dex file is reusable if it is identical to
+// one in the previous oat file and so is every dex file in the transitive closure of the dex files
+// defining the types it refers to. Types that resolve to the boot class path are covered by
+// requiring the previous oat file to have been compiled against the same boot image.
+//
+// The oat file doesn't keep the linker patches of its methods. Outside of images and patch
+// information, only calls get patches, mostly the relative calls between the methods of the oat
+// file, so if the previous oat file may have patches only methods without invokes are reused.
+class ReusableOatFile {
+ public:
+  // Opens the oat file at filename for reuse by driver. Returns nullptr and sets error_msg if the
+  // file cannot be opened or was compiled for a different target, boot image or options.
+  static ReusableOatFile* Open(const std::string& filename, const CompilerDriver& driver,
+                               std::string* error_msg);
+
+  ~ReusableOatFile();
+
+  // Determines which of dex_files can reuse the compiled code of the previous oat file, given
+  // the class_path their types are resolved against. Must be called before compilation starts.
+  void SelectDexFiles(const std::vector<const DexFile*>& dex_files,
+                      const std::vector<const DexFile*>& class_path);
+
+  // Returns a CompiledMethod holding a copy of the code the previous oat file has for the given
+  // method, or nullptr if the method must be compiled. The copy has no linker patches, nor the
+  // source map and CFI that are only written with debug symbols.
+  CompiledMethod* ReuseMethod(CompilerDriver* driver, const DexFile& dex_file,
+                              uint16_t class_def_idx, uint32_t method_idx,
+                              uint32_t access_flags) const;
+
+  const std::string& GetLocation() const;
+
+  size_t GetNumReusableDexFiles() const {
+    return reusable_dex_files_.size();
+  }
+
+  size_t GetNumReusedMethods() const {
+    return num_reused_methods_.LoadRelaxed();
+  }
+
+ private:
+  ReusableOatFile(const OatFile* oat_file, bool may_have_linker_patches);
+
+  // Returns the OatDexFile of the previous oat file holding the same dex file, or nullptr.
+  const OatDexFile* FindOatDexFile(const DexFile& dex_file) const;
+
+  std::unique_ptr<const OatFile> oat_file_;
+  const bool may_have_linker_patches_;
+  SafeMap<const DexFile*, const OatDexFile*> reusable_dex_files_;
+  mutable Atomic<size_t> num_reused_methods_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReusableOatFile);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_REUSABLE_OAT_FILE_H_
@@ -17,6 +17,8 @@
 #ifndef ART_COMPILER_ELF_BUILDER_H_
 #define ART_COMPILER_ELF_BUILDER_H_
 
+#include <algorithm>
+
 #include "arch/instruction_set.h"
 #include "base/stl_util.h"
 #include "base/value_object.h"
@@ -393,14 +395,31 @@ class ElfFilePiece {
  public:
   virtual ~ElfFilePiece() {}
 
-  virtual bool Write(File* elf_file) {
-    if (static_cast<off_t>(offset_) != lseek(elf_file->Fd(), offset_, SEEK_SET)) {
-      PLOG(ERROR) << "Failed to seek to " << GetDescription() << " offset " << offset_ << " for "
-          << elf_file->GetPath();
+  // Writes the piece at its offset. The pieces are written in the order of their offsets through
+  // a single stream, any gap before the piece is filled with zeros.
+  virtual bool Write(OutputStream* out) {
+    off_t position = out->Seek(0, kSeekCurrent);
+    if (position == static_cast<off_t>(-1)) {
+      PLOG(ERROR) << "Failed to get the position for " << GetDescription() << " in "
+          << out->GetLocation();
       return false;
     }
-
-    return DoActualWrite(elf_file);
+    if (static_cast<off_t>(offset_) < position) {
+      LOG(ERROR) << GetDescription() << " at offset " << offset_ << " overlaps the previous piece"
+          << " ending at " << position << " in " << out->GetLocation();
+      return false;
+    }
+    static const uint8_t kZeros[64] = { 0 };
+    for (size_t gap = offset_ - position; gap != 0u; ) {
+      size_t chunk = std::min(gap, sizeof(kZeros));
+      if (!out->WriteFully(kZeros, chunk)) {
+        PLOG(ERROR) << "Failed to write padding before " << GetDescription() << " in "
+            << out->GetLocation();
+        return false;
+      }
+      gap -= chunk;
+    }
+    return DoActualWrite(out);
   }
 
   static bool Compare(ElfFilePiece* a, ElfFilePiece* b) {
@@ -415,7 +434,7 @@ class ElfFilePiece {
   }
 
   virtual const char* GetDescription() const = 0;
-  virtual bool DoActualWrite(File* elf_file) = 0;
+  virtual bool DoActualWrite(OutputStream* out) = 0;
 
  private:
   const Elf_Word offset_;
@@ -430,11 +449,11 @@ class ElfFileMemoryPiece FINAL : public ElfFilePiece<Elf_Word> {
       : ElfFilePiece<Elf_Word>(offset), dbg_name_(name), data_(data), size_(size) {}
 
  protected:
-  bool DoActualWrite(File* elf_file) OVERRIDE {
+  bool DoActualWrite(OutputStream* out) OVERRIDE {
     DCHECK(data_ != nullptr || size_ == 0U) << dbg_name_ << " " << size_;
 
-    if (!elf_file->WriteFully(data_, size_)) {
-      PLOG(ERROR) << "Failed to write " << dbg_name_ << " for " << elf_file->GetPath();
+    if (!out->WriteFully(data_, size_)) {
+      PLOG(ERROR) << "Failed to write " << dbg_name_ << " for " << out->GetLocation();
       return false;
     }
 
@@ -465,12 +484,10 @@ class ElfFileRodataPiece FINAL : public ElfFilePiece<Elf_Word> {
       output_(output) {}
 
  protected:
-  bool DoActualWrite(File* elf_file) OVERRIDE {
+  bool DoActualWrite(OutputStream* out) OVERRIDE {
     output_->SetCodeOffset(this->GetOffset());
-    std::unique_ptr<BufferedOutputStream> output_stream(
-        new BufferedOutputStream(new FileOutputStream(elf_file)));
-    if (!output_->Write(output_stream.get())) {
-      PLOG(ERROR) << "Failed to write .rodata and .text for " << elf_file->GetPath();
+    if (!output_->Write(out)) {
+      PLOG(ERROR) << "Failed to write .rodata and .text for " << out->GetLocation();
       return false;
     }
 
@@ -493,14 +510,18 @@ class ElfFileOatTextPiece FINAL : public ElfFilePiece<Elf_Word> {
   ElfFileOatTextPiece(Elf_Word offset, CodeOutput* output) : ElfFilePiece<Elf_Word>(offset),
       output_(output) {}
 
- protected:
-  bool DoActualWrite(File* elf_file ATTRIBUTE_UNUSED) OVERRIDE {
+  bool Write(OutputStream* out ATTRIBUTE_UNUSED) OVERRIDE {
     // All data is written by the ElfFileRodataPiece right now, as the oat writer writes in one
     // piece. This is for future flexibility.
     UNUSED(output_);
     return true;
   }
 
+ protected:
+  bool DoActualWrite(OutputStream* out ATTRIBUTE_UNUSED) OVERRIDE {
+    return true;
+  }
+
   const char* GetDescription() const OVERRIDE {
     return ".text";
   }
@@ -511,17 +532,6 @@ class ElfFileOatTextPiece FINAL : public ElfFilePiece<Elf_Word> {
   DISALLOW_COPY_AND_ASSIGN(ElfFileOatTextPiece);
 };
 
-template <typename Elf_Word>
-static bool WriteOutFile(const std::vector<ElfFilePiece<Elf_Word>*>& pieces, File* elf_file) {
-  // TODO It would be nice if this checked for overlap.
-  for (auto it = pieces.begin(); it != pieces.end(); ++it) {
-    if (!(*it)->Write(elf_file)) {
-      return false;
-    }
-  }
-  return true;
-}
-
 template <typename Elf_Word, typename Elf_Shdr>
 static inline constexpr Elf_Word NextOffset(const Elf_Shdr& cur, const Elf_Shdr& prev) {
   return RoundUp(prev.sh_size + prev.sh_offset, cur.sh_addralign);
@@ -1008,9 +1018,7 @@ class ElfBuilder FINAL {
     elf_header_.e_shnum = section_ptrs_.size();
     elf_header_.e_shstrndx = shstrtab_builder_.GetSectionIndex();
 
-    // Add the rest of the pieces to the list.
-    pieces.push_back(new ElfFileMemoryPiece<Elf_Word>("Elf Header", 0, &elf_header_,
-                                                      sizeof(elf_header_)));
+    // Add the rest of the pieces to the list. The ELF header is written last.
     pieces.push_back(new ElfFileMemoryPiece<Elf_Word>("Program headers", PHDR_OFFSET,
                                                       &program_headers_, sizeof(program_headers_)));
     pieces.push_back(new ElfFileMemoryPiece<Elf_Word>(".dynamic",
@@ -1057,7 +1065,7 @@ class ElfBuilder FINAL {
                                                         it->GetBuffer()->size()));
     }
 
-    if (!WriteOutFile(pieces)) {
+    if (!WriteOutFile(&pieces)) {
       LOG(ERROR) << "Unable to write to file " << elf_file_->GetPath();
 
       STLDeleteElements(&pieces);  // Have to manually clean pieces.
@@ -1181,13 +1189,27 @@ class ElfBuilder FINAL {
   }
 
 
-  // Write each of the pieces out to the file.
-  bool WriteOutFile(const std::vector<ElfFilePiece<Elf_Word>*>& pieces) {
-    for (auto it = pieces.begin(); it != pieces.end(); ++it) {
-      if (!(*it)->Write(elf_file_)) {
+  // Write the pieces out to the file front to back through one buffered stream, so that the oat
+  // data is streamed out along with the rest without seeking around the file. The ELF header is
+  // left zeroed until everything else has been written, so an incomplete file is never taken for
+  // a valid ELF file.
+  bool WriteOutFile(std::vector<ElfFilePiece<Elf_Word>*>* pieces) {
+    std::stable_sort(pieces->begin(), pieces->end(), ElfFilePiece<Elf_Word>::Compare);
+    BufferedOutputStream out(new FileOutputStream(elf_file_));
+    if (out.Seek(0, kSeekSet) != 0) {
+      PLOG(ERROR) << "Failed to seek to the start of " << elf_file_->GetPath();
+      return false;
+    }
+    for (ElfFilePiece<Elf_Word>* piece : *pieces) {
+      if (!piece->Write(&out)) {
         return false;
       }
     }
+    if (out.Seek(0, kSeekSet) != 0 || !out.WriteFully(&elf_header_, sizeof(elf_header_)) ||
+        !out.Flush()) {
+      PLOG(ERROR) << "Failed to write Elf Header for " << elf_file_->GetPath();
+      return false;
+    }
     return true;
   }
 
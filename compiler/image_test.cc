@@ -16,6 +16,7 @@
 
 #include "image.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,15 +25,23 @@
 #include "class_linker.h"
 #include "common_compiler_test.h"
 #include "elf_writer.h"
+#include "gc/heap.h"
 #include "gc/space/image_space.h"
+#include "handle_scope-inl.h"
 #include "image_writer.h"
 #include "lock_word.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/dex_cache.h"
 #include "mirror/object-inl.h"
+#include "oat_file.h"
 #include "oat_writer.h"
 #include "scoped_thread_state_change.h"
 #include "signal_catcher.h"
 #include "utils.h"
 #include "vector_output_stream.h"
+#include "well_known_classes.h"
 
 namespace art {
 
@@ -42,6 +51,192 @@ class ImageTest : public CommonCompilerTest {
     ReserveImageSpace();
     CommonCompilerTest::SetUp();
   }
+
+  typedef ImageWriter::SavedHashes SavedHashes;
+
+  // What a writer has produced: the image and its bitmaps.
+  struct WrittenImage {
+    std::vector<uint8_t> image;
+    std::vector<uint8_t> image_bitmap;
+    std::vector<uint32_t> relocation_bitmap;
+  };
+
+  static WrittenImage GetWrittenImage(const ImageWriter& writer) {
+    WrittenImage written;
+    written.image.assign(writer.image_->Begin(), writer.image_->Begin() + writer.image_end_);
+    const uint8_t* image_bitmap = reinterpret_cast<const uint8_t*>(writer.image_bitmap_->Begin());
+    written.image_bitmap.assign(image_bitmap, image_bitmap + writer.image_bitmap_->Size());
+    written.relocation_bitmap = writer.relocation_bitmap_;
+    return written;
+  }
+
+  static SavedHashes GetSavedHashes(const ImageWriter& writer) {
+    return writer.saved_hashes_;
+  }
+
+  // Returns the bin slot that the given image offset was computed from.
+  static ImageWriter::BinSlot GetBinSlot(const ImageWriter& writer, size_t offset) {
+    for (size_t i = 0; i != ImageWriter::kBinSize; ++i) {
+      ImageWriter::Bin bin = static_cast<ImageWriter::Bin>(i);
+      size_t bin_begin = writer.image_objects_offset_begin_ + writer.GetBinSizeSum(bin);
+      if (offset < bin_begin + writer.bin_slot_sizes_[i]) {
+        return ImageWriter::BinSlot(bin, offset - bin_begin);
+      }
+    }
+    LOG(FATAL) << "No bin holds offset " << offset;
+    UNREACHABLE();
+  }
+
+  // Takes the writer back to where its objects had bin slots, with the saved_hashes it had after
+  // assigning the offsets, and assigns the offsets and copies the objects again. The writer's
+  // thread pool is gone once it has written the image, so this runs on the calling thread only.
+  static void RewriteOnCallingThread(ImageWriter* writer,
+                                     const SavedHashes& saved_hashes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    ASSERT_TRUE(writer->thread_pool_.get() == nullptr);
+    {
+      WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+      for (mirror::Object* obj : writer->GetHeapObjects()) {
+        ImageWriter::BinSlot bin_slot = GetBinSlot(*writer, writer->GetImageOffset(obj));
+        obj->SetLockWord(LockWord::FromForwardingAddress(static_cast<uint32_t>(bin_slot)), false);
+      }
+      for (const std::pair<mirror::Object*, uint32_t>& hash_pair : saved_hashes) {
+        size_t offset = reinterpret_cast<uint8_t*>(hash_pair.first) - writer->image_->Begin();
+        writer->saved_hashes_map_.insert(std::make_pair(GetBinSlot(*writer, offset),
+                                                        hash_pair.second));
+      }
+      writer->image_bitmap_->Clear();
+      memset(writer->image_->Begin() + writer->image_objects_offset_begin_, 0,
+             writer->image_end_ - writer->image_objects_offset_begin_);
+      std::fill(writer->relocation_bitmap_.begin(), writer->relocation_bitmap_.end(), 0u);
+      writer->AssignImageOffsets();
+    }
+    writer->CopyAndFixupObjects();
+  }
+
+  // Compiles the boot class path and writes it as a loadable image at image_filename, with the
+  // oat file next to it.
+  void WriteBootImage(const std::string& image_filename) {
+    std::string oat_filename(image_filename, 0, image_filename.size() - 3);
+    oat_filename += "oat";
+    std::unique_ptr<File> oat_file(OS::CreateEmptyFile(oat_filename.c_str()));
+    ASSERT_TRUE(oat_file.get() != nullptr);
+    ImageWriter writer(*compiler_driver_, ART_BASE_ADDRESS, /*compile_pic*/false);
+    {
+      ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+      TimingLogger timings("ImageTest::WriteBootImage", false, false);
+      for (const DexFile* dex_file : class_linker->GetBootClassPath()) {
+        dex_file->EnableWrite();
+      }
+      compiler_driver_->CompileAll(nullptr, class_linker->GetBootClassPath(), &timings);
+      SafeMap<std::string, std::string> key_value_store;
+      OatWriter oat_writer(class_linker->GetBootClassPath(), 0, 0, 0, compiler_driver_.get(),
+                           &writer, &timings, &key_value_store);
+      ASSERT_TRUE(writer.PrepareImageAddressSpace());
+      ASSERT_TRUE(compiler_driver_->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild,
+                                             class_linker->GetBootClassPath(), &oat_writer,
+                                             oat_file.get()));
+    }
+    ASSERT_EQ(0, oat_file->FlushClose());
+    oat_file.reset(OS::OpenFileReadWrite(oat_filename.c_str()));
+    ASSERT_TRUE(oat_file.get() != nullptr);
+    ASSERT_TRUE(writer.Write(image_filename, oat_filename, oat_filename));
+    ASSERT_TRUE(ElfWriter::Fixup(oat_file.get(), writer.GetOatDataBegin()));
+    ASSERT_EQ(0, oat_file->FlushCloseOrErase());
+  }
+
+  static std::vector<uint8_t> ReadFileContents(const std::string& filename) {
+    std::unique_ptr<File> file(OS::OpenFileForReading(filename.c_str()));
+    CHECK(file.get() != nullptr) << filename;
+    std::vector<uint8_t> contents(file->GetLength());
+    CHECK(file->ReadFully(contents.data(), contents.size())) << filename;
+    return contents;
+  }
+
+  static void WriteFileContents(const std::string& filename, const std::vector<uint8_t>& contents) {
+    std::unique_ptr<File> file(OS::CreateEmptyFile(filename.c_str()));
+    CHECK(file.get() != nullptr) << filename;
+    CHECK(file->WriteFully(contents.data(), contents.size())) << filename;
+    CHECK_EQ(0, file->FlushCloseOrErase()) << filename;
+  }
+
+  // Runs patchoat on the image at image_location and writes the result to output_filename.
+  static bool RelocateImage(const std::string& image_location, const std::string& output_filename,
+                            off_t delta, std::string* error_msg) {
+    std::vector<std::string> argv;
+    argv.push_back(Runtime::Current()->GetPatchoatExecutable());
+    argv.push_back("--input-image-location=" + image_location);
+    argv.push_back("--output-image-file=" + output_filename);
+    argv.push_back(std::string("--instruction-set=") + GetInstructionSetString(kRuntimeISA));
+    argv.push_back(StringPrintf("--base-offset-delta=%d", static_cast<int>(delta)));
+    return Exec(argv, error_msg);
+  }
+
+  // Replaces the runtime by one started from the boot image at image_location, a compiler one
+  // with the callbacks of the test if compiler is true. Leaves the thread suspended.
+  void RestartRuntime(const std::string& image_location, bool compiler) {
+    compiler_driver_.reset();
+    UnreserveImageSpace();
+    runtime_.reset();
+    java_lang_dex_file_ = nullptr;
+
+    MemMap::Init();
+    RuntimeOptions options;
+    std::string image("-Ximage:");
+    image.append(image_location);
+    options.push_back(std::make_pair(image.c_str(), nullptr));
+    options.push_back(std::make_pair("-Xnorelocate", nullptr));
+    if (compiler) {
+      options.push_back(std::make_pair("compilercallbacks", callbacks_.get()));
+    }
+    ASSERT_TRUE(Runtime::Create(options, false)) << "Failed to create runtime";
+    runtime_.reset(Runtime::Current());
+    class_linker_ = runtime_->GetClassLinker();
+    Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+    WellKnownClasses::Init(Thread::Current()->GetJniEnv());
+  }
+
+  // Returns a PathClassLoader that finds its classes in dex_files, without registering them.
+  static jobject CreateClassLoader(std::vector<const DexFile*>& dex_files) {
+    JNIEnv* env = Thread::Current()->GetJniEnv();
+    jobject class_loader_local = env->AllocObject(WellKnownClasses::dalvik_system_PathClassLoader);
+    jobject class_loader = env->NewGlobalRef(class_loader_local);
+    env->DeleteLocalRef(class_loader_local);
+    Runtime::Current()->SetCompileTimeClassPath(class_loader, dex_files);
+    return class_loader;
+  }
+
+  // Returns a PathClassLoader with the BootClassLoader as parent whose DexPathList has a single
+  // element with dex_files as its cookie, the class loader FindClassInPathClassLoader handles.
+  static jobject CreatePathClassLoader(std::vector<const DexFile*>* dex_files) {
+    JNIEnv* env = Thread::Current()->GetJniEnv();
+    jobject dex_file = env->AllocObject(WellKnownClasses::dalvik_system_DexFile);
+    env->SetLongField(dex_file, WellKnownClasses::dalvik_system_DexFile_cookie,
+                      static_cast<jlong>(reinterpret_cast<uintptr_t>(dex_files)));
+    jobject element = env->AllocObject(WellKnownClasses::dalvik_system_DexPathList__Element);
+    env->SetObjectField(element, WellKnownClasses::dalvik_system_DexPathList__Element_dexFile,
+                        dex_file);
+    jobjectArray dex_elements =
+        env->NewObjectArray(1, WellKnownClasses::dalvik_system_DexPathList__Element, element);
+    jobject dex_path_list = env->AllocObject(WellKnownClasses::dalvik_system_DexPathList);
+    env->SetObjectField(dex_path_list, WellKnownClasses::dalvik_system_DexPathList_dexElements,
+                        dex_elements);
+    jobject class_loader_local = env->AllocObject(WellKnownClasses::dalvik_system_PathClassLoader);
+    env->SetObjectField(class_loader_local,
+                        WellKnownClasses::dalvik_system_PathClassLoader_pathList, dex_path_list);
+    jfieldID parent = env->GetFieldID(WellKnownClasses::java_lang_ClassLoader, "parent",
+                                      "Ljava/lang/ClassLoader;");
+    jobject boot_class_loader = env->AllocObject(WellKnownClasses::java_lang_BootClassLoader);
+    env->SetObjectField(class_loader_local, parent, boot_class_loader);
+    jobject class_loader = env->NewGlobalRef(class_loader_local);
+    env->DeleteLocalRef(boot_class_loader);
+    env->DeleteLocalRef(class_loader_local);
+    env->DeleteLocalRef(dex_path_list);
+    env->DeleteLocalRef(dex_elements);
+    env->DeleteLocalRef(element);
+    env->DeleteLocalRef(dex_file);
+    return class_loader;
+  }
 };
 
 TEST_F(ImageTest, WriteRead) {
@@ -118,6 +313,15 @@ TEST_F(ImageTest, WriteRead) {
     ASSERT_TRUE(image_header.IsValid());
     ASSERT_GE(image_header.GetImageBitmapOffset(), sizeof(image_header));
     ASSERT_NE(0U, image_header.GetImageBitmapSize());
+    if (!kUseBrooksReadBarrier) {
+      ASSERT_EQ(ImageHeader::ComputeRelocationBitmapSize(image_header.GetImageSize()),
+                image_header.GetRelocationBitmapSize());
+      ASSERT_GE(image_header.GetRelocationBitmapOffset(),
+                image_header.GetImageBitmapOffset() + image_header.GetImageBitmapSize());
+      ASSERT_EQ(static_cast<int64_t>(image_header.GetRelocationBitmapOffset() +
+                                     image_header.GetRelocationBitmapSize()),
+                file->GetLength());
+    }
 
     gc::Heap* heap = Runtime::Current()->GetHeap();
     ASSERT_TRUE(!heap->GetContinuousSpaces().empty());
@@ -197,11 +401,243 @@ TEST_F(ImageTest, WriteRead) {
   CHECK_EQ(0, rmdir_result);
 }
 
+TEST_F(ImageTest, ParallelWriteMatchesSerial) {
+  TEST_DISABLED_FOR_PORTABLE();
+  // The writer uses as many threads as the compiler. The code doesn't matter here, so only
+  // compile what the image needs.
+  compiler_options_->SetCompilerFilter(CompilerOptions::kInterpretOnly);
+  compiler_driver_.reset(new CompilerDriver(compiler_options_.get(), verification_results_.get(),
+                                            method_inliner_map_.get(), Compiler::kQuick,
+                                            kRuntimeISA, instruction_set_features_.get(), true,
+                                            new std::set<std::string>, nullptr, 4, true, true,
+                                            timer_.get(), ""));
+  compiler_driver_->SetSupportBootImageFixup(false);
+
+  ScratchFile image_file;
+  ScratchFile oat_file;
+  std::unique_ptr<ImageWriter> writer(new ImageWriter(*compiler_driver_, ART_BASE_ADDRESS,
+                                                      /*compile_pic*/false));
+  SavedHashes saved_hashes;
+  {
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    TimingLogger timings("ImageTest::ParallelWriteMatchesSerial", false, false);
+    for (const DexFile* dex_file : class_linker->GetBootClassPath()) {
+      dex_file->EnableWrite();
+    }
+    compiler_driver_->CompileAll(nullptr, class_linker->GetBootClassPath(), &timings);
+    SafeMap<std::string, std::string> key_value_store;
+    OatWriter oat_writer(class_linker->GetBootClassPath(), 0, 0, 0, compiler_driver_.get(),
+                         writer.get(), &timings, &key_value_store);
+    ASSERT_TRUE(writer->PrepareImageAddressSpace());
+    ASSERT_TRUE(compiler_driver_->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild,
+                                           class_linker->GetBootClassPath(), &oat_writer,
+                                           oat_file.GetFile()));
+    saved_hashes = GetSavedHashes(*writer);
+  }
+  std::unique_ptr<File> dup_oat(OS::OpenFileReadWrite(oat_file.GetFilename().c_str()));
+  ASSERT_TRUE(dup_oat.get() != nullptr);
+  ASSERT_TRUE(writer->Write(image_file.GetFilename(), dup_oat->GetPath(), dup_oat->GetPath()));
+  ASSERT_EQ(0, dup_oat->FlushCloseOrErase());
+  WrittenImage parallel = GetWrittenImage(*writer);
+
+  ScopedObjectAccess soa(Thread::Current());
+  RewriteOnCallingThread(writer.get(), saved_hashes);
+  WrittenImage serial = GetWrittenImage(*writer);
+  ASSERT_EQ(serial.image.size(), parallel.image.size());
+  size_t first_difference =
+      std::mismatch(serial.image.begin(), serial.image.end(), parallel.image.begin()).first -
+      serial.image.begin();
+  EXPECT_EQ(serial.image.size(), first_difference) << "The images differ at " << first_difference;
+  EXPECT_TRUE(serial.image_bitmap == parallel.image_bitmap);
+  EXPECT_TRUE(serial.relocation_bitmap == parallel.relocation_bitmap);
+}
+
+TEST_F(ImageTest, RelocationBitmapMatchesObjectWalk) {
+  TEST_DISABLED_FOR_PORTABLE();
+  if (kUseBrooksReadBarrier) {
+    // Images written with a Brooks read barrier have no relocation bitmap.
+    return;
+  }
+  compiler_options_->SetCompilerFilter(CompilerOptions::kInterpretOnly);
+
+  // Write the image under two locations. patchoat relocates the first one with its relocation
+  // bitmap and, as the second one has a header without the bitmap, that one by walking the
+  // objects.
+  const char* isa = GetInstructionSetString(kRuntimeISA);
+  std::string bitmap_location = dalvik_cache_ + "/bitmap/core.art";
+  std::string walk_location = dalvik_cache_ + "/walk/core.art";
+  for (const std::string& dir : { dalvik_cache_ + "/bitmap", dalvik_cache_ + "/walk" }) {
+    ASSERT_EQ(0, mkdir(dir.c_str(), 0700)) << dir;
+    ASSERT_EQ(0, mkdir((dir + "/" + isa).c_str(), 0700)) << dir;
+  }
+  std::string bitmap_image = GetSystemImageFilename(bitmap_location.c_str(), kRuntimeISA);
+  std::string walk_image = GetSystemImageFilename(walk_location.c_str(), kRuntimeISA);
+  WriteBootImage(bitmap_image);
+
+  std::vector<uint8_t> image = ReadFileContents(bitmap_image);
+  ASSERT_GE(image.size(), sizeof(ImageHeader));
+  ImageHeader header;
+  memcpy(&header, image.data(), sizeof(header));
+  ASSERT_TRUE(header.IsValid());
+  ASSERT_NE(0u, header.GetRelocationBitmapSize());
+  ImageHeader walk_header(PointerToLowMemUInt32(header.GetImageBegin()),
+                          header.GetImageSize(),
+                          header.GetImageBitmapOffset(),
+                          header.GetImageBitmapSize(),
+                          /*relocation_bitmap_offset*/0u,
+                          /*relocation_bitmap_size*/0u,
+                          PointerToLowMemUInt32(header.GetImageRoots()),
+                          header.GetOatChecksum(),
+                          PointerToLowMemUInt32(header.GetOatFileBegin()),
+                          PointerToLowMemUInt32(header.GetOatDataBegin()),
+                          PointerToLowMemUInt32(header.GetOatDataEnd()),
+                          PointerToLowMemUInt32(header.GetOatFileEnd()),
+                          /*boot_image_begin*/0u,
+                          /*boot_image_size*/0u,
+                          header.CompilePic());
+  memcpy(image.data(), &walk_header, sizeof(walk_header));
+  WriteFileContents(walk_image, image);
+  std::string bitmap_oat(bitmap_image, 0, bitmap_image.size() - 3);
+  std::string walk_oat(walk_image, 0, walk_image.size() - 3);
+  WriteFileContents(walk_oat + "oat", ReadFileContents(bitmap_oat + "oat"));
+
+  const off_t delta = 16 * kPageSize;
+  std::string bitmap_output = dalvik_cache_ + "/bitmap-relocated.art";
+  std::string walk_output = dalvik_cache_ + "/walk-relocated.art";
+  std::string error_msg;
+  ASSERT_TRUE(RelocateImage(bitmap_location, bitmap_output, delta, &error_msg)) << error_msg;
+  ASSERT_TRUE(RelocateImage(walk_location, walk_output, delta, &error_msg)) << error_msg;
+
+  std::vector<uint8_t> bitmap_relocated = ReadFileContents(bitmap_output);
+  std::vector<uint8_t> walk_relocated = ReadFileContents(walk_output);
+  ASSERT_EQ(walk_relocated.size(), bitmap_relocated.size());
+  ImageHeader bitmap_header;
+  memcpy(&bitmap_header, bitmap_relocated.data(), sizeof(bitmap_header));
+  memcpy(&walk_header, walk_relocated.data(), sizeof(walk_header));
+  EXPECT_EQ(delta, bitmap_header.GetPatchDelta());
+  EXPECT_EQ(header.GetImageBegin() + delta, bitmap_header.GetImageBegin());
+  EXPECT_EQ(walk_header.GetPatchDelta(), bitmap_header.GetPatchDelta());
+  EXPECT_EQ(walk_header.GetImageBegin(), bitmap_header.GetImageBegin());
+  EXPECT_EQ(walk_header.GetImageRoots(), bitmap_header.GetImageRoots());
+  EXPECT_EQ(walk_header.GetOatFileBegin(), bitmap_header.GetOatFileBegin());
+  EXPECT_EQ(walk_header.GetOatDataBegin(), bitmap_header.GetOatDataBegin());
+  EXPECT_EQ(walk_header.GetOatDataEnd(), bitmap_header.GetOatDataEnd());
+  EXPECT_EQ(walk_header.GetOatFileEnd(), bitmap_header.GetOatFileEnd());
+  size_t first_difference =
+      std::mismatch(bitmap_relocated.begin() + sizeof(ImageHeader), bitmap_relocated.end(),
+                    walk_relocated.begin() + sizeof(ImageHeader)).first -
+      bitmap_relocated.begin();
+  EXPECT_EQ(bitmap_relocated.size(), first_difference)
+      << "The relocated images differ at " << first_difference;
+}
+
+TEST_F(ImageTest, AppImage) {
+  TEST_DISABLED_FOR_PORTABLE();
+  if (kUseBrooksReadBarrier) {
+    // App images are relocated with their relocation bitmap, which Brooks pointers are not in.
+    return;
+  }
+  compiler_options_->SetCompilerFilter(CompilerOptions::kInterpretOnly);
+  const char* isa = GetInstructionSetString(kRuntimeISA);
+  std::string boot_location = dalvik_cache_ + "/boot/core.art";
+  ASSERT_EQ(0, mkdir((dalvik_cache_ + "/boot").c_str(), 0700));
+  ASSERT_EQ(0, mkdir((dalvik_cache_ + "/boot/" + isa).c_str(), 0700));
+  WriteBootImage(GetSystemImageFilename(boot_location.c_str(), kRuntimeISA));
+
+  // Compile the app against the boot image and write its oat file and app image.
+  RestartRuntime(boot_location, /*compiler*/true);
+  std::string oat_filename = dalvik_cache_ + "/Interfaces.oat";
+  std::string app_image_filename = ImageHeader::GetAppImageLocationFromOatLocation(oat_filename);
+  EXPECT_EQ(dalvik_cache_ + "/Interfaces.art", app_image_filename);
+  {
+    compiler_driver_.reset(new CompilerDriver(compiler_options_.get(),
+                                              verification_results_.get(),
+                                              method_inliner_map_.get(), Compiler::kQuick,
+                                              kRuntimeISA, instruction_set_features_.get(),
+                                              false, nullptr, nullptr, 2, true, true,
+                                              timer_.get(), ""));
+    std::vector<const DexFile*> dex_files = OpenTestDexFiles("Interfaces");
+    ASSERT_EQ(1u, dex_files.size());
+    jobject class_loader;
+    {
+      ScopedObjectAccess soa(Thread::Current());
+      for (const DexFile* dex_file : dex_files) {
+        class_linker_->RegisterDexFile(*dex_file);
+      }
+      class_loader = CreateClassLoader(dex_files);
+    }
+    std::unique_ptr<File> oat_file(OS::CreateEmptyFile(oat_filename.c_str()));
+    ASSERT_TRUE(oat_file.get() != nullptr);
+    TimingLogger timings("ImageTest::AppImage", false, false);
+    compiler_driver_->CompileAll(class_loader, dex_files, &timings);
+    SafeMap<std::string, std::string> key_value_store;
+    OatWriter oat_writer(dex_files, 0, 0, 0, compiler_driver_.get(), nullptr, &timings,
+                         &key_value_store);
+    ASSERT_TRUE(compiler_driver_->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild, dex_files,
+                                           &oat_writer, oat_file.get()));
+    ASSERT_EQ(0, oat_file->Flush());
+
+    ImageWriter writer(*compiler_driver_, class_loader, dex_files);
+    ASSERT_TRUE(writer.PrepareImageAddressSpace());
+    ASSERT_TRUE(writer.WriteAppImage(app_image_filename, oat_file.get(), oat_filename));
+    ASSERT_EQ(0, oat_file->FlushCloseOrErase());
+  }
+
+  // Load the app through a PathClassLoader with dex files from the oat file, without a compile
+  // time class path FindClass goes through FindClassInPathClassLoader.
+  RestartRuntime(boot_location, /*compiler*/false);
+  ASSERT_FALSE(runtime_->IsCompiler());
+  std::string error_msg;
+  std::unique_ptr<OatFile> oat_file(OatFile::Open(oat_filename, oat_filename, nullptr, nullptr,
+                                                  false, &error_msg));
+  ASSERT_TRUE(oat_file.get() != nullptr) << error_msg;
+  ASSERT_EQ(1u, oat_file->GetOatDexFiles().size());
+  std::unique_ptr<const DexFile> dex_file(oat_file->GetOatDexFiles()[0]->OpenDexFile(&error_msg));
+  ASSERT_TRUE(dex_file.get() != nullptr) << error_msg;
+  std::vector<const DexFile*> dex_files(1u, dex_file.get());
+  jobject class_loader = CreatePathClassLoader(&dex_files);
+  ASSERT_FALSE(runtime_->UseCompileTimeClassPath());
+
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ClassLoader> loader(hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader)));
+  mirror::Class* klass = class_linker_->FindClass(soa.Self(), "LInterfaces$A;", loader);
+  ASSERT_TRUE(klass != nullptr);
+  gc::space::ContinuousSpace* space =
+      runtime_->GetHeap()->FindContinuousSpaceFromObject(klass, false);
+  ASSERT_TRUE(space != nullptr && space->IsImageSpace());
+  gc::space::ImageSpace* app_image = space->AsImageSpace();
+  EXPECT_TRUE(app_image->IsAppImage());
+  EXPECT_EQ(runtime_->GetHeap()->GetImageSpace()->Begin(),
+            app_image->Begin() + RoundUp(app_image->GetImageHeader().GetImageSize(), kPageSize));
+  EXPECT_EQ(loader.Get(), klass->GetClassLoader());
+  EXPECT_EQ(dex_file.get(), &klass->GetDexFile());
+  EXPECT_TRUE(class_linker_->IsDexFileRegistered(*dex_file));
+  for (size_t i = 0; i < klass->NumVirtualMethods(); ++i) {
+    EXPECT_TRUE(klass->GetVirtualMethod(i)->GetEntryPointFromQuickCompiledCode() != nullptr);
+  }
+  // The other classes of the image are there without being defined.
+  const char* descriptor = "LInterfaces$B;";
+  mirror::Class* other = class_linker_->LookupClass(soa.Self(), descriptor,
+                                                    ComputeModifiedUtf8Hash(descriptor),
+                                                    loader.Get());
+  ASSERT_TRUE(other != nullptr);
+  EXPECT_TRUE(app_image->Contains(other));
+  // The GC treats the app image like the boot image and keeps its references up to date.
+  {
+    ScopedThreadStateChange tsc(soa.Self(), kNative);
+    runtime_->GetHeap()->CollectGarbage(false);
+  }
+  EXPECT_EQ(loader.Get(), klass->GetClassLoader());
+}
+
 TEST_F(ImageTest, ImageHeaderIsValid) {
     uint32_t image_begin = ART_BASE_ADDRESS;
     uint32_t image_size_ = 16 * KB;
     uint32_t image_bitmap_offset = 0;
     uint32_t image_bitmap_size = 0;
+    uint32_t relocation_bitmap_offset = 0;
+    uint32_t relocation_bitmap_size = 0;
     uint32_t image_roots = ART_BASE_ADDRESS + (1 * KB);
     uint32_t oat_checksum = 0;
     uint32_t oat_file_begin = ART_BASE_ADDRESS + (4 * KB);  // page aligned
@@ -212,12 +648,16 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
                              image_size_,
                              image_bitmap_offset,
                              image_bitmap_size,
+                             relocation_bitmap_offset,
+                             relocation_bitmap_size,
                              image_roots,
                              oat_checksum,
                              oat_file_begin,
                              oat_data_begin,
                              oat_data_end,
                              oat_file_end,
+                             /*boot_image_begin*/0u,
+                             /*boot_image_size*/0u,
                              /*compile_pic*/false);
     ASSERT_TRUE(image_header.IsValid());
 
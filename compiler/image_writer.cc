@@ -18,12 +18,13 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
 #include "base/logging.h"
 #include "base/unix_file/fd_file.h"
-#include "class_linker.h"
+#include "class_linker-inl.h"
 #include "compiled_method.h"
 #include "dex_file-inl.h"
 #include "driver/compiler_driver.h"
@@ -34,6 +35,7 @@
 #include "gc/accounting/heap_bitmap.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
+#include "gc/space/image_space.h"
 #include "gc/space/large_object_space.h"
 #include "gc/space/space-inl.h"
 #include "globals.h"
@@ -54,6 +56,8 @@
 #include "runtime.h"
 #include "scoped_thread_state_change.h"
 #include "handle_scope-inl.h"
+#include "thread_pool.h"
+#include "utf.h"
 
 #include <numeric>
 
@@ -71,8 +75,47 @@ namespace art {
 // Separate objects into multiple bins to optimize dirty memory use.
 static constexpr bool kBinObjects = true;
 
+// Number of objects a task claims at a time when objects are visited in parallel.
+static constexpr size_t kObjectsPerChunk = 1024;
+
+static uintptr_t GetBootImageBegin() {
+  gc::space::ImageSpace* boot_image = Runtime::Current()->GetHeap()->GetImageSpace();
+  CHECK(boot_image != nullptr) << "App images refer to a boot image";
+  return reinterpret_cast<uintptr_t>(boot_image->Begin());
+}
+
+// The app image goes right below the boot image, image_begin_ is set once its size is known.
+ImageWriter::ImageWriter(const CompilerDriver& compiler_driver, jobject class_loader,
+                         const std::vector<const DexFile*>& dex_files)
+    : ImageWriter(compiler_driver, GetBootImageBegin(), /*compile_pic*/false) {
+  gc::space::ImageSpace* boot_image = Runtime::Current()->GetHeap()->GetImageSpace();
+  app_image_ = true;
+  app_class_loader_ = class_loader;
+  app_dex_files_ = dex_files;
+  boot_image_begin_ = boot_image->Begin();
+  boot_image_end_ = boot_image->End();
+}
+
 bool ImageWriter::PrepareImageAddressSpace() {
   target_ptr_size_ = InstructionSetPointerSize(compiler_driver_.GetInstructionSet());
+  if (app_image_) {
+    // The runtime relocates app images with their relocation bitmap, which has no Brooks
+    // pointers.
+    if (kUseBrooksReadBarrier) {
+      LOG(ERROR) << "App images are not supported with Brooks read barriers";
+      return false;
+    }
+    if (!AllocMemory()) {
+      return false;
+    }
+    if (thread_count_ > 1u) {
+      thread_pool_.reset(new ThreadPool("Image writer thread pool", thread_count_ - 1u));
+    }
+    Thread::Current()->TransitionFromSuspendedToRunnable();
+    bool success = CalculateAppImageObjectOffsets();
+    Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+    return success;
+  }
   {
     Thread::Current()->TransitionFromSuspendedToRunnable();
     PruneNonImageClasses();  // Remove junk
@@ -92,6 +135,12 @@ bool ImageWriter::PrepareImageAddressSpace() {
     CheckNonImageClassesRemoved();
   }
 
+  // The workers attach to the runtime, so create them while suspended. They are kept until the
+  // objects have been copied in Write().
+  if (thread_count_ > 1u) {
+    thread_pool_.reset(new ThreadPool("Image writer thread pool", thread_count_ - 1u));
+  }
+
   Thread::Current()->TransitionFromSuspendedToRunnable();
   CalculateNewObjectOffsets();
   Thread::Current()->TransitionFromRunnableToSuspended(kNative);
@@ -151,6 +200,7 @@ bool ImageWriter::Write(const std::string& image_filename,
   CreateHeader(oat_loaded_size, oat_data_offset);
   CopyAndFixupObjects();
   Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  thread_pool_.reset();
 
   SetOatChecksumFromElfFile(oat_file.get());
 
@@ -159,6 +209,35 @@ bool ImageWriter::Write(const std::string& image_filename,
     return false;
   }
 
+  return WriteImageFile(image_filename);
+}
+
+bool ImageWriter::WriteAppImage(const std::string& image_filename,
+                                File* oat_file,
+                                const std::string& oat_location) {
+  CHECK(app_image_);
+  CHECK(!image_filename.empty());
+  // The image only needs the checksum of the oat file, the runtime links the methods to it.
+  std::string error_msg;
+  std::unique_ptr<OatFile> app_oat_file(OatFile::OpenReadable(oat_file, oat_location,
+                                                              &error_msg));
+  if (app_oat_file.get() == nullptr) {
+    LOG(ERROR) << "Failed to open oat file " << oat_location << ": " << error_msg;
+    return false;
+  }
+  oat_file_ = app_oat_file.get();
+
+  Thread::Current()->TransitionFromSuspendedToRunnable();
+  CreateHeader(0u, 0u);
+  CopyAndFixupObjects();
+  Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  thread_pool_.reset();
+  oat_file_ = nullptr;
+
+  return WriteImageFile(image_filename);
+}
+
+bool ImageWriter::WriteImageFile(const std::string& image_filename) {
   std::unique_ptr<File> image_file(OS::CreateEmptyFile(image_filename.c_str()));
   ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin());
   if (image_file.get() == NULL) {
@@ -189,6 +268,16 @@ bool ImageWriter::Write(const std::string& image_filename,
     return false;
   }
 
+  // Write out the relocation bitmap after the image bitmap, for patchoat.
+  if (image_header->GetRelocationBitmapSize() != 0u &&
+      !image_file->Write(reinterpret_cast<char*>(relocation_bitmap_.data()),
+                         image_header->GetRelocationBitmapSize(),
+                         image_header->GetRelocationBitmapOffset())) {
+    PLOG(ERROR) << "Failed to write image file " << image_filename;
+    image_file->Erase();
+    return false;
+  }
+
   if (image_file->FlushCloseOrErase() != 0) {
     PLOG(ERROR) << "Failed to flush and close image file " << image_filename;
     return false;
@@ -198,20 +287,22 @@ bool ImageWriter::Write(const std::string& image_filename,
 
 void ImageWriter::SetImageOffset(mirror::Object* object,
                                  ImageWriter::BinSlot bin_slot,
-                                 size_t offset) {
+                                 size_t offset,
+                                 SavedHashes* saved_hashes) {
   DCHECK(object != nullptr);
   DCHECK_NE(offset, 0U);
   mirror::Object* obj = reinterpret_cast<mirror::Object*>(image_->Begin() + offset);
   DCHECK_ALIGNED(obj, kObjectAlignment);
 
-  image_bitmap_->Set(obj);  // Mark the obj as mutated, since we will end up changing it.
-  {
+  // Mark the obj as mutated, since we will end up changing it. Other threads may be setting bits
+  // in the same word of the bitmap.
+  image_bitmap_->AtomicTestAndSet(obj);
+  if (string_aliases_.find(object) == string_aliases_.end()) {
     // Remember the object-inside-of-the-image's hash code so we can restore it after the copy.
+    // The map is only read while offsets are being assigned, it is cleared afterwards.
     auto hash_it = saved_hashes_map_.find(bin_slot);
     if (hash_it != saved_hashes_map_.end()) {
-      std::pair<BinSlot, uint32_t> slot_hash = *hash_it;
-      saved_hashes_.push_back(std::make_pair(obj, slot_hash.second));
-      saved_hashes_map_.erase(hash_it);
+      saved_hashes->push_back(std::make_pair(obj, hash_it->second));
     }
   }
   // The object is already deflated from when we set the bin slot. Just overwrite the lock word.
@@ -219,7 +310,8 @@ void ImageWriter::SetImageOffset(mirror::Object* object,
   DCHECK(IsImageOffsetAssigned(object));
 }
 
-void ImageWriter::AssignImageOffset(mirror::Object* object, ImageWriter::BinSlot bin_slot) {
+void ImageWriter::AssignImageOffset(mirror::Object* object, ImageWriter::BinSlot bin_slot,
+                                    SavedHashes* saved_hashes) {
   DCHECK(object != nullptr);
   DCHECK_NE(image_objects_offset_begin_, 0u);
 
@@ -227,7 +319,7 @@ void ImageWriter::AssignImageOffset(mirror::Object* object, ImageWriter::BinSlot
   size_t new_offset = image_objects_offset_begin_ + previous_bin_sizes + bin_slot.GetIndex();
   DCHECK_ALIGNED(new_offset, kObjectAlignment);
 
-  SetImageOffset(object, bin_slot, new_offset);
+  SetImageOffset(object, bin_slot, new_offset, saved_hashes);
   DCHECK_LT(new_offset, image_end_);
 }
 
@@ -264,7 +356,10 @@ void ImageWriter::SetImageBinSlot(mirror::Object* object, BinSlot bin_slot) {
       break;
     }
     case LockWord::kUnlocked:
-      // No hash, don't need to save it.
+      // Fall-through.
+    case LockWord::kBiased:
+      // No hash, don't need to save it. A bias towards a compiler thread is meaningless at
+      // runtime and gets dropped with the lock word.
       break;
     case LockWord::kHashCode:
       saved_hashes_map_[bin_slot] = lw.GetHashCode();
@@ -693,6 +788,104 @@ void ImageWriter::CheckNonImageClassesRemovedCallback(Object* obj, void* arg) {
   }
 }
 
+struct AppImageClassCandidates {
+  mirror::ClassLoader* class_loader;
+  const std::vector<const DexFile*>* dex_files;
+  std::vector<Class*> classes;
+};
+
+static bool AppImageClassCandidatesVisitor(Class* klass, void* arg)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  AppImageClassCandidates* candidates = reinterpret_cast<AppImageClassCandidates*>(arg);
+  if (klass->GetClassLoader() != candidates->class_loader || klass->IsTemp() ||
+      klass->IsErroneous() || klass->IsArrayClass() || klass->IsProxyClass()) {
+    return true;
+  }
+  // Initialized classes would bring their static field values along, their class initializers
+  // run at runtime instead.
+  Class::Status status = klass->GetStatus();
+  if (status != Class::kStatusResolved && status != Class::kStatusRetryVerificationAtRuntime &&
+      status != Class::kStatusVerified) {
+    return true;
+  }
+  const std::vector<const DexFile*>& dex_files = *candidates->dex_files;
+  if (std::find(dex_files.begin(), dex_files.end(), &klass->GetDexFile()) != dex_files.end()) {
+    candidates->classes.push_back(klass);
+  }
+  return true;
+}
+
+void ImageWriter::ComputeAppImageClasses() {
+  Thread* self = Thread::Current();
+  AppImageClassCandidates candidates;
+  candidates.class_loader = down_cast<mirror::ClassLoader*>(self->DecodeJObject(app_class_loader_));
+  candidates.dex_files = &app_dex_files_;
+  Runtime::Current()->GetClassLinker()->VisitClasses(AppImageClassCandidatesVisitor, &candidates);
+
+  // Drop the classes whose superclass or interfaces are in neither image, until none is left.
+  app_image_class_set_.insert(candidates.classes.begin(), candidates.classes.end());
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (Class* klass : candidates.classes) {
+      if (app_image_class_set_.find(klass) == app_image_class_set_.end()) {
+        continue;
+      }
+      bool in_images = true;
+      Class* super_class = klass->GetSuperClass();
+      if (super_class != nullptr && !IsInBootImage(super_class) && !IsAppImageClass(super_class)) {
+        in_images = false;
+      }
+      for (int32_t i = 0, count = klass->GetIfTableCount(); in_images && i != count; ++i) {
+        Class* interface = klass->GetIfTable()->GetInterface(i);
+        in_images = IsInBootImage(interface) || IsAppImageClass(interface);
+      }
+      if (!in_images) {
+        app_image_class_set_.erase(klass);
+        changed = true;
+      }
+    }
+  }
+  for (Class* klass : candidates.classes) {
+    if (IsAppImageClass(klass)) {
+      app_image_classes_.push_back(klass);
+    }
+  }
+}
+
+bool ImageWriter::IsAppImageClass(Class* klass) const {
+  return app_image_class_set_.find(klass) != app_image_class_set_.end();
+}
+
+void ImageWriter::PruneAppDexCaches() {
+  Runtime* runtime = Runtime::Current();
+  ClassLinker* class_linker = runtime->GetClassLinker();
+  ArtMethod* resolution_method = runtime->GetResolutionMethod();
+  for (const DexFile* dex_file : app_dex_files_) {
+    DexCache* dex_cache = class_linker->FindDexCache(*dex_file);
+    for (size_t i = 0; i < dex_cache->NumResolvedTypes(); i++) {
+      Class* klass = dex_cache->GetResolvedType(i);
+      if (klass != nullptr && !IsInBootImage(klass) && !IsAppImageClass(klass)) {
+        dex_cache->SetResolvedType(i, nullptr);
+      }
+    }
+    for (size_t i = 0; i < dex_cache->NumResolvedMethods(); i++) {
+      ArtMethod* method = dex_cache->GetResolvedMethod(i);
+      if (method != nullptr && !IsInBootImage(method) &&
+          !IsAppImageClass(method->GetDeclaringClass())) {
+        dex_cache->SetResolvedMethod(i, resolution_method);
+      }
+    }
+    for (size_t i = 0; i < dex_cache->NumResolvedFields(); i++) {
+      ArtField* field = dex_cache->GetResolvedField(i);
+      if (field != nullptr && !IsInBootImage(field) &&
+          !IsAppImageClass(field->GetDeclaringClass())) {
+        dex_cache->SetResolvedField(i, nullptr);
+      }
+    }
+  }
+}
+
 void ImageWriter::DumpImageClasses() {
   const std::set<std::string>* image_classes = compiler_driver_.GetImageClasses();
   CHECK(image_classes != NULL);
@@ -718,6 +911,7 @@ void ImageWriter::CalculateObjectBinSlots(Object* obj) {
       }
       // point those looking for this object to the interned version.
       SetImageBinSlot(obj, GetImageBinSlot(interned));
+      string_aliases_.insert(obj);
       return;
     }
     // else (obj == interned), nothing to do but fall through to the normal case
@@ -779,6 +973,150 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   return image_roots.Get();
 }
 
+ObjectArray<Object>* ImageWriter::CreateAppImageRoots() const {
+  Runtime* runtime = Runtime::Current();
+  ClassLinker* class_linker = runtime->GetClassLinker();
+  Thread* self = Thread::Current();
+  StackHandleScope<4> hs(self);
+  Handle<Class> object_array_class(hs.NewHandle(
+      class_linker->FindSystemClass(self, "[Ljava/lang/Object;")));
+  // Classes are not moved by the allocations, they are in the non-moving space.
+  Handle<ObjectArray<Object>> dex_caches(hs.NewHandle(
+      ObjectArray<Object>::Alloc(self, object_array_class.Get(), app_dex_files_.size())));
+  CHECK(dex_caches.Get() != nullptr) << "Failed to allocate a dex cache array.";
+  Handle<ObjectArray<Object>> classes(hs.NewHandle(
+      ObjectArray<Object>::Alloc(self, object_array_class.Get(), app_image_classes_.size())));
+  CHECK(classes.Get() != nullptr) << "Failed to allocate a class array.";
+  for (size_t i = 0; i != app_dex_files_.size(); ++i) {
+    dex_caches->Set<false>(i, class_linker->FindDexCache(*app_dex_files_[i]));
+  }
+  for (size_t i = 0; i != app_image_classes_.size(); ++i) {
+    classes->Set<false>(i, app_image_classes_[i]);
+  }
+
+  // The runtime methods are those of the boot image, the dex caches and classes those of the app.
+  Handle<ObjectArray<Object>> image_roots(hs.NewHandle(
+      ObjectArray<Object>::Alloc(self, object_array_class.Get(), ImageHeader::kImageRootsMax)));
+  CHECK(image_roots.Get() != nullptr) << "Failed to allocate the image roots.";
+  image_roots->Set<false>(ImageHeader::kResolutionMethod, runtime->GetResolutionMethod());
+  image_roots->Set<false>(ImageHeader::kImtConflictMethod, runtime->GetImtConflictMethod());
+  image_roots->Set<false>(ImageHeader::kImtUnimplementedMethod,
+                          runtime->GetImtUnimplementedMethod());
+  image_roots->Set<false>(ImageHeader::kDefaultImt, runtime->GetDefaultImt());
+  image_roots->Set<false>(ImageHeader::kCalleeSaveMethod,
+                          runtime->GetCalleeSaveMethod(Runtime::kSaveAll));
+  image_roots->Set<false>(ImageHeader::kRefsOnlySaveMethod,
+                          runtime->GetCalleeSaveMethod(Runtime::kRefsOnly));
+  image_roots->Set<false>(ImageHeader::kRefsAndArgsSaveMethod,
+                          runtime->GetCalleeSaveMethod(Runtime::kRefsAndArgs));
+  image_roots->Set<false>(ImageHeader::kDexCaches, dex_caches.Get());
+  image_roots->Set<false>(ImageHeader::kClassRoots, classes.Get());
+  for (int i = 0; i < ImageHeader::kImageRootsMax; i++) {
+    CHECK(image_roots->Get(i) != nullptr);
+  }
+  return image_roots.Get();
+}
+
+static bool IsDexCache(Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  return obj->GetClass() == class_linker->GetClassRoot(ClassLinker::kJavaLangDexCache);
+}
+
+bool ImageWriter::IsOmittedAppImageReference(Object* obj, MemberOffset offset) const {
+  if (!app_image_) {
+    return false;
+  }
+  // Classes get the class loader that loads the image, dex caches have no Dex object until
+  // one is asked for.
+  if (offset.Uint32Value() == Class::ClassLoaderOffset().Uint32Value() && obj->IsClass()) {
+    return true;
+  }
+  return offset.Uint32Value() == DexCache::DexOffset().Uint32Value() && IsDexCache(obj);
+}
+
+// Pushes the references of the objects it visits that are not in the boot image.
+class AppImageObjectCollector {
+ public:
+  AppImageObjectCollector(const ImageWriter* image_writer, std::vector<Object*>* work_list)
+      : image_writer_(image_writer), work_list_(work_list) {
+  }
+
+  void operator()(Object* obj, MemberOffset offset, bool /*is_static*/) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (!image_writer_->IsOmittedAppImageReference(obj, offset)) {
+      Push(obj->GetFieldObject<Object, kVerifyNone>(offset));
+    }
+  }
+
+  void operator()(Class* /*klass*/, mirror::Reference* ref) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    Push(ref->GetReferent());
+  }
+
+ private:
+  void Push(Object* ref) const {
+    if (ref != nullptr && !image_writer_->IsInBootImage(ref)) {
+      work_list_->push_back(ref);
+    }
+  }
+
+  const ImageWriter* const image_writer_;
+  std::vector<Object*>* const work_list_;
+};
+
+bool ImageWriter::CollectAppImageObjects(ObjectArray<Object>* image_roots) {
+  // Depth first, so that objects tend to be next to what refers to them.
+  std::unordered_set<Object*> visited;
+  std::vector<Object*> work_list(1u, image_roots);
+  AppImageObjectCollector collector(this, &work_list);
+  while (!work_list.empty()) {
+    Object* obj = work_list.back();
+    work_list.pop_back();
+    if (!visited.insert(obj).second) {
+      continue;
+    }
+    if (obj->IsClass() && !IsAppImageClass(obj->AsClass())) {
+      LOG(ERROR) << "App image refers to " << PrettyClass(obj->AsClass())
+                 << ", which is in neither the boot image nor the app image";
+      return false;
+    }
+    app_image_objects_.push_back(obj);
+    obj->VisitReferences<true /*visit class*/>(collector, collector);
+  }
+  return true;
+}
+
+bool ImageWriter::CalculateAppImageObjectOffsets() {
+  Thread* self = Thread::Current();
+  ComputeAppImageClasses();
+  if (app_image_classes_.empty()) {
+    LOG(ERROR) << "No classes for the app image";
+    return false;
+  }
+  PruneAppDexCaches();
+  StackHandleScope<1> hs(self);
+  Handle<ObjectArray<Object>> image_roots(hs.NewHandle(CreateAppImageRoots()));
+
+  DCHECK_EQ(0U, image_end_);
+  image_end_ += RoundUp(sizeof(ImageHeader), kObjectAlignment);  // 64-bit-alignment
+  {
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    DCHECK_LT(image_end_, image_->Size());
+    image_objects_offset_begin_ = image_end_;
+    // Only take over the lock words once it is known that the image can be written.
+    if (!CollectAppImageObjects(image_roots.Get())) {
+      return false;
+    }
+    for (Object* obj : app_image_objects_) {
+      AssignImageBinSlot(obj);
+    }
+    image_begin_ = const_cast<uint8_t*>(boot_image_begin_) - RoundUp(image_end_, kPageSize);
+    AssignImageOffsets();
+  }
+  image_roots_address_ = PointerToLowMemUInt32(GetImageAddress(image_roots.Get()));
+  return true;
+}
+
 // Walk instance fields of the given Class. Separate function to allow recursion on the super
 // class.
 void ImageWriter::WalkInstanceFields(mirror::Object* obj, mirror::Class* klass) {
@@ -846,13 +1184,7 @@ void ImageWriter::WalkFieldsCallback(mirror::Object* obj, void* arg) {
   writer->WalkFieldsInOrder(obj);
 }
 
-void ImageWriter::UnbinObjectsIntoOffsetCallback(mirror::Object* obj, void* arg) {
-  ImageWriter* writer = reinterpret_cast<ImageWriter*>(arg);
-  DCHECK(writer != nullptr);
-  writer->UnbinObjectsIntoOffset(obj);
-}
-
-void ImageWriter::UnbinObjectsIntoOffset(mirror::Object* obj) {
+void ImageWriter::UnbinObjectsIntoOffset(size_t task_index, mirror::Object* obj) {
   CHECK(obj != nullptr);
 
   // We know the bin slot, and the total bin sizes for all objects by now,
@@ -861,7 +1193,127 @@ void ImageWriter::UnbinObjectsIntoOffset(mirror::Object* obj) {
   DCHECK(IsImageBinSlotAssigned(obj));
   BinSlot bin_slot = GetImageBinSlot(obj);
   // Change the lockword from a bin slot into an offset
-  AssignImageOffset(obj, bin_slot);
+  AssignImageOffset(obj, bin_slot, &task_saved_hashes_[task_index]);
+}
+
+std::vector<Class*> ImageWriter::FindHotClasses() {
+  Thread* self = Thread::Current();
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  std::vector<Class*> hot_classes;
+  for (const std::string& descriptor : hot_class_descriptors_) {
+    Class* klass = class_linker->LookupClass(self, descriptor.c_str(),
+                                             ComputeModifiedUtf8Hash(descriptor.c_str()), nullptr);
+    if (klass == nullptr) {
+      // Not every class of a profile needs to be an image class.
+      VLOG(compiler) << "Hot class " << descriptor << " is not in the image";
+      continue;
+    }
+    hot_classes.push_back(klass);
+  }
+  return hot_classes;
+}
+
+// Adds array and its elements to objects.
+template <typename T>
+static void AddArrayAndElements(ObjectArray<T>* array, std::vector<Object*>* objects)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (array != nullptr) {
+    objects->push_back(array);
+    for (int32_t i = 0, length = array->GetLength(); i != length; ++i) {
+      objects->push_back(array->Get(i));
+    }
+  }
+}
+
+void ImageWriter::AssignHotClassBinSlots(const std::vector<Class*>& hot_classes) {
+  // Only the class and what it owns, walking its fields would drag in dex caches and the like.
+  // The bins are kept, so the hot objects go at the start of each bin.
+  std::vector<Object*> hot_objects;
+  for (Class* klass : hot_classes) {
+    hot_objects.push_back(klass);
+    AddArrayAndElements(klass->GetDirectMethods(), &hot_objects);
+    AddArrayAndElements(klass->GetVirtualMethods(), &hot_objects);
+    AddArrayAndElements(klass->GetSFields(), &hot_objects);
+    AddArrayAndElements(klass->GetIFields(), &hot_objects);
+  }
+  for (Object* obj : hot_objects) {
+    if (obj != nullptr && !IsImageBinSlotAssigned(obj)) {
+      CalculateObjectBinSlots(obj);
+    }
+  }
+}
+
+std::vector<Object*> ImageWriter::GetHeapObjects() {
+  if (app_image_) {
+    // The app image objects are all there is to the image, the rest of the heap is left alone.
+    return app_image_objects_;
+  }
+  std::vector<Object*> objects;
+  Runtime::Current()->GetHeap()->VisitObjects([](Object* obj, void* arg) {
+    reinterpret_cast<std::vector<Object*>*>(arg)->push_back(obj);
+  }, &objects);
+  // VisitObjects walks the spaces in turn, they need not be in address order.
+  std::sort(objects.begin(), objects.end());
+  return objects;
+}
+
+class ImageWriter::VisitObjectsTask FINAL : public Task {
+ public:
+  VisitObjectsTask(ImageWriter* image_writer,
+                   void (ImageWriter::*visitor)(size_t task_index, Object* obj),
+                   const std::vector<Object*>* objects, Atomic<size_t>* next_index,
+                   size_t task_index)
+      : image_writer_(image_writer),
+        visitor_(visitor),
+        objects_(objects),
+        next_index_(next_index),
+        task_index_(task_index) {}
+
+  // Like the GC's marking tasks, this runs while the thread that started the tasks holds the
+  // mutator lock and the heap bitmap lock.
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    const size_t num_objects = objects_->size();
+    while (true) {
+      const size_t begin = next_index_->FetchAndAddSequentiallyConsistent(kObjectsPerChunk);
+      if (begin >= num_objects) {
+        break;
+      }
+      const size_t end = std::min(begin + kObjectsPerChunk, num_objects);
+      for (size_t i = begin; i != end; ++i) {
+        (image_writer_->*visitor_)(task_index_, (*objects_)[i]);
+      }
+    }
+  }
+
+  virtual void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ImageWriter* const image_writer_;
+  void (ImageWriter::*const visitor_)(size_t task_index, Object* obj);
+  const std::vector<Object*>* const objects_;
+  Atomic<size_t>* const next_index_;
+  const size_t task_index_;
+};
+
+void ImageWriter::VisitObjectsParallel(const std::vector<Object*>& objects,
+                                       void (ImageWriter::*visitor)(size_t task_index,
+                                                                    Object* obj)) {
+  Thread* self = Thread::Current();
+  Atomic<size_t> next_index(0u);
+  if (thread_pool_.get() == nullptr) {
+    VisitObjectsTask task(this, visitor, &objects, &next_index, 0u);
+    task.Run(self);
+    return;
+  }
+  DCHECK_EQ(thread_pool_->GetThreadCount() + 1u, thread_count_);
+  for (size_t i = 0; i != thread_count_; ++i) {
+    thread_pool_->AddTask(self, new VisitObjectsTask(this, visitor, &objects, &next_index, i));
+  }
+  thread_pool_->StartWorkers(self);
+  thread_pool_->Wait(self, true, true);
+  thread_pool_->StopWorkers(self);
 }
 
 void ImageWriter::CalculateNewObjectOffsets() {
@@ -876,16 +1328,18 @@ void ImageWriter::CalculateNewObjectOffsets() {
   // know where image_roots is going to end up
   image_end_ += RoundUp(sizeof(ImageHeader), kObjectAlignment);  // 64-bit-alignment
 
+  const std::vector<Class*> hot_classes = FindHotClasses();
+
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     // TODO: Image spaces only?
     DCHECK_LT(image_end_, image_->Size());
     image_objects_offset_begin_ = image_end_;
     // Clear any pre-existing monitors which may have been in the monitor words, assign bin slots.
+    // This stays on one thread, the order of the walk determines the layout of the image.
+    AssignHotClassBinSlots(hot_classes);
     heap->VisitObjects(WalkFieldsCallback, this);
-    // Transform each object's bin slot into an offset which will be used to do the final copy.
-    heap->VisitObjects(UnbinObjectsIntoOffsetCallback, this);
-    DCHECK(saved_hashes_map_.empty());  // All binslot hashes should've been put into vector by now.
+    AssignImageOffsets();
   }
 
   DCHECK_GT(image_end_, GetBinSizeSum());
@@ -895,29 +1349,59 @@ void ImageWriter::CalculateNewObjectOffsets() {
   // Note that image_end_ is left at end of used space
 }
 
-void ImageWriter::CreateHeader(size_t oat_loaded_size, size_t oat_data_offset) {
-  CHECK_NE(0U, oat_loaded_size);
-  const uint8_t* oat_file_begin = GetOatFileBegin();
-  const uint8_t* oat_file_end = oat_file_begin + oat_loaded_size;
+void ImageWriter::AssignImageOffsets() {
+  // Transform each object's bin slot into an offset which will be used to do the final copy.
+  // Each object only changes its own lock word, so this can be split over the heap.
+  task_saved_hashes_.resize(thread_count_);
+  VisitObjectsParallel(GetHeapObjects(), &ImageWriter::UnbinObjectsIntoOffset);
+  for (SavedHashes& hashes : task_saved_hashes_) {
+    saved_hashes_.insert(saved_hashes_.end(), hashes.begin(), hashes.end());
+  }
+  task_saved_hashes_.clear();
+  // All binslot hashes should've been put into the vector by now.
+  DCHECK_EQ(saved_hashes_.size(), saved_hashes_map_.size());
+  saved_hashes_map_.clear();
+}
 
-  oat_data_begin_ = oat_file_begin + oat_data_offset;
-  const uint8_t* oat_data_end = oat_data_begin_ + oat_file_->Size();
+void ImageWriter::CreateHeader(size_t oat_loaded_size, size_t oat_data_offset) {
+  // An app image has no oat file addresses, see ImageHeader::IsAppImage().
+  const uint8_t* oat_file_begin = nullptr;
+  const uint8_t* oat_file_end = nullptr;
+  const uint8_t* oat_data_end = nullptr;
+  if (!app_image_) {
+    CHECK_NE(0U, oat_loaded_size);
+    oat_file_begin = GetOatFileBegin();
+    oat_file_end = oat_file_begin + oat_loaded_size;
+    oat_data_begin_ = oat_file_begin + oat_data_offset;
+    oat_data_end = oat_data_begin_ + oat_file_->Size();
+  }
 
   // Return to write header at start of image with future location of image_roots. At this point,
   // image_end_ is the size of the image (excluding bitmaps).
   const size_t heap_bytes_per_bitmap_byte = kBitsPerByte * kObjectAlignment;
   const size_t bitmap_bytes = RoundUp(image_end_, heap_bytes_per_bitmap_byte) /
       heap_bytes_per_bitmap_byte;
+  const size_t bitmap_offset = RoundUp(image_end_, kPageSize);
+  const size_t bitmap_size = RoundUp(bitmap_bytes, kPageSize);
+  // The relocation bitmap is filled in while the objects are copied. Brooks pointers are not
+  // recorded in it, so leave it out when they are used and let patchoat walk the objects.
+  const size_t relocation_bitmap_size =
+      kUseBrooksReadBarrier ? 0u : ImageHeader::ComputeRelocationBitmapSize(image_end_);
+  relocation_bitmap_.assign(relocation_bitmap_size / sizeof(uint32_t), 0u);
   new (image_->Begin()) ImageHeader(PointerToLowMemUInt32(image_begin_),
                                     static_cast<uint32_t>(image_end_),
-                                    RoundUp(image_end_, kPageSize),
-                                    RoundUp(bitmap_bytes, kPageSize),
+                                    bitmap_offset,
+                                    bitmap_size,
+                                    bitmap_offset + bitmap_size,
+                                    relocation_bitmap_size,
                                     image_roots_address_,
                                     oat_file_->GetOatHeader().GetChecksum(),
                                     PointerToLowMemUInt32(oat_file_begin),
                                     PointerToLowMemUInt32(oat_data_begin_),
                                     PointerToLowMemUInt32(oat_data_end),
                                     PointerToLowMemUInt32(oat_file_end),
+                                    PointerToLowMemUInt32(boot_image_begin_),
+                                    static_cast<uint32_t>(boot_image_end_ - boot_image_begin_),
                                     compile_pic_);
 }
 
@@ -928,21 +1412,33 @@ void ImageWriter::CopyAndFixupObjects() {
   heap->DisableObjectValidation();
   // TODO: Image spaces only?
   WriterMutexLock mu(ants.Self(), *Locks::heap_bitmap_lock_);
-  heap->VisitObjects(CopyAndFixupObjectsCallback, this);
+  // Every object is copied to its own location and only reads the others, so this can be split
+  // over the heap.
+  VisitObjectsParallel(GetHeapObjects(), &ImageWriter::CopyAndFixupObject);
   // Fix up the object previously had hash codes.
   for (const std::pair<mirror::Object*, uint32_t>& hash_pair : saved_hashes_) {
     hash_pair.first->SetLockWord(LockWord::FromHashCode(hash_pair.second), false);
   }
   saved_hashes_.clear();
+  if (app_image_) {
+    // The compiler keeps running with these objects, give them back their hash codes in place of
+    // the forwarding addresses.
+    for (Object* obj : app_image_objects_) {
+      Object* copy = reinterpret_cast<Object*>(image_->Begin() + GetImageOffset(obj));
+      obj->SetLockWord(copy->GetLockWord(false), false);
+    }
+  }
 }
 
-void ImageWriter::CopyAndFixupObjectsCallback(Object* obj, void* arg) {
+void ImageWriter::CopyAndFixupObject(size_t task_index ATTRIBUTE_UNUSED, Object* obj) {
   DCHECK(obj != nullptr);
-  DCHECK(arg != nullptr);
-  ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  if (string_aliases_.find(obj) != string_aliases_.end()) {
+    // The interned string is copied to the same location.
+    return;
+  }
   // see GetLocalAddress for similar computation
-  size_t offset = image_writer->GetImageOffset(obj);
-  uint8_t* dst = image_writer->image_->Begin() + offset;
+  size_t offset = GetImageOffset(obj);
+  uint8_t* dst = image_->Begin() + offset;
   const uint8_t* src = reinterpret_cast<const uint8_t*>(obj);
   size_t n;
   if (obj->IsArtMethod()) {
@@ -952,13 +1448,13 @@ void ImageWriter::CopyAndFixupObjectsCallback(Object* obj, void* arg) {
   } else {
     n = obj->SizeOf();
   }
-  DCHECK_LT(offset + n, image_writer->image_->Size());
+  DCHECK_LT(offset + n, image_->Size());
   memcpy(dst, src, n);
   Object* copy = reinterpret_cast<Object*>(dst);
   // Write in a hash code of objects which have inflated monitors or a hash code in their monitor
   // word.
   copy->SetLockWord(LockWord(), false);
-  image_writer->FixupObject(obj, copy);
+  FixupObject(obj, copy);
 }
 
 // Rewrite all the references in the copied object to point to their image address equivalent
@@ -969,11 +1465,16 @@ class FixupVisitor {
 
   void operator()(Object* obj, MemberOffset offset, bool /*is_static*/) const
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_) {
-    Object* ref = obj->GetFieldObject<Object, kVerifyNone>(offset);
+    Object* ref = image_writer_->IsOmittedAppImageReference(obj, offset)
+        ? nullptr
+        : obj->GetFieldObject<Object, kVerifyNone>(offset);
     // Use SetFieldObjectWithoutWriteBarrier to avoid card marking since we are writing to the
     // image.
     copy_->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(
         offset, image_writer_->GetImageAddress(ref));
+    if (ref != nullptr) {
+      image_writer_->MarkRelocation(reinterpret_cast<uint8_t*>(copy_) + offset.Uint32Value());
+    }
   }
 
   // java.lang.ref.Reference visitor.
@@ -982,6 +1483,10 @@ class FixupVisitor {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
     copy_->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(
         mirror::Reference::ReferentOffset(), image_writer_->GetImageAddress(ref->GetReferent()));
+    if (ref->GetReferent() != nullptr) {
+      image_writer_->MarkRelocation(reinterpret_cast<uint8_t*>(copy_) +
+                                    mirror::Reference::ReferentOffset().Uint32Value());
+    }
   }
 
  protected:
@@ -1031,12 +1536,54 @@ void ImageWriter::FixupObject(Object* orig, Object* copy) {
     FixupVisitor visitor(this, copy);
     orig->VisitReferences<true /*visit class*/>(visitor, visitor);
   }
-  if (orig->IsArtMethod<kVerifyNone>()) {
+  if (orig->IsArtMethod<kVerifyNone>() && app_image_) {
+    // The entry points are left null, the runtime links the methods when it loads the image.
+  } else if (orig->IsArtMethod<kVerifyNone>()) {
     FixupMethod(orig->AsArtMethod<kVerifyNone>(), down_cast<ArtMethod*>(copy));
+    // The entry points are the same ones patchoat moves, those that are set.
+    MarkPointerRelocation(copy, ArtMethod::EntryPointFromPortableCompiledCodeOffset(
+        target_ptr_size_));
+    MarkPointerRelocation(copy, ArtMethod::EntryPointFromQuickCompiledCodeOffset(
+        target_ptr_size_));
+    MarkPointerRelocation(copy, ArtMethod::EntryPointFromInterpreterOffset(target_ptr_size_));
+    MarkPointerRelocation(copy, ArtMethod::EntryPointFromJniOffset(target_ptr_size_));
   } else if (orig->IsClass() && orig->AsClass()->IsArtMethodClass()) {
     // Set the right size for the target.
     size_t size = mirror::ArtMethod::InstanceSize(target_ptr_size_);
     down_cast<mirror::Class*>(copy)->SetObjectSizeWithoutChecks(size);
+  } else if (app_image_ && IsDexCache(orig)) {
+    // The runtime sets the dex file when it registers the dex cache.
+    copy->SetFieldPtr<false, true, kVerifyNone>(DexCache::DexFileOffset(),
+                                                static_cast<const DexFile*>(nullptr));
+  }
+}
+
+void ImageWriter::MarkRelocation(const uint8_t* copy_address) {
+  if (relocation_bitmap_.empty()) {
+    return;
+  }
+  const size_t offset = copy_address - image_->Begin();
+  DCHECK_ALIGNED(offset, ImageHeader::kRelocationGranularity);
+  DCHECK_LT(offset, image_end_);
+  const size_t index = offset / ImageHeader::kRelocationGranularity;
+  const size_t bits_per_word = BitSizeOf<uint32_t>();
+  // Objects next to each other may be copied by different threads.
+  reinterpret_cast<Atomic<uint32_t>*>(&relocation_bitmap_[index / bits_per_word])->
+      FetchAndOrSequentiallyConsistent(1u << (index % bits_per_word));
+}
+
+void ImageWriter::MarkPointerRelocation(Object* copy, MemberOffset offset) {
+  const uint8_t* address = reinterpret_cast<const uint8_t*>(copy) + offset.Uint32Value();
+  uint64_t value;
+  if (target_ptr_size_ == 8u) {
+    value = *reinterpret_cast<const uint64_t*>(address);
+  } else {
+    value = *reinterpret_cast<const uint32_t*>(address);
+  }
+  if (value != 0u) {
+    // Only the low word is adjusted, which is enough for the low 4GiB the image lives in.
+    DCHECK_EQ(value >> 32, 0u);
+    MarkRelocation(address);
   }
 }
 
@@ -20,11 +20,14 @@
 #include <stdint.h>
 #include <valgrind.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <memory>
 #include <set>
 #include <string>
 #include <ostream>
+#include <unordered_set>
+#include <vector>
 
 #include "base/macros.h"
 #include "driver/compiler_driver.h"
@@ -35,6 +38,7 @@
 #include "os.h"
 #include "safe_map.h"
 #include "gc/space/space.h"
+#include "thread_pool.h"
 #include "utils.h"
 
 namespace art {
@@ -53,10 +57,18 @@ class ImageWriter FINAL {
         quick_imt_conflict_trampoline_offset_(0), quick_resolution_trampoline_offset_(0),
         quick_to_interpreter_bridge_offset_(0), compile_pic_(compile_pic),
         target_ptr_size_(InstructionSetPointerSize(compiler_driver_.GetInstructionSet())),
-        bin_slot_sizes_(), bin_slot_count_() {
+        bin_slot_sizes_(), bin_slot_count_(),
+        thread_count_(std::max<size_t>(compiler_driver_.GetThreadCount(), 1u)),
+        app_image_(false), app_class_loader_(nullptr), boot_image_begin_(nullptr),
+        boot_image_end_(nullptr) {
     CHECK_NE(image_begin, 0U);
   }
 
+  // Writes an app image of the classes that class_loader defined from dex_files, see
+  // ImageHeader::IsAppImage(). The runtime must have a boot image.
+  ImageWriter(const CompilerDriver& compiler_driver, jobject class_loader,
+              const std::vector<const DexFile*>& dex_files);
+
   ~ImageWriter() {
     // For interned strings a large array is allocated to hold all the character data and avoid
     // overhead. However, no GC is run anymore at this point. As the array is likely large, it
@@ -67,6 +79,14 @@ class ImageWriter FINAL {
     }
   }
 
+  // Lays out the classes with the given descriptors, in the given order, ahead of all other
+  // objects of their bins, so that the classes used most at runtime share as few pages as
+  // possible. The order is typically taken from a profile. Must be called before
+  // PrepareImageAddressSpace().
+  void SetHotClasses(const std::vector<std::string>& descriptors) {
+    hot_class_descriptors_ = descriptors;
+  }
+
   bool PrepareImageAddressSpace();
 
   bool IsImageAddressSpaceReady() const {
@@ -78,6 +98,10 @@ class ImageWriter FINAL {
     if (object == nullptr) {
       return nullptr;
     }
+    if (IsInBootImage(object)) {
+      // An app image refers to the boot image objects where they are.
+      return object;
+    }
     return reinterpret_cast<mirror::Object*>(image_begin_ + GetImageOffset(object));
   }
 
@@ -90,6 +114,13 @@ class ImageWriter FINAL {
              const std::string& oat_location)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Writes the app image for the oat file that the classes were compiled to, which must be
+  // complete. The oat file is left open.
+  bool WriteAppImage(const std::string& image_filename,
+                     File* oat_file,
+                     const std::string& oat_location)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   uintptr_t GetOatDataBegin() {
     return reinterpret_cast<uintptr_t>(oat_data_begin_);
   }
@@ -149,10 +180,14 @@ class ImageWriter FINAL {
     const uint32_t lockword_;
   };
 
-  // We use the lock word to store the offset of the object in the image.
-  void AssignImageOffset(mirror::Object* object, BinSlot bin_slot)
+  typedef std::vector<std::pair<mirror::Object*, uint32_t>> SavedHashes;
+
+  // We use the lock word to store the offset of the object in the image. The hash code the object
+  // had, if any, is added to saved_hashes.
+  void AssignImageOffset(mirror::Object* object, BinSlot bin_slot, SavedHashes* saved_hashes)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  void SetImageOffset(mirror::Object* object, BinSlot bin_slot, size_t offset)
+  void SetImageOffset(mirror::Object* object, BinSlot bin_slot, size_t offset,
+                      SavedHashes* saved_hashes)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool IsImageOffsetAssigned(mirror::Object* object) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -223,13 +258,61 @@ class ImageWriter FINAL {
   // Lays out where the image objects will be at runtime.
   void CalculateNewObjectOffsets()
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  bool IsInBootImage(const mirror::Object* object) const {
+    const uint8_t* address = reinterpret_cast<const uint8_t*>(object);
+    return boot_image_begin_ <= address && address < boot_image_end_;
+  }
+
+  // Finds the classes of the app image: the resolved classes the app class loader defined from
+  // app_dex_files_ whose superclasses and interfaces are in the boot image or the app image too.
+  void ComputeAppImageClasses() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool IsAppImageClass(mirror::Class* klass) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Clears the dex cache entries of the app that refer to classes outside of the images.
+  void PruneAppDexCaches() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  mirror::ObjectArray<mirror::Object>* CreateAppImageRoots() const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Lays out the app image objects, those reachable from image_roots outside of the boot image.
+  // Returns false if one of them is a class that can't be in the app image.
+  bool CalculateAppImageObjectOffsets() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool CollectAppImageObjects(mirror::ObjectArray<mirror::Object>* image_roots)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Returns whether the reference at offset of obj is written as null into an app image: the
+  // class loader the classes were compiled with and the Dex objects of the dex caches.
+  bool IsOmittedAppImageReference(mirror::Object* obj, MemberOffset offset) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void CreateHeader(size_t oat_loaded_size, size_t oat_data_offset)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::ObjectArray<mirror::Object>* CreateImageRoots() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void CalculateObjectBinSlots(mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  void UnbinObjectsIntoOffset(mirror::Object* obj)
+  void UnbinObjectsIntoOffset(size_t task_index, mirror::Object* obj)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Looks up the classes named by hot_class_descriptors_ that are in the image.
+  std::vector<mirror::Class*> FindHotClasses() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Assigns bin slots to the hot classes and the methods and fields they own, in order.
+  void AssignHotClassBinSlots(const std::vector<mirror::Class*>& hot_classes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Turns the bin slot of every object into its offset in the image.
+  void AssignImageOffsets()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns all objects of the heap, in address order.
+  std::vector<mirror::Object*> GetHeapObjects()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Calls (this->*visitor)(task_index, obj) for each of the objects, in disjoint ranges spread
+  // over thread_count_ tasks on the thread pool. The visitors run on behalf of the calling thread,
+  // which holds the locks for them.
+  class VisitObjectsTask;
+  void VisitObjectsParallel(const std::vector<mirror::Object*>& objects,
+                            void (ImageWriter::*visitor)(size_t task_index, mirror::Object* obj))
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void WalkInstanceFields(mirror::Object* obj, mirror::Class* klass)
@@ -238,18 +321,21 @@ class ImageWriter FINAL {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static void WalkFieldsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  static void UnbinObjectsIntoOffsetCallback(mirror::Object* obj, void* arg)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Creates the contiguous image in memory and adjusts pointers.
   void CopyAndFixupObjects() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  static void CopyAndFixupObjectsCallback(mirror::Object* obj, void* arg)
+  void CopyAndFixupObject(size_t task_index, mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void FixupMethod(mirror::ArtMethod* orig, mirror::ArtMethod* copy)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void FixupObject(mirror::Object* orig, mirror::Object* copy)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Records in the relocation bitmap that the word of the image at copy_address holds an address.
+  void MarkRelocation(const uint8_t* copy_address);
+  // Records the native pointer field of copy at offset if it is set.
+  void MarkPointerRelocation(mirror::Object* copy, MemberOffset offset);
+
   // Get quick code for non-resolution/imt_conflict/abstract method.
   const uint8_t* GetQuickCode(mirror::ArtMethod* method, bool* quick_is_interpreted)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -260,6 +346,9 @@ class ImageWriter FINAL {
   // Patches references in OatFile to expect runtime addresses.
   void SetOatChecksumFromElfFile(File* elf_file);
 
+  // Writes the image, its bitmap and its relocation bitmap to image_filename.
+  bool WriteImageFile(const std::string& image_filename);
+
   // Calculate the sum total of the bin slot sizes in [0, up_to). Defaults to all bins.
   size_t GetBinSizeSum(Bin up_to = kBinSize) const;
 
@@ -292,12 +381,23 @@ class ImageWriter FINAL {
   // Saved hashes (objects are bin slots to inside of the image, not yet allocated an address).
   std::map<BinSlot, uint32_t> saved_hashes_map_;
 
+  // Saved hashes collected by each task while assigning offsets, merged into saved_hashes_.
+  std::vector<SavedHashes> task_saved_hashes_;
+
+  // Non-interned strings sharing the bin slot of their interned equivalent. They are not copied,
+  // so that only one object is written to each location of the image. Probed for every object
+  // while offsets are assigned and objects copied, hence hashed.
+  std::unordered_set<mirror::Object*> string_aliases_;
+
   // Beginning target oat address for the pointers from the output image to its oat file.
   const uint8_t* oat_data_begin_;
 
   // Image bitmap which lets us know where the objects inside of the image reside.
   std::unique_ptr<gc::accounting::ContinuousSpaceBitmap> image_bitmap_;
 
+  // The words of the image holding addresses, see ImageHeader::GetRelocationBitmapOffset().
+  std::vector<uint32_t> relocation_bitmap_;
+
   // Offset from oat_data_begin_ to the stubs.
   uint32_t interpreter_to_interpreter_bridge_offset_;
   uint32_t interpreter_to_compiled_code_bridge_offset_;
@@ -320,8 +420,29 @@ class ImageWriter FINAL {
 
   void* string_data_array_;  // The backing for the interned strings.
 
+  // Descriptors of the classes to lay out first, see SetHotClasses().
+  std::vector<std::string> hot_class_descriptors_;
+
+  // Offsets are assigned and objects copied by this many threads, including the calling thread.
+  const size_t thread_count_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  // Whether this writes an app image, of the classes app_class_loader_ defined from
+  // app_dex_files_. The app image refers to the boot image in [boot_image_begin_,
+  // boot_image_end_) and its objects are app_image_objects_, in layout order.
+  bool app_image_;
+  jobject app_class_loader_;
+  std::vector<const DexFile*> app_dex_files_;
+  std::vector<mirror::Class*> app_image_classes_;
+  std::unordered_set<mirror::Class*> app_image_class_set_;
+  std::vector<mirror::Object*> app_image_objects_;
+  const uint8_t* boot_image_begin_;
+  const uint8_t* boot_image_end_;
+
+  friend class AppImageObjectCollector;
   friend class FixupVisitor;
   friend class FixupClassVisitor;
+  friend class ImageTest;
   DISALLOW_COPY_AND_ASSIGN(ImageWriter);
 };
 
@@ -23,6 +23,7 @@
 #include "dex_file.h"
 #include "gtest/gtest.h"
 #include "indirect_reference_table.h"
+#include "java_vm_ext.h"
 #include "jni_internal.h"
 #include "mem_map.h"
 #include "mirror/art_method-inl.h"
@@ -135,6 +136,7 @@ class JniCompilerTest : public CommonCompilerTest {
   void CompileAndRunNoArgMethodImpl();
   void CompileAndRunIntMethodThroughStubImpl();
   void CompileAndRunStaticIntMethodThroughStubImpl();
+  void NativeMethodSymbolIndexImpl();
   void CompileAndRunIntMethodImpl();
   void CompileAndRunIntIntMethodImpl();
   void CompileAndRunLongLongMethodImpl();
@@ -169,6 +171,15 @@ class JniCompilerTest : public CommonCompilerTest {
   void StackArgsIntsFirstImpl();
   void StackArgsFloatsFirstImpl();
   void StackArgsMixedImpl();
+  void FastNativeInstanceMethodImpl();
+  void FastNativeStaticMethodImpl();
+  void FastNativeReturnReferenceImpl();
+  void FastNativeSynchronizedMethodImpl();
+  void CriticalNativeDoubleDoubleMethodImpl();
+  void CriticalNativeStackArgsImpl();
+  void CriticalNativeIgnoredOnInstanceMethodImpl();
+  void CriticalNativeIgnoredOnSynchronizedMethodImpl();
+  void CriticalNativeIgnoredWithReferenceArgImpl();
 
   JNIEnv* env_;
   jmethodID jmethod_;
@@ -248,6 +259,33 @@ void JniCompilerTest::CompileAndRunStaticIntMethodThroughStubImpl() {
 
 JNI_TEST(CompileAndRunStaticIntMethodThroughStub)
 
+void JniCompilerTest::NativeMethodSymbolIndexImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "bar", "(I)I", nullptr);
+
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  std::string reason;
+  ASSERT_TRUE(vm->LoadNativeLibrary(env_, "", class_loader_, &reason)) << reason;
+
+  // Java_MyClassNatives_bar is defined by the main program, so it is found in its index.
+  size_t indexed = vm->GetIndexedNativeMethodCount();
+  size_t searched = vm->GetSearchedNativeMethodCount();
+  jint result = env_->CallNonvirtualIntMethod(jobj_, jklass_, jmethod_, 24);
+  EXPECT_EQ(25, result);
+  EXPECT_EQ(indexed + 1, vm->GetIndexedNativeMethodCount());
+  EXPECT_EQ(searched, vm->GetSearchedNativeMethodCount());
+
+  // A method no library defines misses the index and falls back to dlsym.
+  SetUpForTest(false, "withoutImplementation", "()V", nullptr);
+  env_->CallVoidMethod(jobj_, jmethod_);
+  EXPECT_TRUE(env_->ExceptionCheck() == JNI_TRUE);
+  env_->ExceptionClear();
+  EXPECT_EQ(indexed + 1, vm->GetIndexedNativeMethodCount());
+  EXPECT_EQ(searched + 1, vm->GetSearchedNativeMethodCount());
+}
+
+JNI_TEST(NativeMethodSymbolIndex)
+
 int gJava_MyClassNatives_fooI_calls = 0;
 jint Java_MyClassNatives_fooI(JNIEnv* env, jobject thisObj, jint x) {
   // 1 = thisObj
@@ -1735,4 +1773,278 @@ void JniCompilerTest::StackArgsMixedImpl() {
 
 JNI_TEST(StackArgsMixed)
 
+
+int gJava_MyClassNatives_fastFooI_calls = 0;
+jint Java_MyClassNatives_fastFooI(JNIEnv* env, jobject thisObj, jint x) {
+  // Fast natives stay runnable.
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(thisObj != nullptr);
+  EXPECT_TRUE(env->IsInstanceOf(thisObj, JniCompilerTest::jklass_));
+  gJava_MyClassNatives_fastFooI_calls++;
+  ScopedObjectAccess soa(Thread::Current());
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  return x;
+}
+
+void JniCompilerTest::FastNativeInstanceMethodImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "fastFooI", "(I)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fastFooI));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastFooI_calls);
+  jint result = env_->CallNonvirtualIntMethod(jobj_, jklass_, jmethod_, 42);
+  EXPECT_EQ(42, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooI_calls);
+  result = env_->CallNonvirtualIntMethod(jobj_, jklass_, jmethod_, 0xCAFED00D);
+  EXPECT_EQ(static_cast<jint>(0xCAFED00D), result);
+  EXPECT_EQ(2, gJava_MyClassNatives_fastFooI_calls);
+
+  gJava_MyClassNatives_fastFooI_calls = 0;
+}
+
+JNI_TEST(FastNativeInstanceMethod)
+
+int gJava_MyClassNatives_fastSbar_calls = 0;
+jint Java_MyClassNatives_fastSbar(JNIEnv* env, jclass klass, jint count) {
+  // 1 = klass
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(klass != nullptr);
+  EXPECT_TRUE(env->IsSameObject(JniCompilerTest::jklass_, klass));
+  gJava_MyClassNatives_fastSbar_calls++;
+  ScopedObjectAccess soa(Thread::Current());
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  return count + 1;
+}
+
+void JniCompilerTest::FastNativeStaticMethodImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "fastSbar", "(I)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fastSbar));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastSbar_calls);
+  jint result = env_->CallStaticIntMethod(jklass_, jmethod_, 42);
+  EXPECT_EQ(43, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastSbar_calls);
+
+  gJava_MyClassNatives_fastSbar_calls = 0;
+}
+
+JNI_TEST(FastNativeStaticMethod)
+
+int gJava_MyClassNatives_fastFooO_calls = 0;
+jobject Java_MyClassNatives_fastFooO(JNIEnv* env, jobject thisObj, jobject x) {
+  // 2 = this + x
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(thisObj != nullptr);
+  EXPECT_TRUE(env->IsInstanceOf(thisObj, JniCompilerTest::jklass_));
+  gJava_MyClassNatives_fastFooO_calls++;
+  // Return a new local reference, which must survive the stub popping the local references.
+  return (x == nullptr) ? nullptr : env->NewLocalRef(x);
+}
+
+void JniCompilerTest::FastNativeReturnReferenceImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "fastFooO", "(Ljava/lang/Object;)Ljava/lang/Object;",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fastFooO));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastFooO_calls);
+  jobject result = env_->CallNonvirtualObjectMethod(jobj_, jklass_, jmethod_, nullptr);
+  EXPECT_TRUE(result == nullptr);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooO_calls);
+  result = env_->CallNonvirtualObjectMethod(jobj_, jklass_, jmethod_, jklass_);
+  EXPECT_TRUE(env_->IsSameObject(jklass_, result));
+  EXPECT_EQ(2, gJava_MyClassNatives_fastFooO_calls);
+
+  gJava_MyClassNatives_fastFooO_calls = 0;
+}
+
+JNI_TEST(FastNativeReturnReference)
+
+int gJava_MyClassNatives_fastFooJJ_synchronized_calls = 0;
+jlong Java_MyClassNatives_fastFooJJ_synchronized(JNIEnv* env, jobject thisObj, jlong x,
+                                                 jlong y) {
+  // 1 = thisObj
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(thisObj != nullptr);
+  gJava_MyClassNatives_fastFooJJ_synchronized_calls++;
+  ScopedObjectAccess soa(Thread::Current());
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  EXPECT_EQ(soa.Self()->GetThreadId(),
+            soa.Decode<mirror::Object*>(thisObj)->GetLockOwnerThreadId());
+  return x | y;
+}
+
+void JniCompilerTest::FastNativeSynchronizedMethodImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "fastFooJJ_synchronized", "(JJ)J",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fastFooJJ_synchronized));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastFooJJ_synchronized_calls);
+  jlong a = 0x1000000020000000ULL;
+  jlong b = 0x00ff000000aa0000ULL;
+  jlong result = env_->CallNonvirtualLongMethod(jobj_, jklass_, jmethod_, a, b);
+  EXPECT_EQ(a | b, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooJJ_synchronized_calls);
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    EXPECT_EQ(0U, soa.Decode<mirror::Object*>(jobj_)->GetLockOwnerThreadId());
+  }
+
+  gJava_MyClassNatives_fastFooJJ_synchronized_calls = 0;
+}
+
+JNI_TEST(FastNativeSynchronizedMethod)
+
+// Critical natives are passed neither the JNIEnv* nor the jclass.
+int gJava_MyClassNatives_criticalFooDD_calls = 0;
+jdouble Java_MyClassNatives_criticalFooDD(jdouble x, jdouble y) {
+  gJava_MyClassNatives_criticalFooDD_calls++;
+  return x - y;  // non-commutative operator
+}
+
+void JniCompilerTest::CriticalNativeDoubleDoubleMethodImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalFooDD", "(DD)D",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalFooDD));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_criticalFooDD_calls);
+  jdouble result = env_->CallStaticDoubleMethod(jklass_, jmethod_, 99.0, 10.0);
+  EXPECT_DOUBLE_EQ(99.0 - 10.0, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalFooDD_calls);
+  jdouble a = 3.14159265358979323846;
+  jdouble b = 0.69314718055994530942;
+  result = env_->CallStaticDoubleMethod(jklass_, jmethod_, a, b);
+  EXPECT_DOUBLE_EQ(a - b, result);
+  EXPECT_EQ(2, gJava_MyClassNatives_criticalFooDD_calls);
+
+  gJava_MyClassNatives_criticalFooDD_calls = 0;
+}
+
+JNI_TEST(CriticalNativeDoubleDoubleMethod)
+
+// Argument k of each type, for the critical native with more arguments than fit in registers.
+static jint CriticalIntArg(int k) {
+  return k;
+}
+
+static jlong CriticalLongArg(int k) {
+  return k * INT64_C(0x100000001);
+}
+
+static jfloat CriticalFloatArg(int k) {
+  return k + 0.5f;
+}
+
+static jdouble CriticalDoubleArg(int k) {
+  return k + 0.25;
+}
+
+#define EXPECT_CRITICAL_ARGS(k) \
+  EXPECT_EQ(CriticalIntArg(k), i ## k); \
+  EXPECT_EQ(CriticalLongArg(k), l ## k); \
+  EXPECT_FLOAT_EQ(CriticalFloatArg(k), f ## k); \
+  EXPECT_DOUBLE_EQ(CriticalDoubleArg(k), d ## k)
+
+jlong Java_MyClassNatives_criticalStackArgs(
+    jint i1, jlong l1, jfloat f1, jdouble d1, jint i2, jlong l2, jfloat f2, jdouble d2,
+    jint i3, jlong l3, jfloat f3, jdouble d3, jint i4, jlong l4, jfloat f4, jdouble d4,
+    jint i5, jlong l5, jfloat f5, jdouble d5, jint i6, jlong l6, jfloat f6, jdouble d6,
+    jint i7, jlong l7, jfloat f7, jdouble d7, jint i8, jlong l8, jfloat f8, jdouble d8) {
+  EXPECT_CRITICAL_ARGS(1);
+  EXPECT_CRITICAL_ARGS(2);
+  EXPECT_CRITICAL_ARGS(3);
+  EXPECT_CRITICAL_ARGS(4);
+  EXPECT_CRITICAL_ARGS(5);
+  EXPECT_CRITICAL_ARGS(6);
+  EXPECT_CRITICAL_ARGS(7);
+  EXPECT_CRITICAL_ARGS(8);
+  return l1 + l2 + l3 + l4 + l5 + l6 + l7 + l8 + i1 + i2 + i3 + i4 + i5 + i6 + i7 + i8;
+}
+
+#undef EXPECT_CRITICAL_ARGS
+
+#define CRITICAL_ARGS(k) \
+  CriticalIntArg(k), CriticalLongArg(k), CriticalFloatArg(k), CriticalDoubleArg(k)
+
+void JniCompilerTest::CriticalNativeStackArgsImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalStackArgs", "(IJFDIJFDIJFDIJFDIJFDIJFDIJFDIJFD)J",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalStackArgs));
+
+  // Eight arguments of each type, more than there are argument registers of either kind.
+  jlong result = env_->CallStaticLongMethod(jklass_, jmethod_, CRITICAL_ARGS(1), CRITICAL_ARGS(2),
+                                            CRITICAL_ARGS(3), CRITICAL_ARGS(4), CRITICAL_ARGS(5),
+                                            CRITICAL_ARGS(6), CRITICAL_ARGS(7), CRITICAL_ARGS(8));
+  jlong expected = 0;
+  for (int k = 1; k <= 8; ++k) {
+    expected += CriticalLongArg(k) + CriticalIntArg(k);
+  }
+  EXPECT_EQ(expected, result);
+}
+
+#undef CRITICAL_ARGS
+
+JNI_TEST(CriticalNativeStackArgs)
+
+// The @CriticalNative annotation is ignored on the following methods, they get the JNIEnv* and
+// transition to native as usual.
+jint Java_MyClassNatives_criticalIgnoredInstance(JNIEnv* env, jobject thisObj, jint x) {
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(env->IsInstanceOf(thisObj, JniCompilerTest::jklass_));
+  return x + 1;
+}
+
+void JniCompilerTest::CriticalNativeIgnoredOnInstanceMethodImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "criticalIgnoredInstance", "(I)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalIgnoredInstance));
+
+  EXPECT_EQ(43, env_->CallNonvirtualIntMethod(jobj_, jklass_, jmethod_, 42));
+}
+
+JNI_TEST(CriticalNativeIgnoredOnInstanceMethod)
+
+jint Java_MyClassNatives_criticalIgnoredSynchronized(JNIEnv* env, jclass klass, jint x) {
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(env->IsSameObject(JniCompilerTest::jklass_, klass));
+  ScopedObjectAccess soa(Thread::Current());
+  EXPECT_EQ(soa.Self()->GetThreadId(),
+            soa.Decode<mirror::Class*>(klass)->GetLockOwnerThreadId());
+  return x + 2;
+}
+
+void JniCompilerTest::CriticalNativeIgnoredOnSynchronizedMethodImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalIgnoredSynchronized", "(I)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalIgnoredSynchronized));
+
+  EXPECT_EQ(44, env_->CallStaticIntMethod(jklass_, jmethod_, 42));
+}
+
+JNI_TEST(CriticalNativeIgnoredOnSynchronizedMethod)
+
+jint Java_MyClassNatives_criticalIgnoredObject(JNIEnv* env, jclass klass, jobject x) {
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(env->IsSameObject(JniCompilerTest::jklass_, klass));
+  return (x == nullptr) ? 0 : 1;
+}
+
+void JniCompilerTest::CriticalNativeIgnoredWithReferenceArgImpl() {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalIgnoredObject", "(Ljava/lang/Object;)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalIgnoredObject));
+
+  EXPECT_EQ(0, env_->CallStaticIntMethod(jklass_, jmethod_, nullptr));
+  EXPECT_EQ(1, env_->CallStaticIntMethod(jklass_, jmethod_, jobj_));
+}
+
+JNI_TEST(CriticalNativeIgnoredWithReferenceArg)
+
 }  // namespace art
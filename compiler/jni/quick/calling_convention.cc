@@ -101,20 +101,25 @@ bool ManagedRuntimeCallingConvention::IsCurrentParamALong() {
 // JNI calling convention
 
 JniCallingConvention* JniCallingConvention::Create(bool is_static, bool is_synchronized,
-                                                   const char* shorty,
+                                                   bool is_critical_native, const char* shorty,
                                                    InstructionSet instruction_set) {
   switch (instruction_set) {
     case kArm:
     case kThumb2:
-      return new arm::ArmJniCallingConvention(is_static, is_synchronized, shorty);
+      return new arm::ArmJniCallingConvention(is_static, is_synchronized, is_critical_native,
+                                              shorty);
     case kArm64:
-      return new arm64::Arm64JniCallingConvention(is_static, is_synchronized, shorty);
+      return new arm64::Arm64JniCallingConvention(is_static, is_synchronized, is_critical_native,
+                                                  shorty);
     case kMips:
-      return new mips::MipsJniCallingConvention(is_static, is_synchronized, shorty);
+      return new mips::MipsJniCallingConvention(is_static, is_synchronized, is_critical_native,
+                                                shorty);
     case kX86:
-      return new x86::X86JniCallingConvention(is_static, is_synchronized, shorty);
+      return new x86::X86JniCallingConvention(is_static, is_synchronized, is_critical_native,
+                                              shorty);
     case kX86_64:
-      return new x86_64::X86_64JniCallingConvention(is_static, is_synchronized, shorty);
+      return new x86_64::X86_64JniCallingConvention(is_static, is_synchronized, is_critical_native,
+                                                    shorty);
     default:
       LOG(FATAL) << "Unknown InstructionSet: " << instruction_set;
       return NULL;
@@ -122,6 +127,10 @@ JniCallingConvention* JniCallingConvention::Create(bool is_static, bool is_synch
 }
 
 size_t JniCallingConvention::ReferenceCount() const {
+  if (IsCriticalNative()) {
+    DCHECK_EQ(NumReferenceArgs(), 0u);
+    return 0u;
+  }
   return NumReferenceArgs() + (IsStatic() ? 1 : 0);
 }
 
@@ -136,7 +145,7 @@ FrameOffset JniCallingConvention::ReturnValueSaveLocation() const {
 }
 
 bool JniCallingConvention::HasNext() {
-  if (itr_args_ <= kObjectOrClass) {
+  if (!IsCriticalNative() && itr_args_ <= kObjectOrClass) {
     return true;
   } else {
     unsigned int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
@@ -146,7 +155,7 @@ bool JniCallingConvention::HasNext() {
 
 void JniCallingConvention::Next() {
   CHECK(HasNext());
-  if (itr_args_ > kObjectOrClass) {
+  if (IsCriticalNative() || itr_args_ > kObjectOrClass) {
     int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
     if (IsParamALongOrDouble(arg_pos)) {
       itr_longs_and_doubles_++;
@@ -164,59 +173,59 @@ void JniCallingConvention::Next() {
 }
 
 bool JniCallingConvention::IsCurrentParamAReference() {
-  switch (itr_args_) {
-    case kJniEnv:
-      return false;  // JNIEnv*
-    case kObjectOrClass:
-      return true;   // jobject or jclass
-    default: {
-      int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
-      return IsParamAReference(arg_pos);
+  if (!IsCriticalNative()) {
+    switch (itr_args_) {
+      case kJniEnv:
+        return false;  // JNIEnv*
+      case kObjectOrClass:
+        return true;   // jobject or jclass
     }
   }
+  int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
+  return IsParamAReference(arg_pos);
 }
 
 bool JniCallingConvention::IsCurrentParamJniEnv() {
-  return (itr_args_ == kJniEnv);
+  return !IsCriticalNative() && (itr_args_ == kJniEnv);
 }
 
 bool JniCallingConvention::IsCurrentParamAFloatOrDouble() {
-  switch (itr_args_) {
-    case kJniEnv:
-      return false;  // JNIEnv*
-    case kObjectOrClass:
-      return false;   // jobject or jclass
-    default: {
-      int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
-      return IsParamAFloatOrDouble(arg_pos);
+  if (!IsCriticalNative()) {
+    switch (itr_args_) {
+      case kJniEnv:
+        return false;  // JNIEnv*
+      case kObjectOrClass:
+        return false;  // jobject or jclass
     }
   }
+  int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
+  return IsParamAFloatOrDouble(arg_pos);
 }
 
 bool JniCallingConvention::IsCurrentParamADouble() {
-  switch (itr_args_) {
-    case kJniEnv:
-      return false;  // JNIEnv*
-    case kObjectOrClass:
-      return false;   // jobject or jclass
-    default: {
-      int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
-      return IsParamADouble(arg_pos);
+  if (!IsCriticalNative()) {
+    switch (itr_args_) {
+      case kJniEnv:
+        return false;  // JNIEnv*
+      case kObjectOrClass:
+        return false;  // jobject or jclass
     }
   }
+  int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
+  return IsParamADouble(arg_pos);
 }
 
 bool JniCallingConvention::IsCurrentParamALong() {
-  switch (itr_args_) {
-    case kJniEnv:
-      return false;  // JNIEnv*
-    case kObjectOrClass:
-      return false;   // jobject or jclass
-    default: {
-      int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
-      return IsParamALong(arg_pos);
+  if (!IsCriticalNative()) {
+    switch (itr_args_) {
+      case kJniEnv:
+        return false;  // JNIEnv*
+      case kObjectOrClass:
+        return false;  // jobject or jclass
     }
   }
+  int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
+  return IsParamALong(arg_pos);
 }
 
 // Return position of handle scope entry holding reference at the current iterator
@@ -230,7 +239,7 @@ FrameOffset JniCallingConvention::CurrentParamHandleScopeEntryOffset() {
 }
 
 size_t JniCallingConvention::CurrentParamSize() {
-  if (itr_args_ <= kObjectOrClass) {
+  if (!IsCriticalNative() && itr_args_ <= kObjectOrClass) {
     return frame_pointer_size_;  // JNIEnv or jobject/jclass
   } else {
     int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
@@ -239,6 +248,9 @@ size_t JniCallingConvention::CurrentParamSize() {
 }
 
 size_t JniCallingConvention::NumberOfExtraArgumentsForJni() {
+  if (IsCriticalNative()) {
+    return 0;
+  }
   // The first argument is the JNIEnv*.
   // Static methods have an extra argument which is the jclass.
   return IsStatic() ? 2 : 1;
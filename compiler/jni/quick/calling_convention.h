@@ -268,9 +268,13 @@ class ManagedRuntimeCallingConvention : public CallingConvention {
 //
 // [1] We must save all callee saves here to enable any exception throws to restore
 // callee saves for frames above this one.
+//
+// Critical natives are passed neither the JNIEnv* nor the jclass, their handle scope is left
+// empty.
 class JniCallingConvention : public CallingConvention {
  public:
-  static JniCallingConvention* Create(bool is_static, bool is_synchronized, const char* shorty,
+  static JniCallingConvention* Create(bool is_static, bool is_synchronized,
+                                      bool is_critical_native, const char* shorty,
                                       InstructionSet instruction_set);
 
   // Size of frame excluding space for outgoing args (its assumed Method* is
@@ -347,16 +351,23 @@ class JniCallingConvention : public CallingConvention {
     kObjectOrClass = 1
   };
 
-  explicit JniCallingConvention(bool is_static, bool is_synchronized, const char* shorty,
-                                size_t frame_pointer_size)
-      : CallingConvention(is_static, is_synchronized, shorty, frame_pointer_size) {}
+  JniCallingConvention(bool is_static, bool is_synchronized, bool is_critical_native,
+                       const char* shorty, size_t frame_pointer_size)
+      : CallingConvention(is_static, is_synchronized, shorty, frame_pointer_size),
+        is_critical_native_(is_critical_native) {}
 
   // Number of stack slots for outgoing arguments, above which the handle scope is
   // located
   virtual size_t NumberOfOutgoingStackArgs() = 0;
 
  protected:
+  bool IsCriticalNative() const {
+    return is_critical_native_;
+  }
   size_t NumberOfExtraArgumentsForJni();
+
+ private:
+  const bool is_critical_native_;
 };
 
 }  // namespace art
@@ -29,6 +29,7 @@
 #include "oat_file-inl.h"
 #include "oat_writer.h"
 #include "scoped_thread_state_change.h"
+#include "utf.h"
 #include "vector_output_stream.h"
 
 namespace art {
@@ -61,7 +62,7 @@ class OatTest : public CommonCompilerTest {
         EXPECT_EQ(oat_method.GetFpSpillMask(), compiled_method->GetFpSpillMask());
         uintptr_t oat_code_aligned = RoundDown(reinterpret_cast<uintptr_t>(quick_oat_code), 2);
         quick_oat_code = reinterpret_cast<const void*>(oat_code_aligned);
-        const std::vector<uint8_t>* quick_code = compiled_method->GetQuickCode();
+        const SwapVector<uint8_t>* quick_code = compiled_method->GetQuickCode();
         EXPECT_TRUE(quick_code != nullptr);
         size_t code_size = quick_code->size() * sizeof(quick_code[0]);
         EXPECT_EQ(0, memcmp(quick_oat_code, &quick_code[0], code_size))
@@ -75,7 +76,7 @@ class OatTest : public CommonCompilerTest {
         EXPECT_EQ(oat_method.GetFpSpillMask(), 0U);
         uintptr_t oat_code_aligned = RoundDown(reinterpret_cast<uintptr_t>(portable_oat_code), 2);
         portable_oat_code = reinterpret_cast<const void*>(oat_code_aligned);
-        const std::vector<uint8_t>* portable_code = compiled_method->GetPortableCode();
+        const SwapVector<uint8_t>* portable_code = compiled_method->GetPortableCode();
         EXPECT_TRUE(portable_code != nullptr);
         size_t code_size = portable_code->size() * sizeof(portable_code[0]);
         EXPECT_EQ(0, memcmp(quick_oat_code, &portable_code[0], code_size))
@@ -186,6 +187,59 @@ TEST_F(OatTest, WriteRead) {
   }
 }
 
+TEST_F(OatTest, DexFileOpenedFromOatFile) {
+  TimingLogger timings("OatTest::DexFileOpenedFromOatFile", false, false);
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+
+  ScratchFile tmp;
+  SafeMap<std::string, std::string> key_value_store;
+  key_value_store.Put(OatHeader::kImageLocationKey, "lue.art");
+  OatWriter oat_writer(class_linker->GetBootClassPath(),
+                       42U,
+                       4096U,
+                       0,
+                       compiler_driver_.get(),
+                       nullptr,
+                       &timings,
+                       &key_value_store);
+  ASSERT_TRUE(compiler_driver_->WriteElf(GetTestAndroidRoot(),
+                                         !kIsTargetBuild,
+                                         class_linker->GetBootClassPath(),
+                                         &oat_writer,
+                                         tmp.GetFile()));
+
+  std::string error_msg;
+  std::unique_ptr<OatFile> oat_file(OatFile::Open(tmp.GetFilename(), tmp.GetFilename(), nullptr,
+                                                  nullptr, false, &error_msg));
+  ASSERT_TRUE(oat_file.get() != nullptr) << error_msg;
+
+  // The dex file the runtime opened directly has no OatDexFile.
+  const DexFile* dex_file = java_lang_dex_file_;
+  EXPECT_TRUE(dex_file->GetOatDexFile() == nullptr);
+
+  uint32_t dex_file_checksum = dex_file->GetLocationChecksum();
+  const OatFile::OatDexFile* oat_dex_file = oat_file->GetOatDexFile(dex_file->GetLocation().c_str(),
+                                                                    &dex_file_checksum);
+  ASSERT_TRUE(oat_dex_file != nullptr);
+  ASSERT_TRUE(oat_dex_file->GetLookupTableData() != nullptr);
+  std::unique_ptr<const DexFile> oat_backed_dex_file(oat_dex_file->OpenDexFile(&error_msg));
+  ASSERT_TRUE(oat_backed_dex_file.get() != nullptr) << error_msg;
+  EXPECT_EQ(oat_dex_file, oat_backed_dex_file->GetOatDexFile());
+
+  // FindClassDef goes through the type lookup table written into the oat file.
+  ASSERT_TRUE(oat_backed_dex_file->GetTypeLookupTable() != nullptr);
+  for (size_t i = 0; i < oat_backed_dex_file->NumClassDefs(); ++i) {
+    const DexFile::ClassDef& class_def = oat_backed_dex_file->GetClassDef(i);
+    const char* descriptor = oat_backed_dex_file->GetClassDescriptor(class_def);
+    EXPECT_EQ(&class_def,
+              oat_backed_dex_file->FindClassDef(descriptor, ComputeModifiedUtf8Hash(descriptor)))
+        << descriptor;
+  }
+  const char* missing = "Ljava/lang/Missing;";
+  EXPECT_TRUE(oat_backed_dex_file->FindClassDef(missing, ComputeModifiedUtf8Hash(missing)) ==
+              nullptr);
+}
+
 TEST_F(OatTest, OatHeaderSizeCheck) {
   // If this test is failing and you have to update these constants,
   // it is time to update OatHeader::kOatVersion
@@ -37,9 +37,11 @@
 #include "safe_map.h"
 #include "scoped_thread_state_change.h"
 #include "handle_scope-inl.h"
+#include "type_lookup_table.h"
 #include "utils/arm/assembler_thumb2.h"
 #include "utils/arm64/assembler_arm64.h"
 #include "verifier/method_verifier.h"
+#include "verifier/verifier_deps.h"
 
 namespace art {
 
@@ -414,6 +416,10 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_header_(0),
     size_oat_header_key_value_store_(0),
     size_dex_file_(0),
+    size_lookup_table_alignment_(0),
+    size_lookup_table_(0),
+    size_verifier_deps_alignment_(0),
+    size_verifier_deps_(0),
     size_interpreter_to_interpreter_bridge_(0),
     size_interpreter_to_compiled_code_bridge_(0),
     size_jni_dlsym_lookup_(0),
@@ -436,6 +442,8 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_dex_file_location_data_(0),
     size_oat_dex_file_location_checksum_(0),
     size_oat_dex_file_offset_(0),
+    size_oat_dex_file_lookup_table_offset_(0),
+    size_oat_dex_file_verifier_deps_offset_(0),
     size_oat_dex_file_methods_offsets_(0),
     size_oat_class_type_(0),
     size_oat_class_status_(0),
@@ -475,6 +483,14 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     TimingLogger::ScopedTiming split("InitDexFiles", timings);
     offset = InitDexFiles(offset);
   }
+  {
+    TimingLogger::ScopedTiming split("InitLookupTables", timings);
+    offset = InitLookupTables(offset);
+  }
+  {
+    TimingLogger::ScopedTiming split("InitVerifierDeps", timings);
+    offset = InitVerifierDeps(offset);
+  }
   {
     TimingLogger::ScopedTiming split("InitOatClasses", timings);
     offset = InitOatClasses(offset);
@@ -507,7 +523,7 @@ OatWriter::~OatWriter() {
 }
 
 struct OatWriter::GcMapDataAccess {
-  static const std::vector<uint8_t>* GetData(const CompiledMethod* compiled_method) ALWAYS_INLINE {
+  static const SwapVector<uint8_t>* GetData(const CompiledMethod* compiled_method) ALWAYS_INLINE {
     return compiled_method->GetGcMap();
   }
 
@@ -529,7 +545,7 @@ struct OatWriter::GcMapDataAccess {
 };
 
 struct OatWriter::MappingTableDataAccess {
-  static const std::vector<uint8_t>* GetData(const CompiledMethod* compiled_method) ALWAYS_INLINE {
+  static const SwapVector<uint8_t>* GetData(const CompiledMethod* compiled_method) ALWAYS_INLINE {
     return &compiled_method->GetMappingTable();
   }
 
@@ -551,7 +567,7 @@ struct OatWriter::MappingTableDataAccess {
 };
 
 struct OatWriter::VmapTableDataAccess {
-  static const std::vector<uint8_t>* GetData(const CompiledMethod* compiled_method) ALWAYS_INLINE {
+  static const SwapVector<uint8_t>* GetData(const CompiledMethod* compiled_method) ALWAYS_INLINE {
     return &compiled_method->GetVmapTable();
   }
 
@@ -722,8 +738,8 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
       // Derived from CompiledMethod.
       uint32_t quick_code_offset = 0;
 
-      const std::vector<uint8_t>* portable_code = compiled_method->GetPortableCode();
-      const std::vector<uint8_t>* quick_code = compiled_method->GetQuickCode();
+      const SwapVector<uint8_t>* portable_code = compiled_method->GetPortableCode();
+      const SwapVector<uint8_t>* quick_code = compiled_method->GetQuickCode();
       if (portable_code != nullptr) {
         CHECK(quick_code == nullptr);
         size_t oat_method_offsets_offset =
@@ -841,7 +857,7 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
         } else {
           status = mirror::Class::kStatusNotReady;
         }
-        std::vector<uint8_t> const * gc_map = compiled_method->GetGcMap();
+        SwapVector<uint8_t> const * gc_map = compiled_method->GetGcMap();
         if (gc_map != nullptr) {
           size_t gc_map_size = gc_map->size() * sizeof(gc_map[0]);
           bool is_native = it.MemberIsNative();
@@ -883,7 +899,7 @@ class OatWriter::InitMapMethodVisitor : public OatDexMethodVisitor {
       DCHECK_LT(method_offsets_index_, oat_class->method_offsets_.size());
       DCHECK_EQ(DataAccess::GetOffset(oat_class, method_offsets_index_), 0u);
 
-      const std::vector<uint8_t>* map = DataAccess::GetData(compiled_method);
+      const SwapVector<uint8_t>* map = DataAccess::GetData(compiled_method);
       uint32_t map_size = map == nullptr ? 0 : map->size() * sizeof((*map)[0]);
       if (map_size != 0u) {
         auto lb = dedupe_map_.lower_bound(map);
@@ -905,7 +921,7 @@ class OatWriter::InitMapMethodVisitor : public OatDexMethodVisitor {
  private:
   // Deduplication is already done on a pointer basis by the compiler driver,
   // so we can simply compare the pointers to find out if things are duplicated.
-  SafeMap<const std::vector<uint8_t>*, uint32_t> dedupe_map_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> dedupe_map_;
 };
 
 class OatWriter::InitImageMethodVisitor : public OatDexMethodVisitor {
@@ -1003,9 +1019,10 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
       size_t file_offset = file_offset_;
       OutputStream* out = out_;
 
-      const std::vector<uint8_t>* quick_code = compiled_method->GetQuickCode();
-      if (quick_code != nullptr) {
+      const SwapVector<uint8_t>* quick_code_vector = compiled_method->GetQuickCode();
+      if (quick_code_vector != nullptr) {
         CHECK(compiled_method->GetPortableCode() == nullptr);
+        ArrayRef<const uint8_t> quick_code(*quick_code_vector);
         offset_ = writer_->relative_call_patcher_->WriteThunks(out, offset_);
         if (offset_ == 0u) {
           ReportWriteFailure("relative call thunk", it);
@@ -1023,7 +1040,7 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
         }
         DCHECK_ALIGNED_PARAM(offset_,
                              GetInstructionSetAlignment(compiled_method->GetInstructionSet()));
-        uint32_t code_size = quick_code->size() * sizeof(uint8_t);
+        uint32_t code_size = quick_code.size() * sizeof(uint8_t);
         CHECK_NE(code_size, 0U);
 
         // Deduplicate code arrays.
@@ -1044,8 +1061,8 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
           DCHECK_OFFSET_();
 
           if (!compiled_method->GetPatches().empty()) {
-            patched_code_ =  *quick_code;
-            quick_code = &patched_code_;
+            patched_code_.assign(quick_code.begin(), quick_code.end());
+            quick_code = ArrayRef<const uint8_t>(patched_code_);
             for (const LinkerPatch& patch : compiled_method->GetPatches()) {
               if (patch.Type() == kLinkerPatchCallRelative) {
                 // NOTE: Relative calls across oat files are not supported.
@@ -1066,8 +1083,8 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
             }
           }
 
-          writer_->oat_header_->UpdateChecksum(&(*quick_code)[0], code_size);
-          if (!out->WriteFully(&(*quick_code)[0], code_size)) {
+          writer_->oat_header_->UpdateChecksum(quick_code.data(), code_size);
+          if (!out->WriteFully(quick_code.data(), code_size)) {
             ReportWriteFailure("method code", it);
             return false;
           }
@@ -1184,7 +1201,7 @@ class OatWriter::WriteMapMethodVisitor : public OatDexMethodVisitor {
       ++method_offsets_index_;
 
       // Write deduplicated map.
-      const std::vector<uint8_t>* map = DataAccess::GetData(compiled_method);
+      const SwapVector<uint8_t>* map = DataAccess::GetData(compiled_method);
       size_t map_size = map == nullptr ? 0 : map->size() * sizeof((*map)[0]);
       DCHECK((map_size == 0u && map_offset == 0u) ||
             (map_size != 0u && map_offset != 0u && map_offset <= offset_))
@@ -1256,6 +1273,10 @@ bool OatWriter::VisitDexMethods(DexMethodVisitor* visitor) {
 }
 
 size_t OatWriter::InitOatHeader() {
+  // Lets a later compilation tell whether the code can be copied without its patches.
+  key_value_store_->Put(OatHeader::kLinkerPatchesKey,
+                        compiler_driver_->GetLinkerPatchCount() != 0u ? "true" : "false");
+  key_value_store_->Put(OatHeader::kCompilerOptionsKey, compiler_driver_->GetCompilerOptionsKey());
   oat_header_ = OatHeader::Create(compiler_driver_->GetInstructionSet(),
                                   compiler_driver_->GetInstructionSetFeatures(),
                                   dex_files_,
@@ -1295,6 +1316,69 @@ size_t OatWriter::InitDexFiles(size_t offset) {
   return offset;
 }
 
+size_t OatWriter::InitLookupTables(size_t offset) {
+  // create the type lookup tables and calculate their offsets
+  for (size_t i = 0; i != dex_files_->size(); ++i) {
+    const DexFile* dex_file = (*dex_files_)[i];
+    lookup_tables_.emplace_back(TypeLookupTable::Create(*dex_file));
+    TypeLookupTable* table = lookup_tables_.back().get();
+    if (table == nullptr) {
+      // No class defs, or too many of them. The runtime falls back to DexFile's own index.
+      oat_dex_files_[i]->lookup_table_offset_ = 0u;
+      continue;
+    }
+    oat_header_->UpdateChecksum(table->RawData(), table->RawDataLength());
+
+    // lookup tables are required to be 4 byte aligned
+    size_t original_offset = offset;
+    offset = RoundUp(offset, 4);
+    size_lookup_table_alignment_ += offset - original_offset;
+
+    // set offset in OatDexFile to TypeLookupTable
+    oat_dex_files_[i]->lookup_table_offset_ = offset;
+    offset += table->RawDataLength();
+  }
+  return offset;
+}
+
+size_t OatWriter::InitVerifierDeps(size_t offset) {
+  // encode the dependencies of the classes that are verified again at runtime
+  VerificationResults* verification_results = compiler_driver_->GetVerificationResults();
+  for (size_t i = 0; i != dex_files_->size(); ++i) {
+    const DexFile* dex_file = (*dex_files_)[i];
+    verifier::VerifierDeps::DexFileDeps deps;
+    verification_results->GetClassDependencies(dex_file, &deps);
+    for (auto it = deps.begin(); it != deps.end(); ) {
+      CompiledClass* compiled_class =
+          compiler_driver_->GetCompiledClass(ClassReference(dex_file, it->first));
+      if (compiled_class == nullptr ||
+          compiled_class->GetStatus() != mirror::Class::kStatusRetryVerificationAtRuntime ||
+          !it->second.is_recordable) {
+        it = deps.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    verifier_deps_.emplace_back();
+    if (deps.empty()) {
+      oat_dex_files_[i]->verifier_deps_offset_ = 0u;
+      continue;
+    }
+    std::vector<uint8_t>* data = &verifier_deps_.back();
+    verifier::VerifierDeps::Encode(deps, data);
+    oat_header_->UpdateChecksum(&(*data)[0], data->size());
+
+    // verifier deps are required to be 4 byte aligned
+    size_t original_offset = offset;
+    offset = RoundUp(offset, 4);
+    size_verifier_deps_alignment_ += offset - original_offset;
+
+    oat_dex_files_[i]->verifier_deps_offset_ = offset;
+    offset += data->size();
+  }
+  return offset;
+}
+
 size_t OatWriter::InitOatClasses(size_t offset) {
   // calculate the offsets within OatDexFiles to OatClasses
   InitOatClassesMethodVisitor visitor(this, offset);
@@ -1464,6 +1548,10 @@ bool OatWriter::Write(OutputStream* out) {
     DO_STAT(size_oat_header_);
     DO_STAT(size_oat_header_key_value_store_);
     DO_STAT(size_dex_file_);
+    DO_STAT(size_lookup_table_alignment_);
+    DO_STAT(size_lookup_table_);
+    DO_STAT(size_verifier_deps_alignment_);
+    DO_STAT(size_verifier_deps_);
     DO_STAT(size_interpreter_to_interpreter_bridge_);
     DO_STAT(size_interpreter_to_compiled_code_bridge_);
     DO_STAT(size_jni_dlsym_lookup_);
@@ -1486,6 +1574,8 @@ bool OatWriter::Write(OutputStream* out) {
     DO_STAT(size_oat_dex_file_location_data_);
     DO_STAT(size_oat_dex_file_location_checksum_);
     DO_STAT(size_oat_dex_file_offset_);
+    DO_STAT(size_oat_dex_file_lookup_table_offset_);
+    DO_STAT(size_oat_dex_file_verifier_deps_offset_);
     DO_STAT(size_oat_dex_file_methods_offsets_);
     DO_STAT(size_oat_class_type_);
     DO_STAT(size_oat_class_status_);
@@ -1544,6 +1634,48 @@ bool OatWriter::WriteTables(OutputStream* out, const size_t file_offset) {
     }
     size_dex_file_ += dex_file->GetHeader().file_size_;
   }
+  for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
+    const TypeLookupTable* table = lookup_tables_[i].get();
+    if (table == nullptr) {
+      continue;
+    }
+    uint32_t expected_offset = file_offset + oat_dex_files_[i]->lookup_table_offset_;
+    off_t actual_offset = out->Seek(expected_offset, kSeekSet);
+    if (static_cast<uint32_t>(actual_offset) != expected_offset) {
+      const DexFile* dex_file = (*dex_files_)[i];
+      PLOG(ERROR) << "Failed to seek to lookup table section. Actual: " << actual_offset
+                  << " Expected: " << expected_offset << " File: " << dex_file->GetLocation();
+      return false;
+    }
+    if (!out->WriteFully(table->RawData(), table->RawDataLength())) {
+      const DexFile* dex_file = (*dex_files_)[i];
+      PLOG(ERROR) << "Failed to write lookup table for " << dex_file->GetLocation()
+                  << " to " << out->GetLocation();
+      return false;
+    }
+    size_lookup_table_ += table->RawDataLength();
+  }
+  for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
+    const std::vector<uint8_t>& data = verifier_deps_[i];
+    if (data.empty()) {
+      continue;
+    }
+    uint32_t expected_offset = file_offset + oat_dex_files_[i]->verifier_deps_offset_;
+    off_t actual_offset = out->Seek(expected_offset, kSeekSet);
+    if (static_cast<uint32_t>(actual_offset) != expected_offset) {
+      const DexFile* dex_file = (*dex_files_)[i];
+      PLOG(ERROR) << "Failed to seek to verifier deps section. Actual: " << actual_offset
+                  << " Expected: " << expected_offset << " File: " << dex_file->GetLocation();
+      return false;
+    }
+    if (!out->WriteFully(&data[0], data.size())) {
+      const DexFile* dex_file = (*dex_files_)[i];
+      PLOG(ERROR) << "Failed to write verifier deps for " << dex_file->GetLocation()
+                  << " to " << out->GetLocation();
+      return false;
+    }
+    size_verifier_deps_ += data.size();
+  }
   for (size_t i = 0; i != oat_classes_.size(); ++i) {
     if (!oat_classes_[i]->Write(this, out, file_offset)) {
       PLOG(ERROR) << "Failed to write oat methods information to " << out->GetLocation();
@@ -1662,6 +1794,8 @@ OatWriter::OatDexFile::OatDexFile(size_t offset, const DexFile& dex_file) {
   dex_file_location_data_ = reinterpret_cast<const uint8_t*>(location.data());
   dex_file_location_checksum_ = dex_file.GetLocationChecksum();
   dex_file_offset_ = 0;
+  lookup_table_offset_ = 0;
+  verifier_deps_offset_ = 0;
   methods_offsets_.resize(dex_file.NumClassDefs());
 }
 
@@ -1670,6 +1804,8 @@ size_t OatWriter::OatDexFile::SizeOf() const {
           + dex_file_location_size_
           + sizeof(dex_file_location_checksum_)
           + sizeof(dex_file_offset_)
+          + sizeof(lookup_table_offset_)
+          + sizeof(verifier_deps_offset_)
           + (sizeof(methods_offsets_[0]) * methods_offsets_.size());
 }
 
@@ -1678,6 +1814,8 @@ void OatWriter::OatDexFile::UpdateChecksum(OatHeader* oat_header) const {
   oat_header->UpdateChecksum(dex_file_location_data_, dex_file_location_size_);
   oat_header->UpdateChecksum(&dex_file_location_checksum_, sizeof(dex_file_location_checksum_));
   oat_header->UpdateChecksum(&dex_file_offset_, sizeof(dex_file_offset_));
+  oat_header->UpdateChecksum(&lookup_table_offset_, sizeof(lookup_table_offset_));
+  oat_header->UpdateChecksum(&verifier_deps_offset_, sizeof(verifier_deps_offset_));
   oat_header->UpdateChecksum(&methods_offsets_[0],
                             sizeof(methods_offsets_[0]) * methods_offsets_.size());
 }
@@ -1706,6 +1844,16 @@ bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
     return false;
   }
   oat_writer->size_oat_dex_file_offset_ += sizeof(dex_file_offset_);
+  if (!out->WriteFully(&lookup_table_offset_, sizeof(lookup_table_offset_))) {
+    PLOG(ERROR) << "Failed to write lookup table offset to " << out->GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_lookup_table_offset_ += sizeof(lookup_table_offset_);
+  if (!out->WriteFully(&verifier_deps_offset_, sizeof(verifier_deps_offset_))) {
+    PLOG(ERROR) << "Failed to write verifier deps offset to " << out->GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_verifier_deps_offset_ += sizeof(verifier_deps_offset_);
   if (!out->WriteFully(&methods_offsets_[0],
                       sizeof(methods_offsets_[0]) * methods_offsets_.size())) {
     PLOG(ERROR) << "Failed to write methods offsets to " << out->GetLocation();
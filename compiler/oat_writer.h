@@ -34,6 +34,7 @@ class BitVector;
 class CompiledMethod;
 class ImageWriter;
 class OutputStream;
+class TypeLookupTable;
 
 // OatHeader         variable length with count of D OatDexFiles
 //
@@ -47,6 +48,16 @@ class OutputStream;
 // ...
 // Dex[D]
 //
+// TypeLookupTable[0] one descriptor hash table for each DexFile with class defs.
+// TypeLookupTable[1] used by DexFile::FindClassDef at runtime.
+// ...
+// TypeLookupTable[D]
+//
+// VerifierDeps[0]   class resolution assumptions of the classes that need to be verified again
+// VerifierDeps[1]   at runtime, for each DexFile with such classes.
+// ...
+// VerifierDeps[D]
+//
 // OatClass[0]       one variable sized OatClass for each of C DexFile::ClassDefs
 // OatClass[1]       contains OatClass entries with class status, offsets to code, etc.
 // ...
@@ -159,6 +170,8 @@ class OatWriter {
   size_t InitOatHeader();
   size_t InitOatDexFiles(size_t offset);
   size_t InitDexFiles(size_t offset);
+  size_t InitLookupTables(size_t offset);
+  size_t InitVerifierDeps(size_t offset);
   size_t InitOatClasses(size_t offset);
   size_t InitOatMaps(size_t offset);
   size_t InitOatCode(size_t offset)
@@ -189,6 +202,8 @@ class OatWriter {
     const uint8_t* dex_file_location_data_;
     uint32_t dex_file_location_checksum_;
     uint32_t dex_file_offset_;
+    uint32_t lookup_table_offset_;
+    uint32_t verifier_deps_offset_;
     std::vector<uint32_t> methods_offsets_;
 
    private:
@@ -282,6 +297,8 @@ class OatWriter {
   OatHeader* oat_header_;
   std::vector<OatDexFile*> oat_dex_files_;
   std::vector<OatClass*> oat_classes_;
+  std::vector<std::unique_ptr<TypeLookupTable>> lookup_tables_;
+  std::vector<std::vector<uint8_t>> verifier_deps_;
   std::unique_ptr<const std::vector<uint8_t>> interpreter_to_interpreter_bridge_;
   std::unique_ptr<const std::vector<uint8_t>> interpreter_to_compiled_code_bridge_;
   std::unique_ptr<const std::vector<uint8_t>> jni_dlsym_lookup_;
@@ -299,6 +316,10 @@ class OatWriter {
   uint32_t size_oat_header_;
   uint32_t size_oat_header_key_value_store_;
   uint32_t size_dex_file_;
+  uint32_t size_lookup_table_alignment_;
+  uint32_t size_lookup_table_;
+  uint32_t size_verifier_deps_alignment_;
+  uint32_t size_verifier_deps_;
   uint32_t size_interpreter_to_interpreter_bridge_;
   uint32_t size_interpreter_to_compiled_code_bridge_;
   uint32_t size_jni_dlsym_lookup_;
@@ -321,6 +342,8 @@ class OatWriter {
   uint32_t size_oat_dex_file_location_data_;
   uint32_t size_oat_dex_file_location_checksum_;
   uint32_t size_oat_dex_file_offset_;
+  uint32_t size_oat_dex_file_lookup_table_offset_;
+  uint32_t size_oat_dex_file_verifier_deps_offset_;
   uint32_t size_oat_dex_file_methods_offsets_;
   uint32_t size_oat_class_type_;
   uint32_t size_oat_class_status_;
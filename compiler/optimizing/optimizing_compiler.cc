@@ -27,6 +27,7 @@
 #include "dead_code_elimination.h"
 #include "driver/compiler_driver.h"
 #include "driver/dex_compilation_unit.h"
+#include "driver/method_compile_stats.h"
 #include "elf_writer_quick.h"
 #include "graph_visualizer.h"
 #include "gvn.h"
@@ -192,7 +193,8 @@ static bool CanOptimize(const DexFile::CodeItem& code_item) {
   return code_item.tries_size_ == 0;
 }
 
-static void RunOptimizations(HGraph* graph, const HGraphVisualizer& visualizer) {
+static void RunOptimizations(HGraph* graph, const HGraphVisualizer& visualizer,
+                             MethodCompileStats* method_stats) {
   HDeadCodeElimination opt1(graph);
   HConstantFolding opt2(graph);
   SsaRedundantPhiElimination opt3(graph);
@@ -215,7 +217,10 @@ static void RunOptimizations(HGraph* graph, const HGraphVisualizer& visualizer)
 
   for (size_t i = 0; i < arraysize(optimizations); ++i) {
     HOptimization* optimization = optimizations[i];
-    optimization->Run();
+    {
+      ScopedPassTiming pass_timing(method_stats, optimization->GetPassName());
+      optimization->Run();
+    }
     visualizer.DumpGraph(optimization->GetPassName());
     optimization->Check();
   }
@@ -223,7 +228,9 @@ static void RunOptimizations(HGraph* graph, const HGraphVisualizer& visualizer)
 
 static bool TryBuildingSsa(HGraph* graph,
                            const DexCompilationUnit& dex_compilation_unit,
-                           const HGraphVisualizer& visualizer) {
+                           const HGraphVisualizer& visualizer,
+                           MethodCompileStats* method_stats) {
+  ScopedPassTiming pass_timing(method_stats, "ssa transform");
   graph->BuildDominatorTree();
   graph->TransformToSSA();
 
@@ -232,6 +239,7 @@ static bool TryBuildingSsa(HGraph* graph,
               << PrettyMethod(dex_compilation_unit.GetDexMethodIndex(),
                               *dex_compilation_unit.GetDexFile())
               << ": it contains a non natural loop";
+    RecordFallbackReason(method_stats, "non natural loop");
     return false;
   }
   visualizer.DumpGraph("ssa transform");
@@ -247,6 +255,10 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
                                             const DexFile& dex_file) const {
   UNUSED(invoke_type);
   total_compiled_methods_++;
+  MethodCompileStats* method_stats = GetCompilerDriver()->GetMethodStats();
+  if (method_stats != nullptr) {
+    method_stats->backend = "optimizing";
+  }
   InstructionSet instruction_set = GetCompilerDriver()->GetInstructionSet();
   // Always use the thumb2 assembler: some runtime functionality (like implicit stack
   // overflow checks) assume thumb2.
@@ -256,10 +268,12 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
 
   // Do not attempt to compile on architectures we do not support.
   if (!IsInstructionSetSupported(instruction_set)) {
+    RecordFallbackReason(method_stats, "unsupported instruction set");
     return nullptr;
   }
 
   if (Compiler::IsPathologicalCase(*code_item, method_idx, dex_file)) {
+    RecordFallbackReason(method_stats, "pathological case");
     return nullptr;
   }
 
@@ -278,15 +292,21 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
   ArenaAllocator arena(&pool);
   HGraphBuilder builder(&arena, &dex_compilation_unit, &dex_file, GetCompilerDriver());
 
-  HGraph* graph = builder.BuildGraph(*code_item);
+  HGraph* graph;
+  {
+    ScopedPassTiming pass_timing(method_stats, "builder");
+    graph = builder.BuildGraph(*code_item);
+  }
   if (graph == nullptr) {
     CHECK(!shouldCompile) << "Could not build graph in optimizing compiler";
+    RecordFallbackReason(method_stats, "could not build graph");
     return nullptr;
   }
 
   CodeGenerator* codegen = CodeGenerator::Create(&arena, graph, instruction_set);
   if (codegen == nullptr) {
     CHECK(!shouldCompile) << "Could not find code generator for optimizing compiler";
+    RecordFallbackReason(method_stats, "no code generator");
     return nullptr;
   }
 
@@ -301,22 +321,34 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
       && RegisterAllocator::CanAllocateRegistersFor(*graph, instruction_set)) {
     VLOG(compiler) << "Optimizing " << PrettyMethod(method_idx, dex_file);
     optimized_compiled_methods_++;
-    if (!TryBuildingSsa(graph, dex_compilation_unit, visualizer)) {
+    if (!TryBuildingSsa(graph, dex_compilation_unit, visualizer, method_stats)) {
       // We could not transform the graph to SSA, bailout.
       return nullptr;
     }
-    RunOptimizations(graph, visualizer);
+    RunOptimizations(graph, visualizer, method_stats);
 
-    PrepareForRegisterAllocation(graph).Run();
+    {
+      ScopedPassTiming pass_timing(method_stats, "prepare for register allocation");
+      PrepareForRegisterAllocation(graph).Run();
+    }
     SsaLivenessAnalysis liveness(*graph, codegen);
-    liveness.Analyze();
+    {
+      ScopedPassTiming pass_timing(method_stats, kLivenessPassName);
+      liveness.Analyze();
+    }
     visualizer.DumpGraph(kLivenessPassName);
 
     RegisterAllocator register_allocator(graph->GetArena(), codegen, liveness);
-    register_allocator.AllocateRegisters();
+    {
+      ScopedPassTiming pass_timing(method_stats, kRegisterAllocatorPassName);
+      register_allocator.AllocateRegisters();
+    }
 
     visualizer.DumpGraph(kRegisterAllocatorPassName);
-    codegen->CompileOptimized(&allocator);
+    {
+      ScopedPassTiming pass_timing(method_stats, "codegen");
+      codegen->CompileOptimized(&allocator);
+    }
 
     std::vector<uint8_t> mapping_table;
     SrcMap src_mapping_table;
@@ -327,6 +359,10 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
     std::vector<uint8_t> stack_map;
     codegen->BuildStackMaps(&stack_map);
 
+    if (method_stats != nullptr) {
+      method_stats->arena_bytes = arena.BytesAllocated();
+    }
+
     return new CompiledMethod(GetCompilerDriver(),
                               instruction_set,
                               allocator.GetMemory(),
@@ -341,7 +377,10 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
   } else {
     VLOG(compiler) << "Compile baseline " << PrettyMethod(method_idx, dex_file);
     unoptimized_compiled_methods_++;
-    codegen->CompileBaseline(&allocator);
+    {
+      ScopedPassTiming pass_timing(method_stats, "codegen baseline");
+      codegen->CompileBaseline(&allocator);
+    }
 
     std::vector<uint8_t> mapping_table;
     SrcMap src_mapping_table;
@@ -353,6 +392,10 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
     std::vector<uint8_t> gc_map;
     codegen->BuildNativeGCMap(&gc_map, dex_compilation_unit);
 
+    if (method_stats != nullptr) {
+      method_stats->arena_bytes = arena.BytesAllocated();
+    }
+
     return new CompiledMethod(GetCompilerDriver(),
                               instruction_set,
                               allocator.GetMemory(),
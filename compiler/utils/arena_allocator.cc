@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <sys/mman.h>
+
 #include <algorithm>
 #include <iomanip>
 #include <numeric>
@@ -126,7 +128,8 @@ template class ArenaAllocatorStatsImpl<kArenaAllocatorCountAllocations>;
 Arena::Arena(size_t size)
     : bytes_allocated_(0),
       map_(nullptr),
-      next_(nullptr) {
+      next_(nullptr),
+      cache_index_(0u) {
   if (kUseMemMap) {
     std::string error_msg;
     map_ = MemMap::MapAnonymous("dalvik-arena", NULL, size, PROT_READ | PROT_WRITE, false,
@@ -159,60 +162,160 @@ void Arena::Reset() {
   }
 }
 
-ArenaPool::ArenaPool()
-    : lock_("Arena pool lock"),
-      free_arenas_(nullptr) {
+void Arena::Release() {
+  if (bytes_allocated_ > 0) {
+    if (kUseMemMap) {
+      map_->MadviseDontNeedAndZero();
+    } else {
+      // Only whole pages can be dropped, zero the partial pages at either end by hand.
+      uint8_t* used_end = memory_ + bytes_allocated_;
+      uint8_t* release_begin = AlignUp(memory_, kPageSize);
+      uint8_t* release_end = AlignDown(used_end, kPageSize);
+      if (release_begin < release_end) {
+        memset(memory_, 0, release_begin - memory_);
+        if (madvise(release_begin, release_end - release_begin, MADV_DONTNEED) != 0) {
+          PLOG(WARNING) << "madvise failed, zeroing arena memory instead";
+          memset(release_begin, 0, release_end - release_begin);
+        }
+        memset(release_end, 0, used_end - release_end);
+      } else {
+        memset(memory_, 0, bytes_allocated_);
+      }
+    }
+    bytes_allocated_ = 0;
+  }
+}
+
+ArenaPool::ThreadCache::ThreadCache()
+    : lock("Arena pool lock"),
+      in_use_bytes(0u),
+      peak_in_use_bytes(0u),
+      retained_bytes(0u) {
+  std::fill_n(free_arenas, kNumSizeClasses, nullptr);
+}
+
+Arena* ArenaPool::ThreadCache::TakeArena(size_t size, size_t size_class) {
+  for (size_t i = size_class; i != kNumSizeClasses; ++i) {
+    // Arenas in the last size class vary in size, the others are all large enough.
+    for (Arena** link = &free_arenas[i]; *link != nullptr; link = &(*link)->next_) {
+      Arena* arena = *link;
+      if (LIKELY(arena->Size() >= size)) {
+        *link = arena->next_;
+        retained_bytes -= arena->GetBytesAllocated();
+        return arena;
+      }
+    }
+  }
+  return nullptr;
+}
+
+ArenaPool::ArenaPool() {
 }
 
 ArenaPool::~ArenaPool() {
-  while (free_arenas_ != nullptr) {
-    auto* arena = free_arenas_;
-    free_arenas_ = free_arenas_->next_;
-    delete arena;
+  for (ThreadCache& cache : caches_) {
+    for (Arena*& free_arenas : cache.free_arenas) {
+      while (free_arenas != nullptr) {
+        auto* arena = free_arenas;
+        free_arenas = free_arenas->next_;
+        delete arena;
+      }
+    }
   }
 }
 
+size_t ArenaPool::SizeClass(size_t size) {
+  size_t size_class = 0u;
+  while (size_class + 1u != kNumSizeClasses && (Arena::kDefaultSize << size_class) < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+size_t ArenaPool::ThreadCacheIndex(Thread* self) {
+  return (self != nullptr) ? self->GetThreadId() % kNumThreadCaches : 0u;
+}
+
 Arena* ArenaPool::AllocArena(size_t size) {
   Thread* self = Thread::Current();
+  const size_t cache_index = ThreadCacheIndex(self);
+  const size_t size_class = SizeClass(size);
   Arena* ret = nullptr;
-  {
-    MutexLock lock(self, lock_);
-    if (free_arenas_ != nullptr && LIKELY(free_arenas_->Size() >= size)) {
-      ret = free_arenas_;
-      free_arenas_ = free_arenas_->next_;
-    }
+  for (size_t i = 0; i != kNumThreadCaches && ret == nullptr; ++i) {
+    ThreadCache& cache = caches_[(cache_index + i) % kNumThreadCaches];
+    MutexLock lock(self, cache.lock);
+    ret = cache.TakeArena(size, size_class);
   }
   if (ret == nullptr) {
-    ret = new Arena(size);
+    size_t class_size = Arena::kDefaultSize << size_class;
+    ret = new Arena((size_class + 1u != kNumSizeClasses) ? class_size : std::max(size, class_size));
   }
   ret->Reset();
+  ret->cache_index_ = cache_index;
+  ThreadCache& cache = caches_[cache_index];
+  MutexLock lock(self, cache.lock);
+  cache.in_use_bytes += ret->Size();
+  cache.peak_in_use_bytes = std::max(cache.peak_in_use_bytes, cache.in_use_bytes);
   return ret;
 }
 
 size_t ArenaPool::GetBytesAllocated() const {
   size_t total = 0;
-  MutexLock lock(Thread::Current(), lock_);
-  for (Arena* arena = free_arenas_; arena != nullptr; arena = arena->next_) {
-    total += arena->GetBytesAllocated();
+  Thread* self = Thread::Current();
+  for (const ThreadCache& cache : caches_) {
+    MutexLock lock(self, cache.lock);
+    total += cache.retained_bytes;
   }
   return total;
 }
 
+void ArenaPool::TrimMaps() {
+  Thread* self = Thread::Current();
+  for (ThreadCache& cache : caches_) {
+    MutexLock lock(self, cache.lock);
+    for (Arena* free_arenas : cache.free_arenas) {
+      for (Arena* arena = free_arenas; arena != nullptr; arena = arena->next_) {
+        arena->Release();
+      }
+    }
+    cache.retained_bytes = 0u;
+  }
+}
+
+void ArenaPool::DumpThreadStats(std::ostream& os) const {
+  Thread* self = Thread::Current();
+  for (size_t i = 0; i != kNumThreadCaches; ++i) {
+    const ThreadCache& cache = caches_[i];
+    MutexLock lock(self, cache.lock);
+    if (cache.peak_in_use_bytes != 0u) {
+      os << "Arena thread cache " << i << ": peak=" << PrettySize(cache.peak_in_use_bytes)
+         << " in use=" << PrettySize(cache.in_use_bytes)
+         << " retained=" << PrettySize(cache.retained_bytes) << "\n";
+    }
+  }
+}
+
 void ArenaPool::FreeArenaChain(Arena* first) {
   if (UNLIKELY(RUNNING_ON_VALGRIND > 0)) {
     for (Arena* arena = first; arena != nullptr; arena = arena->next_) {
       VALGRIND_MAKE_MEM_UNDEFINED(arena->memory_, arena->bytes_allocated_);
     }
   }
-  if (first != nullptr) {
-    Arena* last = first;
-    while (last->next_ != nullptr) {
-      last = last->next_;
+  Thread* self = Thread::Current();
+  while (first != nullptr) {
+    Arena* arena = first;
+    first = first->next_;
+    // Large arenas are needed by few methods only, don't keep their memory around.
+    if (arena->Size() > Arena::kDefaultSize) {
+      arena->Release();
     }
-    Thread* self = Thread::Current();
-    MutexLock lock(self, lock_);
-    last->next_ = free_arenas_;
-    free_arenas_ = first;
+    ThreadCache& cache = caches_[arena->cache_index_];
+    const size_t size_class = SizeClass(arena->Size());
+    MutexLock lock(self, cache.lock);
+    arena->next_ = cache.free_arenas[size_class];
+    cache.free_arenas[size_class] = arena;
+    cache.in_use_bytes -= arena->Size();
+    cache.retained_bytes += arena->GetBytesAllocated();
   }
 }
 
@@ -139,12 +139,17 @@ class Arena {
     return bytes_allocated_;
   }
 
+  // Returns the used memory to the system. It reads as zero when touched again.
+  void Release();
+
  private:
   size_t bytes_allocated_;
   uint8_t* memory_;
   size_t size_;
   MemMap* map_;
   Arena* next_;
+  // Index of the ArenaPool thread cache the arena was allocated from and is returned to.
+  size_t cache_index_;
   friend class ArenaPool;
   friend class ArenaAllocator;
   friend class ArenaStack;
@@ -157,13 +162,45 @@ class ArenaPool {
  public:
   ArenaPool();
   ~ArenaPool();
-  Arena* AllocArena(size_t size) LOCKS_EXCLUDED(lock_);
-  void FreeArenaChain(Arena* first) LOCKS_EXCLUDED(lock_);
-  size_t GetBytesAllocated() const LOCKS_EXCLUDED(lock_);
+  Arena* AllocArena(size_t size);
+  void FreeArenaChain(Arena* first);
+  // Returns the number of bytes held by free arenas that still need to be zeroed for reuse.
+  size_t GetBytesAllocated() const;
+  // Returns the memory of the free arenas to the system, keeping the arenas for reuse.
+  void TrimMaps();
+  // Dumps the peak and retained arena bytes of each thread cache.
+  void DumpThreadStats(std::ostream& os) const;
 
  private:
-  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  Arena* free_arenas_ GUARDED_BY(lock_);
+  // Arenas are sized kDefaultSize << size_class, except for the last size class which holds all
+  // the larger arenas at their requested size.
+  static constexpr size_t kNumSizeClasses = 6u;
+
+  // Threads allocate from and free to the cache selected by their thread id, falling back to the
+  // caches of the other threads before allocating a new arena. As long as there are no more
+  // threads than caches, each compiler thread gets a cache to itself.
+  static constexpr size_t kNumThreadCaches = 16u;
+
+  struct ThreadCache {
+    ThreadCache();
+
+    // Takes a free arena of at least size bytes, starting the search at size_class.
+    Arena* TakeArena(size_t size, size_t size_class) EXCLUSIVE_LOCKS_REQUIRED(lock);
+
+    mutable Mutex lock DEFAULT_MUTEX_ACQUIRED_AFTER;
+    Arena* free_arenas[kNumSizeClasses] GUARDED_BY(lock);
+    // Total size of the arenas allocated from this cache and not yet freed.
+    size_t in_use_bytes GUARDED_BY(lock);
+    size_t peak_in_use_bytes GUARDED_BY(lock);
+    // Bytes of the free arenas that are dirty, i.e. resident and in need of zeroing.
+    size_t retained_bytes GUARDED_BY(lock);
+  };
+
+  static size_t SizeClass(size_t size);
+  static size_t ThreadCacheIndex(Thread* self);
+
+  ThreadCache caches_[kNumThreadCaches];
+
   DISALLOW_COPY_AND_ASSIGN(ArenaPool);
 };
 
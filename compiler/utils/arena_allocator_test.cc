@@ -30,4 +30,31 @@ TEST(ArenaAllocator, Test) {
   EXPECT_EQ(2U, bv.GetStorageSize());
 }
 
+TEST(ArenaAllocator, ReuseAndTrim) {
+  ArenaPool pool;
+  {
+    ArenaAllocator arena(&pool);
+    memset(arena.Alloc(1000, kArenaAllocMisc), 0xff, 1000);
+    memset(arena.Alloc(3 * Arena::kDefaultSize, kArenaAllocMisc), 0xff, 3 * Arena::kDefaultSize);
+  }
+  // The large arena is released when freed, the small one keeps its memory until trimmed.
+  EXPECT_EQ(1000U, pool.GetBytesAllocated());
+  pool.TrimMaps();
+  EXPECT_EQ(0U, pool.GetBytesAllocated());
+
+  // The freed arenas are reused and come back zeroed.
+  {
+    ArenaAllocator arena(&pool);
+    uint8_t* large = reinterpret_cast<uint8_t*>(
+        arena.Alloc(2 * Arena::kDefaultSize + 8, kArenaAllocMisc));
+    for (size_t i = 0; i != 2 * Arena::kDefaultSize + 8; ++i) {
+      ASSERT_EQ(0U, large[i]);
+    }
+    uint8_t* small = reinterpret_cast<uint8_t*>(arena.Alloc(1000, kArenaAllocMisc));
+    for (size_t i = 0; i != 1000; ++i) {
+      ASSERT_EQ(0U, small[i]);
+    }
+  }
+}
+
 }  // namespace art
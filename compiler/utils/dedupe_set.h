@@ -17,68 +17,149 @@
 #ifndef ART_COMPILER_UTILS_DEDUPE_SET_H_
 #define ART_COMPILER_UTILS_DEDUPE_SET_H_
 
-#include <set>
+#include <algorithm>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
+#include "atomic.h"
 #include "base/mutex.h"
-#include "base/stl_util.h"
 #include "base/stringprintf.h"
+#include "utils.h"
 
 namespace art {
 
-// A set of Keys that support a HashFunc returning HashType. Used to find duplicates of Key in the
-// Add method. The data-structure is thread-safe through the use of internal locks, it also
-// supports the lock being sharded.
-template <typename Key, typename HashType, typename HashFunc, HashType kShard = 1>
+// A set of Keys that support a HashFunc returning HashType. Used to find duplicates of InKey in the
+// Add method. Keys not seen before are copied into a StoreKey allocated with the allocator the set
+// was created with. The data-structure is thread-safe and supports being sharded.
+//
+// Each shard is an open-addressing hash table with linear probing. Many keys added by the compiler
+// are duplicates, so lookups don't take the lock: slots are only ever filled, never cleared or
+// moved, and a slot's key is published after its hash. Only inserting takes the shard's lock. A
+// full table is replaced by a larger copy while the old one is kept alive, since lookups may still
+// be probing it; a lookup missing a key that was added concurrently retries under the lock.
+template <typename InKey, typename StoreKey, typename HashType, typename HashFunc,
+          HashType kShard = 1>
 class DedupeSet {
-  typedef std::pair<HashType, Key*> HashedKey;
-
-  class Comparator {
-   public:
-    bool operator()(const HashedKey& a, const HashedKey& b) const {
-      if (a.first != b.first) {
-        return a.first < b.first;
-      } else {
-        return *a.second < *b.second;
-      }
+  struct Slot {
+    Atomic<HashType> hash;
+    Atomic<StoreKey*> store_key;  // nullptr if the slot is empty.
+  };
+
+  struct Table {
+    explicit Table(size_t capacity_in)
+        : capacity(capacity_in), num_entries(0u), slots(new Slot[capacity_in]) {
+      DCHECK(IsPowerOfTwo(capacity));
     }
+
+    const size_t capacity;
+    size_t num_entries;  // Guarded by the shard's lock.
+    std::unique_ptr<Slot[]> slots;
   };
 
+  static constexpr size_t kInitialCapacity = 1024u;
+
  public:
-  Key* Add(Thread* self, const Key& key) {
+  typedef typename StoreKey::allocator_type StoreAllocator;
+
+  StoreKey* Add(Thread* self, const InKey& key) {
     HashType raw_hash = HashFunc()(key);
     HashType shard_hash = raw_hash / kShard;
     HashType shard_bin = raw_hash % kShard;
-    HashedKey hashed_key(shard_hash, const_cast<Key*>(&key));
+    StoreKey* store_key =
+        Find(table_[shard_bin].load(std::memory_order_acquire), shard_hash, key);
+    if (store_key != nullptr) {
+      return store_key;
+    }
     MutexLock lock(self, *lock_[shard_bin]);
-    auto it = keys_[shard_bin].find(hashed_key);
-    if (it != keys_[shard_bin].end()) {
-      return it->second;
+    // Look again, the key may have been inserted or the table grown since.
+    Table* table = table_[shard_bin].LoadRelaxed();
+    store_key = Find(table, shard_hash, key);
+    if (store_key != nullptr) {
+      return store_key;
+    }
+    // Keep the load factor at or below 1/2 to keep probe sequences short.
+    if (2u * (table->num_entries + 1u) > table->capacity) {
+      table = Grow(shard_bin);
     }
-    hashed_key.second = new Key(key);
-    keys_[shard_bin].insert(hashed_key);
-    return hashed_key.second;
+    store_key = new StoreKey(key.begin(), key.end(), allocator_);
+    Insert(table, shard_hash, store_key);
+    return store_key;
   }
 
-  explicit DedupeSet(const char* set_name) {
+  explicit DedupeSet(const char* set_name, const StoreAllocator& allocator = StoreAllocator())
+      : allocator_(allocator) {
     for (HashType i = 0; i < kShard; ++i) {
       std::ostringstream oss;
       oss << set_name << " lock " << i;
       lock_name_[i] = oss.str();
       lock_[i].reset(new Mutex(lock_name_[i].c_str()));
+      tables_[i].emplace_back(new Table(kInitialCapacity));
+      table_[i].StoreRelaxed(tables_[i].back().get());
     }
   }
 
   ~DedupeSet() {
     for (HashType i = 0; i < kShard; ++i) {
-      STLDeleteValues(&keys_[i]);
+      // Every key is in the current table, the old ones hold a subset of them.
+      const Table* table = table_[i].LoadRelaxed();
+      for (size_t j = 0; j != table->capacity; ++j) {
+        delete table->slots[j].store_key.LoadRelaxed();
+      }
     }
   }
 
  private:
+  static StoreKey* Find(const Table* table, HashType hash, const InKey& key) {
+    const size_t mask = table->capacity - 1u;
+    for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1u) & mask) {
+      const Slot& slot = table->slots[i];
+      // Acquire to see the hash and the contents of the key stored before it was published.
+      StoreKey* store_key = slot.store_key.load(std::memory_order_acquire);
+      if (store_key == nullptr) {
+        return nullptr;
+      }
+      if (slot.hash.LoadRelaxed() == hash && key.size() == store_key->size() &&
+          std::equal(key.begin(), key.end(), store_key->begin())) {
+        return store_key;
+      }
+    }
+  }
+
+  static void Insert(Table* table, HashType hash, StoreKey* store_key) {
+    const size_t mask = table->capacity - 1u;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (table->slots[i].store_key.LoadRelaxed() != nullptr) {
+      i = (i + 1u) & mask;
+    }
+    table->slots[i].hash.StoreRelaxed(hash);
+    table->slots[i].store_key.StoreRelease(store_key);
+    ++table->num_entries;
+  }
+
+  // Replaces the shard's table with one twice as large. Called with the shard's lock held.
+  Table* Grow(HashType shard_bin) {
+    const Table* old_table = table_[shard_bin].LoadRelaxed();
+    Table* new_table = new Table(2u * old_table->capacity);
+    for (size_t i = 0; i != old_table->capacity; ++i) {
+      StoreKey* store_key = old_table->slots[i].store_key.LoadRelaxed();
+      if (store_key != nullptr) {
+        Insert(new_table, old_table->slots[i].hash.LoadRelaxed(), store_key);
+      }
+    }
+    tables_[shard_bin].emplace_back(new_table);
+    table_[shard_bin].StoreRelease(new_table);
+    return new_table;
+  }
+
   std::string lock_name_[kShard];
   std::unique_ptr<Mutex> lock_[kShard];
-  std::set<HashedKey, Comparator> keys_[kShard];
+  // The current table of each shard, read without holding the lock.
+  Atomic<Table*> table_[kShard];
+  // All tables each shard has had, guarded by the shard's lock.
+  std::vector<std::unique_ptr<Table>> tables_[kShard];
+  const StoreAllocator allocator_;
 
   DISALLOW_COPY_AND_ASSIGN(DedupeSet);
 };
@@ -15,8 +15,13 @@
  */
 
 #include "dedupe_set.h"
+
+#include <vector>
+
+#include "common_runtime_test.h"
 #include "gtest/gtest.h"
 #include "thread-inl.h"
+#include "thread_pool.h"
 
 namespace art {
 
@@ -32,10 +37,11 @@ class DedupeHashFunc {
     return hash;
   }
 };
+
 TEST(DedupeSetTest, Test) {
   Thread* self = Thread::Current();
   typedef std::vector<uint8_t> ByteArray;
-  DedupeSet<ByteArray, size_t, DedupeHashFunc> deduplicator("test");
+  DedupeSet<ByteArray, ByteArray, size_t, DedupeHashFunc> deduplicator("test");
   ByteArray* array1;
   {
     ByteArray test1;
@@ -72,4 +78,78 @@ TEST(DedupeSetTest, Test) {
   }
 }
 
+typedef std::vector<uint8_t> ByteArray;
+typedef DedupeSet<ByteArray, ByteArray, size_t, DedupeHashFunc, 4> ShardedDeduplicator;
+
+// Adds every array of a shared pool, starting at a different offset in each task so that threads
+// race to insert the same keys.
+class DedupeTask : public Task {
+ public:
+  DedupeTask(ShardedDeduplicator* deduplicator, const std::vector<ByteArray>* arrays,
+             size_t start, size_t num_rounds, std::vector<ByteArray*>* results)
+      : deduplicator_(deduplicator), arrays_(arrays), start_(start), num_rounds_(num_rounds),
+        results_(results) {}
+
+  void Run(Thread* self) {
+    const size_t num_arrays = arrays_->size();
+    results_->resize(num_arrays);
+    for (size_t round = 0; round != num_rounds_; ++round) {
+      for (size_t i = 0; i != num_arrays; ++i) {
+        size_t index = (start_ + i) % num_arrays;
+        (*results_)[index] = deduplicator_->Add(self, (*arrays_)[index]);
+      }
+    }
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  ShardedDeduplicator* const deduplicator_;
+  const std::vector<ByteArray>* const arrays_;
+  const size_t start_;
+  const size_t num_rounds_;
+  std::vector<ByteArray*>* const results_;
+};
+
+// The worker threads need a runtime to attach to.
+class DedupeSetMultiThreadedTest : public CommonRuntimeTest {};
+
+// Checks that concurrent adds agree on the stored key, growing the tables on the way.
+TEST_F(DedupeSetMultiThreadedTest, Add) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kNumArrays = 20000;
+  static constexpr size_t kNumRounds = 10;
+  Thread* self = Thread::Current();
+  std::vector<ByteArray> arrays;
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    // Arrays of varying length, half of them duplicating the contents of another one.
+    size_t value = i % (kNumArrays / 2);
+    ByteArray array(4 + value % 64, static_cast<uint8_t>(value));
+    array[0] = static_cast<uint8_t>(value >> 8);
+    arrays.push_back(array);
+  }
+
+  ShardedDeduplicator deduplicator("test");
+  std::vector<std::vector<ByteArray*>> results(kNumThreads);
+  ThreadPool thread_pool("Dedupe set test thread pool", kNumThreads);
+  for (size_t t = 0; t != kNumThreads; ++t) {
+    thread_pool.AddTask(self, new DedupeTask(&deduplicator, &arrays, t * kNumArrays / kNumThreads,
+                                             kNumRounds, &results[t]));
+  }
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, false, false);
+
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    ByteArray* stored = results[0][i];
+    ASSERT_TRUE(stored != nullptr);
+    EXPECT_EQ(arrays[i], *stored);
+    EXPECT_EQ(stored, deduplicator.Add(self, arrays[i]));
+    for (size_t t = 1; t != kNumThreads; ++t) {
+      EXPECT_EQ(stored, results[t][i]);
+    }
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swap_space.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "globals.h"
+#include "thread-inl.h"
+#include "utils.h"
+
+namespace art {
+
+// Allocations are rounded up to keep every block suitably aligned for the vectors stored in it.
+static constexpr size_t kAlignment = 8u;
+
+// The file is grown by at least this much at a time to keep the number of mappings low.
+static constexpr size_t kMinimumMapSize = 16 * MB;
+
+SwapSpace::SwapSpace(int fd, size_t initial_size)
+    : lock_("SwapSpace lock", kSwapSpaceLock),
+      fd_(fd),
+      size_(0) {
+  MutexLock mu(Thread::Current(), lock_);
+  InsertChunk(NewFileChunk(initial_size));
+}
+
+SwapSpace::~SwapSpace() {
+  for (const SpaceChunk& chunk : maps_) {
+    if (munmap(chunk.ptr, chunk.size) != 0) {
+      PLOG(WARNING) << "Failed to unmap swap space chunk of " << chunk.size << " bytes";
+    }
+  }
+  // Nothing needs to be written back, drop the data from the file.
+  if (TEMP_FAILURE_RETRY(ftruncate(fd_, 0)) != 0) {
+    PLOG(WARNING) << "Failed to truncate swap file";
+  }
+  close(fd_);
+}
+
+size_t SwapSpace::GetSize() {
+  MutexLock mu(Thread::Current(), lock_);
+  return size_;
+}
+
+void* SwapSpace::Alloc(size_t size) {
+  MutexLock mu(Thread::Current(), lock_);
+  size = (size != 0u) ? RoundUp(size, kAlignment) : kAlignment;
+
+  // Best fit: the smallest free chunk that is large enough, at the lowest address.
+  auto it = free_by_size_.lower_bound(std::make_pair(size, static_cast<uint8_t*>(nullptr)));
+  SpaceChunk chunk;
+  if (it != free_by_size_.end()) {
+    chunk = SpaceChunk { it->second, it->first };
+    RemoveChunk(chunk);
+  } else {
+    chunk = NewFileChunk(size);
+  }
+  if (chunk.size != size) {
+    InsertChunk(SpaceChunk { chunk.ptr + size, chunk.size - size });
+  }
+  return chunk.ptr;
+}
+
+void SwapSpace::Free(void* ptr, size_t size) {
+  MutexLock mu(Thread::Current(), lock_);
+  size = (size != 0u) ? RoundUp(size, kAlignment) : kAlignment;
+  SpaceChunk chunk = { reinterpret_cast<uint8_t*>(ptr), size };
+
+  // Coalesce with the free chunks directly after and before the freed one.
+  auto next = free_by_start_.lower_bound(chunk.ptr);
+  if (next != free_by_start_.end() && next->first == chunk.ptr + chunk.size) {
+    SpaceChunk next_chunk = { next->first, next->second };
+    chunk.size += next_chunk.size;
+    RemoveChunk(next_chunk);
+  }
+  auto prev = free_by_start_.lower_bound(chunk.ptr);
+  if (prev != free_by_start_.begin()) {
+    --prev;
+    DCHECK_LE(prev->first + prev->second, chunk.ptr) << "Double free in swap space";
+    if (prev->first + prev->second == chunk.ptr) {
+      SpaceChunk prev_chunk = { prev->first, prev->second };
+      chunk.ptr = prev_chunk.ptr;
+      chunk.size += prev_chunk.size;
+      RemoveChunk(prev_chunk);
+    }
+  }
+  InsertChunk(chunk);
+}
+
+SwapSpace::SpaceChunk SwapSpace::NewFileChunk(size_t min_size) {
+  const size_t next_size = RoundUp(std::max(min_size, kMinimumMapSize), kPageSize);
+  if (TEMP_FAILURE_RETRY(ftruncate(fd_, size_ + next_size)) != 0) {
+    PLOG(FATAL) << "Failed to grow swap file to " << (size_ + next_size) << " bytes";
+  }
+  void* ptr = mmap(nullptr, next_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, size_);
+  if (ptr == MAP_FAILED) {
+    PLOG(FATAL) << "Failed to map " << next_size << " bytes of swap file at offset " << size_;
+  }
+  size_ += next_size;
+  SpaceChunk chunk = { reinterpret_cast<uint8_t*>(ptr), next_size };
+  maps_.push_back(chunk);
+  VLOG(compiler) << "Swap space grown to " << PrettySize(size_);
+  return chunk;
+}
+
+void SwapSpace::InsertChunk(const SpaceChunk& chunk) {
+  DCHECK(free_by_start_.find(chunk.ptr) == free_by_start_.end());
+  free_by_start_.emplace(chunk.ptr, chunk.size);
+  free_by_size_.emplace(chunk.size, chunk.ptr);
+}
+
+void SwapSpace::RemoveChunk(const SpaceChunk& chunk) {
+  size_t erased = free_by_start_.erase(chunk.ptr);
+  DCHECK_EQ(erased, 1u);
+  erased = free_by_size_.erase(std::make_pair(chunk.size, chunk.ptr));
+  DCHECK_EQ(erased, 1u);
+}
+
+}  // namespace art
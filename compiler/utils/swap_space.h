@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_UTILS_SWAP_SPACE_H_
+#define ART_COMPILER_UTILS_SWAP_SPACE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+// A space for long-lived allocations backed by a file. The file is grown in large chunks that are
+// mapped shared, so the kernel can write pages back to the file and drop them from memory rather
+// than having to keep them resident. Free blocks are coalesced and reused best fit.
+class SwapSpace {
+ public:
+  // Takes ownership of fd, which must refer to a file opened for reading and writing.
+  SwapSpace(int fd, size_t initial_size);
+  ~SwapSpace();
+
+  void* Alloc(size_t size) LOCKS_EXCLUDED(lock_);
+  void Free(void* ptr, size_t size) LOCKS_EXCLUDED(lock_);
+
+  // Returns the size of the file backing the space.
+  size_t GetSize() LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct SpaceChunk {
+    uint8_t* ptr;
+    size_t size;
+  };
+
+  // Maps and adds to the file a chunk of at least min_size bytes.
+  SpaceChunk NewFileChunk(size_t min_size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  void InsertChunk(const SpaceChunk& chunk) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RemoveChunk(const SpaceChunk& chunk) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Allocations are made while holding the locks of the DedupeSets storing into the space.
+  Mutex lock_;
+
+  const int fd_;
+  size_t size_ GUARDED_BY(lock_);
+  std::list<SpaceChunk> maps_ GUARDED_BY(lock_);
+
+  // Free chunks, indexed both by start address for coalescing and by size for allocation.
+  std::map<uint8_t*, size_t> free_by_start_ GUARDED_BY(lock_);
+  std::set<std::pair<size_t, uint8_t*>> free_by_size_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(SwapSpace);
+};
+
+// Allocator for STL containers that allocates from a SwapSpace, or from the native heap if the
+// swap space is nullptr.
+template <typename T>
+class SwapAllocator;
+
+template <typename T>
+using SwapVector = std::vector<T, SwapAllocator<T>>;
+
+template <>
+class SwapAllocator<void> {
+ public:
+  typedef void value_type;
+  typedef void* pointer;
+  typedef const void* const_pointer;
+
+  template <typename U>
+  struct rebind {
+    typedef SwapAllocator<U> other;
+  };
+
+  explicit SwapAllocator(SwapSpace* swap_space) : swap_space_(swap_space) {}
+
+  template <typename U>
+  SwapAllocator(const SwapAllocator<U>& other) : swap_space_(other.swap_space_) {}
+
+  SwapAllocator(const SwapAllocator& other) = default;
+  SwapAllocator& operator=(const SwapAllocator& other) = default;
+  ~SwapAllocator() = default;
+
+ private:
+  SwapSpace* swap_space_;
+
+  template <typename U>
+  friend class SwapAllocator;
+};
+
+template <typename T>
+class SwapAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef T& reference;
+  typedef const T* const_pointer;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef SwapAllocator<U> other;
+  };
+
+  explicit SwapAllocator(SwapSpace* swap_space) : swap_space_(swap_space) {}
+
+  template <typename U>
+  SwapAllocator(const SwapAllocator<U>& other) : swap_space_(other.swap_space_) {}
+
+  SwapAllocator(const SwapAllocator& other) = default;
+  SwapAllocator& operator=(const SwapAllocator& other) = default;
+  ~SwapAllocator() = default;
+
+  size_type max_size() const {
+    return static_cast<size_type>(-1) / sizeof(T);
+  }
+
+  pointer address(reference x) const { return &x; }
+  const_pointer address(const_reference x) const { return &x; }
+
+  pointer allocate(size_type n, SwapAllocator<void>::pointer hint = nullptr) {
+    UNUSED(hint);
+    DCHECK_LE(n, max_size());
+    if (swap_space_ == nullptr) {
+      return reinterpret_cast<T*>(malloc(n * sizeof(T)));
+    } else {
+      return reinterpret_cast<T*>(swap_space_->Alloc(n * sizeof(T)));
+    }
+  }
+  void deallocate(pointer p, size_type n) {
+    if (swap_space_ == nullptr) {
+      free(p);
+    } else {
+      swap_space_->Free(p, n * sizeof(T));
+    }
+  }
+
+  void construct(pointer p, const_reference val) {
+    new (static_cast<void*>(p)) value_type(val);
+  }
+  void destroy(pointer p) {
+    p->~value_type();
+  }
+
+ private:
+  SwapSpace* swap_space_;
+
+  template <typename U>
+  friend class SwapAllocator;
+
+  template <typename U>
+  friend bool operator==(const SwapAllocator<U>& lhs, const SwapAllocator<U>& rhs);
+};
+
+template <typename T>
+inline bool operator==(const SwapAllocator<T>& lhs, const SwapAllocator<T>& rhs) {
+  return lhs.swap_space_ == rhs.swap_space_;
+}
+
+template <typename T>
+inline bool operator!=(const SwapAllocator<T>& lhs, const SwapAllocator<T>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace art
+
+#endif  // ART_COMPILER_UTILS_SWAP_SPACE_H_
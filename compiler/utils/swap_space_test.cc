@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/swap_space.h"
+
+#include <unistd.h>
+#include <memory>
+
+#include "base/unix_file/fd_file.h"
+#include "common_runtime_test.h"
+#include "gtest/gtest.h"
+
+namespace art {
+
+class SwapSpaceTest : public CommonRuntimeTest {
+ protected:
+  static void SwapTest(SwapSpace* space) {
+    SwapAllocator<void> allocator(space);
+
+    // Fill a number of vectors, then release every other one so that their replacements can reuse
+    // the freed blocks, and check that no contents got overwritten.
+    std::vector<std::unique_ptr<SwapVector<uint8_t>>> vectors;
+    for (size_t i = 0; i != 64; ++i) {
+      vectors.emplace_back(new SwapVector<uint8_t>(1 * KB + i, static_cast<uint8_t>(i), allocator));
+    }
+    for (size_t i = 0; i != vectors.size(); i += 2) {
+      vectors[i].reset();
+    }
+    for (size_t i = 0; i != vectors.size(); i += 2) {
+      vectors[i].reset(new SwapVector<uint8_t>(allocator));
+      for (size_t j = 0; j != 2 * KB; ++j) {
+        vectors[i]->push_back(static_cast<uint8_t>(i + j));
+      }
+    }
+    for (size_t i = 0; i != vectors.size(); ++i) {
+      const SwapVector<uint8_t>& v = *vectors[i];
+      if ((i & 1) == 0) {
+        ASSERT_EQ(2 * KB, v.size());
+        for (size_t j = 0; j != v.size(); ++j) {
+          ASSERT_EQ(static_cast<uint8_t>(i + j), v[j]);
+        }
+      } else {
+        ASSERT_EQ(1 * KB + i, v.size());
+        for (size_t j = 0; j != v.size(); ++j) {
+          ASSERT_EQ(static_cast<uint8_t>(i), v[j]);
+        }
+      }
+    }
+  }
+};
+
+TEST_F(SwapSpaceTest, Memory) {
+  SwapTest(nullptr);
+}
+
+TEST_F(SwapSpaceTest, File) {
+  ScratchFile scratch;
+  int fd = dup(scratch.GetFd());
+  ASSERT_NE(-1, fd);
+  scratch.Unlink();
+  {
+    SwapSpace space(fd, 1 * MB);
+    EXPECT_LE(1 * MB, space.GetSize());
+    SwapTest(&space);
+    int64_t file_length = scratch.GetFile()->GetLength();
+    EXPECT_EQ(static_cast<int64_t>(space.GetSize()), file_length);
+  }
+  // The space drops its contents on destruction.
+  EXPECT_EQ(0, scratch.GetFile()->GetLength());
+}
+
+}  // namespace art
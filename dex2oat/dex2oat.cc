@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -47,8 +48,10 @@
 #include "dex/verification_results.h"
 #include "dex/quick_compiler_callbacks.h"
 #include "dex/quick/dex_file_to_method_inliner_map.h"
+#include "driver/compiled_method_cache.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
+#include "driver/reusable_oat_file.h"
 #include "elf_file.h"
 #include "elf_writer.h"
 #include "gc/space/image_space.h"
@@ -136,9 +139,17 @@ static void UsageError(const char* fmt, ...) {
   UsageError("  --image=<file.art>: specifies the output image filename.");
   UsageError("      Example: --image=/system/framework/boot.art");
   UsageError("");
+  UsageError("  --app-image-file=<file.art>: specifies an image of the resolved app classes to");
+  UsageError("      write next to the app oat file. The runtime maps it below the boot image.");
+  UsageError("      Example: --app-image-file=/data/dalvik-cache/arm/system@app@Calculator.apk.art");
+  UsageError("");
   UsageError("  --image-classes=<classname-file>: specifies classes to include in an image.");
   UsageError("      Example: --image=frameworks/base/preloaded-classes");
   UsageError("");
+  UsageError("  --image-hot-classes=<classname-file>: lays out the listed classes first in the");
+  UsageError("      image, in the listed order, so that the classes used most share pages.");
+  UsageError("      Example: --image-hot-classes=out/hot-classes");
+  UsageError("");
   UsageError("  --base=<hex-address>: specifies the base address when creating a boot image.");
   UsageError("      Example: --base=0x50000000");
   UsageError("");
@@ -225,6 +236,9 @@ static void UsageError(const char* fmt, ...) {
   UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
+  UsageError("  --dump-method-stats=<file.csv>: write the compile time, pass times, arena and code");
+  UsageError("      bytes, spill count and backend of every method compiled as CSV.");
+  UsageError("");
   UsageError("  --include-patch-information: Include patching information so the generated code");
   UsageError("      can have its base address moved without full recompilation.");
   UsageError("");
@@ -241,6 +255,22 @@ static void UsageError(const char* fmt, ...) {
   UsageError("");
   UsageError("  --profile-file=<filename>: specify profiler output file to use for compilation.");
   UsageError("");
+  UsageError("  --swap-file=<file-name>: keep the compiled code and its tables in a file-backed");
+  UsageError("      swap space rather than on the native heap to bound resident memory. The file");
+  UsageError("      is removed as soon as it has been created.");
+  UsageError("      Example: --swap-file=/data/tmp/swap.001");
+  UsageError("");
+  UsageError("  --swap-fd=<file-descriptor>: like --swap-file, but uses an already open file.");
+  UsageError("      Example: --swap-fd=10");
+  UsageError("");
+  UsageError("  --reuse-oat-file=<file.oat>: copy the compiled code of dex files that are unchanged");
+  UsageError("      since an earlier compilation of the same application from its oat file.");
+  UsageError("      The oat file must have been compiled with the same compiler options.");
+  UsageError("");
+  UsageError("  --compiled-method-cache=<directory>: look up compiled methods in a cache directory");
+  UsageError("      shared between compilations before compiling them, and store the ones compiled.");
+  UsageError("      Example: --compiled-method-cache=/tmp/dex2oat-cache");
+  UsageError("");
   UsageError("  --print-pass-names: print a list of pass names");
   UsageError("");
   UsageError("  --disable-passes=<pass-names>:  disable one or more passes separated by comma.");
@@ -415,9 +445,12 @@ class Dex2Oat FINAL {
       start_ns_(NanoTime()),
       oat_fd_(-1),
       zip_fd_(-1),
+      swap_fd_(-1),
+      class_loader_(nullptr),
       image_base_(0U),
       image_classes_zip_filename_(nullptr),
       image_classes_filename_(nullptr),
+      image_hot_classes_filename_(nullptr),
       compiled_classes_zip_filename_(nullptr),
       compiled_classes_filename_(nullptr),
       image_(false),
@@ -526,8 +559,12 @@ class Dex2Oat FINAL {
         bitcode_filename_ = option.substr(strlen("--bitcode=")).data();
       } else if (option.starts_with("--image=")) {
         image_filename_ = option.substr(strlen("--image=")).data();
+      } else if (option.starts_with("--app-image-file=")) {
+        app_image_filename_ = option.substr(strlen("--app-image-file=")).data();
       } else if (option.starts_with("--image-classes=")) {
         image_classes_filename_ = option.substr(strlen("--image-classes=")).data();
+      } else if (option.starts_with("--image-hot-classes=")) {
+        image_hot_classes_filename_ = option.substr(strlen("--image-hot-classes=")).data();
       } else if (option.starts_with("--image-classes-zip=")) {
         image_classes_zip_filename_ = option.substr(strlen("--image-classes-zip=")).data();
       } else if (option.starts_with("--compiled-classes=")) {
@@ -647,6 +684,8 @@ class Dex2Oat FINAL {
         dump_timing_ = true;
       } else if (option == "--dump-passes") {
         dump_passes_ = true;
+      } else if (option.starts_with("--dump-method-stats=")) {
+        method_stats_filename_ = option.substr(strlen("--dump-method-stats=")).data();
       } else if (option == "--dump-stats") {
         dump_stats_ = true;
       } else if (option == "--include-debug-symbols" || option == "--no-strip-symbols") {
@@ -657,6 +696,20 @@ class Dex2Oat FINAL {
       } else if (option.starts_with("--profile-file=")) {
         profile_file_ = option.substr(strlen("--profile-file=")).data();
         VLOG(compiler) << "dex2oat: profile file is " << profile_file_;
+      } else if (option.starts_with("--swap-file=")) {
+        swap_file_name_ = option.substr(strlen("--swap-file=")).data();
+      } else if (option.starts_with("--swap-fd=")) {
+        const char* swap_fd_str = option.substr(strlen("--swap-fd=")).data();
+        if (!ParseInt(swap_fd_str, &swap_fd_)) {
+          Usage("Failed to parse --swap-fd argument '%s' as an integer", swap_fd_str);
+        }
+        if (swap_fd_ < 0) {
+          Usage("--swap-fd passed a negative value %d", swap_fd_);
+        }
+      } else if (option.starts_with("--reuse-oat-file=")) {
+        reuse_oat_filename_ = option.substr(strlen("--reuse-oat-file=")).data();
+      } else if (option.starts_with("--compiled-method-cache=")) {
+        compiled_method_cache_dir_ = option.substr(strlen("--compiled-method-cache=")).data();
       } else if (option == "--no-profile-file") {
         // No profile
       } else if (option.starts_with("--top-k-profile-threshold=")) {
@@ -728,6 +781,10 @@ class Dex2Oat FINAL {
       Usage("--oat-fd should not be used with --image");
     }
 
+    if (!swap_file_name_.empty() && swap_fd_ != -1) {
+      Usage("--swap-file should not be used with --swap-fd");
+    }
+
     if (android_root_.empty()) {
       const char* android_root_env_var = getenv("ANDROID_ROOT");
       if (android_root_env_var == nullptr) {
@@ -746,6 +803,10 @@ class Dex2Oat FINAL {
       boot_image_option_ += boot_image_filename;
     }
 
+    if (image_ && !app_image_filename_.empty()) {
+      Usage("--app-image-file should not be used with --image");
+    }
+
     if (image_classes_filename_ != nullptr && !image_) {
       Usage("--image-classes should only be used with --image");
     }
@@ -754,6 +815,10 @@ class Dex2Oat FINAL {
       Usage("--image-classes should not be used with --boot-image");
     }
 
+    if (image_hot_classes_filename_ != nullptr && !image_) {
+      Usage("--image-hot-classes should only be used with --image");
+    }
+
     if (image_classes_zip_filename_ != nullptr && image_classes_filename_ == nullptr) {
       Usage("--image-classes-zip should be used with --image-classes");
     }
@@ -959,6 +1024,16 @@ class Dex2Oat FINAL {
       oat_file_->Erase();
       return false;
     }
+    if (!swap_file_name_.empty()) {
+      swap_fd_ = open(swap_file_name_.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+      if (swap_fd_ == -1) {
+        PLOG(ERROR) << "Failed to create swap file: " << swap_file_name_;
+        EraseOatFile();
+        return false;
+      }
+      // Only the descriptor is used from here on, don't leave the file behind.
+      unlink(swap_file_name_.c_str());
+    }
     return true;
   }
 
@@ -1027,6 +1102,10 @@ class Dex2Oat FINAL {
     } else if (image_) {
       image_classes_.reset(new std::set<std::string>);
     }
+    if (image_hot_classes_filename_ != nullptr &&
+        !ReadHotClassesFromFile(image_hot_classes_filename_, &image_hot_classes_)) {
+      return false;
+    }
     // If --compiled-classes was specified, calculate the full list of classes to compile in the
     // image.
     if (compiled_classes_filename_ != nullptr) {
@@ -1146,6 +1225,7 @@ class Dex2Oat FINAL {
       class_loader = soa.Env()->NewGlobalRef(class_loader_local.get());
       Runtime::Current()->SetCompileTimeClassPath(class_loader, class_path_files);
     }
+    class_loader_ = class_loader;
 
     driver_.reset(new CompilerDriver(compiler_options_.get(),
                                      verification_results_.get(),
@@ -1160,11 +1240,49 @@ class Dex2Oat FINAL {
                                      dump_stats_,
                                      dump_passes_,
                                      compiler_phases_timings_.get(),
-                                     profile_file_));
+                                     profile_file_,
+                                     swap_fd_));
 
     driver_->GetCompiler()->SetBitcodeFileName(*driver_, bitcode_filename_);
 
+    if (!reuse_oat_filename_.empty()) {
+      TimingLogger::ScopedTiming t2("dex2oat Open reusable oat file", timings_);
+      std::string error_msg;
+      ReusableOatFile* reusable_oat_file =
+          ReusableOatFile::Open(reuse_oat_filename_, *driver_, &error_msg);
+      if (reusable_oat_file == nullptr) {
+        LOG(WARNING) << "Not reusing compiled code from " << reuse_oat_filename_ << ": "
+                     << error_msg;
+      } else {
+        driver_->SetReusableOatFile(reusable_oat_file);
+      }
+    }
+
+    if (!compiled_method_cache_dir_.empty()) {
+      std::string error_msg;
+      CompiledMethodCache* compiled_method_cache = CompiledMethodCache::Create(
+          compiled_method_cache_dir_, *driver_, &error_msg);
+      if (compiled_method_cache == nullptr) {
+        LOG(WARNING) << "Not using compiled method cache " << compiled_method_cache_dir_ << ": "
+                     << error_msg;
+      } else {
+        driver_->SetCompiledMethodCache(compiled_method_cache);
+      }
+    }
+
+    if (!method_stats_filename_.empty()) {
+      driver_->EnableMethodStats();
+    }
+
     driver_->CompileAll(class_loader, dex_files_, timings_);
+
+    if (!method_stats_filename_.empty()) {
+      std::ofstream method_stats_output(method_stats_filename_);
+      driver_->DumpMethodStats(method_stats_output);
+      if (method_stats_output.fail()) {
+        LOG(ERROR) << "Failed to write the method statistics to " << method_stats_filename_;
+      }
+    }
   }
 
   // Notes on the interleaving of creating the image and oat file to
@@ -1376,6 +1494,27 @@ class Dex2Oat FINAL {
     return true;
   }
 
+  // Write the app image of the classes resolved during compilation. Failing to write it is not an
+  // error, the runtime then loads the classes from the oat file.
+  void HandleAppImage() LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    if (app_image_filename_.empty()) {
+      return;
+    }
+    TimingLogger::ScopedTiming t("dex2oat AppImage", timings_);
+    if (class_loader_ == nullptr || Runtime::Current()->GetHeap()->GetImageSpace() == nullptr) {
+      LOG(WARNING) << "Not writing app image " << app_image_filename_ << " without a boot image";
+      return;
+    }
+    ImageWriter app_image_writer(*driver_, class_loader_, dex_files_);
+    if (!app_image_writer.PrepareImageAddressSpace() ||
+        !app_image_writer.WriteAppImage(app_image_filename_, oat_file_.get(), oat_location_)) {
+      LOG(WARNING) << "Failed to create app image " << app_image_filename_;
+      unlink(app_image_filename_.c_str());
+      return;
+    }
+    VLOG(compiler) << "App image written successfully: " << app_image_filename_;
+  }
+
   bool FlushOatFile() {
     if (oat_file_.get() != nullptr) {
       TimingLogger::ScopedTiming t2("dex2oat Flush ELF", timings_);
@@ -1404,6 +1543,11 @@ class Dex2Oat FINAL {
   void DumpTiming() {
     if (dump_timing_ || (dump_slow_timing_ && timings_->GetTotalNs() > MsToNs(1000))) {
       LOG(INFO) << Dumpable<TimingLogger>(*timings_);
+      if (driver_.get() != nullptr) {
+        std::ostringstream oss;
+        driver_->DumpCompileTailLatency(oss);
+        LOG(INFO) << oss.str();
+      }
     }
     if (dump_passes_) {
       LOG(INFO) << Dumpable<CumulativeLogger>(*driver_->GetTimingsLogger());
@@ -1498,6 +1642,7 @@ class Dex2Oat FINAL {
 
   void PrepareImageWriter(uintptr_t image_base) {
     image_writer_.reset(new ImageWriter(*driver_, image_base, compiler_options_->GetCompilePic()));
+    image_writer_->SetHotClasses(image_hot_classes_);
   }
 
   // Let the ImageWriter write the image file. If we do not compile PIC, also fix up the oat file.
@@ -1563,6 +1708,30 @@ class Dex2Oat FINAL {
     return image_classes.release();
   }
 
+  // Reads the class names (java.lang.Object) into a list of descriptors (Ljava/lang/Object;),
+  // keeping the order of the file.
+  static bool ReadHotClassesFromFile(const char* hot_classes_filename,
+                                     std::vector<std::string>* hot_classes) {
+    std::ifstream hot_classes_file(hot_classes_filename, std::ifstream::in);
+    if (!hot_classes_file.good()) {
+      LOG(ERROR) << "Failed to open hot classes file " << hot_classes_filename;
+      return false;
+    }
+    std::set<std::string> seen;
+    while (hot_classes_file.good()) {
+      std::string dot;
+      std::getline(hot_classes_file, dot);
+      if (StartsWith(dot, "#") || dot.empty()) {
+        continue;
+      }
+      std::string descriptor(DotToDescriptor(dot.c_str()));
+      if (seen.insert(descriptor).second) {
+        hot_classes->push_back(descriptor);
+      }
+    }
+    return true;
+  }
+
   // Reads the class names (java.lang.Object) and returns a set of descriptors (Ljava/lang/Object;)
   static std::set<std::string>* ReadImageClassesFromZip(const char* zip_filename,
                                                         const char* image_classes_filename,
@@ -1626,17 +1795,24 @@ class Dex2Oat FINAL {
   std::vector<const char*> dex_filenames_;
   std::vector<const char*> dex_locations_;
   int zip_fd_;
+  // The CompilerDriver takes ownership of the swap file descriptor.
+  std::string swap_file_name_;
+  int swap_fd_;
   std::string zip_location_;
   std::string boot_image_option_;
   std::vector<const char*> runtime_args_;
   std::string image_filename_;
+  std::string app_image_filename_;
+  jobject class_loader_;
   uintptr_t image_base_;
   const char* image_classes_zip_filename_;
   const char* image_classes_filename_;
+  const char* image_hot_classes_filename_;
   const char* compiled_classes_zip_filename_;
   const char* compiled_classes_filename_;
   std::unique_ptr<std::set<std::string>> image_classes_;
   std::unique_ptr<std::set<std::string>> compiled_classes_;
+  std::vector<std::string> image_hot_classes_;
   bool image_;
   std::unique_ptr<ImageWriter> image_writer_;
   bool is_host_;
@@ -1649,6 +1825,9 @@ class Dex2Oat FINAL {
   bool dump_timing_;
   bool dump_slow_timing_;
   std::string profile_file_;  // Profile file to use
+  std::string reuse_oat_filename_;
+  std::string compiled_method_cache_dir_;
+  std::string method_stats_filename_;
   TimingLogger* timings_;
   std::unique_ptr<CumulativeLogger> compiler_phases_timings_;
   std::unique_ptr<std::ostream> init_failure_output_;
@@ -1738,6 +1917,9 @@ static int CompileApp(Dex2Oat& dex2oat) {
     return EXIT_FAILURE;
   }
 
+  // The app image carries the checksum of the oat file, so it is written once that is final.
+  dex2oat.HandleAppImage();
+
   // When given --host, finish early without stripping.
   if (dex2oat.IsHost()) {
     if (!dex2oat.FlushCloseOatFile()) {
@@ -1771,7 +1953,7 @@ static int CompileApp(Dex2Oat& dex2oat) {
 static int dex2oat(int argc, char** argv) {
   b13564922();
 
-  TimingLogger timings("compiler", false, false);
+  TimingLogger timings("compiler", false, false, true);
 
   Dex2Oat dex2oat(&timings);
 
@@ -1287,6 +1287,11 @@ class ImageDumper {
     os << "IMAGE BITMAP OFFSET: " << reinterpret_cast<void*>(image_header_.GetImageBitmapOffset())
        << " SIZE: " << reinterpret_cast<void*>(image_header_.GetImageBitmapSize()) << "\n\n";
 
+    os << "RELOCATION BITMAP OFFSET: "
+       << reinterpret_cast<void*>(image_header_.GetRelocationBitmapOffset())
+       << " SIZE: " << reinterpret_cast<void*>(image_header_.GetRelocationBitmapSize())
+       << "\n\n";
+
     os << "OAT CHECKSUM: " << StringPrintf("0x%08x\n\n", image_header_.GetOatChecksum());
 
     os << "OAT FILE BEGIN:" << reinterpret_cast<void*>(image_header_.GetOatFileBegin()) << "\n\n";
@@ -1386,7 +1391,7 @@ class ImageDumper {
       {
         self->TransitionFromRunnableToSuspended(kNative);
         ThreadList* thread_list = Runtime::Current()->GetThreadList();
-        thread_list->SuspendAll();
+        thread_list->SuspendAll("oatdump");
         heap->RevokeAllThreadLocalAllocationStacks(self);
         thread_list->ResumeAll();
         self->TransitionFromSuspendedToRunnable();
@@ -1424,6 +1429,7 @@ class ImageDumper {
     stats_.alignment_bytes += alignment_bytes;
     stats_.alignment_bytes += image_header_.GetImageBitmapOffset() - image_header_.GetImageSize();
     stats_.bitmap_bytes += image_header_.GetImageBitmapSize();
+    stats_.bitmap_bytes += image_header_.GetRelocationBitmapSize();
     stats_.Dump(os);
     os << "\n";
 
@@ -21,6 +21,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -48,6 +49,44 @@
 
 namespace art {
 
+// Ranges smaller than this are not worth a thread of their own.
+static constexpr size_t kMinParallelRangeSize = 16 * KB;
+
+// Calls fn(begin, end) for disjoint ranges covering [0, size), each on its own thread, up to
+// thread_count of them. Plain threads are enough as only memory is touched, and the oat file is
+// patched without a runtime.
+template <typename Fn>
+static void ForEachRangeInParallel(size_t size, size_t thread_count, const Fn& fn) {
+  struct Range {
+    const Fn* fn;
+    size_t begin;
+    size_t end;
+    pthread_t thread;
+
+    static void* Run(void* arg) {
+      Range* range = reinterpret_cast<Range*>(arg);
+      (*range->fn)(range->begin, range->end);
+      return nullptr;
+    }
+  };
+  const size_t num_ranges =
+      std::max<size_t>(std::min(thread_count, size / kMinParallelRangeSize), 1u);
+  std::vector<Range> ranges(num_ranges);
+  for (size_t i = 0; i != num_ranges; ++i) {
+    ranges[i].fn = &fn;
+    ranges[i].begin = size * i / num_ranges;
+    ranges[i].end = size * (i + 1) / num_ranges;
+  }
+  for (size_t i = 1; i < num_ranges; ++i) {
+    CHECK_PTHREAD_CALL(pthread_create, (&ranges[i].thread, nullptr, &Range::Run, &ranges[i]),
+                       "patchoat worker");
+  }
+  Range::Run(&ranges[0]);
+  for (size_t i = 1; i < num_ranges; ++i) {
+    CHECK_PTHREAD_CALL(pthread_join, (ranges[i].thread, nullptr), "patchoat worker");
+  }
+}
+
 static InstructionSet ElfISAToInstructionSet(Elf32_Word isa) {
   switch (isa) {
     case EM_ARM:
@@ -109,7 +148,7 @@ static bool LocationToFilename(const std::string& location, InstructionSet isa,
 
 bool PatchOat::Patch(const std::string& image_location, off_t delta,
                      File* output_image, InstructionSet isa,
-                     TimingLogger* timings) {
+                     TimingLogger* timings, size_t thread_count) {
   CHECK(Runtime::Current() == nullptr);
   CHECK(output_image != nullptr);
   CHECK_GE(output_image->Fd(), 0);
@@ -176,7 +215,7 @@ bool PatchOat::Patch(const std::string& image_location, off_t delta,
   gc::space::ImageSpace* ispc = Runtime::Current()->GetHeap()->GetImageSpace();
 
   PatchOat p(isa, image.release(), ispc->GetLiveBitmap(), ispc->GetMemMap(),
-             delta, timings);
+             delta, timings, thread_count);
   t.NewTiming("Patching files");
   if (!p.PatchImage()) {
     LOG(ERROR) << "Failed to patch image file " << input_image->GetPath();
@@ -192,7 +231,7 @@ bool PatchOat::Patch(const std::string& image_location, off_t delta,
 
 bool PatchOat::Patch(File* input_oat, const std::string& image_location, off_t delta,
                      File* output_oat, File* output_image, InstructionSet isa,
-                     TimingLogger* timings,
+                     TimingLogger* timings, size_t thread_count,
                      bool output_oat_opened_from_fd,
                      bool new_oat_out) {
   CHECK(Runtime::Current() == nullptr);
@@ -298,7 +337,7 @@ bool PatchOat::Patch(File* input_oat, const std::string& image_location, off_t d
   }
 
   PatchOat p(isa, elf.release(), image.release(), ispc->GetLiveBitmap(), ispc->GetMemMap(),
-             delta, timings);
+             delta, timings, thread_count);
   t.NewTiming("Patching files");
   if (!skip_patching_oat && !p.PatchElf()) {
     LOG(ERROR) << "Failed to patch oat file " << input_oat->GetPath();
@@ -439,6 +478,16 @@ bool PatchOat::PatchImage() {
   mirror::Object* img_roots = image_header->GetImageRoots();
   image_header->RelocateImage(delta_);
 
+  if (image_header->GetRelocationBitmapSize() != 0u) {
+    if (!image_header->IsValid()) {
+      LOG(ERROR) << "reloction renders image header invalid";
+      return false;
+    }
+    // The image records which words to patch, there is no need to look at the objects.
+    TimingLogger::ScopedTiming t("Apply Relocation Bitmap", timings_);
+    return ApplyRelocationBitmap(*image_header);
+  }
+
   VisitObject(img_roots);
   if (!image_header->IsValid()) {
     LOG(ERROR) << "reloction renders image header invalid";
@@ -454,6 +503,27 @@ bool PatchOat::PatchImage() {
   return true;
 }
 
+bool PatchOat::ApplyRelocationBitmap(const ImageHeader& image_header) {
+  if (!image_header.IsRelocationBitmapValid(image_->Size())) {
+    LOG(ERROR) << "Relocation bitmap at " << image_header.GetRelocationBitmapOffset() << " of "
+               << image_header.GetRelocationBitmapSize() << " bytes does not match the image";
+    return false;
+  }
+  const uint32_t* bitmap = reinterpret_cast<const uint32_t*>(
+      image_->Begin() + image_header.GetRelocationBitmapOffset());
+  uint8_t* image = image_->Begin();
+  const size_t image_size = image_header.GetImageSize();
+  // Addresses in the image are 32-bit, wrapping around is what subtracting a negative delta does.
+  const uint32_t delta = static_cast<uint32_t>(delta_);
+  // Each bitmap word covers its own 32 words of the image, so the ranges never overlap.
+  ForEachRangeInParallel(image_header.GetRelocationBitmapSize() / sizeof(uint32_t), thread_count_,
+                         [bitmap, image, image_size, delta](size_t begin, size_t end) {
+    CHECK(ImageHeader::ApplyRelocationBitmap(bitmap, begin, end, image, image_size, delta))
+        << "Relocation outside of the image";
+  });
+  return true;
+}
+
 bool PatchOat::InHeap(mirror::Object* o) {
   uintptr_t begin = reinterpret_cast<uintptr_t>(heap_->Begin());
   uintptr_t end = reinterpret_cast<uintptr_t>(heap_->End());
@@ -568,7 +638,7 @@ void PatchOat::FixupMethod(mirror::ArtMethod* object, mirror::ArtMethod* copy) {
 }
 
 bool PatchOat::Patch(File* input_oat, off_t delta, File* output_oat, TimingLogger* timings,
-                     bool output_oat_opened_from_fd, bool new_oat_out) {
+                     size_t thread_count, bool output_oat_opened_from_fd, bool new_oat_out) {
   CHECK(input_oat != nullptr);
   CHECK(output_oat != nullptr);
   CHECK_GE(input_oat->Fd(), 0);
@@ -598,7 +668,7 @@ bool PatchOat::Patch(File* input_oat, off_t delta, File* output_oat, TimingLogge
     CHECK(is_oat_pic == NOT_PIC);
   }
 
-  PatchOat p(elf.release(), delta, timings);
+  PatchOat p(elf.release(), delta, timings, thread_count);
   t.NewTiming("Patch Oat file");
   if (!p.PatchElf()) {
     return false;
@@ -753,12 +823,18 @@ bool PatchOat::PatchTextSection(ElfFileImpl* oat_file) {
   uint8_t* to_patch = oat_file->Begin() + oat_text_sec->sh_offset;
   uintptr_t to_patch_end = reinterpret_cast<uintptr_t>(to_patch) + oat_text_sec->sh_size;
 
-  for (; patches < patches_end; patches++) {
-    CHECK_LT(*patches, oat_text_sec->sh_size) << "Bad Patch";
-    uint32_t* patch_loc = reinterpret_cast<uint32_t*>(to_patch + *patches);
-    CHECK_LT(reinterpret_cast<uintptr_t>(patch_loc), to_patch_end);
-    *patch_loc += delta_;
-  }
+  // Every patch is at a location of its own, so the list can be split up.
+  const off_t delta = delta_;
+  const auto text_size = oat_text_sec->sh_size;
+  ForEachRangeInParallel(patches_end - patches, thread_count_,
+                         [=](size_t begin, size_t end) {
+    for (size_t i = begin; i != end; ++i) {
+      CHECK_LT(patches[i], text_size) << "Bad Patch";
+      uint32_t* patch_loc = reinterpret_cast<uint32_t*>(to_patch + patches[i]);
+      CHECK_LT(reinterpret_cast<uintptr_t>(patch_loc), to_patch_end);
+      *patch_loc += delta;
+    }
+  });
   return true;
 }
 
@@ -844,6 +920,10 @@ static void UsageError(const char* fmt, ...) {
   UsageError("");
   UsageError("  --no-lock-output: Do not attempt to obtain a flock on output oat file.");
   UsageError("");
+  UsageError("  -j<number-of-threads>: specifies the number of threads used for patching.");
+  UsageError("      Example: -j4");
+  UsageError("      Default: the number of CPUs");
+  UsageError("");
   UsageError("  --dump-timings: dump out patch timing information");
   UsageError("");
   UsageError("  --no-dump-timings: do not dump out patch timing information");
@@ -956,6 +1036,7 @@ static int patchoat(int argc, char **argv) {
   std::string patched_image_location;
   bool dump_timings = kIsDebugBuild;
   bool lock_output = true;
+  size_t thread_count = sysconf(_SC_NPROCESSORS_CONF);
 
   for (int i = 0; i < argc; ++i) {
     const StringPiece option(argv[i]);
@@ -1059,6 +1140,11 @@ static int patchoat(int argc, char **argv) {
       lock_output = true;
     } else if (option == "--no-lock-output") {
       lock_output = false;
+    } else if (option.starts_with("-j")) {
+      const char* thread_count_str = option.substr(strlen("-j")).data();
+      if (!ParseUint(thread_count_str, &thread_count) || thread_count == 0u) {
+        Usage("Failed to parse -j argument '%s' as a positive integer", thread_count_str);
+      }
     } else if (option == "--dump-timings") {
       dump_timings = true;
     } else if (option == "--no-dump-timings") {
@@ -1286,7 +1372,7 @@ static int patchoat(int argc, char **argv) {
   if (have_image_files && have_oat_files) {
     TimingLogger::ScopedTiming pt("patch image and oat", &timings);
     ret = PatchOat::Patch(input_oat.get(), input_image_location, base_delta,
-                          output_oat.get(), output_image.get(), isa, &timings,
+                          output_oat.get(), output_image.get(), isa, &timings, thread_count,
                           output_oat_fd >= 0,  // was it opened from FD?
                           new_oat_out);
     // The order here doesn't matter. If the first one is successfully saved and the second one
@@ -1295,13 +1381,14 @@ static int patchoat(int argc, char **argv) {
     ret = ret && FinishFile(output_oat.get(), ret);
   } else if (have_oat_files) {
     TimingLogger::ScopedTiming pt("patch oat", &timings);
-    ret = PatchOat::Patch(input_oat.get(), base_delta, output_oat.get(), &timings,
+    ret = PatchOat::Patch(input_oat.get(), base_delta, output_oat.get(), &timings, thread_count,
                           output_oat_fd >= 0,  // was it opened from FD?
                           new_oat_out);
     ret = ret && FinishFile(output_oat.get(), ret);
   } else if (have_image_files) {
     TimingLogger::ScopedTiming pt("patch image", &timings);
-    ret = PatchOat::Patch(input_image_location, base_delta, output_image.get(), isa, &timings);
+    ret = PatchOat::Patch(input_image_location, base_delta, output_image.get(), isa, &timings,
+                          thread_count);
     ret = ret && FinishFile(output_image.get(), ret);
   } else {
     CHECK(false);
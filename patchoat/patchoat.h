@@ -41,36 +41,39 @@ class ArtMethod;
 
 class PatchOat {
  public:
+  // The patching is split over up to thread_count threads.
+
   // Patch only the oat file
   static bool Patch(File* oat_in, off_t delta, File* oat_out, TimingLogger* timings,
+                    size_t thread_count,
                     bool output_oat_opened_from_fd,  // Was this using --oatput-oat-fd ?
                     bool new_oat_out);               // Output oat was a new file created by us?
 
   // Patch only the image (art file)
   static bool Patch(const std::string& art_location, off_t delta, File* art_out, InstructionSet isa,
-                    TimingLogger* timings);
+                    TimingLogger* timings, size_t thread_count);
 
   // Patch both the image and the oat file
   static bool Patch(File* oat_in, const std::string& art_location,
                     off_t delta, File* oat_out, File* art_out, InstructionSet isa,
-                    TimingLogger* timings,
+                    TimingLogger* timings, size_t thread_count,
                     bool output_oat_opened_from_fd,  // Was this using --oatput-oat-fd ?
                     bool new_oat_out);               // Output oat was a new file created by us?
 
  private:
   // Takes ownership only of the ElfFile. All other pointers are only borrowed.
-  PatchOat(ElfFile* oat_file, off_t delta, TimingLogger* timings)
+  PatchOat(ElfFile* oat_file, off_t delta, TimingLogger* timings, size_t thread_count)
       : oat_file_(oat_file), image_(nullptr), bitmap_(nullptr), heap_(nullptr), delta_(delta),
-        isa_(kNone), timings_(timings) {}
+        isa_(kNone), timings_(timings), thread_count_(thread_count) {}
   PatchOat(InstructionSet isa, MemMap* image, gc::accounting::ContinuousSpaceBitmap* bitmap,
-           MemMap* heap, off_t delta, TimingLogger* timings)
+           MemMap* heap, off_t delta, TimingLogger* timings, size_t thread_count)
       : image_(image), bitmap_(bitmap), heap_(heap),
-        delta_(delta), isa_(isa), timings_(timings) {}
+        delta_(delta), isa_(isa), timings_(timings), thread_count_(thread_count) {}
   PatchOat(InstructionSet isa, ElfFile* oat_file, MemMap* image,
            gc::accounting::ContinuousSpaceBitmap* bitmap, MemMap* heap, off_t delta,
-           TimingLogger* timings)
+           TimingLogger* timings, size_t thread_count)
       : oat_file_(oat_file), image_(image), bitmap_(bitmap), heap_(heap),
-        delta_(delta), isa_(isa), timings_(timings) {}
+        delta_(delta), isa_(isa), timings_(timings), thread_count_(thread_count) {}
   ~PatchOat() {}
 
   // Was the .art image at image_path made with --compile-pic ?
@@ -117,6 +120,8 @@ class PatchOat {
   bool PatchOatHeader(ElfFileImpl* oat_file);
 
   bool PatchImage() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Adds delta_ to the words of the image marked in its relocation bitmap.
+  bool ApplyRelocationBitmap(const ImageHeader& image_header);
 
   bool WriteElf(File* out);
   bool WriteImage(File* out);
@@ -162,6 +167,9 @@ class PatchOat {
 
   TimingLogger* timings_;
 
+  // Maximum number of threads to patch with.
+  const size_t thread_count_;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(PatchOat);
 };
 
@@ -34,6 +34,7 @@ LIBART_COMMON_SRC_FILES := \
   base/unix_file/random_access_file_utils.cc \
   check_jni.cc \
   class_linker.cc \
+  class_preloader.cc \
   common_throws.cc \
   debugger.cc \
   dex_file.cc \
@@ -86,6 +87,7 @@ LIBART_COMMON_SRC_FILES := \
   jni_env_ext.cc \
   jni_internal.cc \
   jobject_comparator.cc \
+  lookup_cache.cc \
   mem_map.cc \
   memory_region.cc \
   mirror/art_field.cc \
@@ -99,6 +101,7 @@ LIBART_COMMON_SRC_FILES := \
   mirror/string.cc \
   mirror/throwable.cc \
   monitor.cc \
+  monitor_contention_profiler.cc \
   native_bridge_art_interface.cc \
   native/dalvik_system_DexFile.cc \
   native/dalvik_system_VMDebug.cc \
@@ -137,6 +140,7 @@ LIBART_COMMON_SRC_FILES := \
   reference_table.cc \
   reflection.cc \
   runtime.cc \
+  safepoint_log.cc \
   signal_catcher.cc \
   stack.cc \
   thread.cc \
@@ -145,6 +149,7 @@ LIBART_COMMON_SRC_FILES := \
   throw_location.cc \
   trace.cc \
   transaction.cc \
+  type_lookup_table.cc \
   profiler.cc \
   fault_handler.cc \
   utf.cc \
@@ -155,6 +160,7 @@ LIBART_COMMON_SRC_FILES := \
   verifier/reg_type.cc \
   verifier/reg_type_cache.cc \
   verifier/register_line.cc \
+  verifier/verifier_deps.cc \
   well_known_classes.cc \
   zip_archive.cc
 
@@ -691,9 +691,12 @@ static void TestUnlockObject(StubTest* test) NO_THREAD_SAFETY_ANALYSIS {
 
   test->Invoke3(reinterpret_cast<size_t>(obj.Get()), 0U, 0U, art_quick_unlock_object, self);
 
+  // A fully unlocked lock stays biased towards us.
+  const LockWord::LockState released_state = Runtime::Current()->UseBiasedLocking()
+      ? LockWord::LockState::kBiased : LockWord::LockState::kUnlocked;
   LockWord lock_after3 = obj->GetLockWord(false);
   LockWord::LockState new_state3 = lock_after3.GetState();
-  EXPECT_EQ(LockWord::LockState::kUnlocked, new_state3);
+  EXPECT_EQ(released_state, new_state3);
 
   // Stress test:
   // Keep a number of objects and their locks in flight. Randomly lock or unlock one of them in
@@ -767,7 +770,7 @@ static void TestUnlockObject(StubTest* test) NO_THREAD_SAFETY_ANALYSIS {
           EXPECT_EQ(LockWord::LockState::kThinLocked, iter_state);
           EXPECT_EQ(counts[index] - 1, lock_iter.ThinLockCount());
         } else {
-          EXPECT_EQ(LockWord::LockState::kUnlocked, iter_state);
+          EXPECT_EQ(released_state, iter_state);
         }
       }
     }
@@ -786,7 +789,7 @@ static void TestUnlockObject(StubTest* test) NO_THREAD_SAFETY_ANALYSIS {
 
     LockWord lock_after4 = objects[index]->GetLockWord(false);
     LockWord::LockState new_state4 = lock_after4.GetState();
-    EXPECT_TRUE(LockWord::LockState::kUnlocked == new_state4
+    EXPECT_TRUE(released_state == new_state4
                 || LockWord::LockState::kFatLocked == new_state4);
   }
 
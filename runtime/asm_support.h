@@ -18,6 +18,7 @@
 #define ART_RUNTIME_ASM_SUPPORT_H_
 
 #if defined(__cplusplus)
+#include "lock_word.h"
 #include "mirror/art_method.h"
 #include "mirror/class.h"
 #include "mirror/string.h"
@@ -82,6 +83,11 @@ ADD_TEST_EQ(THREAD_FLAGS_OFFSET,
 ADD_TEST_EQ(THREAD_ID_OFFSET,
             art::Thread::ThinLockIdOffset<__SIZEOF_POINTER__>().Int32Value())
 
+// Offset of field Thread::tls32_.thin_lock_acquire_word.
+#define THREAD_LOCK_ACQUIRE_WORD_OFFSET 44
+ADD_TEST_EQ(THREAD_LOCK_ACQUIRE_WORD_OFFSET,
+            art::Thread::ThinLockAcquireWordOffset<__SIZEOF_POINTER__>().Int32Value())
+
 // Offset of field Thread::tlsPtr_.card_table.
 #define THREAD_CARD_TABLE_OFFSET 120
 ADD_TEST_EQ(THREAD_CARD_TABLE_OFFSET,
@@ -108,6 +114,11 @@ ADD_TEST_EQ(MIRROR_OBJECT_CLASS_OFFSET, art::mirror::Object::ClassOffset().Int32
 #define MIRROR_OBJECT_LOCK_WORD_OFFSET 4
 ADD_TEST_EQ(MIRROR_OBJECT_LOCK_WORD_OFFSET, art::mirror::Object::MonitorOffset().Int32Value())
 
+// Bias bit of a thin lock word, it changes when the lock count of a thin lock word overflows.
+#define LOCK_WORD_THIN_LOCK_BIAS_MASK_SHIFTED 0x20000000
+ADD_TEST_EQ(LOCK_WORD_THIN_LOCK_BIAS_MASK_SHIFTED,
+            static_cast<int32_t>(art::LockWord::kThinLockBiasMaskShifted))
+
 #if defined(USE_BAKER_OR_BROOKS_READ_BARRIER)
 #define MIRROR_OBJECT_HEADER_SIZE 16
 #else
@@ -119,9 +119,62 @@ inline void BaseMutex::RegisterAsUnlocked(Thread* self) {
   }
 }
 
+#if ART_USE_FUTEXES
+inline AtomicInteger* ReaderWriterMutex::GetReaderSlot(const Thread* self) const {
+  if (reader_slots_ == nullptr || self == NULL) {
+    return nullptr;
+  }
+  uint32_t slot = self->GetThreadId();
+  if (slot == 0 || slot >= kNumReaderSlots) {
+    return nullptr;
+  }
+  return reinterpret_cast<AtomicInteger*>(reader_slots_ + slot * kReaderSlotSize);
+}
+
+inline bool ReaderWriterMutex::BiasedSharedLock(Thread* self) {
+  AtomicInteger* reader_slot = GetReaderSlot(self);
+  if (reader_slot == nullptr || reader_bias_.LoadRelaxed() == 0) {
+    return false;
+  }
+  DCHECK_EQ(reader_slot->LoadRelaxed(), 0);
+  uint32_t slot = self->GetThreadId();
+  if (UNLIKELY(slot > static_cast<uint32_t>(max_reader_slot_.LoadRelaxed()))) {
+    RaiseMaxReaderSlot(slot);
+  }
+  // Mark the slot, then check the bias wasn't revoked in the meantime. A writer revokes the bias
+  // before checking the slots, so either it sees our mark or we see the revocation.
+  reader_slot->StoreSequentiallyConsistent(1);
+  if (LIKELY(reader_bias_.LoadSequentiallyConsistent() != 0)) {
+    return true;
+  }
+  // Back off, waking the writer that may be waiting for our slot.
+  reader_slot->StoreSequentiallyConsistent(0);
+  futex(reader_slot->Address(), FUTEX_WAKE, -1, NULL, NULL, 0);
+  return false;
+}
+
+inline bool ReaderWriterMutex::BiasedSharedUnlock(Thread* self) {
+  AtomicInteger* reader_slot = GetReaderSlot(self);
+  if (reader_slot == nullptr || reader_slot->LoadRelaxed() == 0) {
+    return false;
+  }
+  // Clear the slot with release ordering. If the bias is revoked a writer may be waiting for it.
+  reader_slot->StoreSequentiallyConsistent(0);
+  if (UNLIKELY(reader_bias_.LoadSequentiallyConsistent() == 0)) {
+    futex(reader_slot->Address(), FUTEX_WAKE, -1, NULL, NULL, 0);
+  }
+  return true;
+}
+#endif
+
 inline void ReaderWriterMutex::SharedLock(Thread* self) {
   DCHECK(self == NULL || self == Thread::Current());
 #if ART_USE_FUTEXES
+  if (BiasedSharedLock(self)) {
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_.LoadRelaxed();
@@ -132,6 +185,9 @@ inline void ReaderWriterMutex::SharedLock(Thread* self) {
       HandleSharedLockContention(self, cur_state);
     }
   } while (!done);
+  if (UNLIKELY(reader_slots_ != nullptr && reader_bias_.LoadRelaxed() == 0)) {
+    RestoreReaderBias();
+  }
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_rdlock, (&rwlock_));
 #endif
@@ -146,6 +202,9 @@ inline void ReaderWriterMutex::SharedUnlock(Thread* self) {
   AssertSharedHeld(self);
   RegisterAsUnlocked(self);
 #if ART_USE_FUTEXES
+  if (BiasedSharedUnlock(self)) {
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_.LoadRelaxed();
@@ -489,13 +489,29 @@ std::ostream& operator<<(std::ostream& os, const Mutex& mu) {
   return os;
 }
 
-ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level)
+#if ART_USE_FUTEXES
+constexpr uint32_t ReaderWriterMutex::kNumReaderSlots;
+constexpr size_t ReaderWriterMutex::kReaderSlotSize;
+#endif
+
+ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level, bool reader_biased)
     : BaseMutex(name, level)
 #if ART_USE_FUTEXES
-    , state_(0), num_pending_readers_(0), num_pending_writers_(0)
+    , state_(0), num_pending_readers_(0), num_pending_writers_(0),
+    reader_slot_storage_(nullptr), reader_slots_(nullptr), reader_bias_(0), max_reader_slot_(0)
 #endif
 {  // NOLINT(whitespace/braces)
-#if !ART_USE_FUTEXES
+#if ART_USE_FUTEXES
+  if (reader_biased) {
+    static_assert(sizeof(AtomicInteger) <= kReaderSlotSize, "Reader slots too small");
+    // Over-allocate so that the slots can be aligned to cache lines.
+    size_t slots_size = kNumReaderSlots * kReaderSlotSize;
+    reader_slot_storage_ = new uint8_t[slots_size + kReaderSlotSize]();
+    reader_slots_ = AlignUp(reader_slot_storage_, kReaderSlotSize);
+    reader_bias_.StoreRelaxed(1);
+  }
+#else
+  UNUSED(reader_biased);
   CHECK_MUTEX_CALL(pthread_rwlock_init, (&rwlock_, nullptr));
 #endif
   exclusive_owner_ = 0;
@@ -507,6 +523,7 @@ ReaderWriterMutex::~ReaderWriterMutex() {
   CHECK_EQ(exclusive_owner_, 0U);
   CHECK_EQ(num_pending_readers_.LoadRelaxed(), 0);
   CHECK_EQ(num_pending_writers_.LoadRelaxed(), 0);
+  delete[] reader_slot_storage_;
 #else
   // We can't use CHECK_MUTEX_CALL here because on shutdown a suspended daemon thread
   // may still be using locks.
@@ -547,6 +564,10 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
     }
   } while (!done);
   DCHECK_EQ(state_.LoadRelaxed(), -1);
+  if (reader_slots_ != nullptr) {
+    bool revoked = RevokeReaderBias(nullptr);
+    DCHECK(revoked);
+  }
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_wrlock, (&rwlock_));
 #endif
@@ -626,6 +647,14 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
       --num_pending_writers_;
     }
   } while (!done);
+  if (reader_slots_ != nullptr && !RevokeReaderBias(&end_abs_ts)) {
+    // Give the state back so that readers blocked on it can run.
+    state_.StoreSequentiallyConsistent(0);
+    if (num_pending_readers_.LoadRelaxed() > 0 || num_pending_writers_.LoadRelaxed() > 0) {
+      futex(state_.Address(), FUTEX_WAKE, -1, NULL, NULL, 0);
+    }
+    return false;  // Timed out.
+  }
 #else
   timespec ts;
   InitTimeSpec(true, CLOCK_REALTIME, ms, ns, &ts);
@@ -646,6 +675,51 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
 #endif
 
 #if ART_USE_FUTEXES
+void ReaderWriterMutex::RaiseMaxReaderSlot(uint32_t slot) {
+  int32_t max_slot = max_reader_slot_.LoadRelaxed();
+  while (static_cast<int32_t>(slot) > max_slot &&
+         !max_reader_slot_.CompareExchangeWeakSequentiallyConsistent(max_slot, slot)) {
+    max_slot = max_reader_slot_.LoadRelaxed();
+  }
+}
+
+void ReaderWriterMutex::RestoreReaderBias() {
+  // Holding a share keeps writers out, so a writer can't be between revoking the bias and
+  // checking the slots.
+  reader_bias_.StoreSequentiallyConsistent(1);
+}
+
+bool ReaderWriterMutex::RevokeReaderBias(const timespec* end_abs_ts) {
+  DCHECK_EQ(state_.LoadRelaxed(), -1);
+  reader_bias_.StoreSequentiallyConsistent(0);
+  int32_t max_slot = max_reader_slot_.LoadSequentiallyConsistent();
+  for (int32_t slot = 1; slot <= max_slot; ++slot) {
+    AtomicInteger* reader_slot =
+        reinterpret_cast<AtomicInteger*>(reader_slots_ + slot * kReaderSlotSize);
+    int32_t cur_value;
+    while ((cur_value = reader_slot->LoadSequentiallyConsistent()) != 0) {
+      // The reader wakes us when it clears the slot as it sees the bias revoked.
+      timespec rel_ts;
+      if (end_abs_ts != nullptr) {
+        timespec now_abs_ts;
+        InitTimeSpec(true, CLOCK_REALTIME, 0, 0, &now_abs_ts);
+        if (ComputeRelativeTimeSpec(&rel_ts, *end_abs_ts, now_abs_ts)) {
+          return false;
+        }
+      }
+      if (futex(reader_slot->Address(), FUTEX_WAIT, cur_value,
+                end_abs_ts != nullptr ? &rel_ts : NULL, NULL, 0) != 0) {
+        if (errno == ETIMEDOUT) {
+          return false;
+        } else if ((errno != EAGAIN) && (errno != EINTR)) {
+          PLOG(FATAL) << "futex wait failed for reader slot " << slot << " of " << name_;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 void ReaderWriterMutex::HandleSharedLockContention(Thread* self, int32_t cur_state) {
   // Owner holds it exclusively, hang up.
   ScopedContentionRecorder scr(this, GetExclusiveOwnerTid(), SafeGetTid(self));
@@ -707,6 +781,7 @@ void ReaderWriterMutex::Dump(std::ostream& os) const {
       << " state=" << state_.LoadSequentiallyConsistent()
       << " num_pending_writers=" << num_pending_writers_.LoadSequentiallyConsistent()
       << " num_pending_readers=" << num_pending_readers_.LoadSequentiallyConsistent()
+      << " reader_bias=" << reader_bias_.LoadSequentiallyConsistent()
 #endif
       << " ";
   DumpContention(os);
@@ -937,7 +1012,8 @@ void Locks::Init() {
 
     UPDATE_CURRENT_LOCK_LEVEL(kMutatorLock);
     DCHECK(mutator_lock_ == nullptr);
-    mutator_lock_ = new ReaderWriterMutex("mutator lock", current_lock_level);
+    // Every thread state transition takes or releases a share of the mutator lock.
+    mutator_lock_ = new ReaderWriterMutex("mutator lock", current_lock_level, true);
 
     UPDATE_CURRENT_LOCK_LEVEL(kHeapBitmapLock);
     DCHECK(heap_bitmap_lock_ == nullptr);
@@ -76,6 +76,7 @@ enum LockLevel {
   kTransactionLogLock,
   kInternTableLock,
   kOatFileSecondaryLookupLock,
+  kSwapSpaceLock,
   kDefaultMutexLevel,
   kMarkSweepLargeObjectLock,
   kPinTableLock,
@@ -279,10 +280,17 @@ class LOCKABLE Mutex : public BaseMutex {
 // Exclusive | Block         | Free            | Block            | error
 // Shared(n) | Block         | error           | SharedLock(n+1)* | Shared(n-1) or Free
 // * for large values of n the SharedLock may block.
+//
+// A reader biased ReaderWriterMutex lets attached threads with small thread ids take a share by
+// marking a slot of their own rather than by updating the shared state, so that readers on
+// different cores don't contend for one cache line. ExclusiveLock revokes the bias and waits for
+// the marked slots to clear, making it slower. The bias is restored by the next reader to take
+// the slow path.
 std::ostream& operator<<(std::ostream& os, const ReaderWriterMutex& mu);
 class LOCKABLE ReaderWriterMutex : public BaseMutex {
  public:
-  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel);
+  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel,
+                             bool reader_biased = false);
   ~ReaderWriterMutex();
 
   virtual bool IsReaderWriterMutex() const { return true; }
@@ -360,9 +368,33 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
 
  private:
 #if ART_USE_FUTEXES
+  // Threads with ids below this have a reader slot in reader biased mutexes.
+  static constexpr uint32_t kNumReaderSlots = 512;
+  // Each slot has its own cache line.
+  static constexpr size_t kReaderSlotSize = 64;
+
   // Out-of-inline path for handling contention for a SharedLock.
   void HandleSharedLockContention(Thread* self, int32_t cur_state);
 
+  // The reader slot of self, or nullptr if it doesn't have one.
+  AtomicInteger* GetReaderSlot(const Thread* self) const ALWAYS_INLINE;
+
+  // Try to take a share by marking the reader slot of self, fails if the bias is revoked.
+  bool BiasedSharedLock(Thread* self) ALWAYS_INLINE;
+
+  // Release a share taken by BiasedSharedLock, returns false if self doesn't hold one.
+  bool BiasedSharedUnlock(Thread* self) ALWAYS_INLINE;
+
+  // Note a reader slot above max_reader_slot_ is in use.
+  void RaiseMaxReaderSlot(uint32_t slot);
+
+  // Restore the bias after it was revoked, called holding a share.
+  void RestoreReaderBias();
+
+  // Revoke the bias, called holding the state exclusively, and wait for the biased readers to
+  // release their shares. Returns false if the absolute timeout is reached first.
+  bool RevokeReaderBias(const timespec* end_abs_ts);
+
   // -1 implies held exclusive, +ve shared held by state_ many owners.
   AtomicInteger state_;
   // Exclusive owner. Modification guarded by this mutex.
@@ -371,6 +403,13 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
   AtomicInteger num_pending_readers_;
   // Number of contenders waiting to be the writer.
   AtomicInteger num_pending_writers_;
+  // Reader slots, each 1 if the thread with the slot's id holds a share, null if not biased.
+  uint8_t* reader_slot_storage_;
+  uint8_t* reader_slots_;
+  // Non-zero if readers may take a share using their slot.
+  AtomicInteger reader_bias_;
+  // The highest reader slot ever used, bounding the slots ExclusiveLock checks.
+  AtomicInteger max_reader_slot_;
 #else
   pthread_rwlock_t rwlock_;
   volatile uint64_t exclusive_owner_;  // Guarded by rwlock_.
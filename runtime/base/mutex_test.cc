@@ -171,4 +171,67 @@ TEST_F(MutexTest, SharedTryLockUnlock) {
   SharedTryLockUnlockTest();
 }
 
+// GCC has trouble with our mutex tests, so we have to turn off thread safety analysis.
+static void ReaderBiasedLockUnlockTest() NO_THREAD_SAFETY_ANALYSIS {
+  ReaderWriterMutex mu("test rwmutex", kDefaultMutexLevel, true);
+  mu.SharedLock(Thread::Current());
+  mu.AssertSharedHeld(Thread::Current());
+  mu.SharedUnlock(Thread::Current());
+  mu.AssertNotHeld(Thread::Current());
+  // Revoke the bias.
+  mu.ExclusiveLock(Thread::Current());
+  mu.AssertExclusiveHeld(Thread::Current());
+  mu.ExclusiveUnlock(Thread::Current());
+  // Take a share the slow way, restoring the bias, then the biased way.
+  for (size_t i = 0; i != 2; ++i) {
+    mu.SharedLock(Thread::Current());
+    mu.AssertSharedHeld(Thread::Current());
+    mu.AssertNotExclusiveHeld(Thread::Current());
+    mu.SharedUnlock(Thread::Current());
+    mu.AssertNotHeld(Thread::Current());
+  }
+}
+
+TEST_F(MutexTest, ReaderBiasedLockUnlock) {
+  ReaderBiasedLockUnlockTest();
+}
+
+struct ReaderBiasedExclusiveLock {
+  ReaderBiasedExclusiveLock() : mu("test rwmutex", kDefaultMutexLevel, true), acquired(0) {
+  }
+
+  static void* Callback(void* arg) NO_THREAD_SAFETY_ANALYSIS {
+    ReaderBiasedExclusiveLock* state = reinterpret_cast<ReaderBiasedExclusiveLock*>(arg);
+    state->mu.ExclusiveLock(Thread::Current());
+    state->acquired.StoreSequentiallyConsistent(1);
+    state->mu.ExclusiveUnlock(Thread::Current());
+    return NULL;
+  }
+
+  ReaderWriterMutex mu;
+  AtomicInteger acquired;
+};
+
+// GCC has trouble with our mutex tests, so we have to turn off thread safety analysis.
+static void ReaderBiasedExclusiveLockTest() NO_THREAD_SAFETY_ANALYSIS {
+  ReaderBiasedExclusiveLock state;
+  state.mu.SharedLock(Thread::Current());
+
+  pthread_t pthread;
+  int pthread_create_result =
+      pthread_create(&pthread, NULL, ReaderBiasedExclusiveLock::Callback, &state);
+  ASSERT_EQ(0, pthread_create_result);
+
+  // The writer must wait for our biased share.
+  usleep(10000);
+  EXPECT_EQ(0, state.acquired.LoadSequentiallyConsistent());
+  state.mu.SharedUnlock(Thread::Current());
+  EXPECT_EQ(pthread_join(pthread, NULL), 0);
+  EXPECT_EQ(1, state.acquired.LoadSequentiallyConsistent());
+}
+
+TEST_F(MutexTest, ReaderBiasedExclusiveLock) {
+  ReaderBiasedExclusiveLockTest();
+}
+
 }  // namespace art
@@ -22,6 +22,7 @@
 #include "timing_logger.h"
 
 #include "base/logging.h"
+#include "base/stringprintf.h"
 #include "thread-inl.h"
 #include "base/stl_util.h"
 #include "base/histogram-inl.h"
@@ -127,8 +128,8 @@ void CumulativeLogger::DumpHistogram(std::ostream &os) const {
   os << "Done Dumping histograms \n";
 }
 
-TimingLogger::TimingLogger(const char* name, bool precise, bool verbose)
-    : name_(name), precise_(precise), verbose_(verbose) {
+TimingLogger::TimingLogger(const char* name, bool precise, bool verbose, bool record_cpu_time)
+    : name_(name), precise_(precise), verbose_(verbose), record_cpu_time_(record_cpu_time) {
 }
 
 void TimingLogger::Reset() {
@@ -137,12 +138,12 @@ void TimingLogger::Reset() {
 
 void TimingLogger::StartTiming(const char* label) {
   DCHECK(label != nullptr);
-  timings_.push_back(Timing(NanoTime(), label));
+  timings_.push_back(Timing(NanoTime(), record_cpu_time_ ? ProcessCpuNanoTime() : 0u, label));
   ATRACE_BEGIN(label);
 }
 
 void TimingLogger::EndTiming() {
-  timings_.push_back(Timing(NanoTime(), nullptr));
+  timings_.push_back(Timing(NanoTime(), record_cpu_time_ ? ProcessCpuNanoTime() : 0u, nullptr));
   ATRACE_END();
 }
 
@@ -175,6 +176,8 @@ TimingLogger::TimingData TimingLogger::CalculateTimingData() const {
       ret.data_[open_idx].exclusive_time += time;
       DCHECK_EQ(ret.data_[open_idx].total_time, 0U);
       ret.data_[open_idx].total_time += time;
+      ret.data_[open_idx].total_cpu_time =
+          timings_[i].GetCpuTime() - timings_[open_idx].GetCpuTime();
       // Each open split has exactly one end.
       open_stack.pop_back();
       // If there is a parent node, subtract from the exclusive time.
@@ -223,7 +226,15 @@ void TimingLogger::Dump(std::ostream &os, const char* indent_string) const {
       if (exclusive_time != total_time) {
         os << "/" << FormatDuration(total_time, tu, kFractionalDigits);
       }
-      os << " " << timings_[i].GetName() << "\n";
+      os << " " << timings_[i].GetName();
+      if (record_cpu_time_ && total_time != 0u) {
+        uint64_t total_cpu_time = timing_data.GetTotalCpuTime(i);
+        os << " (cpu " << FormatDuration(total_cpu_time, tu, kFractionalDigits) << ", "
+           << StringPrintf("%.2f",
+                           static_cast<double>(total_cpu_time) / timing_data.GetTotalTime(i))
+           << " cores busy)";
+      }
+      os << "\n";
       ++tab_count;
     } else {
       --tab_count;
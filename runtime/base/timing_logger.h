@@ -81,7 +81,8 @@ class TimingLogger {
 
   class Timing {
    public:
-    Timing(uint64_t time, const char* name) : time_(time), name_(name) {
+    Timing(uint64_t time, uint64_t cpu_time, const char* name)
+        : time_(time), cpu_time_(cpu_time), name_(name) {
     }
     bool IsStartTiming() const {
       return !IsEndTiming();
@@ -92,12 +93,17 @@ class TimingLogger {
     uint64_t GetTime() const {
       return time_;
     }
+    // Process CPU time, only recorded if the logger was asked to.
+    uint64_t GetCpuTime() const {
+      return cpu_time_;
+    }
     const char* GetName() const {
       return name_;
     }
 
    private:
     uint64_t time_;
+    uint64_t cpu_time_;
     const char* name_;
   };
 
@@ -118,20 +124,28 @@ class TimingLogger {
     uint64_t GetExclusiveTime(size_t idx) {
       return data_[idx].exclusive_time;
     }
+    uint64_t GetTotalCpuTime(size_t idx) {
+      return data_[idx].total_cpu_time;
+    }
 
    private:
     // Each begin split has a total time and exclusive time. Exclusive time is total time - total
     // time of children nodes.
     struct CalculatedDataPoint {
-      CalculatedDataPoint() : total_time(0), exclusive_time(0) {}
+      CalculatedDataPoint() : total_time(0), exclusive_time(0), total_cpu_time(0) {}
       uint64_t total_time;
       uint64_t exclusive_time;
+      // CPU time used by the whole process during the split.
+      uint64_t total_cpu_time;
     };
     std::vector<CalculatedDataPoint> data_;
     friend class TimingLogger;
   };
 
-  explicit TimingLogger(const char* name, bool precise, bool verbose);
+  // If record_cpu_time is set, the process CPU time is recorded along with each timing and the dump
+  // shows how many cores were busy on average during each split.
+  explicit TimingLogger(const char* name, bool precise, bool verbose,
+                        bool record_cpu_time = false);
   ~TimingLogger();
   // Verify that all open timings have related closed timings.
   void Verify();
@@ -187,6 +201,8 @@ class TimingLogger {
   const bool precise_;
   // Verbose logging.
   const bool verbose_;
+  // Record the process CPU time with each timing.
+  const bool record_cpu_time_;
   // Timing points that are either start or end points. For each starting point ret[i] = location
   // of end split associated with i. If it is and end split ret[i] = i.
   std::vector<Timing> timings_;
@@ -158,4 +158,24 @@ TEST_F(TimingLoggerTest, ScopedAndExplicit) {
   EXPECT_LE(timings[idx_innerinnersplit1].GetTime(), timings[idx_innerinnersplit2].GetTime());
 }
 
+TEST_F(TimingLoggerTest, CpuTime) {
+  const char* split1name = "First Split";
+  TimingLogger logger("CpuTime", true, false, true);
+  logger.StartTiming(split1name);
+  // Burn some CPU time.
+  volatile uint64_t sum = 0;
+  for (uint64_t i = 0; i != 10000000; ++i) {
+    sum += i;
+  }
+  logger.EndTiming();
+  const auto& timings = logger.GetTimings();
+  EXPECT_EQ(2U, timings.size());
+  EXPECT_LT(timings[0].GetCpuTime(), timings[1].GetCpuTime());
+  TimingLogger::TimingData timing_data(logger.CalculateTimingData());
+  EXPECT_EQ(timings[1].GetCpuTime() - timings[0].GetCpuTime(), timing_data.GetTotalCpuTime(0));
+  std::ostringstream oss;
+  logger.Dump(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("cores busy"));
+}
+
 }  // namespace art
@@ -30,6 +30,7 @@
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker-inl.h"
+#include "class_preloader.h"
 #include "compiler_callbacks.h"
 #include "debugger.h"
 #include "dex_file-inl.h"
@@ -42,7 +43,9 @@
 #include "handle_scope.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "java_vm_ext.h"
 #include "leb128.h"
+#include "lookup_cache.h"
 #include "oat.h"
 #include "oat_file.h"
 #include "object_lock.h"
@@ -68,6 +71,7 @@
 #include "thread-inl.h"
 #include "utils.h"
 #include "verifier/method_verifier.h"
+#include "verifier/verifier_deps.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -230,6 +234,8 @@ ClassLinker::ClassLinker(InternTable* intern_table)
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
       dex_cache_image_class_lookup_required_(false),
       failed_dex_cache_class_lookups_(0),
+      class_preloader_started_(false),
+      class_preloader_running_(false),
       class_roots_(nullptr),
       array_iftable_(nullptr),
       find_array_class_cache_next_victim_(0),
@@ -728,6 +734,12 @@ OatFile& ClassLinker::GetImageOatFile(gc::space::ImageSpace* space) {
 }
 
 const OatFile::OatDexFile* ClassLinker::FindOpenedOatDexFileForDexFile(const DexFile& dex_file) {
+  // Dex files opened from an oat file remember where they came from. This is the common case for
+  // FindOatClass, which runs for every loaded class, so avoid the locked search by location.
+  const OatFile::OatDexFile* oat_dex_file = dex_file.GetOatDexFile();
+  if (oat_dex_file != nullptr) {
+    return oat_dex_file;
+  }
   const char* dex_location = dex_file.GetLocation().c_str();
   uint32_t dex_location_checksum = dex_file.GetLocationChecksum();
   return FindOpenedOatDexFile(nullptr, dex_location, &dex_location_checksum);
@@ -2058,6 +2070,185 @@ ClassPathEntry FindInClassPath(const char* descriptor,
   return ClassPathEntry(nullptr, nullptr);
 }
 
+bool ClassLinker::MaybeLoadAppImage(Thread* self, Handle<mirror::ClassLoader> class_loader,
+                                    const std::vector<const DexFile*>& dex_files,
+                                    const DexFile& dex_file) {
+  Runtime* const runtime = Runtime::Current();
+  const OatFile::OatDexFile* oat_dex_file = dex_file.GetOatDexFile();
+  if (runtime->IsCompiler() || oat_dex_file == nullptr ||
+      runtime->GetHeap()->GetImageSpace() == nullptr) {
+    return false;
+  }
+  const OatFile* oat_file = oat_dex_file->GetOatFile();
+  {
+    // Most lookups come after the oat file was looked at, they only need the reader lock.
+    ReaderMutexLock mu(self, dex_lock_);
+    if (app_image_oat_files_.find(oat_file) != app_image_oat_files_.end()) {
+      return false;
+    }
+  }
+  {
+    WriterMutexLock mu(self, dex_lock_);
+    if (!app_image_oat_files_.insert(oat_file).second) {
+      return false;
+    }
+  }
+  const std::string image_location =
+      ImageHeader::GetAppImageLocationFromOatLocation(oat_file->GetLocation());
+  if (!OS::FileExists(image_location.c_str())) {
+    return false;
+  }
+  std::string error_msg;
+  std::unique_ptr<gc::space::ImageSpace> space(
+      gc::space::ImageSpace::CreateAppImage(image_location.c_str(), *oat_file, &error_msg));
+  if (space.get() == nullptr) {
+    LOG(WARNING) << "Failed to load app image " << image_location << ": " << error_msg;
+    return false;
+  }
+
+  // Check that the image can be used before the heap gets it, the space can't be removed from the
+  // heap again. The image objects are not in the heap yet, so there must be no GC while they are
+  // looked at.
+  mirror::ObjectArray<mirror::DexCache>* image_dex_caches;
+  mirror::ObjectArray<mirror::Class>* image_classes;
+  std::vector<const DexFile*> image_dex_files;
+  std::vector<std::string> descriptors;
+  std::vector<size_t> hashes;
+  {
+    ScopedAssertNoThreadSuspension ants(self, "Validating app image");
+    const ImageHeader& image_header = space->GetImageHeader();
+    image_dex_caches =
+        image_header.GetImageRoot(ImageHeader::kDexCaches)->AsObjectArray<mirror::DexCache>();
+    image_classes =
+        image_header.GetImageRoot(ImageHeader::kClassRoots)->AsObjectArray<mirror::Class>();
+    // Pair the dex caches of the image with the dex files they were written for.
+    for (int32_t i = 0; i < image_dex_caches->GetLength(); ++i) {
+      const std::string location = image_dex_caches->Get(i)->GetLocation()->ToModifiedUtf8();
+      const DexFile* image_dex_file = nullptr;
+      for (const DexFile* candidate : dex_files) {
+        if (candidate->GetLocation() == location && candidate->GetOatDexFile() != nullptr &&
+            candidate->GetOatDexFile()->GetOatFile() == oat_file) {
+          image_dex_file = candidate;
+          break;
+        }
+      }
+      if (image_dex_file == nullptr || IsDexFileRegistered(*image_dex_file)) {
+        LOG(WARNING) << "Not using app image " << image_location << ", " << location
+                     << " is not an unregistered dex file of " << oat_file->GetLocation();
+        return false;
+      }
+      image_dex_files.push_back(image_dex_file);
+    }
+    // The dex caches have no dex files yet, take the descriptors from the paired dex files.
+    for (int32_t i = 0; i < image_classes->GetLength(); ++i) {
+      mirror::Class* klass = image_classes->Get(i);
+      const DexFile* class_dex_file = nullptr;
+      for (int32_t j = 0; j < image_dex_caches->GetLength(); ++j) {
+        if (image_dex_caches->Get(j) == klass->GetDexCache()) {
+          class_dex_file = image_dex_files[j];
+          break;
+        }
+      }
+      if (class_dex_file == nullptr) {
+        LOG(WARNING) << "Not using app image " << image_location << ", a class of it has no dex "
+                     << "cache in it";
+        return false;
+      }
+      descriptors.push_back(class_dex_file->StringByTypeIdx(klass->GetDexTypeIndex()));
+      hashes.push_back(ComputeModifiedUtf8Hash(descriptors.back().c_str()));
+      if (LookupClass(self, descriptors.back().c_str(), hashes.back(), class_loader.Get()) !=
+          nullptr) {
+        LOG(WARNING) << "Not using app image " << image_location << ", "
+                     << descriptors.back() << " is already loaded";
+        return false;
+      }
+    }
+  }
+
+  {
+    ScopedThreadStateChange tsc(self, kNative);
+    runtime->GetHeap()->AddAppImageSpace(space.release());
+  }
+  // The image objects don't move, they can be held onto from here on like any other.
+  StackHandleScope<2> hs(self);
+  Handle<mirror::ObjectArray<mirror::DexCache>> dex_caches(hs.NewHandle(image_dex_caches));
+  Handle<mirror::ObjectArray<mirror::Class>> classes(hs.NewHandle(image_classes));
+  // The classes find their dex files through the dex caches.
+  for (size_t i = 0; i != image_dex_files.size(); ++i) {
+    dex_caches->Get(i)->SetDexFile(image_dex_files[i]);
+  }
+
+  // Link the methods to the code of the oat file, the image has no entry points.
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    StackHandleScope<2> hs2(self);
+    Handle<mirror::Class> klass(hs2.NewHandle(classes->Get(i)));
+    const OatFile::OatClass oat_class =
+        klass->GetDexFile().GetOatDexFile()->GetOatClass(klass->GetDexClassDefIndex());
+    MutableHandle<mirror::ArtMethod> method(hs2.NewHandle<mirror::ArtMethod>(nullptr));
+    for (size_t j = 0; j < klass->NumDirectMethods(); ++j) {
+      method.Assign(klass->GetDirectMethod(j));
+      LinkCode(method, &oat_class, j);
+    }
+    for (size_t j = 0; j < klass->NumVirtualMethods(); ++j) {
+      method.Assign(klass->GetVirtualMethod(j));
+      if (method->IsMiranda()) {
+        // Mirandas are copies of interface methods, with no code in the oat file.
+        LinkCode(method, nullptr, 0);
+      } else {
+        LinkCode(method, &oat_class, klass->NumDirectMethods() + j);
+      }
+    }
+    klass->SetClassLoader(class_loader.Get());
+  }
+
+  // Strings resolved by the compiler have to be the interned ones of this runtime.
+  InternTable* intern_table = runtime->GetInternTable();
+  for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
+    mirror::DexCache* dex_cache = dex_caches->Get(i);
+    for (size_t j = 0; j < dex_cache->NumStrings(); ++j) {
+      mirror::String* string = dex_cache->GetResolvedString(j);
+      if (string != nullptr) {
+        mirror::String* interned = intern_table->InternStrong(string);
+        if (interned != string) {
+          dex_cache->SetResolvedString(j, interned);
+        }
+      }
+    }
+  }
+
+  {
+    WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    WriterMutexLock mu2(self, dex_lock_);
+    // Another thread may have gone ahead while the methods were linked. The image stays mapped
+    // unused then, the heap can't give the space back.
+    for (const DexFile* image_dex_file : image_dex_files) {
+      if (IsDexFileRegisteredLocked(*image_dex_file)) {
+        return false;
+      }
+    }
+    for (int32_t i = 0; i < classes->GetLength(); ++i) {
+      if (LookupClassFromTableLocked(descriptors[i].c_str(), class_loader.Get(), hashes[i]) !=
+          nullptr) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i != image_dex_files.size(); ++i) {
+      StackHandleScope<1> hs2(self);
+      RegisterDexFileLocked(*image_dex_files[i], hs2.NewHandle(dex_caches->Get(i)));
+    }
+    for (int32_t i = 0; i < classes->GetLength(); ++i) {
+      mirror::Class* klass = classes->Get(i);
+      class_table_.InsertWithHash(GcRoot<mirror::Class>(klass), hashes[i]);
+      if (log_new_class_table_roots_) {
+        new_class_roots_.push_back(GcRoot<mirror::Class>(klass));
+      }
+    }
+  }
+  VLOG(class_linker) << "Loaded " << classes->GetLength() << " classes from app image "
+                     << image_location;
+  return true;
+}
+
 mirror::Class* ClassLinker::FindClassInPathClassLoader(ScopedObjectAccessAlreadyRunnable& soa,
                                                        Thread* self, const char* descriptor,
                                                        size_t hash,
@@ -2130,6 +2321,12 @@ mirror::Class* ClassLinker::FindClassInPathClassLoader(ScopedObjectAccessAlready
             for (const DexFile* cp_dex_file : *dex_files) {
               const DexFile::ClassDef* dex_class_def = cp_dex_file->FindClassDef(descriptor, hash);
               if (dex_class_def != nullptr) {
+                if (MaybeLoadAppImage(self, class_loader, *dex_files, *cp_dex_file)) {
+                  mirror::Class* klass = LookupClass(self, descriptor, hash, class_loader.Get());
+                  if (klass != nullptr) {
+                    return EnsureResolved(self, descriptor, klass);
+                  }
+                }
                 RegisterDexFile(*cp_dex_file);
                 mirror::Class* klass = DefineClass(self, descriptor, hash, class_loader,
                                                    *cp_dex_file, *dex_class_def);
@@ -2161,10 +2358,25 @@ mirror::Class* ClassLinker::FindClass(Thread* self, const char* descriptor,
     return FindPrimitiveClass(descriptor[0]);
   }
   const size_t hash = ComputeModifiedUtf8Hash(descriptor);
+  // Check the classes this thread found recently, they can't be unloaded. A class that became
+  // erroneous since takes the slow path to throw.
+  LookupCache* cache = self->GetClassLookupCache();
+  uint32_t cache_epoch = LookupCache::CurrentEpoch();
+  mirror::Object* cached = cache->Lookup(hash, class_loader.Get());
+  if (cached != nullptr) {
+    mirror::Class* cached_class = cached->AsClass();
+    if (cached_class->IsResolved() && cached_class->DescriptorEquals(descriptor)) {
+      return cached_class;
+    }
+  }
   // Find the class in the loaded classes table.
   mirror::Class* klass = LookupClass(self, descriptor, hash, class_loader.Get());
   if (klass != nullptr) {
-    return EnsureResolved(self, descriptor, klass);
+    klass = EnsureResolved(self, descriptor, klass);
+    if (klass != nullptr && klass->IsResolved()) {
+      cache->Add(hash, class_loader.Get(), klass, cache_epoch);
+    }
+    return klass;
   }
   // Class is not yet loaded.
   if (descriptor[0] == '[') {
@@ -2208,6 +2420,12 @@ mirror::Class* ClassLinker::FindClass(Thread* self, const char* descriptor,
     }
     pair = FindInClassPath(descriptor, hash, *class_path);
     if (pair.second != nullptr) {
+      if (MaybeLoadAppImage(self, class_loader, *class_path, *pair.first)) {
+        klass = LookupClass(self, descriptor, hash, class_loader.Get());
+        if (klass != nullptr) {
+          return EnsureResolved(self, descriptor, klass);
+        }
+      }
       return DefineClass(self, descriptor, hash, class_loader, *pair.first, *pair.second);
     } else {
       // Use the pre-allocated NCDFE at compile time to avoid wasting time constructing exceptions.
@@ -2255,10 +2473,52 @@ mirror::Class* ClassLinker::FindClass(Thread* self, const char* descriptor,
   UNREACHABLE();
 }
 
+void ClassLinker::MaybeStartClassPreloader(Thread* self, Handle<mirror::ClassLoader> class_loader,
+                                           const DexFile& dex_file) {
+  if (LIKELY(class_preloader_started_.LoadRelaxed())) {
+    // The workers are past their last class once the list is finished, so this thread can't be
+    // one of them.
+    if (UNLIKELY(class_preloader_running_.LoadSequentiallyConsistent()) &&
+        class_preloader_->IsFinished() &&
+        class_preloader_running_.CompareExchangeStrongSequentiallyConsistent(true, false)) {
+      ScopedThreadStateChange tsc(self, kNative);
+      class_preloader_->DeleteThreadPool();
+    }
+    return;
+  }
+  Runtime* const runtime = Runtime::Current();
+  const size_t num_threads = runtime->GetAppClassPreloadThreads();
+  if (num_threads == 0 || runtime->IsCompiler() || runtime->IsZygote() ||
+      !class_preloader_started_.CompareExchangeStrongSequentiallyConsistent(false, true)) {
+    return;
+  }
+  jobject global_class_loader = runtime->GetJavaVM()->AddGlobalRef(self, class_loader.Get());
+  // Reading the list and attaching the workers may take a while, don't block GC meanwhile.
+  ScopedThreadStateChange tsc(self, kNative);
+  std::vector<std::string> descriptors;
+  std::string error_msg;
+  if (!ClassPreloader::ReadClassList(dex_file.GetBaseLocation(), &descriptors, &error_msg)) {
+    VLOG(class_linker) << "Not preloading classes: " << error_msg;
+    runtime->GetJavaVM()->DeleteGlobalRef(self, global_class_loader);
+    return;
+  }
+  class_preloader_.reset(new ClassPreloader(global_class_loader, std::move(descriptors),
+                                            num_threads));
+  class_preloader_->Start(self);
+  class_preloader_running_.StoreSequentiallyConsistent(true);
+}
+
+void ClassLinker::StopClassPreloader() {
+  class_preloader_.reset();
+}
+
 mirror::Class* ClassLinker::DefineClass(Thread* self, const char* descriptor, size_t hash,
                                         Handle<mirror::ClassLoader> class_loader,
                                         const DexFile& dex_file,
                                         const DexFile::ClassDef& dex_class_def) {
+  if (class_loader.Get() != nullptr) {
+    MaybeStartClassPreloader(self, class_loader, dex_file);
+  }
   StackHandleScope<3> hs(self);
   auto klass = hs.NewHandle<mirror::Class>(nullptr);
 
@@ -2920,6 +3180,28 @@ void ClassLinker::LoadField(const DexFile& /*dex_file*/, const ClassDataItemIter
   dst->SetAccessFlags(it.GetFieldAccessFlags());
 }
 
+uint32_t ClassLinker::GetNativeMethodAnnotationFlags(const DexFile& dex_file,
+                                                     const DexFile::ClassDef& class_def,
+                                                     uint32_t method_idx, uint32_t access_flags) {
+  DCHECK_NE(access_flags & kAccNative, 0u);
+  if (dex_file.IsMethodAnnotationPresent(class_def, method_idx,
+                                         "Ldalvik/annotation/optimization/CriticalNative;")) {
+    const char* shorty = dex_file.GetMethodShorty(dex_file.GetMethodId(method_idx));
+    if ((access_flags & kAccStatic) != 0 && (access_flags & kAccSynchronized) == 0 &&
+        strchr(shorty, 'L') == nullptr) {
+      return kAccCriticalNative;
+    }
+    LOG(WARNING) << "Ignoring @CriticalNative on " << PrettyMethod(method_idx, dex_file)
+                 << ", it must be static, unsynchronized and use only primitive types";
+    return 0u;
+  }
+  if (dex_file.IsMethodAnnotationPresent(class_def, method_idx,
+                                         "Ldalvik/annotation/optimization/FastNative;")) {
+    return kAccFastNative;
+  }
+  return 0u;
+}
+
 mirror::ArtMethod* ClassLinker::LoadMethod(Thread* self, const DexFile& dex_file,
                                            const ClassDataItemIterator& it,
                                            Handle<mirror::Class> klass) {
@@ -2978,6 +3260,10 @@ mirror::ArtMethod* ClassLinker::LoadMethod(Thread* self, const DexFile& dex_file
       }
     }
   }
+  if (UNLIKELY((access_flags & kAccNative) != 0)) {
+    access_flags |= GetNativeMethodAnnotationFlags(
+        dex_file, dex_file.GetClassDef(klass->GetDexClassDefIndex()), dex_method_idx, access_flags);
+  }
   dst->SetAccessFlags(access_flags);
 
   return dst;
@@ -3373,6 +3659,8 @@ mirror::Class* ClassLinker::UpdateClass(const char* descriptor, mirror::Class* k
 
 bool ClassLinker::RemoveClass(const char* descriptor, mirror::ClassLoader* class_loader) {
   WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  // The class may be cached by threads that found it.
+  LookupCache::InvalidateAll();
   auto pair = std::make_pair(descriptor, class_loader);
   auto it = class_table_.Find(pair);
   if (it != class_table_.end()) {
@@ -3620,7 +3908,15 @@ void ClassLinker::VerifyClass(Thread* self, Handle<mirror::Class> klass) {
   }
   verifier::MethodVerifier::FailureKind verifier_failure = verifier::MethodVerifier::kNoFailure;
   std::string error_msg;
-  if (!preverified) {
+  bool has_soft_failures = false;
+  if (!preverified &&
+      oat_file_class_status == mirror::Class::kStatusRetryVerificationAtRuntime &&
+      VerifyClassUsingVerifierDeps(self, dex_file, klass, &has_soft_failures)) {
+    if (has_soft_failures) {
+      verifier_failure = verifier::MethodVerifier::kSoftFailure;
+      error_msg = "compile time soft failures with unchanged class resolution";
+    }
+  } else if (!preverified) {
     verifier_failure = verifier::MethodVerifier::VerifyClass(self, klass.Get(),
                                                              Runtime::Current()->IsCompiler(),
                                                              &error_msg);
@@ -3755,6 +4051,32 @@ bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class
   UNREACHABLE();
 }
 
+bool ClassLinker::VerifyClassUsingVerifierDeps(Thread* self, const DexFile& dex_file,
+                                               Handle<mirror::Class> klass,
+                                               bool* has_soft_failures) {
+  if (Runtime::Current()->IsCompiler()) {
+    return false;
+  }
+  const OatFile::OatDexFile* oat_dex_file = FindOpenedOatDexFileForDexFile(dex_file);
+  if (oat_dex_file == nullptr || oat_dex_file->GetVerifierDepsData() == nullptr) {
+    return false;
+  }
+  verifier::VerifierDeps::ClassDeps deps;
+  if (!verifier::VerifierDeps::Decode(oat_dex_file->GetVerifierDepsData(),
+                                      klass->GetDexClassDefIndex(), &deps)) {
+    return false;
+  }
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> class_loader(hs.NewHandle(klass->GetClassLoader()));
+  if (!verifier::VerifierDeps::DependenciesHold(self, dex_file, class_loader, deps)) {
+    return false;
+  }
+  VLOG(class_linker) << "Skipping runtime verification of " << PrettyDescriptor(klass.Get())
+                     << ", its verifier dependencies are unchanged";
+  *has_soft_failures = deps.has_soft_failures;
+  return true;
+}
+
 void ClassLinker::ResolveClassExceptionHandlerTypes(const DexFile& dex_file,
                                                     Handle<mirror::Class> klass) {
   for (size_t i = 0; i < klass->NumDirectMethods(); i++) {
@@ -18,6 +18,7 @@
 #define ART_RUNTIME_CLASS_LINKER_H_
 
 #include <deque>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -48,6 +49,7 @@ namespace mirror {
   class StackTraceElement;
 }  // namespace mirror
 
+class ClassPreloader;
 template<class T> class Handle;
 class InternTable;
 template<class T> class ObjectLock;
@@ -144,6 +146,9 @@ class ClassLinker {
                              const DexFile& dex_file, const DexFile::ClassDef& dex_class_def)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Stops the application class preloader, if it was started, and waits for its workers to exit.
+  void StopClassPreloader() LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   // Finds a class by its descriptor, returning NULL if it isn't wasn't loaded
   // by the given 'class_loader'.
   mirror::Class* LookupClass(Thread* self, const char* descriptor, size_t hash,
@@ -340,6 +345,15 @@ class ClassLinker {
                                            InstructionSet instruction_set,
                                            std::string* error_msg);
 
+  // Returns kAccFastNative for a native method annotated with @FastNative, which keeps the thread
+  // Runnable while in the native code, and kAccCriticalNative for one annotated with
+  // @CriticalNative, which additionally isn't passed the JNIEnv* and jclass. Critical natives
+  // must be static, unsynchronized and take and return only primitives, otherwise the annotation
+  // is ignored. Shared with the compiler so that JNI stubs agree with the runtime.
+  static uint32_t GetNativeMethodAnnotationFlags(const DexFile& dex_file,
+                                                 const DexFile::ClassDef& class_def,
+                                                 uint32_t method_idx, uint32_t access_flags);
+
   // Allocate an instance of a java.lang.Object.
   mirror::Object* AllocObject(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -372,6 +386,12 @@ class ClassLinker {
   bool VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class* klass,
                                mirror::Class::Status& oat_file_class_status)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Checks whether the class resolution assumptions recorded by the compiler for a class that has
+  // to be verified again at runtime still hold, in which case the verifier would reach the same
+  // result as at compile time and does not need to run.
+  bool VerifyClassUsingVerifierDeps(Thread* self, const DexFile& dex_file,
+                                    Handle<mirror::Class> klass, bool* has_soft_failures)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void ResolveClassExceptionHandlerTypes(const DexFile& dex_file,
                                          Handle<mirror::Class> klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -601,6 +621,15 @@ class ClassLinker {
   void LinkCode(Handle<mirror::ArtMethod> method, const OatFile::OatClass* oat_class,
                 uint32_t class_def_method_index)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Loads the app image written next to the oat file of dex_file, if there is one and its oat file
+  // was not looked at before, and adds its classes to class_loader. The image must hold the dex
+  // caches of dex files from dex_files only, none of which is registered yet. Returns whether the
+  // classes were added.
+  bool MaybeLoadAppImage(Thread* self, Handle<mirror::ClassLoader> class_loader,
+                         const std::vector<const DexFile*>& dex_files, const DexFile& dex_file)
+      LOCKS_EXCLUDED(dex_lock_, Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void CreateReferenceInstanceOffsets(Handle<mirror::Class> klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -731,6 +760,12 @@ class ClassLinker {
   void SetClassRoot(ClassRoot class_root, mirror::Class* klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Starts preloading the classes listed in the apk of the first application class loader on a
+  // pool of worker threads. Later calls stop the workers once the whole list has been processed.
+  void MaybeStartClassPreloader(Thread* self, Handle<mirror::ClassLoader> class_loader,
+                                const DexFile& dex_file)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Return the quick generic JNI stub for testing.
   const void* GetRuntimeQuickGenericJniStub() const;
 
@@ -740,6 +775,8 @@ class ClassLinker {
   std::vector<size_t> new_dex_cache_roots_ GUARDED_BY(dex_lock_);
   std::vector<GcRoot<mirror::DexCache>> dex_caches_ GUARDED_BY(dex_lock_);
   std::vector<const OatFile*> oat_files_ GUARDED_BY(dex_lock_);
+  // The oat files MaybeLoadAppImage() looked for an app image of.
+  std::set<const OatFile*> app_image_oat_files_ GUARDED_BY(dex_lock_);
 
   class ClassDescriptorHashEquals {
    public:
@@ -785,6 +822,12 @@ class ClassLinker {
   // the classes into the class_table_ to avoid dex cache based searches.
   Atomic<uint32_t> failed_dex_cache_class_lookups_;
 
+  // Set once the first application class loader has been seen.
+  Atomic<bool> class_preloader_started_;
+  std::unique_ptr<ClassPreloader> class_preloader_;
+  // Set once class_preloader_ has been started and cleared once its workers have been stopped.
+  Atomic<bool> class_preloader_running_;
+
   // Well known mirror::Class roots.
   GcRoot<mirror::ObjectArray<mirror::Class>> class_roots_;
 
@@ -1157,4 +1157,49 @@ TEST_F(ClassLinkerTest, IsBootStrapClassLoaded) {
   EXPECT_FALSE(statics.Get()->IsBootStrapClassLoaded());
 }
 
+
+TEST_F(ClassLinkerTest, NativeMethodAnnotationFlags) {
+  ScopedObjectAccess soa(Thread::Current());
+
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("MyClassNatives"))));
+  Handle<mirror::Class> klass(
+      hs.NewHandle(class_linker_->FindClass(soa.Self(), "LMyClassNatives;", class_loader)));
+  ASSERT_TRUE(klass.Get() != nullptr);
+  const DexFile& dex_file = klass->GetDexFile();
+  const DexFile::ClassDef& class_def = *klass->GetClassDef();
+
+  struct {
+    const char* name;
+    const char* signature;
+    bool direct;
+    uint32_t expected_flags;
+  } methods[] = {
+    { "foo", "()V", false, 0u },
+    { "fastFooI", "(I)I", false, kAccFastNative },
+    { "fastSbar", "(I)I", true, kAccFastNative },
+    { "fastFooJJ_synchronized", "(JJ)J", false, kAccFastNative },
+    { "criticalFooDD", "(DD)D", true, kAccCriticalNative },
+    // @CriticalNative is ignored on instance and synchronized methods and ones with references.
+    { "criticalIgnoredInstance", "(I)I", false, 0u },
+    { "criticalIgnoredSynchronized", "(I)I", true, 0u },
+    { "criticalIgnoredObject", "(Ljava/lang/Object;)I", true, 0u },
+  };
+  for (const auto& m : methods) {
+    mirror::ArtMethod* method = m.direct ? klass->FindDirectMethod(m.name, m.signature)
+                                         : klass->FindVirtualMethod(m.name, m.signature);
+    ASSERT_TRUE(method != nullptr) << m.name;
+    uint32_t dex_access_flags = method->GetAccessFlags() & ~(kAccFastNative | kAccCriticalNative);
+    EXPECT_EQ(m.expected_flags,
+              ClassLinker::GetNativeMethodAnnotationFlags(dex_file, class_def,
+                                                          method->GetDexMethodIndex(),
+                                                          dex_access_flags)) << m.name;
+    // The loaded method has the same flags.
+    EXPECT_EQ(m.expected_flags,
+              method->GetAccessFlags() & (kAccFastNative | kAccCriticalNative)) << m.name;
+    EXPECT_EQ(m.expected_flags == kAccCriticalNative, method->IsCriticalNative()) << m.name;
+  }
+}
+
 }  // namespace art
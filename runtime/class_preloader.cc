@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_preloader.h"
+
+#include <sstream>
+
+#include "base/stringprintf.h"
+#include "class_linker.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread-inl.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include "zip_archive.h"
+
+namespace art {
+
+class ClassPreloader::PreloadTask : public Task {
+ public:
+  explicit PreloadTask(ClassPreloader* preloader) : preloader_(preloader) {}
+
+  void Run(Thread* self) OVERRIDE {
+    while (preloader_->PreloadNext(self)) {
+    }
+  }
+
+ private:
+  ClassPreloader* const preloader_;
+};
+
+bool ClassPreloader::ReadClassList(const std::string& zip_location,
+                                   std::vector<std::string>* descriptors,
+                                   std::string* error_msg) {
+  std::unique_ptr<ZipArchive> zip_archive(ZipArchive::Open(zip_location.c_str(), error_msg));
+  if (zip_archive.get() == nullptr) {
+    return false;
+  }
+  std::unique_ptr<ZipEntry> zip_entry(zip_archive->Find(kClassListEntry, error_msg));
+  if (zip_entry.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to find '%s' within '%s': %s", kClassListEntry,
+                              zip_location.c_str(), error_msg->c_str());
+    return false;
+  }
+  std::unique_ptr<MemMap> class_list(zip_entry->ExtractToMemMap(zip_location.c_str(),
+                                                                kClassListEntry,
+                                                                error_msg));
+  if (class_list.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to extract '%s' from '%s': %s", kClassListEntry,
+                              zip_location.c_str(), error_msg->c_str());
+    return false;
+  }
+  ParseClassList(std::string(reinterpret_cast<char*>(class_list->Begin()), class_list->Size()),
+                 descriptors);
+  return true;
+}
+
+void ClassPreloader::ParseClassList(const std::string& class_list,
+                                    std::vector<std::string>* descriptors) {
+  std::istringstream class_list_stream(class_list);
+  while (class_list_stream.good()) {
+    std::string dot;
+    std::getline(class_list_stream, dot);
+    // Lists edited on Windows end their lines with "\r\n".
+    if (!dot.empty() && dot.back() == '\r') {
+      dot.pop_back();
+    }
+    if (StartsWith(dot, "#") || dot.empty()) {
+      continue;
+    }
+    descriptors->push_back(DotToDescriptor(dot.c_str()));
+  }
+}
+
+ClassPreloader::ClassPreloader(jobject class_loader, std::vector<std::string>&& descriptors,
+                               size_t num_threads)
+    : class_loader_(class_loader),
+      descriptors_(std::move(descriptors)),
+      num_threads_(num_threads),
+      start_ns_(0),
+      next_index_(0),
+      num_processed_(0),
+      num_preloaded_(0),
+      shutting_down_(false) {
+  DCHECK_GT(num_threads_, 0U);
+}
+
+ClassPreloader::~ClassPreloader() {
+  Thread* self = Thread::Current();
+  shutting_down_.StoreRelaxed(true);
+  // Joins the workers. Each of them bails out after the class it is currently working on.
+  thread_pool_.reset();
+  VLOG(class_linker) << "Class preloader processed " << num_processed_.LoadRelaxed() << "/"
+                     << descriptors_.size() << " classes, preloaded "
+                     << num_preloaded_.LoadRelaxed();
+  Runtime::Current()->GetJavaVM()->DeleteGlobalRef(self, class_loader_);
+}
+
+void ClassPreloader::DeleteThreadPool() {
+  DCHECK(IsFinished());
+  // Joins the workers, which are waiting for tasks once the list is exhausted.
+  thread_pool_.reset();
+  VLOG(class_linker) << "Class preloader stopped its workers, preloaded "
+                     << num_preloaded_.LoadRelaxed() << "/" << descriptors_.size() << " classes";
+}
+
+void ClassPreloader::Start(Thread* self) {
+  CHECK(thread_pool_.get() == nullptr);
+  start_ns_ = NanoTime();
+  const size_t num_threads = std::min(num_threads_, descriptors_.size());
+  if (num_threads == 0) {
+    return;
+  }
+  thread_pool_.reset(new ThreadPool("Class preloader", num_threads));
+  for (size_t i = 0; i < num_threads; ++i) {
+    tasks_.emplace_back(new PreloadTask(this));
+    thread_pool_->AddTask(self, tasks_.back().get());
+  }
+  thread_pool_->StartWorkers(self);
+}
+
+bool ClassPreloader::PreloadNext(Thread* self) {
+  if (shutting_down_.LoadRelaxed()) {
+    return false;
+  }
+  const size_t index = next_index_.FetchAndAddSequentiallyConsistent(1);
+  if (index >= descriptors_.size()) {
+    return false;
+  }
+  const char* descriptor = descriptors_[index].c_str();
+  {
+    ScopedObjectAccess soa(self);
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    StackHandleScope<2> hs(self);
+    Handle<mirror::ClassLoader> class_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader_)));
+    Handle<mirror::Class> klass(
+        hs.NewHandle(class_linker->FindClass(self, descriptor, class_loader)));
+    if (klass.Get() == nullptr) {
+      // The list may be stale. Leave it to the main thread to report missing classes.
+      VLOG(class_linker) << "Failed to preload " << descriptor;
+      self->ClearException();
+    } else {
+      if (!klass->IsVerified() && !klass->IsErroneous()) {
+        // VerifyClass holds the class' lock, so this cannot race with initialization on another
+        // thread. A verification error leaves the class erroneous for the main thread to throw.
+        class_linker->VerifyClass(self, klass);
+        self->ClearException();
+      }
+      num_preloaded_.FetchAndAddSequentiallyConsistent(1);
+    }
+  }
+  if (num_processed_.FetchAndAddSequentiallyConsistent(1) + 1 == descriptors_.size()) {
+    VLOG(class_linker) << "Class preloader finished " << descriptors_.size() << " classes in "
+                       << PrettyDuration(NanoTime() - start_ns_);
+  }
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_PRELOADER_H_
+#define ART_RUNTIME_CLASS_PRELOADER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "jni.h"
+
+namespace art {
+
+class Task;
+class Thread;
+class ThreadPool;
+
+// Resolves, links and verifies a list of application classes on a pool of worker threads so that
+// the main thread finds them ready when it first touches them. Classes are never initialized by
+// the preloader, so no <clinit> runs off the main thread. Concurrent definition of the same class
+// is serialized by the class linker exactly as for any other pair of racing threads.
+class ClassPreloader {
+ public:
+  // Name of the zip entry holding the list of classes to preload, one dotted class name per line.
+  static constexpr const char* kClassListEntry = "preloaded-classes";
+
+  // Reads the class list of the zip file at zip_location and appends the class descriptors to
+  // descriptors. Lines starting with '#' and empty lines are ignored.
+  static bool ReadClassList(const std::string& zip_location,
+                            std::vector<std::string>* descriptors,
+                            std::string* error_msg);
+
+  // Appends the descriptors of the dotted class names in class_list, one per line, to
+  // descriptors.
+  static void ParseClassList(const std::string& class_list, std::vector<std::string>* descriptors);
+
+  // Takes ownership of class_loader, which must be a global reference.
+  ClassPreloader(jobject class_loader, std::vector<std::string>&& descriptors, size_t num_threads);
+
+  // Stops the workers and waits for them to finish their current class.
+  ~ClassPreloader() LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Creates the worker threads and starts preloading. Must not be called while runnable since
+  // workers attach to the runtime before the pool is returned.
+  void Start(Thread* self) LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Stops and joins the worker threads so that they no longer stay attached to the runtime. Must
+  // only be called once IsFinished() and not while runnable.
+  void DeleteThreadPool() LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Returns true if every class in the list has been processed.
+  bool IsFinished() const {
+    return num_processed_.LoadRelaxed() == descriptors_.size();
+  }
+
+  size_t GetNumPreloaded() const {
+    return num_preloaded_.LoadRelaxed();
+  }
+
+ private:
+  class PreloadTask;
+
+  // Preloads the next class in the list. Returns false once the list is exhausted or the
+  // preloader is shutting down.
+  bool PreloadNext(Thread* self) LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  const jobject class_loader_;
+  const std::vector<std::string> descriptors_;
+  const size_t num_threads_;
+  uint64_t start_ns_;
+
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::vector<std::unique_ptr<Task>> tasks_;
+
+  // Index of the next descriptor to preload, shared by all of the workers.
+  Atomic<size_t> next_index_;
+  Atomic<size_t> num_processed_;
+  Atomic<size_t> num_preloaded_;
+  Atomic<bool> shutting_down_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassPreloader);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_PRELOADER_H_
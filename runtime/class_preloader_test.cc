@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_preloader.h"
+
+#include <unistd.h>
+
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "scoped_thread_state_change.h"
+#include "utf.h"
+
+namespace art {
+
+class ClassPreloaderTest : public CommonRuntimeTest {};
+
+TEST_F(ClassPreloaderTest, ParseClassList) {
+  std::vector<std::string> descriptors;
+  ClassPreloader::ParseClassList("# Comment\r\nInterfaces$A\r\n\r\nInterfaces$B\njava.lang.Object",
+                                 &descriptors);
+  ASSERT_EQ(3u, descriptors.size());
+  EXPECT_EQ("LInterfaces$A;", descriptors[0]);
+  EXPECT_EQ("LInterfaces$B;", descriptors[1]);
+  EXPECT_EQ("Ljava/lang/Object;", descriptors[2]);
+}
+
+TEST_F(ClassPreloaderTest, PreloadClasses) {
+  Thread* self = Thread::Current();
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    class_loader = LoadDex("Interfaces");
+  }
+  std::vector<std::string> descriptors = {
+      "LInterfaces$A;", "LInterfaces$B;", "LInterfaces$K;", "LInterfaces$Missing;" };
+  // The preloader takes ownership of the global reference to the class loader.
+  ClassPreloader preloader(class_loader, std::vector<std::string>(descriptors), 2u);
+  preloader.Start(self);
+  while (!preloader.IsFinished()) {
+    usleep(1000);
+  }
+  EXPECT_EQ(3u, preloader.GetNumPreloaded());
+  preloader.DeleteThreadPool();
+
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader)));
+  for (size_t i = 0; i != 3u; ++i) {
+    const char* descriptor = descriptors[i].c_str();
+    mirror::Class* klass = class_linker_->LookupClass(self, descriptor,
+                                                      ComputeModifiedUtf8Hash(descriptor),
+                                                      loader.Get());
+    ASSERT_TRUE(klass != nullptr) << descriptor;
+    EXPECT_TRUE(klass->IsResolved()) << descriptor;
+    EXPECT_TRUE(klass->IsVerified()) << descriptor;
+    EXPECT_FALSE(klass->IsInitialized()) << descriptor;
+  }
+  const char* missing = descriptors[3].c_str();
+  EXPECT_TRUE(class_linker_->LookupClass(self, missing, ComputeModifiedUtf8Hash(missing),
+                                         loader.Get()) == nullptr);
+  EXPECT_FALSE(self->IsExceptionPending());
+}
+
+}  // namespace art
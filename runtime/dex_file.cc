@@ -37,10 +37,12 @@
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/string.h"
+#include "oat_file.h"
 #include "os.h"
 #include "safe_map.h"
 #include "handle_scope-inl.h"
 #include "thread.h"
+#include "type_lookup_table.h"
 #include "utf-inl.h"
 #include "utils.h"
 #include "well_known_classes.h"
@@ -248,6 +250,7 @@ const DexFile* DexFile::OpenMemory(const std::string& location,
                     location,
                     location_checksum,
                     mem_map,
+                    nullptr,
                     error_msg);
 }
 
@@ -333,20 +336,27 @@ const DexFile* DexFile::OpenMemory(const uint8_t* base,
                                    size_t size,
                                    const std::string& location,
                                    uint32_t location_checksum,
-                                   MemMap* mem_map, std::string* error_msg) {
+                                   MemMap* mem_map,
+                                   const OatDexFile* oat_dex_file,
+                                   std::string* error_msg) {
   CHECK_ALIGNED(base, 4);  // various dex file structures must be word aligned
-  std::unique_ptr<DexFile> dex_file(new DexFile(base, size, location, location_checksum, mem_map));
+  std::unique_ptr<DexFile> dex_file(new DexFile(base, size, location, location_checksum, mem_map,
+                                                oat_dex_file));
   if (!dex_file->Init(error_msg)) {
     return nullptr;
-  } else {
-    return dex_file.release();
   }
+  if (oat_dex_file != nullptr && oat_dex_file->GetLookupTableData() != nullptr) {
+    dex_file->lookup_table_.reset(
+        TypeLookupTable::Open(oat_dex_file->GetLookupTableData(), *dex_file));
+  }
+  return dex_file.release();
 }
 
 DexFile::DexFile(const uint8_t* base, size_t size,
                  const std::string& location,
                  uint32_t location_checksum,
-                 MemMap* mem_map)
+                 MemMap* mem_map,
+                 const OatDexFile* oat_dex_file)
     : begin_(base),
       size_(size),
       location_(location),
@@ -360,7 +370,8 @@ DexFile::DexFile(const uint8_t* base, size_t size,
       proto_ids_(reinterpret_cast<const ProtoId*>(base + header_->proto_ids_off_)),
       class_defs_(reinterpret_cast<const ClassDef*>(base + header_->class_defs_off_)),
       find_class_def_misses_(0),
-      class_def_index_(nullptr) {
+      class_def_index_(nullptr),
+      oat_dex_file_(oat_dex_file) {
   CHECK(begin_ != NULL) << GetLocation();
   CHECK_GT(size_, 0U) << GetLocation();
 }
@@ -421,6 +432,11 @@ uint32_t DexFile::GetVersion() const {
 
 const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor, size_t hash) const {
   DCHECK_EQ(ComputeModifiedUtf8Hash(descriptor), hash);
+  // If the oat file provided a precomputed lookup table use it, it is shared clean memory.
+  if (LIKELY(lookup_table_ != nullptr)) {
+    const uint32_t class_def_idx = lookup_table_->Lookup(descriptor, hash);
+    return (class_def_idx != DexFile::kDexNoIndex) ? &GetClassDef(class_def_idx) : nullptr;
+  }
   // If we have an index lookup the descriptor via that as its constant time to search.
   Index* index = class_def_index_.LoadSequentiallyConsistent();
   if (index != nullptr) {
@@ -480,6 +496,46 @@ const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
   return NULL;
 }
 
+bool DexFile::IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                        const char* descriptor) const {
+  if (class_def.annotations_off_ == 0) {
+    return false;
+  }
+  // Most dex files don't mention the annotation type at all.
+  const StringId* string_id = FindStringId(descriptor);
+  if (string_id == nullptr) {
+    return false;
+  }
+  const TypeId* type_id = FindTypeId(GetIndexForStringId(*string_id));
+  if (type_id == nullptr) {
+    return false;
+  }
+  const uint16_t type_idx = GetIndexForTypeId(*type_id);
+  const AnnotationsDirectoryItem* directory =
+      reinterpret_cast<const AnnotationsDirectoryItem*>(begin_ + class_def.annotations_off_);
+  const FieldAnnotationsItem* field_annotations =
+      reinterpret_cast<const FieldAnnotationsItem*>(directory + 1);
+  const MethodAnnotationsItem* method_annotations =
+      reinterpret_cast<const MethodAnnotationsItem*>(field_annotations + directory->fields_size_);
+  for (uint32_t i = 0; i != directory->methods_size_; ++i) {
+    if (method_annotations[i].method_idx_ != method_idx) {
+      continue;
+    }
+    const AnnotationSetItem* set = reinterpret_cast<const AnnotationSetItem*>(
+        begin_ + method_annotations[i].annotations_off_);
+    for (uint32_t j = 0; j != set->size_; ++j) {
+      // An annotation_item is the visibility byte followed by the encoded_annotation, which starts
+      // with the type index.
+      const uint8_t* annotation = begin_ + set->entries_[j] + 1u;
+      if (DecodeUnsignedLeb128(&annotation) == type_idx) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return false;
+}
+
 const DexFile::FieldId* DexFile::FindFieldId(const DexFile::TypeId& declaring_klass,
                                               const DexFile::StringId& name,
                                               const DexFile::TypeId& type) const {
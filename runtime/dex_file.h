@@ -44,9 +44,11 @@ namespace mirror {
 }  // namespace mirror
 class ClassLinker;
 class MemMap;
+class OatDexFile;
 class Signature;
 template<class T> class Handle;
 class StringPiece;
+class TypeLookupTable;
 class ZipArchive;
 
 // TODO: move all of the macro functionality into the DexCache class.
@@ -392,7 +394,17 @@ class DexFile {
                              const std::string& location,
                              uint32_t location_checksum,
                              std::string* error_msg) {
-    return OpenMemory(base, size, location, location_checksum, NULL, error_msg);
+    return OpenMemory(base, size, location, location_checksum, NULL, nullptr, error_msg);
+  }
+
+  // Opens .dex file embedded in an oat file. The OatDexFile, and the type lookup table it
+  // provides, are not owned by the DexFile and must outlive it.
+  static const DexFile* Open(const uint8_t* base, size_t size,
+                             const std::string& location,
+                             uint32_t location_checksum,
+                             const OatDexFile* oat_dex_file,
+                             std::string* error_msg) {
+    return OpenMemory(base, size, location, location_checksum, NULL, oat_dex_file, error_msg);
   }
 
   // Open all classesXXX.dex files from a zip archive.
@@ -654,6 +666,18 @@ class DexFile {
   // ComputeModifiedUtf8Hash(descriptor).
   const ClassDef* FindClassDef(const char* descriptor, size_t hash) const;
 
+  // Returns the precomputed type lookup table, or nullptr if the dex file was not opened from an
+  // oat file containing one.
+  const TypeLookupTable* GetTypeLookupTable() const {
+    return lookup_table_.get();
+  }
+
+  // Returns the OatDexFile this dex file was opened from, or nullptr if it was not opened from
+  // an oat file.
+  const OatDexFile* GetOatDexFile() const {
+    return oat_dex_file_;
+  }
+
   // Looks up a class definition by its type index.
   const ClassDef* FindClassDef(uint16_t type_idx) const;
 
@@ -675,6 +699,11 @@ class DexFile {
     }
   }
 
+  // Returns whether the method has an annotation of the type with the given descriptor. The
+  // elements of the annotation are not looked at.
+  bool IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                 const char* descriptor) const;
+
   //
   const CodeItem* GetCodeItem(const uint32_t code_off) const {
     if (code_off == 0) {
@@ -919,18 +948,21 @@ class DexFile {
                                    MemMap* mem_map,
                                    std::string* error_msg);
 
-  // Opens a .dex file at the given address, optionally backed by a MemMap
+  // Opens a .dex file at the given address, optionally backed by a MemMap and optionally
+  // embedded in an oat file.
   static const DexFile* OpenMemory(const uint8_t* dex_file,
                                    size_t size,
                                    const std::string& location,
                                    uint32_t location_checksum,
                                    MemMap* mem_map,
+                                   const OatDexFile* oat_dex_file,
                                    std::string* error_msg);
 
   DexFile(const uint8_t* base, size_t size,
           const std::string& location,
           uint32_t location_checksum,
-          MemMap* mem_map);
+          MemMap* mem_map,
+          const OatDexFile* oat_dex_file);
 
   // Top-level initializer that calls other Init methods.
   bool Init(std::string* error_msg);
@@ -1013,6 +1045,14 @@ class DexFile {
   };
   typedef HashMap<const char*, const ClassDef*, UTF16EmptyFn, UTF16HashCmp, UTF16HashCmp> Index;
   mutable Atomic<Index*> class_def_index_;
+
+  // Precomputed descriptor to class def lookup table backed by the oat file, if any. When present
+  // it is used instead of the lazily built class_def_index_.
+  std::unique_ptr<TypeLookupTable> lookup_table_;
+
+  // The OatDexFile this dex file was opened from, if any. Lets the ClassLinker find the oat
+  // classes for this dex file without searching all opened oat files by location.
+  const OatDexFile* const oat_dex_file_;
 };
 std::ostream& operator<<(std::ostream& os, const DexFile& dex_file);
 
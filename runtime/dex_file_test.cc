@@ -273,6 +273,60 @@ TEST_F(DexFileTest, GetMethodSignature) {
   }
 }
 
+// Returns the index of the method of the class with the given name, which must be unique.
+static uint32_t FindMethodIndex(const DexFile& dex_file, const DexFile::ClassDef& class_def,
+                                const char* name) {
+  const uint8_t* class_data = dex_file.GetClassData(class_def);
+  CHECK(class_data != nullptr);
+  ClassDataItemIterator it(dex_file, class_data);
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+    if (strcmp(name, dex_file.GetMethodName(dex_file.GetMethodId(it.GetMemberIndex()))) == 0) {
+      return it.GetMemberIndex();
+    }
+  }
+  LOG(FATAL) << "No method " << name << " in " << dex_file.GetClassDescriptor(class_def);
+  UNREACHABLE();
+}
+
+TEST_F(DexFileTest, IsMethodAnnotationPresent) {
+  ScopedObjectAccess soa(Thread::Current());
+  const DexFile* raw(OpenTestDexFile("MyClassNatives"));
+  ASSERT_TRUE(raw != nullptr);
+  const DexFile::ClassDef* class_def = nullptr;
+  for (size_t i = 0; i != raw->NumClassDefs(); ++i) {
+    if (strcmp("LMyClassNatives;", raw->GetClassDescriptor(raw->GetClassDef(i))) == 0) {
+      class_def = &raw->GetClassDef(i);
+    }
+  }
+  ASSERT_TRUE(class_def != nullptr);
+
+  const char* fast_native = "Ldalvik/annotation/optimization/FastNative;";
+  const char* critical_native = "Ldalvik/annotation/optimization/CriticalNative;";
+  uint32_t fast = FindMethodIndex(*raw, *class_def, "fastFooI");
+  EXPECT_TRUE(raw->IsMethodAnnotationPresent(*class_def, fast, fast_native));
+  EXPECT_FALSE(raw->IsMethodAnnotationPresent(*class_def, fast, critical_native));
+  uint32_t critical = FindMethodIndex(*raw, *class_def, "criticalFooDD");
+  EXPECT_FALSE(raw->IsMethodAnnotationPresent(*class_def, critical, fast_native));
+  EXPECT_TRUE(raw->IsMethodAnnotationPresent(*class_def, critical, critical_native));
+  uint32_t plain = FindMethodIndex(*raw, *class_def, "foo");
+  EXPECT_FALSE(raw->IsMethodAnnotationPresent(*class_def, plain, fast_native));
+  EXPECT_FALSE(raw->IsMethodAnnotationPresent(*class_def, plain, critical_native));
+  // An annotation type of the dex file that only annotates the annotation types.
+  EXPECT_FALSE(raw->IsMethodAnnotationPresent(*class_def, fast,
+                                              "Ljava/lang/annotation/Retention;"));
+
+  // A dex file that doesn't mention the annotation type.
+  const DexFile* nested(OpenTestDexFile("Nested"));
+  ASSERT_TRUE(nested != nullptr);
+  const DexFile::ClassDef& nested_def = nested->GetClassDef(1);
+  ASSERT_STREQ("LNested;", nested->GetClassDescriptor(nested_def));
+  EXPECT_FALSE(nested->IsMethodAnnotationPresent(
+      nested_def, FindMethodIndex(*nested, nested_def, "<init>"), fast_native));
+}
+
 TEST_F(DexFileTest, FindStringId) {
   ScopedObjectAccess soa(Thread::Current());
   const DexFile* raw(OpenTestDexFile("GetMethodSignature"));
@@ -930,6 +930,36 @@ const uint8_t* ElfFileImpl<Elf_Ehdr, Elf_Phdr, Elf_Shdr, Elf_Word,
   }
 }
 
+template <typename Elf_Ehdr, typename Elf_Phdr, typename Elf_Shdr, typename Elf_Word,
+          typename Elf_Sword, typename Elf_Addr, typename Elf_Sym, typename Elf_Rel,
+          typename Elf_Rela, typename Elf_Dyn, typename Elf_Off>
+bool ElfFileImpl<Elf_Ehdr, Elf_Phdr, Elf_Shdr, Elf_Word,
+    Elf_Sword, Elf_Addr, Elf_Sym, Elf_Rel, Elf_Rela, Elf_Dyn, Elf_Off>
+    ::FindDefinedDynamicFunctionNames(const char* prefix, std::vector<const char*>* names) const {
+  Elf_Shdr* symbol_section = FindSectionByType(SHT_DYNSYM);
+  if (symbol_section == nullptr) {
+    return false;
+  }
+  const size_t prefix_length = strlen(prefix);
+  for (uint32_t i = 0; i < GetSymbolNum(*symbol_section); i++) {
+    Elf_Sym* symbol = GetSymbol(SHT_DYNSYM, i);
+    if (symbol == nullptr) {
+      return false;  // Failure condition.
+    }
+    unsigned char type = (sizeof(Elf_Addr) == sizeof(Elf64_Addr))
+                         ? ELF64_ST_TYPE(symbol->st_info)
+                         : ELF32_ST_TYPE(symbol->st_info);
+    if (type != STT_FUNC || symbol->st_shndx == SHN_UNDEF) {
+      continue;
+    }
+    const char* name = GetString(SHT_DYNSYM, symbol->st_name);
+    if (name != nullptr && strncmp(name, prefix, prefix_length) == 0) {
+      names->push_back(name);
+    }
+  }
+  return true;
+}
+
 // WARNING: Only called from FindDynamicSymbolAddress. Elides check for hash section.
 template <typename Elf_Ehdr, typename Elf_Phdr, typename Elf_Shdr, typename Elf_Word,
           typename Elf_Sword, typename Elf_Addr, typename Elf_Sym, typename Elf_Rel,
@@ -2524,6 +2554,11 @@ const uint8_t* ElfFile::FindDynamicSymbolAddress(const std::string& symbol_name)
   DELEGATE_TO_IMPL(FindDynamicSymbolAddress, symbol_name);
 }
 
+bool ElfFile::FindDefinedDynamicFunctionNames(const char* prefix,
+                                              std::vector<const char*>* names) const {
+  DELEGATE_TO_IMPL(FindDefinedDynamicFunctionNames, prefix, names);
+}
+
 size_t ElfFile::Size() const {
   DELEGATE_TO_IMPL(Size);
 }
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/macros.h"
 // Explicitly include our own elf.h to avoid Linux and other dependencies.
@@ -54,6 +55,8 @@ class ElfFile {
 
   const uint8_t* FindDynamicSymbolAddress(const std::string& symbol_name) const;
 
+  bool FindDefinedDynamicFunctionNames(const char* prefix, std::vector<const char*>* names) const;
+
   size_t Size() const;
 
   // The start of the memory map address range for this ELF file.
@@ -72,6 +72,10 @@ class ElfFileImpl {
   // Find .dynsym using .hash for more efficient lookup than FindSymbolAddress.
   const uint8_t* FindDynamicSymbolAddress(const std::string& symbol_name) const;
 
+  // Append the names of the functions defined in .dynsym that start with prefix to names. The
+  // names point into the mapped file. Returns false if there is no .dynsym.
+  bool FindDefinedDynamicFunctionNames(const char* prefix, std::vector<const char*>* names) const;
+
   static bool IsSymbolSectionType(Elf_Word section_type);
   Elf_Word GetSymbolNum(Elf_Shdr&) const;
   Elf_Sym* GetSymbol(Elf_Word section_type, Elf_Word i) const;
@@ -31,7 +31,11 @@ extern "C" void* artFindNativeMethod() {
 extern "C" void* artFindNativeMethod(Thread* self) {
   DCHECK_EQ(self, Thread::Current());
 #endif
-  Locks::mutator_lock_->AssertNotHeld(self);  // We come here as Native.
+  // We come here as Native, unless called from the stub of a fast or critical native, which
+  // stays Runnable.
+  if (self->GetState() != kRunnable) {
+    Locks::mutator_lock_->AssertNotHeld(self);
+  }
   ScopedObjectAccess soa(self);
 
   mirror::ArtMethod* method = self->GetCurrentMethod(NULL);
@@ -74,6 +74,9 @@
   V(JniMethodEndSynchronized, void, uint32_t cookie, jobject locked, Thread* self) \
   V(JniMethodEndWithReference, mirror::Object*, jobject result, uint32_t cookie, Thread* self) \
   V(JniMethodEndWithReferenceSynchronized, mirror::Object*, jobject result, uint32_t cookie, jobject locked, Thread* self) \
+  V(JniMethodFastStart, uint32_t, Thread*) \
+  V(JniMethodFastEnd, void, uint32_t cookie, Thread* self) \
+  V(JniMethodFastEndWithReference, mirror::Object*, jobject result, uint32_t cookie, Thread* self) \
   V(QuickGenericJniTrampoline, void, mirror::ArtMethod*) \
 \
   V(LockObject, void, void*) \
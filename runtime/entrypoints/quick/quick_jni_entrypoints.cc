@@ -110,4 +110,42 @@ extern mirror::Object* JniMethodEndWithReferenceSynchronized(jobject result,
   return o;
 }
 
+extern uint32_t JniMethodFastStart(Thread* self) {
+  DCHECK(self->GetManagedStack()->GetTopQuickFrame()->AsMirrorPtr()->IsFastNative());
+  JNIEnvExt* env = self->GetJniEnv();
+  DCHECK(env != nullptr);
+  uint32_t saved_local_ref_cookie = env->local_ref_cookie;
+  env->local_ref_cookie = env->locals.GetSegmentState();
+  return saved_local_ref_cookie;
+}
+
+static void FastGoToRunnable(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // We never left Runnable, just perform a pending suspend check.
+  if (UNLIKELY(self->TestAllFlags())) {
+    self->CheckSuspend();
+  }
+}
+
+extern void JniMethodFastEnd(uint32_t saved_local_ref_cookie, Thread* self) {
+  FastGoToRunnable(self);
+  PopLocalReferences(saved_local_ref_cookie, self);
+}
+
+extern mirror::Object* JniMethodFastEndWithReference(jobject result,
+                                                     uint32_t saved_local_ref_cookie,
+                                                     Thread* self) {
+  FastGoToRunnable(self);
+  mirror::Object* o = self->DecodeJObject(result);  // Must decode before pop.
+  PopLocalReferences(saved_local_ref_cookie, self);
+  // Process result.
+  if (UNLIKELY(self->GetJniEnv()->check_jni)) {
+    if (self->IsExceptionPending()) {
+      return NULL;
+    }
+    CheckReferenceResult(o, self);
+  }
+  VerifyObject(o);
+  return o;
+}
+
 }  // namespace art
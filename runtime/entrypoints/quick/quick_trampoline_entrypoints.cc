@@ -1302,7 +1302,8 @@ class ComputeNativeCallFrameSize {
 
 class ComputeGenericJniFrameSize FINAL : public ComputeNativeCallFrameSize {
  public:
-  ComputeGenericJniFrameSize() : num_handle_scope_references_(0) {}
+  explicit ComputeGenericJniFrameSize(bool critical_native)
+    : num_handle_scope_references_(0), critical_native_(critical_native) {}
 
   // Lays out the callee-save frame. Assumes that the incorrect frame corresponding to RefsAndArgs
   // is at *m = sp. Will update to point to the bottom of the save frame.
@@ -1390,6 +1391,8 @@ class ComputeGenericJniFrameSize FINAL : public ComputeNativeCallFrameSize {
 
  private:
   uint32_t num_handle_scope_references_;
+  // Critical natives take neither the JNIEnv* nor the jclass.
+  const bool critical_native_;
 };
 
 uintptr_t ComputeGenericJniFrameSize::PushHandle(mirror::Object* /* ptr */) {
@@ -1399,6 +1402,10 @@ uintptr_t ComputeGenericJniFrameSize::PushHandle(mirror::Object* /* ptr */) {
 
 void ComputeGenericJniFrameSize::WalkHeader(
     BuildNativeCallFrameStateMachine<ComputeNativeCallFrameSize>* sm) {
+  if (critical_native_) {
+    return;
+  }
+
   // JNIEnv
   sm->AdvancePointer(nullptr);
 
@@ -1457,11 +1464,12 @@ class FillNativeCall {
 // of transitioning into native code.
 class BuildGenericJniFrameVisitor FINAL : public QuickArgumentVisitor {
  public:
-  BuildGenericJniFrameVisitor(Thread* self, bool is_static, const char* shorty, uint32_t shorty_len,
+  BuildGenericJniFrameVisitor(Thread* self, bool is_static, bool critical_native,
+                              const char* shorty, uint32_t shorty_len,
                               StackReference<mirror::ArtMethod>** sp)
      : QuickArgumentVisitor(*sp, is_static, shorty, shorty_len),
        jni_call_(nullptr, nullptr, nullptr, nullptr), sm_(&jni_call_) {
-    ComputeGenericJniFrameSize fsc;
+    ComputeGenericJniFrameSize fsc(critical_native);
     uintptr_t* start_gpr_reg;
     uint32_t* start_fpr_reg;
     uintptr_t* start_stack_arg;
@@ -1472,6 +1480,11 @@ class BuildGenericJniFrameVisitor FINAL : public QuickArgumentVisitor {
 
     jni_call_.Reset(start_gpr_reg, start_fpr_reg, start_stack_arg, handle_scope_);
 
+    if (critical_native) {
+      // Only primitive arguments, nothing goes into the handle scope.
+      return;
+    }
+
     // jni environment is always first argument
     sm_.AdvancePointer(self->GetJniEnv());
 
@@ -1519,7 +1532,6 @@ class BuildGenericJniFrameVisitor FINAL : public QuickArgumentVisitor {
       while (cur_entry_ < expected_slots) {
         handle_scope_->GetMutableHandle(cur_entry_++).Assign(nullptr);
       }
-      DCHECK_NE(cur_entry_, 0U);
     }
 
    private:
@@ -1641,7 +1653,8 @@ extern "C" TwoWordReturn artQuickGenericJniTrampoline(Thread* self,
   const char* shorty = called->GetShorty(&shorty_len);
 
   // Run the visitor and update sp.
-  BuildGenericJniFrameVisitor visitor(self, called->IsStatic(), shorty, shorty_len, &sp);
+  BuildGenericJniFrameVisitor visitor(self, called->IsStatic(), called->IsCriticalNative(), shorty,
+                                      shorty_len, &sp);
   visitor.VisitArguments();
   visitor.FinalizeHandleScope(self);
 
@@ -33,6 +33,7 @@
 #include "indirect_reference_table.h"
 #include "intern_table.h"
 #include "jni_internal.h"
+#include "lookup_cache.h"
 #include "mark_sweep-inl.h"
 #include "monitor.h"
 #include "mirror/art_field.h"
@@ -186,6 +187,8 @@ inline void MarkCompact::MarkObject(mirror::Object* obj) {
 void MarkCompact::MarkingPhase() {
   TimingLogger::ScopedTiming t(__FUNCTION__, GetTimings());
   Thread* self = Thread::Current();
+  // Fewer lock words to save and restore.
+  heap_->DeflateIdleMonitorsPaused(this);
   // Bitmap which describes which objects we have to move.
   objects_before_forwarding_.reset(accounting::ContinuousSpaceBitmap::Create(
       "objects before forwarding", space_->Begin(), space_->Size()));
@@ -193,6 +196,8 @@ void MarkCompact::MarkingPhase() {
   objects_with_lockword_.reset(accounting::ContinuousSpaceBitmap::Create(
       "objects with lock words", space_->Begin(), space_->Size()));
   CHECK(Locks::mutator_lock_->IsExclusiveHeld(self));
+  // Objects are about to move, drop the references cached by the threads' lookup caches.
+  LookupCache::InvalidateAll();
   // Assume the cleared space is already empty.
   BindBitmaps();
   t.NewTiming("ProcessCards");
@@ -200,6 +200,7 @@ void MarkSweep::PausePhase() {
     RevokeAllThreadLocalAllocationStacks(self);
   }
   heap_->PreSweepingGcVerification(this);
+  heap_->DeflateIdleMonitorsPaused(this);
   // Disallow new system weaks to prevent a race which occurs when someone adds a new system
   // weak before we sweep them. Since this new system weak may not be marked, the GC may
   // incorrectly sweep it. This also fixes a race where interning may attempt to return a strong
@@ -995,8 +996,10 @@ void MarkSweep::MarkRootsCheckpoint(Thread* self,
   CheckpointMarkThreadRoots check_point(this, revoke_ros_alloc_thread_local_buffers_at_checkpoint);
   ThreadList* thread_list = Runtime::Current()->GetThreadList();
   // Request the check point is run on all threads returning a count of the threads that must
-  // run through the barrier including self.
-  size_t barrier_count = thread_list->RunCheckpoint(&check_point);
+  // run through the barrier including self. The roots of suspended threads are marked in
+  // parallel by the GC thread pool, if we have one.
+  size_t barrier_count = thread_list->RunCheckpoint(&check_point, "mark thread roots",
+                                                     GetHeap()->GetThreadPool());
   // Release locks then wait for all mutator threads to pass the barrier.
   // TODO: optimize to not release locks when there are no threads to wait for.
   Locks::heap_bitmap_lock_->ExclusiveUnlock(self);
@@ -40,6 +40,7 @@
 #include "indirect_reference_table.h"
 #include "intern_table.h"
 #include "jni_internal.h"
+#include "lookup_cache.h"
 #include "mark_sweep-inl.h"
 #include "monitor.h"
 #include "mirror/reference-inl.h"
@@ -176,6 +177,9 @@ void SemiSpace::MarkingPhase() {
     runtime->SetFaultMessage(oss.str());
     CHECK_EQ(self_->SetStateUnsafe(old_state), kRunnable);
   }
+  heap_->DeflateIdleMonitorsPaused(this);
+  // Objects are about to move, drop the references cached by the threads' lookup caches.
+  LookupCache::InvalidateAll();
   // Revoke the thread local buffers since the GC may allocate into a RosAllocSpace and this helps
   // to prevent fragmentation.
   RevokeAllThreadLocalBuffers();
@@ -43,6 +43,8 @@ enum CollectorType {
   // A homogeneous space compaction collector used in background transition
   // when both foreground and background collector are CMS.
   kCollectorTypeHomogeneousSpaceCompact,
+  // Not a real collector, used to keep GCs out while an app image space is added.
+  kCollectorTypeAddAppImageSpace,
 };
 std::ostream& operator<<(std::ostream& os, const CollectorType& collector_type);
 
@@ -41,6 +41,8 @@ enum GcCause {
   kGcCauseTrim,
   // GC triggered for background transition when both foreground and background collector are CMS.
   kGcCauseHomogeneousSpaceCompact,
+  // Not a real GC cause, used when we add an app image space.
+  kGcCauseAddAppImageSpace,
 };
 
 const char* PrettyCause(GcCause cause);
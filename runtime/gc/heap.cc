@@ -363,6 +363,10 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   // Relies on the spaces being sorted.
   uint8_t* heap_begin = continuous_spaces_.front()->Begin();
   uint8_t* heap_end = continuous_spaces_.back()->Limit();
+  // App images are added later right below the boot image, leave room for them in the card table.
+  if (GetImageSpace() != nullptr) {
+    heap_begin -= std::min(reinterpret_cast<uintptr_t>(heap_begin) - kPageSize, kMaxAppImageSize);
+  }
   size_t heap_capacity = heap_end - heap_begin;
   // Remove the main backup space since it slows down the GC to have unused extra spaces.
   // TODO: Avoid needing to do this.
@@ -532,7 +536,7 @@ void Heap::DisableMovingGc() {
   ThreadList* tl = Runtime::Current()->GetThreadList();
   Thread* self = Thread::Current();
   ScopedThreadStateChange tsc(self, kSuspended);
-  tl->SuspendAll();
+  tl->SuspendAll("disabling moving GC");
   // Something may have caused the transition to fail.
   if (!IsMovingGc(collector_type_) && non_moving_space_ != main_space_) {
     CHECK(main_space_ != nullptr);
@@ -764,6 +768,30 @@ void Heap::AddSpace(space::Space* space) {
   }
 }
 
+void Heap::AddAppImageSpace(space::ImageSpace* space) {
+  CHECK(space->IsAppImage());
+  Thread* self = Thread::Current();
+  ThreadList* tl = Runtime::Current()->GetThreadList();
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  Locks::mutator_lock_->AssertNotHeld(self);
+  {
+    ScopedThreadStateChange tsc2(self, kWaitingForGcToComplete);
+    MutexLock mu(self, *gc_complete_lock_);
+    // Ensure there is no GC with its immune region already computed while the space is added.
+    WaitForGcToCompleteLocked(kGcCauseAddAppImageSpace, self);
+    collector_type_running_ = kCollectorTypeAddAppImageSpace;
+  }
+  tl->SuspendAll("add app image space");
+  AddSpace(space);
+  // The collectors treat the space as immune, like the boot image, and scan its dirty cards.
+  accounting::ModUnionTable* mod_union_table =
+      new accounting::ModUnionTableToZygoteAllocspace("App image mod-union table", this, space);
+  CHECK(mod_union_table != nullptr) << "Failed to create app image mod-union table";
+  AddModUnionTable(mod_union_table);
+  tl->ResumeAll();
+  FinishGC(self, collector::kGcTypeNone);
+}
+
 void Heap::SetSpaceAsDefault(space::ContinuousSpace* continuous_space) {
   WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
   if (continuous_space->IsDlMallocSpace()) {
@@ -902,7 +930,7 @@ space::Space* Heap::FindSpaceFromObject(const mirror::Object* obj, bool fail_ok)
 
 space::ImageSpace* Heap::GetImageSpace() const {
   for (const auto& space : continuous_spaces_) {
-    if (space->IsImageSpace()) {
+    if (space->IsImageSpace() && !space->AsImageSpace()->IsAppImage()) {
       return space->AsImageSpace();
     }
   }
@@ -967,9 +995,9 @@ void Heap::DoPendingTransitionOrTrim() {
     // Deflate the monitors, this can cause a pause but shouldn't matter since we don't care
     // about pauses.
     Runtime* runtime = Runtime::Current();
-    runtime->GetThreadList()->SuspendAll();
+    runtime->GetThreadList()->SuspendAll("monitor deflation");
     uint64_t start_time = NanoTime();
-    size_t count = runtime->GetMonitorList()->DeflateMonitors();
+    size_t count = runtime->GetMonitorList()->DeflateMonitors(true);
     VLOG(heap) << "Deflating " << count << " monitors took "
         << PrettyDuration(NanoTime() - start_time);
     runtime->GetThreadList()->ResumeAll();
@@ -1025,7 +1053,8 @@ void Heap::Trim() {
     Barrier barrier(0);
     TrimIndirectReferenceTableClosure closure(&barrier);
     ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
-    size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
+    size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(
+        &closure, "trim indirect reference tables");
     barrier.Increment(self, barrier_count);
   }
   uint64_t start_ns = NanoTime();
@@ -1593,7 +1622,7 @@ HomogeneousSpaceCompactResult Heap::PerformHomogeneousSpaceCompact() {
     return HomogeneousSpaceCompactResult::kErrorVMShuttingDown;
   }
   // Suspend all threads.
-  tl->SuspendAll();
+  tl->SuspendAll("homogeneous space compaction");
   uint64_t start_time = NanoTime();
   // Launch compaction.
   space::MallocSpace* to_space = main_space_backup_.release();
@@ -1675,7 +1704,7 @@ void Heap::TransitionCollector(CollectorType collector_type) {
     FinishGC(self, collector::kGcTypeNone);
     return;
   }
-  tl->SuspendAll();
+  tl->SuspendAll("collector transition");
   switch (collector_type) {
     case kCollectorTypeSS: {
       if (!IsMovingGc(collector_type_)) {
@@ -2757,6 +2786,14 @@ void Heap::PreGcVerification(collector::GarbageCollector* gc) {
   }
 }
 
+void Heap::DeflateIdleMonitorsPaused(collector::GarbageCollector* gc) {
+  TimingLogger::ScopedTiming t("(Paused)DeflateIdleMonitors", gc->GetTimings());
+  // Deflating needs mutators suspended, as they update thin lock words without synchronizing.
+  // Leave held monitors alone, they are likely still contended.
+  size_t count = Runtime::Current()->GetMonitorList()->DeflateMonitors(false);
+  VLOG(heap) << gc->GetName() << " deflated " << count << " idle monitors";
+}
+
 void Heap::PrePauseRosAllocVerification(collector::GarbageCollector* gc) {
   UNUSED(gc);
   // TODO: Add a new runtime option for this?
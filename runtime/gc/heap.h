@@ -142,6 +142,8 @@ class Heap {
   static constexpr double kDefaultHeapGrowthMultiplier = 2.0;
   // Primitive arrays larger than this size are put in the large object space.
   static constexpr size_t kDefaultLargeObjectThreshold = 3 * kPageSize;
+  // App images are mapped right below the boot image, the card table covers this much of it.
+  static constexpr size_t kMaxAppImageSize = 64 * MB;
   // Whether or not we use the free list large object space. Only use it if USE_ART_LOW_4G_ALLOCATOR
   // since this means that we have to use the slow msync loop in MemMap::MapAnonymous.
 #if USE_ART_LOW_4G_ALLOCATOR
@@ -317,6 +319,9 @@ class Heap {
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
   void AddSpace(space::Space* space) LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
   void RemoveSpace(space::Space* space) LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
+  // Adds an app image space, which the GC then treats like the boot image. Waits for the running
+  // GC to finish and adds the space with the threads suspended.
+  void AddAppImageSpace(space::ImageSpace* space);
 
   // Set target ideal heap utilization ratio, implements
   // dalvik.system.VMRuntime.setTargetHeapUtilization.
@@ -523,7 +528,7 @@ class Heap {
   void UnBindBitmaps() EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
   // DEPRECATED: Should remove in "near" future when support for multiple image spaces is added.
-  // Assumes there is only one image space.
+  // Assumes there is only one image space. Returns the boot image space, never an app image space.
   space::ImageSpace* GetImageSpace() const;
 
   // Permenantly disable moving garbage collection.
@@ -724,6 +729,10 @@ class Heap {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void PrePauseRosAllocVerification(collector::GarbageCollector* gc)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Return the monitors that are neither held nor waited on to the monitor pool, restoring thin
+  // lock words. Called by the collectors while mutators are paused.
+  void DeflateIdleMonitorsPaused(collector::GarbageCollector* gc)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void PreSweepingGcVerification(collector::GarbageCollector* gc)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void PostGcVerification(collector::GarbageCollector* gc)
@@ -645,6 +645,10 @@ ImageSpace* ImageSpace::Init(const char* image_filename, const char* image_locat
     *error_msg = StringPrintf("Invalid image header in '%s'", image_filename);
     return nullptr;
   }
+  if (image_header.IsAppImage()) {
+    *error_msg = StringPrintf("'%s' is an app image", image_filename);
+    return nullptr;
+  }
 
   // Note: The image header is part of the image due to mmap page alignment required of offset.
   std::unique_ptr<MemMap> map(MemMap::MapFileAtAddress(image_header.GetImageBegin(),
@@ -736,6 +740,134 @@ ImageSpace* ImageSpace::Init(const char* image_filename, const char* image_locat
   return space.release();
 }
 
+ImageSpace* ImageSpace::CreateAppImage(const char* image_filename, const OatFile& oat_file,
+                                       std::string* error_msg) {
+  CHECK(image_filename != nullptr);
+  uint64_t start_time = 0;
+  if (VLOG_IS_ON(heap) || VLOG_IS_ON(class_linker)) {
+    start_time = NanoTime();
+    LOG(INFO) << "ImageSpace::CreateAppImage entering image_filename=" << image_filename;
+  }
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  ImageSpace* boot_image = heap->GetImageSpace();
+  if (boot_image == nullptr) {
+    *error_msg = StringPrintf("No boot image to load app image '%s' with", image_filename);
+    return nullptr;
+  }
+
+  std::unique_ptr<File> file(OS::OpenFileForReading(image_filename));
+  if (file.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to open '%s'", image_filename);
+    return nullptr;
+  }
+  ImageHeader image_header;
+  if (!file->ReadFully(&image_header, sizeof(image_header)) || !image_header.IsValid() ||
+      !image_header.IsAppImage()) {
+    *error_msg = StringPrintf("Invalid app image header in '%s'", image_filename);
+    return nullptr;
+  }
+  const size_t image_size = RoundUp(image_header.GetImageSize(), kPageSize);
+  if (image_header.GetImageBegin() + image_size != image_header.GetBootImageBegin()) {
+    *error_msg = StringPrintf("App image '%s' is not right below its boot image", image_filename);
+    return nullptr;
+  }
+  if (image_header.GetBootImageSize() != boot_image->GetImageHeader().GetImageSize()) {
+    *error_msg = StringPrintf("App image '%s' was written for a different boot image",
+                              image_filename);
+    return nullptr;
+  }
+  if (image_header.GetOatChecksum() != oat_file.GetOatHeader().GetChecksum()) {
+    *error_msg = StringPrintf("Failed to match oat file checksum 0x%x to expected oat checksum 0x%x"
+                              " in app image %s", oat_file.GetOatHeader().GetChecksum(),
+                              image_header.GetOatChecksum(), image_filename);
+    return nullptr;
+  }
+  if (!image_header.IsRelocationBitmapValid(file->GetLength())) {
+    *error_msg = StringPrintf("Invalid relocation bitmap in app image '%s'", image_filename);
+    return nullptr;
+  }
+  // The app image follows the boot image wherever that was relocated to, it has to stay within
+  // the part of the card table set aside for it.
+  uint8_t* const target = boot_image->Begin() - image_size;
+  if (image_size > Heap::kMaxAppImageSize || !heap->GetCardTable()->AddrIsInCardTable(target)) {
+    *error_msg = StringPrintf("App image '%s' of %zu bytes is too large", image_filename,
+                              image_size);
+    return nullptr;
+  }
+
+  std::unique_ptr<MemMap> map(MemMap::MapFileAtAddress(target,
+                                                       image_header.GetImageSize(),
+                                                       PROT_READ | PROT_WRITE,
+                                                       MAP_PRIVATE,
+                                                       file->Fd(),
+                                                       0,
+                                                       false,
+                                                       image_filename,
+                                                       error_msg));
+  if (map.get() == nullptr) {
+    DCHECK(!error_msg->empty());
+    return nullptr;
+  }
+  CHECK_EQ(target, map->Begin());
+
+  std::unique_ptr<MemMap> image_map(
+      MemMap::MapFileAtAddress(nullptr, image_header.GetImageBitmapSize(),
+                               PROT_READ, MAP_PRIVATE,
+                               file->Fd(), image_header.GetBitmapOffset(),
+                               false,
+                               image_filename,
+                               error_msg));
+  if (image_map.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to map image bitmap: %s", error_msg->c_str());
+    return nullptr;
+  }
+  uint32_t bitmap_index = bitmap_index_.FetchAndAddSequentiallyConsistent(1);
+  std::string bitmap_name(StringPrintf("imagespace %s live-bitmap %u", image_filename,
+                                       bitmap_index));
+  std::unique_ptr<accounting::ContinuousSpaceBitmap> bitmap(
+      accounting::ContinuousSpaceBitmap::CreateFromMemMap(bitmap_name, image_map.release(),
+                                                          reinterpret_cast<uint8_t*>(map->Begin()),
+                                                          map->Size()));
+  if (bitmap.get() == nullptr) {
+    *error_msg = StringPrintf("Could not create bitmap '%s'", bitmap_name.c_str());
+    return nullptr;
+  }
+
+  // Move the references, to the app image and to the boot image alike, by the distance the boot
+  // image moved since the app image was written. This is the fixup patchoat applies to images.
+  const uint32_t delta = PointerToLowMemUInt32(target) -
+      PointerToLowMemUInt32(image_header.GetImageBegin());
+  if (delta != 0u) {
+    std::unique_ptr<MemMap> relocation_map(
+        MemMap::MapFileAtAddress(nullptr, image_header.GetRelocationBitmapSize(),
+                                 PROT_READ, MAP_PRIVATE,
+                                 file->Fd(), image_header.GetRelocationBitmapOffset(),
+                                 false,
+                                 image_filename,
+                                 error_msg));
+    if (relocation_map.get() == nullptr) {
+      *error_msg = StringPrintf("Failed to map relocation bitmap: %s", error_msg->c_str());
+      return nullptr;
+    }
+    if (!ImageHeader::ApplyRelocationBitmap(
+            reinterpret_cast<const uint32_t*>(relocation_map->Begin()), 0u,
+            image_header.GetRelocationBitmapSize() / sizeof(uint32_t), map->Begin(),
+            image_header.GetImageSize(), delta)) {
+      *error_msg = StringPrintf("Relocation outside of app image '%s'", image_filename);
+      return nullptr;
+    }
+    reinterpret_cast<ImageHeader*>(map->Begin())->RelocateImage(static_cast<int32_t>(delta));
+  }
+
+  ImageSpace* space = new ImageSpace(image_filename, image_filename, map.release(),
+                                     bitmap.release());
+  if (VLOG_IS_ON(heap) || VLOG_IS_ON(class_linker)) {
+    LOG(INFO) << "ImageSpace::CreateAppImage exiting (" << PrettyDuration(NanoTime() - start_time)
+              << ") " << *space;
+  }
+  return space;
+}
+
 OatFile* ImageSpace::OpenOatFile(const char* image_path, std::string* error_msg) const {
   const ImageHeader& image_header = GetImageHeader();
   std::string oat_filename = ImageHeader::GetOatLocationFromImageLocation(image_path);
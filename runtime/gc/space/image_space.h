@@ -46,6 +46,13 @@ class ImageSpace : public MemMapSpace {
   static ImageSpace* Create(const char* image, InstructionSet image_isa, std::string* error_msg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Maps the app image image_filename, written for the app oat_file, right below the boot image
+  // and relocates it with its relocation bitmap if the boot image moved. The space has no oat
+  // file, its methods are linked to oat_file by the ClassLinker. Returns nullptr on failure,
+  // with reason in error_msg.
+  static ImageSpace* CreateAppImage(const char* image_filename, const OatFile& oat_file,
+                                    std::string* error_msg);
+
   // Reads the image header from the specified image location for the
   // instruction set image_isa or dies trying.
   static ImageHeader* ReadImageHeaderOrDie(const char* image_location,
@@ -73,6 +80,10 @@ class ImageSpace : public MemMapSpace {
     return *reinterpret_cast<ImageHeader*>(Begin());
   }
 
+  bool IsAppImage() const {
+    return GetImageHeader().IsAppImage();
+  }
+
   // Actual filename where image was loaded from.
   // For example: /data/dalvik-cache/arm/system@framework@boot.art
   const std::string GetImageFilename() const {
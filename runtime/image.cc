@@ -24,23 +24,29 @@
 namespace art {
 
 const uint8_t ImageHeader::kImageMagic[] = { 'a', 'r', 't', '\n' };
-const uint8_t ImageHeader::kImageVersion[] = { '0', '1', '3', '\0' };
+const uint8_t ImageHeader::kImageVersion[] = { '0', '1', '5', '\0' };
 
 ImageHeader::ImageHeader(uint32_t image_begin,
                          uint32_t image_size,
                          uint32_t image_bitmap_offset,
                          uint32_t image_bitmap_size,
+                         uint32_t relocation_bitmap_offset,
+                         uint32_t relocation_bitmap_size,
                          uint32_t image_roots,
                          uint32_t oat_checksum,
                          uint32_t oat_file_begin,
                          uint32_t oat_data_begin,
                          uint32_t oat_data_end,
                          uint32_t oat_file_end,
+                         uint32_t boot_image_begin,
+                         uint32_t boot_image_size,
                          bool compile_pic)
   : image_begin_(image_begin),
     image_size_(image_size),
     image_bitmap_offset_(image_bitmap_offset),
     image_bitmap_size_(image_bitmap_size),
+    relocation_bitmap_offset_(relocation_bitmap_offset),
+    relocation_bitmap_size_(relocation_bitmap_size),
     oat_checksum_(oat_checksum),
     oat_file_begin_(oat_file_begin),
     oat_data_begin_(oat_data_begin),
@@ -48,15 +54,24 @@ ImageHeader::ImageHeader(uint32_t image_begin,
     oat_file_end_(oat_file_end),
     patch_delta_(0),
     image_roots_(image_roots),
+    boot_image_begin_(boot_image_begin),
+    boot_image_size_(boot_image_size),
     compile_pic_(compile_pic) {
   CHECK_EQ(image_begin, RoundUp(image_begin, kPageSize));
-  CHECK_EQ(oat_file_begin, RoundUp(oat_file_begin, kPageSize));
-  CHECK_EQ(oat_data_begin, RoundUp(oat_data_begin, kPageSize));
   CHECK_LT(image_begin, image_roots);
-  CHECK_LT(image_roots, oat_file_begin);
-  CHECK_LE(oat_file_begin, oat_data_begin);
-  CHECK_LT(oat_data_begin, oat_data_end);
-  CHECK_LE(oat_data_end, oat_file_end);
+  if (IsAppImage()) {
+    CHECK_EQ(boot_image_begin, RoundUp(boot_image_begin, kPageSize));
+    CHECK_LT(image_roots, image_begin + image_size);
+    CHECK_LE(image_begin + image_size, boot_image_begin);
+    CHECK_EQ(oat_file_begin, 0U);
+  } else {
+    CHECK_EQ(oat_file_begin, RoundUp(oat_file_begin, kPageSize));
+    CHECK_EQ(oat_data_begin, RoundUp(oat_data_begin, kPageSize));
+    CHECK_LT(image_roots, oat_file_begin);
+    CHECK_LE(oat_file_begin, oat_data_begin);
+    CHECK_LT(oat_data_begin, oat_data_end);
+    CHECK_LE(oat_data_end, oat_file_end);
+  }
   memcpy(magic_, kImageMagic, sizeof(kImageMagic));
   memcpy(version_, kImageVersion, sizeof(kImageVersion));
 }
@@ -64,14 +79,42 @@ ImageHeader::ImageHeader(uint32_t image_begin,
 void ImageHeader::RelocateImage(off_t delta) {
   CHECK_ALIGNED(delta, kPageSize) << " patch delta must be page aligned";
   image_begin_ += delta;
-  oat_file_begin_ += delta;
-  oat_data_begin_ += delta;
-  oat_data_end_ += delta;
-  oat_file_end_ += delta;
+  if (IsAppImage()) {
+    // The app image moves with the boot image, it has no oat file addresses to move.
+    boot_image_begin_ += delta;
+  } else {
+    oat_file_begin_ += delta;
+    oat_data_begin_ += delta;
+    oat_data_end_ += delta;
+    oat_file_end_ += delta;
+  }
   image_roots_ += delta;
   patch_delta_ += delta;
 }
 
+bool ImageHeader::IsRelocationBitmapValid(size_t file_size) const {
+  return relocation_bitmap_offset_ >= image_size_ &&
+      relocation_bitmap_offset_ <= file_size &&
+      relocation_bitmap_size_ <= file_size - relocation_bitmap_offset_ &&
+      relocation_bitmap_size_ == ComputeRelocationBitmapSize(image_size_);
+}
+
+bool ImageHeader::ApplyRelocationBitmap(const uint32_t* bitmap, size_t begin, size_t end,
+                                        uint8_t* image, size_t image_size, uint32_t delta) {
+  uint32_t* words = reinterpret_cast<uint32_t*>(image);
+  const size_t num_words = image_size / kRelocationGranularity;
+  for (size_t i = begin; i != end; ++i) {
+    for (uint32_t bits = bitmap[i]; bits != 0u; bits &= bits - 1u) {
+      const size_t index = i * BitSizeOf<uint32_t>() + CTZ(bits);
+      if (index >= num_words) {
+        return false;
+      }
+      words[index] += delta;
+    }
+  }
+  return true;
+}
+
 bool ImageHeader::IsValid() const {
   if (memcmp(magic_, kImageMagic, sizeof(kImageMagic)) != 0) {
     return false;
@@ -83,17 +126,26 @@ bool ImageHeader::IsValid() const {
   if (image_begin_ >= image_begin_ + image_size_) {
     return false;
   }
-  if (oat_file_begin_ > oat_file_end_) {
-    return false;
-  }
-  if (oat_data_begin_ > oat_data_end_) {
-    return false;
-  }
-  if (oat_file_begin_ >= oat_data_begin_) {
-    return false;
-  }
-  if (image_roots_ <= image_begin_ || oat_file_begin_ <= image_roots_) {
-    return false;
+  if (IsAppImage()) {
+    if (image_roots_ <= image_begin_ || image_begin_ + image_size_ <= image_roots_) {
+      return false;
+    }
+    if (boot_image_begin_ < image_begin_ + image_size_) {
+      return false;
+    }
+  } else {
+    if (oat_file_begin_ > oat_file_end_) {
+      return false;
+    }
+    if (oat_data_begin_ > oat_data_end_) {
+      return false;
+    }
+    if (oat_file_begin_ >= oat_data_begin_) {
+      return false;
+    }
+    if (image_roots_ <= image_begin_ || oat_file_begin_ <= image_roots_) {
+      return false;
+    }
   }
   if (!IsAligned<kPageSize>(patch_delta_)) {
     return false;
@@ -34,12 +34,16 @@ class PACKED(4) ImageHeader {
               uint32_t image_size_,
               uint32_t image_bitmap_offset,
               uint32_t image_bitmap_size,
+              uint32_t relocation_bitmap_offset,
+              uint32_t relocation_bitmap_size,
               uint32_t image_roots,
               uint32_t oat_checksum,
               uint32_t oat_file_begin,
               uint32_t oat_data_begin,
               uint32_t oat_data_end,
               uint32_t oat_file_end,
+              uint32_t boot_image_begin,
+              uint32_t boot_image_size,
               bool compile_pic_);
 
   bool IsValid() const;
@@ -61,6 +65,37 @@ class PACKED(4) ImageHeader {
     return image_bitmap_size_;
   }
 
+  // The relocation bitmap has a bit for each 32-bit word of the image that holds an address
+  // within the image or its oat file, which is what has to be adjusted when the image is moved.
+  // Bit (i % 32) of the (i / 32)th word of the bitmap stands for the word at offset 4 * i. A
+  // 64-bit address is marked by its low word, image addresses always fit in 32 bits. The size
+  // is zero if the image has no relocation bitmap.
+  size_t GetRelocationBitmapOffset() const {
+    return relocation_bitmap_offset_;
+  }
+
+  size_t GetRelocationBitmapSize() const {
+    return relocation_bitmap_size_;
+  }
+
+  static constexpr size_t kRelocationGranularity = sizeof(uint32_t);
+
+  // Returns the size of the relocation bitmap of an image of image_size bytes.
+  static size_t ComputeRelocationBitmapSize(size_t image_size) {
+    return RoundUp(image_size / kRelocationGranularity, kBitsPerByte * sizeof(uint32_t)) /
+        kBitsPerByte;
+  }
+
+  // Returns whether the relocation bitmap lies after the image within a file of file_size bytes
+  // and has the size the image needs.
+  bool IsRelocationBitmapValid(size_t file_size) const;
+
+  // Adds delta to the words of image marked by the relocation bitmap words [begin, end). Returns
+  // false, leaving the words after the offending one untouched, if a marked word lies beyond the
+  // image_size bytes of the image. Disjoint ranges can be relocated in parallel.
+  static bool ApplyRelocationBitmap(const uint32_t* bitmap, size_t begin, size_t end,
+                                    uint8_t* image, size_t image_size, uint32_t delta);
+
   uint32_t GetOatChecksum() const {
     return oat_checksum_;
   }
@@ -89,6 +124,21 @@ class PACKED(4) ImageHeader {
     return patch_delta_;
   }
 
+  // An app image holds the classes of an app and refers to the boot image it was compiled
+  // against, which it is mapped right below. It has no oat file of its own, its methods are
+  // linked to the app's oat file when the image is loaded.
+  bool IsAppImage() const {
+    return boot_image_size_ != 0;
+  }
+
+  uint8_t* GetBootImageBegin() const {
+    return reinterpret_cast<uint8_t*>(boot_image_begin_);
+  }
+
+  size_t GetBootImageSize() const {
+    return boot_image_size_;
+  }
+
   size_t GetBitmapOffset() const {
     return RoundUp(image_size_, kPageSize);
   }
@@ -103,6 +153,19 @@ class PACKED(4) ImageHeader {
     return oat_filename;
   }
 
+  static std::string GetAppImageLocationFromOatLocation(const std::string& oat) {
+    std::string image_filename = oat;
+    size_t last_dot = image_filename.rfind('.');
+    size_t last_slash = image_filename.rfind('/');
+    if (last_dot == std::string::npos ||
+        (last_slash != std::string::npos && last_dot < last_slash)) {
+      image_filename += ".art";
+    } else {
+      image_filename.replace(last_dot + 1, std::string::npos, "art");
+    }
+    return image_filename;
+  }
+
   enum ImageRoot {
     kResolutionMethod,
     kImtConflictMethod,
@@ -145,6 +208,10 @@ class PACKED(4) ImageHeader {
   // Size of the image bitmap.
   uint32_t image_bitmap_size_;
 
+  // Relocation bitmap offset in the file and its size, see GetRelocationBitmapOffset().
+  uint32_t relocation_bitmap_offset_;
+  uint32_t relocation_bitmap_size_;
+
   // Checksum of the oat file we link to for load time sanity check.
   uint32_t oat_checksum_;
 
@@ -167,6 +234,10 @@ class PACKED(4) ImageHeader {
   // Absolute address of an Object[] of objects needed to reinitialize from an image.
   uint32_t image_roots_;
 
+  // Address and size of the boot image an app image refers to, both zero for a boot image.
+  uint32_t boot_image_begin_;
+  uint32_t boot_image_size_;
+
   // Boolean (0 or 1) to denote if the image was compiled with --compile-pic option
   const uint32_t compile_pic_;
 
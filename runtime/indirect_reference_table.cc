@@ -24,10 +24,13 @@
 #include "utils.h"
 #include "verify_object-inl.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 namespace art {
 
+constexpr size_t IndirectReferenceTable::kMaxTableSize;
+
 template<typename T>
 class MutatorLockedDumpable {
  public:
@@ -63,28 +66,50 @@ void IndirectReferenceTable::AbortIfNoCheckJNI() {
   }
 }
 
+// The first chunk holds a power of two entries, at least initial_count and about a page.
+static size_t FirstChunkShift(size_t initial_count) {
+  const size_t first_chunk_entries =
+      RoundUpToPowerOfTwo(std::max(initial_count, kPageSize / sizeof(IrtEntry)));
+  return CTZ(first_chunk_entries);
+}
+
 IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
                                                size_t maxCount, IndirectRefKind desiredKind)
-    : kind_(desiredKind),
+    : first_chunk_shift_(FirstChunkShift(initialCount)),
+      kind_(desiredKind),
       max_entries_(maxCount) {
   CHECK_GT(initialCount, 0U);
   CHECK_LE(initialCount, maxCount);
+  CHECK_LE(maxCount, kMaxTableSize);
   CHECK_NE(desiredKind, kHandleScopeOrInvalid);
 
-  std::string error_str;
-  const size_t table_bytes = maxCount * sizeof(IrtEntry);
-  table_mem_map_.reset(MemMap::MapAnonymous("indirect ref table", nullptr, table_bytes,
-                                            PROT_READ | PROT_WRITE, false, &error_str));
-  CHECK(table_mem_map_.get() != nullptr) << error_str;
-  CHECK_EQ(table_mem_map_->Size(), table_bytes);
-  table_ = reinterpret_cast<IrtEntry*>(table_mem_map_->Begin());
-  CHECK(table_ != nullptr);
+  std::fill_n(chunks_, kMaxChunks, nullptr);
+  EnsureChunk(0u);
   segment_state_.all = IRT_FIRST_SEGMENT;
 }
 
 IndirectReferenceTable::~IndirectReferenceTable() {
 }
 
+void IndirectReferenceTable::EnsureChunk(size_t index) {
+  const size_t chunk_index = ChunkIndex(index);
+  DCHECK_LT(chunk_index, kMaxChunks);
+  if (LIKELY(chunks_[chunk_index] != nullptr)) {
+    return;
+  }
+  // Chunk 0 and chunk 1 have the same size, every further chunk doubles the table.
+  const size_t chunk_entries =
+      size_t(1u) << (first_chunk_shift_ + (chunk_index == 0u ? 0u : chunk_index - 1u));
+  const size_t chunk_bytes = chunk_entries * sizeof(IrtEntry);
+  std::string error_str;
+  chunk_mem_maps_[chunk_index].reset(MemMap::MapAnonymous("indirect ref table", nullptr,
+                                                          chunk_bytes, PROT_READ | PROT_WRITE,
+                                                          false, &error_str));
+  CHECK(chunk_mem_maps_[chunk_index].get() != nullptr) << error_str;
+  CHECK_EQ(chunk_mem_maps_[chunk_index]->Size(), chunk_bytes);
+  chunks_[chunk_index] = reinterpret_cast<IrtEntry*>(chunk_mem_maps_[chunk_index]->Begin());
+}
+
 IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
   IRTSegmentState prevState;
   prevState.all = cookie;
@@ -92,7 +117,6 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
 
   CHECK(obj != NULL);
   VerifyObject(obj);
-  DCHECK(table_ != NULL);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
   if (topIndex == max_entries_) {
@@ -102,29 +126,34 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
   }
 
   // We know there's enough room in the table.  Now we just need to find
-  // the right spot.  If there's a hole, find it and fill it; otherwise,
-  // add to the end of the list.
+  // the right spot.  If there's a hole, take it from the free list and fill
+  // it; otherwise, add to the end of the list.
   IndirectRef result;
   int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
+  const size_t bottomIndex = prevState.parts.topIndex;
   size_t index;
   if (numHoles > 0) {
     DCHECK_GT(topIndex, 1U);
-    // Find the first hole; likely to be near the end of the list.
-    IrtEntry* pScan = &table_[topIndex - 1];
-    DCHECK(!pScan->GetReference()->IsNull());
-    --pScan;
-    while (!pScan->GetReference()->IsNull()) {
-      DCHECK_GE(pScan, table_ + prevState.parts.topIndex);
-      --pScan;
-    }
-    index = pScan - table_;
+    // Holes of the current segment were added to the free list after the holes of the segments
+    // below it. Stale indices of holes that were consumed by removing the top entry or popped
+    // with their segment may come first, they no longer refer to a hole of this segment.
+    do {
+      DCHECK(!free_list_.empty());
+      index = free_list_.back();
+      free_list_.pop_back();
+    } while (index < bottomIndex || index >= topIndex ||
+             !EntryAt(index)->GetReference()->IsNull());
     segment_state_.parts.numHoles--;
   } else {
-    // Add to the end.
+    // Add to the end. Any indices of the current segment on the free list are stale.
+    while (!free_list_.empty() && free_list_.back() >= bottomIndex) {
+      free_list_.pop_back();
+    }
     index = topIndex++;
+    EnsureChunk(index);
     segment_state_.parts.topIndex = topIndex;
   }
-  table_[index].Add(obj);
+  EntryAt(index)->Add(obj);
   result = ToIndirectRef(index);
   if ((false)) {
     LOG(INFO) << "+++ added at " << ExtractIndex(result) << " top=" << segment_state_.parts.topIndex
@@ -137,7 +166,7 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
 
 void IndirectReferenceTable::AssertEmpty() {
   for (size_t i = 0; i < Capacity(); ++i) {
-    if (!table_[i].GetReference()->IsNull()) {
+    if (!EntryAt(i)->GetReference()->IsNull()) {
       ScopedObjectAccess soa(Thread::Current());
       LOG(FATAL) << "Internal Error: non-empty local reference table\n"
                  << MutatorLockedDumpable<IndirectReferenceTable>(*this);
@@ -159,7 +188,6 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
   int topIndex = segment_state_.parts.topIndex;
   int bottomIndex = prevState.parts.topIndex;
 
-  DCHECK(table_ != NULL);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
   if (GetIndirectRefKind(iref) == kHandleScopeOrInvalid &&
@@ -188,16 +216,16 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
       return false;
     }
 
-    *table_[idx].GetReference() = GcRoot<mirror::Object>(nullptr);
+    *EntryAt(idx)->GetReference() = GcRoot<mirror::Object>(nullptr);
     int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
     if (numHoles != 0) {
       while (--topIndex > bottomIndex && numHoles != 0) {
         if ((false)) {
           LOG(INFO) << "+++ checking for hole at " << topIndex - 1
                     << " (cookie=" << cookie << ") val="
-                    << table_[topIndex - 1].GetReference()->Read<kWithoutReadBarrier>();
+                    << EntryAt(topIndex - 1)->GetReference()->Read<kWithoutReadBarrier>();
         }
-        if (!table_[topIndex - 1].GetReference()->IsNull()) {
+        if (!EntryAt(topIndex - 1)->GetReference()->IsNull()) {
           break;
         }
         if ((false)) {
@@ -207,6 +235,10 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
       }
       segment_state_.parts.numHoles = numHoles + prevState.parts.numHoles;
       segment_state_.parts.topIndex = topIndex;
+      // Drop the holes just eaten, they were usually the last ones added to the free list.
+      while (!free_list_.empty() && free_list_.back() >= static_cast<size_t>(topIndex)) {
+        free_list_.pop_back();
+      }
     } else {
       segment_state_.parts.topIndex = topIndex-1;
       if ((false)) {
@@ -217,7 +249,7 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
     // Not the top-most entry.  This creates a hole.  We NULL out the
     // entry to prevent somebody from deleting it twice and screwing up
     // the hole count.
-    if (table_[idx].GetReference()->IsNull()) {
+    if (EntryAt(idx)->GetReference()->IsNull()) {
       LOG(INFO) << "--- WEIRD: removing null entry " << idx;
       return false;
     }
@@ -225,8 +257,9 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
       return false;
     }
 
-    *table_[idx].GetReference() = GcRoot<mirror::Object>(nullptr);
+    *EntryAt(idx)->GetReference() = GcRoot<mirror::Object>(nullptr);
     segment_state_.parts.numHoles++;
+    free_list_.push_back(static_cast<uint16_t>(idx));
     if ((false)) {
       LOG(INFO) << "+++ left hole at " << idx << ", holes=" << segment_state_.parts.numHoles;
     }
@@ -236,10 +269,20 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
 }
 
 void IndirectReferenceTable::Trim() {
+  // Chunks stay mapped once the table has grown into them, as references may be read without
+  // holding a lock.
   const size_t top_index = Capacity();
-  auto* release_start = AlignUp(reinterpret_cast<uint8_t*>(&table_[top_index]), kPageSize);
-  uint8_t* release_end = table_mem_map_->End();
-  madvise(release_start, release_end - release_start, MADV_DONTNEED);
+  const size_t top_chunk_index = ChunkIndex(top_index);
+  for (size_t i = top_chunk_index; i != kMaxChunks && chunks_[i] != nullptr; ++i) {
+    MemMap* chunk_mem_map = chunk_mem_maps_[i].get();
+    uint8_t* release_start = chunk_mem_map->Begin();
+    if (i == top_chunk_index) {
+      const size_t chunk_begin = (i == 0u) ? 0u : size_t(1u) << (first_chunk_shift_ + i - 1u);
+      release_start = AlignUp(reinterpret_cast<uint8_t*>(chunks_[i] + (top_index - chunk_begin)),
+                              kPageSize);
+    }
+    madvise(release_start, chunk_mem_map->End() - release_start, MADV_DONTNEED);
+  }
 }
 
 void IndirectReferenceTable::VisitRoots(RootCallback* callback, void* arg, uint32_t tid,
@@ -259,11 +302,11 @@ void IndirectReferenceTable::Dump(std::ostream& os) const {
   os << kind_ << " table dump:\n";
   ReferenceTable::Table entries;
   for (size_t i = 0; i < Capacity(); ++i) {
-    mirror::Object* obj = table_[i].GetReference()->Read<kWithoutReadBarrier>();
+    mirror::Object* obj = EntryAt(i)->GetReference()->Read<kWithoutReadBarrier>();
     if (UNLIKELY(obj == nullptr)) {
       // Remove NULLs.
     } else {
-      obj = table_[i].GetReference()->Read();
+      obj = EntryAt(i)->GetReference()->Read();
       entries.push_back(GcRoot<mirror::Object>(obj));
     }
   }
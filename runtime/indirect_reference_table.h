@@ -20,7 +20,9 @@
 #include <stdint.h>
 
 #include <iosfwd>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/mutex.h"
@@ -28,6 +30,7 @@
 #include "object_callbacks.h"
 #include "offsets.h"
 #include "read_barrier_option.h"
+#include "utils.h"
 
 namespace art {
 
@@ -75,7 +78,8 @@ class MemMap;
  * requirements (e.g. EnsureLocalCapacity).
  *
  * To make everything fit nicely in 32-bit integers, the maximum size of
- * the table is capped at 64K.
+ * the table is capped at 64K.  Memory for the entries is mapped in chunks
+ * as the table grows, so a large maximum costs nothing until it is used.
  *
  * Only SynchronizedGet is synchronized.
  */
@@ -136,14 +140,18 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  * most-recently-added entry).  For JNI local references, the common
  * operations are adding a new entry and removing an entire table segment.
  *
- * If "alloc_entries_" is not equal to "max_entries_", the table may expand
- * when entries are added, which means the memory may move.  If you want
- * to keep pointers into "table" rather than offsets, you must use a
- * fixed-size table.
+ * The entries live in chunks that are mapped when the table first grows
+ * into them and never move afterwards.  The first chunk holds a power of
+ * two number of entries and every further chunk doubles the size of the
+ * table, so an index is mapped to its chunk with a count of leading zeros.
  *
  * If we delete entries from the middle of the list, we will be left with
  * "holes".  We track the number of holes so that, when adding new elements,
- * we can quickly decide to do a trivial append or go slot-hunting.
+ * we can quickly decide to do a trivial append or reuse a hole.  The holes
+ * are kept on a free list, most recent first, so that they are reused
+ * without scanning the table.  Holes that disappear without being reused,
+ * because the top entry was removed or their segment was popped, are left
+ * on the list and skipped when they come up.
  *
  * When the top-most entry is removed, any holes immediately below it are
  * also removed.  Thus, deletion of an entry may reduce "topIndex" by more
@@ -173,11 +181,6 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  * stale references aren't possible (though we may be able to get similar
  * benefits with other approaches).
  *
- * TODO: consider a "lastDeleteIndex" for quick hole-filling when an
- * add immediately follows a delete; must invalidate after segment pop
- * (which could increase the cost/complexity of method call/return).
- * Might be worth only using it for JNI globals.
- *
  * TODO: may want completely different add/remove algorithms for global
  * and local refs to improve performance.  A large circular buffer might
  * reduce the amortized cost of adding global references.
@@ -217,9 +220,11 @@ class PACKED(4) IrtEntry {
   GcRoot<mirror::Object> references_[kIRTPrevCount];
 };
 
+class IndirectReferenceTable;
+
 class IrtIterator {
  public:
-  explicit IrtIterator(IrtEntry* table, size_t i, size_t capacity)
+  explicit IrtIterator(IndirectReferenceTable* table, size_t i, size_t capacity)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
       : table_(table), i_(i), capacity_(capacity) {
   }
@@ -229,17 +234,14 @@ class IrtIterator {
     return *this;
   }
 
-  mirror::Object** operator*() {
-    // This does not have a read barrier as this is used to visit roots.
-    return table_[i_].GetReference()->AddressWithoutBarrier();
-  }
+  mirror::Object** operator*();
 
   bool equals(const IrtIterator& rhs) const {
     return (i_ == rhs.i_ && table_ == rhs.table_);
   }
 
  private:
-  IrtEntry* const table_;
+  IndirectReferenceTable* const table_;
   size_t i_;
   const size_t capacity_;
 };
@@ -254,6 +256,9 @@ bool inline operator!=(const IrtIterator& lhs, const IrtIterator& rhs) {
 
 class IndirectReferenceTable {
  public:
+  // The largest table the indirect reference and segment state encodings allow.
+  static constexpr size_t kMaxTableSize = 0xffff;
+
   IndirectReferenceTable(size_t initialCount, size_t maxCount, IndirectRefKind kind);
 
   ~IndirectReferenceTable();
@@ -309,11 +314,11 @@ class IndirectReferenceTable {
 
   // Note IrtIterator does not have a read barrier as it's used to visit roots.
   IrtIterator begin() {
-    return IrtIterator(table_, 0, Capacity());
+    return IrtIterator(this, 0, Capacity());
   }
 
   IrtIterator end() {
-    return IrtIterator(table_, Capacity(), Capacity());
+    return IrtIterator(this, Capacity(), Capacity());
   }
 
   void VisitRoots(RootCallback* callback, void* arg, uint32_t tid, RootType root_type)
@@ -335,6 +340,34 @@ class IndirectReferenceTable {
   void Trim() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
+  friend class IrtIterator;
+
+  // Enough chunks to cover kMaxTableSize entries even if the first chunk holds a single entry.
+  static constexpr size_t kMaxChunks = 17;
+
+  // Chunk 0 holds the first 1 << first_chunk_shift_ entries and chunk n > 0 holds the entries
+  // whose highest bit is first_chunk_shift_ + n - 1.
+  size_t ChunkIndex(size_t index) const {
+    if (index < (1u << first_chunk_shift_)) {
+      return 0u;
+    }
+    return 31 - CLZ(static_cast<uint32_t>(index)) - first_chunk_shift_ + 1;
+  }
+
+  IrtEntry* EntryAt(size_t index) const {
+    DCHECK_LT(index, max_entries_);
+    if (LIKELY(index < (1u << first_chunk_shift_))) {
+      return &chunks_[0][index];
+    }
+    const size_t highest_bit = 31 - CLZ(static_cast<uint32_t>(index));
+    IrtEntry* chunk = chunks_[highest_bit - first_chunk_shift_ + 1];
+    DCHECK(chunk != nullptr);
+    return &chunk[index - (1u << highest_bit)];
+  }
+
+  // Map the chunk holding index if the table hasn't grown into it yet.
+  void EnsureChunk(size_t index);
+
   // Extract the table index from an indirect reference.
   static uint32_t ExtractIndex(IndirectRef iref) {
     uintptr_t uref = reinterpret_cast<uintptr_t>(iref);
@@ -347,7 +380,7 @@ class IndirectReferenceTable {
    */
   IndirectRef ToIndirectRef(uint32_t tableIndex) const {
     DCHECK_LT(tableIndex, 65536U);
-    uint32_t serialChunk = table_[tableIndex].GetSerial();
+    uint32_t serialChunk = EntryAt(tableIndex)->GetSerial();
     uintptr_t uref = (serialChunk << 20) | (tableIndex << 2) | kind_;
     return reinterpret_cast<IndirectRef>(uref);
   }
@@ -362,17 +395,26 @@ class IndirectReferenceTable {
   /* semi-public - read/write by jni down calls */
   IRTSegmentState segment_state_;
 
-  // Mem map where we store the indirect refs.
-  std::unique_ptr<MemMap> table_mem_map_;
-  // bottom of the stack. Do not directly access the object references
-  // in this as they are roots. Use Get() that has a read barrier.
-  IrtEntry* table_;
+  // Mem maps of the chunks where we store the indirect refs, mapped as the table grows.
+  std::unique_ptr<MemMap> chunk_mem_maps_[kMaxChunks];
+  // The entries of the chunks, nullptr if not mapped yet. Do not directly access the object
+  // references in these as they are roots. Use Get() that has a read barrier.
+  IrtEntry* chunks_[kMaxChunks];
+  // The first chunk holds 1 << first_chunk_shift_ entries.
+  const size_t first_chunk_shift_;
+  // Indices of holes, the most recent last. May hold stale indices, see Add.
+  std::vector<uint16_t> free_list_;
   /* bit mask, ORed into all irefs */
   const IndirectRefKind kind_;
   /* max #of entries allowed */
   const size_t max_entries_;
 };
 
+inline mirror::Object** IrtIterator::operator*() {
+  // This does not have a read barrier as this is used to visit roots.
+  return table_->EntryAt(i_)->GetReference()->AddressWithoutBarrier();
+}
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_INDIRECT_REFERENCE_TABLE_H_
@@ -250,4 +250,75 @@ TEST_F(IndirectReferenceTableTest, BasicTest) {
   CheckDump(&irt, 0, 0);
 }
 
+TEST_F(IndirectReferenceTableTest, GrowsAndReusesHoles) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 1;
+  static const size_t kNumRefs = 3000;
+  IndirectReferenceTable irt(kTableInitial, IndirectReferenceTable::kMaxTableSize, kLocal);
+
+  mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(c != nullptr);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != nullptr);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != nullptr);
+
+  const uint32_t cookie = IRT_FIRST_SEGMENT;
+
+  // Grow well past the first chunk, references in earlier chunks must stay valid.
+  std::vector<IndirectRef> irefs;
+  for (size_t i = 0; i < kNumRefs; ++i) {
+    IndirectRef iref = irt.Add(cookie, (i % 2 == 0) ? obj0 : obj1);
+    ASSERT_TRUE(iref != nullptr) << "Failed adding " << i;
+    irefs.push_back(iref);
+  }
+  ASSERT_EQ(kNumRefs, irt.Capacity());
+  for (size_t i = 0; i < kNumRefs; ++i) {
+    EXPECT_EQ((i % 2 == 0) ? obj0 : obj1, irt.Get(irefs[i])) << i;
+  }
+
+  // Punch holes into every chunk and fill them again without growing the table.
+  for (size_t i = 0; i < kNumRefs - 1; i += 2) {
+    ASSERT_TRUE(irt.Remove(cookie, irefs[i])) << "Failed removing " << i;
+  }
+  ASSERT_EQ(kNumRefs, irt.Capacity());
+  for (size_t i = 0; i < kNumRefs - 1; i += 2) {
+    irefs[i] = irt.Add(cookie, obj1);
+    ASSERT_TRUE(irefs[i] != nullptr) << "Failed adding " << i;
+  }
+  ASSERT_EQ(kNumRefs, irt.Capacity()) << "holes not filled";
+  CheckDump(&irt, kNumRefs, 1);
+
+  // Holes below a new segment are not used by it, and are reused once it is popped.
+  ASSERT_TRUE(irt.Remove(cookie, irefs[10]));
+  ASSERT_TRUE(irt.Remove(cookie, irefs[20]));
+  const uint32_t segment_cookie = irt.GetSegmentState();
+  IndirectRef segment_iref0 = irt.Add(segment_cookie, obj0);
+  ASSERT_TRUE(segment_iref0 != nullptr);
+  IndirectRef segment_iref1 = irt.Add(segment_cookie, obj0);
+  ASSERT_TRUE(segment_iref1 != nullptr);
+  ASSERT_EQ(kNumRefs + 2, irt.Capacity());
+  // A hole in the segment, then one eaten by removing the top entry.
+  ASSERT_TRUE(irt.Remove(segment_cookie, segment_iref0));
+  ASSERT_TRUE(irt.Remove(segment_cookie, segment_iref1));
+  ASSERT_EQ(kNumRefs, irt.Capacity());
+  segment_iref0 = irt.Add(segment_cookie, obj0);
+  ASSERT_TRUE(segment_iref0 != nullptr);
+  ASSERT_EQ(kNumRefs + 1, irt.Capacity());
+  irt.SetSegmentState(segment_cookie);
+  ASSERT_EQ(kNumRefs, irt.Capacity());
+  irefs[10] = irt.Add(cookie, obj1);
+  ASSERT_TRUE(irefs[10] != nullptr);
+  irefs[20] = irt.Add(cookie, obj1);
+  ASSERT_TRUE(irefs[20] != nullptr);
+  ASSERT_EQ(kNumRefs, irt.Capacity()) << "holes below the popped segment not filled";
+  CheckDump(&irt, kNumRefs, 1);
+
+  for (size_t i = kNumRefs; i != 0; --i) {
+    ASSERT_TRUE(irt.Remove(cookie, irefs[i - 1])) << "Failed removing " << (i - 1);
+  }
+  ASSERT_EQ(0U, irt.Capacity());
+  CheckDump(&irt, 0, 0);
+}
+
 }  // namespace art
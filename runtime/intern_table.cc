@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "gc/space/image_space.h"
+#include "lookup_cache.h"
 #include "mirror/dex_cache.h"
 #include "mirror/object_array-inl.h"
 #include "mirror/object-inl.h"
@@ -119,6 +120,8 @@ mirror::String* InternTable::InsertWeak(mirror::String* s) {
 
 void InternTable::RemoveStrong(mirror::String* s) {
   strong_interns_.Remove(s);
+  // The string may be cached by threads that interned it.
+  LookupCache::InvalidateAll();
 }
 
 void InternTable::RemoveWeak(mirror::String* s) {
@@ -249,13 +252,30 @@ mirror::String* InternTable::Insert(mirror::String* s, bool is_strong) {
 
 mirror::String* InternTable::InternStrong(int32_t utf16_length, const char* utf8_data) {
   DCHECK(utf8_data != nullptr);
-  return InternStrong(mirror::String::AllocFromModifiedUtf8(
-      Thread::Current(), utf16_length, utf8_data));
+  Thread* self = Thread::Current();
+  // Strong interns are never freed, so a string this thread interned before can be returned
+  // without allocating a new one or taking the intern table lock.
+  LookupCache* cache = self->GetInternLookupCache();
+  uint32_t cache_epoch = LookupCache::CurrentEpoch();
+  const size_t hash = ComputeModifiedUtf8Hash(utf8_data);
+  mirror::Object* cached = cache->Lookup(hash, nullptr);
+  if (cached != nullptr) {
+    mirror::String* cached_string = cached->AsString();
+    if (cached_string->GetLength() == utf16_length && cached_string->Equals(utf8_data)) {
+      return cached_string;
+    }
+  }
+  mirror::String* s = InternStrong(mirror::String::AllocFromModifiedUtf8(
+      self, utf16_length, utf8_data));
+  if (s != nullptr) {
+    cache->Add(hash, nullptr, s, cache_epoch);
+  }
+  return s;
 }
 
 mirror::String* InternTable::InternStrong(const char* utf8_data) {
   DCHECK(utf8_data != nullptr);
-  return InternStrong(mirror::String::AllocFromModifiedUtf8(Thread::Current(), utf8_data));
+  return InternStrong(CountModifiedUtf8Chars(utf8_data), utf8_data);
 }
 
 mirror::String* InternTable::InternStrong(mirror::String* s) {
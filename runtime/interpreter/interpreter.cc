@@ -134,6 +134,10 @@ static void InterpreterJni(Thread* self, ArtMethod* method, const StringPiece& s
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   // TODO: The following enters JNI code using a typedef-ed function rather than the JNI compiler,
   //       it should be removed and JNI compiled stubs used instead.
+  if (UNLIKELY(method->IsCriticalNative())) {
+    // The typedefs below all pass the JNIEnv* and jclass.
+    LOG(FATAL) << "Cannot interpret critical native method " << PrettyMethod(method);
+  }
   ScopedObjectAccessUnchecked soa(self);
   if (method->IsStatic()) {
     if (shorty == "L") {
@@ -18,10 +18,14 @@
 
 #include <dlfcn.h>
 
+#include <algorithm>
+
 #include "base/dumpable.h"
 #include "base/mutex.h"
 #include "base/stl_util.h"
+#include "base/unix_file/fd_file.h"
 #include "check_jni.h"
+#include "elf_file.h"
 #include "fault_handler.h"
 #include "indirect_reference_table-inl.h"
 #include "mirror/art_method.h"
@@ -29,12 +33,14 @@
 #include "mirror/class_loader.h"
 #include "nativebridge/native_bridge.h"
 #include "java_vm_ext.h"
+#include "os.h"
 #include "parsed_options.h"
 #include "runtime-inl.h"
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "utf.h"
 
 namespace art {
 
@@ -56,6 +62,8 @@ class SharedLibrary {
       : path_(path),
         handle_(handle),
         needs_native_bridge_(false),
+        symbol_index_state_(kSymbolIndexNotBuilt),
+        symbol_index_time_ns_(0u),
         class_loader_(env->NewGlobalRef(class_loader)),
         jni_on_load_lock_("JNI_OnLoad lock"),
         jni_on_load_cond_("JNI_OnLoad condition variable", jni_on_load_lock_),
@@ -131,6 +139,36 @@ class SharedLibrary {
     return dlsym(handle_, symbol_name.c_str());
   }
 
+  // Look up a JNI function in the symbol index, building it on first use. Returns nullptr if the
+  // library itself doesn't define the function, or if it has no index, in which case
+  // *has_index is set to false and the function may only be found with dlsym.
+  void* FindIndexedSymbol(const std::string& symbol_name, bool* has_index)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    if (symbol_index_state_ == kSymbolIndexNotBuilt) {
+      BuildSymbolIndex();
+    }
+    *has_index = (symbol_index_state_ == kSymbolIndexBuilt);
+    if (!*has_index) {
+      return nullptr;
+    }
+    uint32_t hash = static_cast<uint32_t>(ComputeModifiedUtf8Hash(symbol_name.c_str()));
+    if (!std::binary_search(jni_symbol_hashes_.begin(), jni_symbol_hashes_.end(), hash)) {
+      return nullptr;
+    }
+    // A hash collision with another JNI function of the library makes dlsym search its
+    // dependencies, as the fallback would.
+    return FindSymbol(symbol_name);
+  }
+
+  bool HasSymbolIndex() const EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    return symbol_index_state_ == kSymbolIndexBuilt;
+  }
+
+  // Returns the time spent building the symbol index.
+  uint64_t GetSymbolIndexTime() const EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    return symbol_index_time_ns_;
+  }
+
   void* FindSymbolWithNativeBridge(const std::string& symbol_name, const char* shorty) {
     CHECK(NeedsNativeBridge());
 
@@ -145,6 +183,44 @@ class SharedLibrary {
     kOkay,
   };
 
+  // Index the JNI functions the library defines with a single scan of its .dynsym. This is done
+  // on the first lookup rather than when the library is loaded, as libraries that register all
+  // of their natives in JNI_OnLoad never need it. The scan maps the file and touches little more
+  // than .dynsym and .dynstr. Libraries that can't be read as ELF files, such as those loaded
+  // directly from an apk, and native bridge libraries are only searched with dlsym.
+  void BuildSymbolIndex() EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    const uint64_t start_ns = NanoTime();
+    symbol_index_state_ = kSymbolIndexUnavailable;
+    if (NeedsNativeBridge()) {
+      return;
+    }
+    // An empty path is the main program, as for dlopen.
+    const char* file_path = path_.empty() ? "/proc/self/exe" : path_.c_str();
+    std::unique_ptr<File> file(OS::OpenFileForReading(file_path));
+    if (file.get() == nullptr) {
+      return;
+    }
+    std::string error_msg;
+    std::unique_ptr<ElfFile> elf_file(ElfFile::Open(file.get(), false, false, &error_msg));
+    if (elf_file.get() == nullptr) {
+      VLOG(jni) << "[Not indexing symbols of \"" << path_ << "\": " << error_msg << "]";
+      return;
+    }
+    std::vector<const char*> names;
+    if (!elf_file->FindDefinedDynamicFunctionNames("Java_", &names)) {
+      return;
+    }
+    jni_symbol_hashes_.reserve(names.size());
+    for (const char* name : names) {
+      jni_symbol_hashes_.push_back(static_cast<uint32_t>(ComputeModifiedUtf8Hash(name)));
+    }
+    std::sort(jni_symbol_hashes_.begin(), jni_symbol_hashes_.end());
+    symbol_index_state_ = kSymbolIndexBuilt;
+    symbol_index_time_ns_ = NanoTime() - start_ns;
+    VLOG(jni) << "[Indexed " << jni_symbol_hashes_.size() << " JNI functions of \"" << path_
+              << "\" in " << PrettyDuration(symbol_index_time_ns_) << "]";
+  }
+
   // Path to library "/system/lib/libjni.so".
   const std::string path_;
 
@@ -154,6 +230,19 @@ class SharedLibrary {
   // True if a native bridge is required.
   bool needs_native_bridge_;
 
+  enum SymbolIndexState {
+    kSymbolIndexNotBuilt,
+    kSymbolIndexBuilt,
+    kSymbolIndexUnavailable,
+  };
+  SymbolIndexState symbol_index_state_ GUARDED_BY(Locks::jni_libraries_lock_);
+
+  // The sorted hashes of the names of the JNI functions defined by the library.
+  std::vector<uint32_t> jni_symbol_hashes_ GUARDED_BY(Locks::jni_libraries_lock_);
+
+  // Time spent building the index.
+  uint64_t symbol_index_time_ns_ GUARDED_BY(Locks::jni_libraries_lock_);
+
   // The ClassLoader this library is associated with, a global JNI reference that is
   // created/deleted with the scope of the library.
   const jobject class_loader_;
@@ -171,7 +260,11 @@ class SharedLibrary {
 // This exists mainly to keep implementation details out of the header file.
 class Libraries {
  public:
-  Libraries() {
+  Libraries()
+      : num_resolved_methods_(0u),
+        num_indexed_methods_(0u),
+        num_searched_methods_(0u),
+        resolution_time_ns_(0u) {
   }
 
   ~Libraries() {
@@ -202,14 +295,72 @@ class Libraries {
     libraries_.Put(path, library);
   }
 
-  // See section 11.3 "Linking Native Methods" of the JNI spec.
+  size_t GetIndexedMethodCount() const EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    return num_indexed_methods_;
+  }
+
+  size_t GetSearchedMethodCount() const EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    return num_searched_methods_;
+  }
+
+  void DumpResolutionStats(std::ostream& os) const
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_) {
+    size_t num_indexes = 0u;
+    uint64_t symbol_index_time_ns = 0u;
+    for (const auto& lib : libraries_) {
+      if (lib.second->HasSymbolIndex()) {
+        ++num_indexes;
+        symbol_index_time_ns += lib.second->GetSymbolIndexTime();
+      }
+    }
+    os << "Native methods: " << num_resolved_methods_ << " resolved in "
+       << PrettyDuration(resolution_time_ns_) << ", " << num_indexed_methods_
+       << " from symbol indexes, " << num_searched_methods_ << " searched with dlsym; "
+       << num_indexes << " symbol indexes built in " << PrettyDuration(symbol_index_time_ns)
+       << "\n";
+  }
+
   void* FindNativeMethod(mirror::ArtMethod* m, std::string& detail)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    const uint64_t start_ns = NanoTime();
+    void* fn = FindNativeMethodImpl(m, detail);
+    resolution_time_ns_ += NanoTime() - start_ns;
+    if (fn != nullptr) {
+      ++num_resolved_methods_;
+    }
+    return fn;
+  }
+
+ private:
+  // See section 11.3 "Linking Native Methods" of the JNI spec.
+  void* FindNativeMethodImpl(mirror::ArtMethod* m, std::string& detail)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::jni_libraries_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     std::string jni_short_name(JniShortName(m));
     std::string jni_long_name(JniLongName(m));
     const mirror::ClassLoader* declaring_class_loader = m->GetDeclaringClass()->GetClassLoader();
     ScopedObjectAccessUnchecked soa(Thread::Current());
+    // Try the symbol indexes first, they answer misses without dlsym.
+    for (const auto& lib : libraries_) {
+      SharedLibrary* library = lib.second;
+      if (soa.Decode<mirror::ClassLoader*>(library->GetClassLoader()) != declaring_class_loader) {
+        continue;
+      }
+      bool has_index;
+      void* fn = library->FindIndexedSymbol(jni_short_name, &has_index);
+      if (fn == nullptr && has_index) {
+        fn = library->FindIndexedSymbol(jni_long_name, &has_index);
+      }
+      if (fn != nullptr) {
+        VLOG(jni) << "[Found native code for " << PrettyMethod(m)
+                  << " in the symbol index of \"" << library->GetPath() << "\"]";
+        ++num_indexed_methods_;
+        return fn;
+      }
+    }
+    // Fall back to dlsym, which also finds functions defined by the libraries' dependencies.
+    ++num_searched_methods_;
     for (const auto& lib : libraries_) {
       SharedLibrary* library = lib.second;
       if (soa.Decode<mirror::ClassLoader*>(library->GetClassLoader()) != declaring_class_loader) {
@@ -246,8 +397,13 @@ class Libraries {
     return nullptr;
   }
 
- private:
   AllocationTrackingSafeMap<std::string, SharedLibrary*, kAllocatorTagJNILibraries> libraries_;
+
+  // Native method resolution statistics, dumped on SIGQUIT.
+  size_t num_resolved_methods_ GUARDED_BY(Locks::jni_libraries_lock_);
+  size_t num_indexed_methods_ GUARDED_BY(Locks::jni_libraries_lock_);
+  size_t num_searched_methods_ GUARDED_BY(Locks::jni_libraries_lock_);
+  uint64_t resolution_time_ns_ GUARDED_BY(Locks::jni_libraries_lock_);
 };
 
 
@@ -534,6 +690,7 @@ void JavaVMExt::DumpForSigQuit(std::ostream& os) {
   {
     MutexLock mu(self, *Locks::jni_libraries_lock_);
     os << "Libraries: " << Dumpable<Libraries>(*libraries_) << " (" << libraries_->size() << ")\n";
+    libraries_->DumpResolutionStats(os);
   }
 }
 
@@ -738,6 +895,16 @@ void* JavaVMExt::FindCodeForNativeMethod(mirror::ArtMethod* m) {
   return native_method;
 }
 
+size_t JavaVMExt::GetIndexedNativeMethodCount() {
+  MutexLock mu(Thread::Current(), *Locks::jni_libraries_lock_);
+  return libraries_->GetIndexedMethodCount();
+}
+
+size_t JavaVMExt::GetSearchedNativeMethodCount() {
+  MutexLock mu(Thread::Current(), *Locks::jni_libraries_lock_);
+  return libraries_->GetSearchedMethodCount();
+}
+
 void JavaVMExt::SweepJniWeakGlobals(IsMarkedCallback* callback, void* arg) {
   MutexLock mu(Thread::Current(), weak_globals_lock_);
   for (mirror::Object** entry : weak_globals_) {
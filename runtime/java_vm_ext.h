@@ -94,6 +94,11 @@ class JavaVMExt : public JavaVM {
   void* FindCodeForNativeMethod(mirror::ArtMethod* m)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Returns how many native methods were found in the symbol indexes of the loaded libraries,
+  // and how many had to be searched for with dlsym.
+  size_t GetIndexedNativeMethodCount() LOCKS_EXCLUDED(Locks::jni_libraries_lock_);
+  size_t GetSearchedNativeMethodCount() LOCKS_EXCLUDED(Locks::jni_libraries_lock_);
+
   void DumpForSigQuit(std::ostream& os)
       LOCKS_EXCLUDED(Locks::jni_libraries_lock_, globals_lock_, weak_globals_lock_);
 
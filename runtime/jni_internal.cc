@@ -19,6 +19,7 @@
 #include <dlfcn.h>
 
 #include <cstdarg>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -62,6 +63,9 @@ namespace art {
 // things not rendering correctly. E.g. b/16858794
 static constexpr bool kWarnJniAbort = false;
 
+// RegisterNatives calls with at least this many methods look the methods up through an index.
+static constexpr jint kBulkRegistrationThreshold = 8;
+
 // Section 12.3.2 of the JNI spec describes JNI class descriptors. They're
 // separated with slashes but aren't wrapped with "L;" like regular descriptors
 // (i.e. "a/b/C" rather than "La/b/C;"). Arrays of reference types are an
@@ -2107,6 +2111,17 @@ class JNI {
       return JNI_OK;
     }
     CHECK_NON_NULL_ARGUMENT_FN_NAME("RegisterNatives", methods, JNI_ERR);
+    // JNI_OnLoad usually registers all natives of a class at once, index the declared direct
+    // natives by name instead of searching the class hierarchy for each of them.
+    std::multimap<StringPiece, size_t> direct_natives;
+    if (method_count >= kBulkRegistrationThreshold) {
+      for (size_t i = 0; i < c->NumDirectMethods(); ++i) {
+        mirror::ArtMethod* m = c->GetDirectMethod(i);
+        if (m->IsNative()) {
+          direct_natives.emplace(m->GetName(), i);
+        }
+      }
+    }
     for (jint i = 0; i < method_count; ++i) {
       const char* name = methods[i].name;
       const char* sig = methods[i].signature;
@@ -2127,7 +2142,18 @@ class JNI {
         ++sig;
       }
 
-      mirror::ArtMethod* m = c->FindDirectMethod(name, sig);
+      mirror::ArtMethod* m = nullptr;
+      auto range = direct_natives.equal_range(name);
+      for (auto it = range.first; it != range.second; ++it) {
+        mirror::ArtMethod* candidate = c->GetDirectMethod(it->second);
+        if (candidate->GetSignature() == sig) {
+          m = candidate;
+          break;
+        }
+      }
+      if (m == nullptr) {
+        m = c->FindDirectMethod(name, sig);
+      }
       if (m == nullptr) {
         m = c->FindVirtualMethod(name, sig);
       }
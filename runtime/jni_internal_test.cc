@@ -957,6 +957,80 @@ TEST_F(JniInternalTest, RegisterAndUnregisterNatives) {
   RegisterAndUnregisterNativesBadArguments(true, &check_jni_abort_catcher);
 }
 
+// Distinct functions, so that each registration can be told apart by its entry point.
+template <int kIndex>
+static jint BulkRegisteredNative() {
+  return kIndex;
+}
+
+TEST_F(JniInternalTest, RegisterNativesInBulk) {
+  TEST_DISABLED_FOR_PORTABLE();
+  Thread::Current()->TransitionFromSuspendedToRunnable();
+  LoadDex("MyClassNatives");
+  bool started = runtime_->Start();
+  ASSERT_TRUE(started);
+
+  jclass c = env_->FindClass("MyClassNatives");
+  ASSERT_NE(c, nullptr);
+  jclass jlnsme = env_->FindClass("java/lang/NoSuchMethodError");
+
+  // Enough methods to go through the index of the class's native methods, mixing direct and
+  // virtual methods, and methods sharing a name with a method of another signature.
+  struct {
+    bool is_static;
+    JNINativeMethod native;
+  } methods[] = {
+      { false, { "bar", "(I)I", reinterpret_cast<void*>(BulkRegisteredNative<0>) } },
+      { true, { "sbar", "(I)I", reinterpret_cast<void*>(BulkRegisteredNative<1>) } },
+      { false, { "fooI", "(I)I", reinterpret_cast<void*>(BulkRegisteredNative<2>) } },
+      { false, { "fooII", "(II)I", reinterpret_cast<void*>(BulkRegisteredNative<3>) } },
+      { true, { "fooSII", "(II)I", reinterpret_cast<void*>(BulkRegisteredNative<4>) } },
+      { true, { "fooSDD", "(DD)D", reinterpret_cast<void*>(BulkRegisteredNative<5>) } },
+      { false, { "fooDD", "(DD)D", reinterpret_cast<void*>(BulkRegisteredNative<6>) } },
+      { true, { "logD", "(D)D", reinterpret_cast<void*>(BulkRegisteredNative<7>) } },
+      { true, { "logF", "(F)F", reinterpret_cast<void*>(BulkRegisteredNative<8>) } },
+      { true, { "returnInt", "()I", reinterpret_cast<void*>(BulkRegisteredNative<9>) } },
+  };
+  std::vector<JNINativeMethod> natives;
+  for (const auto& method : methods) {
+    natives.push_back(method.native);
+  }
+  ASSERT_EQ(env_->RegisterNatives(c, natives.data(), static_cast<jint>(natives.size())), JNI_OK);
+  EXPECT_FALSE(env_->ExceptionCheck());
+
+  // Check that each method is bound to the function registered for it.
+  {
+    ScopedObjectAccess soa(env_);
+    for (const auto& method : methods) {
+      jmethodID mid = method.is_static
+          ? env_->GetStaticMethodID(c, method.native.name, method.native.signature)
+          : env_->GetMethodID(c, method.native.name, method.native.signature);
+      ASSERT_NE(mid, nullptr) << method.native.name;
+      mirror::ArtMethod* m = soa.DecodeMethod(mid);
+      EXPECT_EQ(method.native.fnPtr, m->GetEntryPointFromJni()) << PrettyMethod(m);
+    }
+  }
+
+  // Check that unregistering unbinds all of them.
+  EXPECT_EQ(env_->UnregisterNatives(c), JNI_OK);
+  {
+    ScopedObjectAccess soa(env_);
+    for (const auto& method : methods) {
+      jmethodID mid = method.is_static
+          ? env_->GetStaticMethodID(c, method.native.name, method.native.signature)
+          : env_->GetMethodID(c, method.native.name, method.native.signature);
+      mirror::ArtMethod* m = soa.DecodeMethod(mid);
+      EXPECT_NE(method.native.fnPtr, m->GetEntryPointFromJni()) << PrettyMethod(m);
+    }
+  }
+
+  // Check that a signature mismatch is still reported when registering many methods at once.
+  natives.back().signature = "()J";
+  EXPECT_EQ(env_->RegisterNatives(c, natives.data(), static_cast<jint>(natives.size())), JNI_ERR);
+  ExpectException(jlnsme);
+  EXPECT_EQ(env_->UnregisterNatives(c), JNI_OK);
+}
+
 #define EXPECT_PRIMITIVE_ARRAY(new_fn, \
                                get_region_fn, \
                                set_region_fn, \
@@ -23,13 +23,22 @@
 namespace art {
 
 inline uint32_t LockWord::ThinLockOwner() const {
-  DCHECK_EQ(GetState(), kThinLocked);
+  DCHECK(GetState() == kThinLocked || GetState() == kBiased) << GetState();
   return (value_ >> kThinLockOwnerShift) & kThinLockOwnerMask;
 }
 
 inline uint32_t LockWord::ThinLockCount() const {
   DCHECK_EQ(GetState(), kThinLocked);
-  return (value_ >> kThinLockCountShift) & kThinLockCountMask;
+  uint32_t count = (value_ >> kThinLockCountShift) & kThinLockCountMask;
+  return IsBiased() ? count - 1 : count;
+}
+
+inline LockWord LockWord::RevokeBias() const {
+  DCHECK(IsBiased());
+  if (GetState() == kBiased) {
+    return LockWord();
+  }
+  return FromThinLockId(ThinLockOwner(), ThinLockCount());
 }
 
 inline Monitor* LockWord::FatLockMonitor() const {
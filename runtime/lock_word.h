@@ -34,9 +34,14 @@ class Monitor;
  * the state. The three possible states are fat locked, thin/unlocked, and hash code.
  * When the lock word is in the "thin" state and its bits are formatted as follows:
  *
- *  |33|22222222221111|1111110000000000|
- *  |10|98765432109876|5432109876543210|
- *  |00| lock count   |thread id owner |
+ *  |33|2|2222222221111|1111110000000000|
+ *  |10|9|8765432109876|5432109876543210|
+ *  |00|B| lock count  |thread id owner |
+ *
+ * A thin lock word with the B bit set is biased towards the owner thread, which locks and unlocks
+ * it with plain stores. Its lock count is the number of times the owner holds the lock, so a
+ * count of zero leaves the lock reserved for the owner without being held. Other threads must
+ * have the bias revoked, while the owner is at a checkpoint or suspended, before locking it.
  *
  * When the lock word is in the "fat" state and its bits are formatted as follows:
  *
@@ -57,8 +62,10 @@ class LockWord {
     kStateSize = 2,
     // Number of bits to encode the thin lock owner.
     kThinLockOwnerSize = 16,
+    // Number of bits to mark a thin lock as biased towards its owner.
+    kThinLockBiasSize = 1,
     // Remaining bits are the recursive lock count.
-    kThinLockCountSize = 32 - kThinLockOwnerSize - kStateSize,
+    kThinLockCountSize = 32 - kThinLockOwnerSize - kThinLockBiasSize - kStateSize,
     // Thin lock bits. Owner in lowest bits.
 
     kThinLockOwnerShift = 0,
@@ -67,10 +74,15 @@ class LockWord {
     // Count in higher bits.
     kThinLockCountShift = kThinLockOwnerSize + kThinLockOwnerShift,
     kThinLockCountMask = (1 << kThinLockCountSize) - 1,
-    kThinLockMaxCount = kThinLockCountMask,
+    // Leave room for the extra count of a biased lock word.
+    kThinLockMaxCount = kThinLockCountMask - 1,
+    // Bias bit above the count, the fast paths detect count overflow by it changing.
+    kThinLockBiasShift = kThinLockCountSize + kThinLockCountShift,
+    kThinLockBiasMask = (1 << kThinLockBiasSize) - 1,
+    kThinLockBiasMaskShifted = kThinLockBiasMask << kThinLockBiasShift,
 
     // State in the highest bits.
-    kStateShift = kThinLockCountSize + kThinLockCountShift,
+    kStateShift = kThinLockBiasSize + kThinLockBiasShift,
     kStateMask = (1 << kStateSize) - 1,
     kStateThinOrUnlocked = 0,
     kStateFat = 1,
@@ -85,13 +97,25 @@ class LockWord {
     kMaxMonitorId = kMaxHash
   };
 
-  static LockWord FromThinLockId(uint32_t thread_id, uint32_t count) {
+  static LockWord FromThinLockId(uint32_t thread_id, uint32_t count, bool biased = false) {
     CHECK_LE(thread_id, static_cast<uint32_t>(kThinLockMaxOwner));
     CHECK_LE(count, static_cast<uint32_t>(kThinLockMaxCount));
+    if (biased) {
+      // A biased lock word counts the times the lock is held rather than the recursion depth.
+      return LockWord((thread_id << kThinLockOwnerShift) | ((count + 1) << kThinLockCountShift) |
+                      kThinLockBiasMaskShifted | (kStateThinOrUnlocked << kStateShift));
+    }
     return LockWord((thread_id << kThinLockOwnerShift) | (count << kThinLockCountShift) |
                      (kStateThinOrUnlocked << kStateShift));
   }
 
+  // A lock word reserved for thread_id, which isn't holding the lock.
+  static LockWord FromBiasedThreadId(uint32_t thread_id) {
+    CHECK_LE(thread_id, static_cast<uint32_t>(kThinLockMaxOwner));
+    return LockWord((thread_id << kThinLockOwnerShift) | kThinLockBiasMaskShifted |
+                    (kStateThinOrUnlocked << kStateShift));
+  }
+
   static LockWord FromForwardingAddress(size_t target) {
     DCHECK(IsAligned < 1 << kStateSize>(target));
     return LockWord((target >> kStateSize) | (kStateForwardingAddress << kStateShift));
@@ -105,6 +129,7 @@ class LockWord {
   enum LockState {
     kUnlocked,    // No lock owners.
     kThinLocked,  // Single uncontended owner.
+    kBiased,      // Reserved for a thread that isn't holding the lock.
     kFatLocked,   // See associated monitor.
     kHashCode,    // Lock word contains an identity hash.
     kForwardingAddress,  // Lock word contains the forwarding address of an object.
@@ -117,6 +142,9 @@ class LockWord {
       uint32_t internal_state = (value_ >> kStateShift) & kStateMask;
       switch (internal_state) {
         case kStateThinOrUnlocked:
+          if (UNLIKELY(value_ == (kThinLockBiasMaskShifted | (value_ & kThinLockOwnerMask)))) {
+            return kBiased;
+          }
           return kThinLocked;
         case kStateHash:
           return kHashCode;
@@ -129,12 +157,21 @@ class LockWord {
     }
   }
 
-  // Return the owner thin lock thread id.
+  // Return the owner thin lock thread id, or the thread a kBiased lock is reserved for.
   uint32_t ThinLockOwner() const;
 
   // Return the number of times a lock value has been locked.
   uint32_t ThinLockCount() const;
 
+  // Is this a thin or kBiased lock word that only its owner may modify?
+  bool IsBiased() const {
+    return ((value_ >> kStateShift) & kStateMask) == kStateThinOrUnlocked &&
+        (value_ & kThinLockBiasMaskShifted) != 0;
+  }
+
+  // Return the equivalent lock word that isn't biased, must be IsBiased().
+  LockWord RevokeBias() const;
+
   // Return the Monitor encoded in a fat lock.
   Monitor* FatLockMonitor() const;
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_LOOKUP_CACHE_H_
+#define ART_RUNTIME_LOOKUP_CACHE_H_
+
+#include <stdint.h>
+
+#include "atomic.h"
+#include "base/macros.h"
+
+namespace art {
+
+namespace mirror {
+  class Object;
+}  // namespace mirror
+
+// A small direct-mapped cache of objects recently found by name in a global table, such as the
+// intern table or the class table. Each thread has its own caches so that repeated lookups don't
+// take the table's lock. Entries hold raw references and are only valid in the epoch they were
+// added in. The epoch is global and advanced whenever cached objects may have moved or been
+// removed from their table.
+class LookupCache {
+ public:
+  static constexpr size_t kNumEntries = 32;
+
+  LookupCache();
+
+  static uint32_t CurrentEpoch() {
+    return epoch_.LoadSequentiallyConsistent();
+  }
+
+  // Invalidate the entries of all caches.
+  static void InvalidateAll() {
+    epoch_.FetchAndAddSequentiallyConsistent(1u);
+  }
+
+  // Returns the object added for the hash and context in the current epoch, or nullptr. Different
+  // names may have the same hash, so the caller must check the object's name.
+  mirror::Object* Lookup(size_t hash, const mirror::Object* context) const {
+    const Entry& entry = entries_[hash % kNumEntries];
+    if (entry.hash == hash && entry.context == context && entry.epoch == CurrentEpoch()) {
+      return entry.value;
+    }
+    return nullptr;
+  }
+
+  // Add an object found for the hash and context. The epoch is the one current before looking it
+  // up, as the object may have moved since.
+  void Add(size_t hash, const mirror::Object* context, mirror::Object* value, uint32_t epoch) {
+    Entry& entry = entries_[hash % kNumEntries];
+    entry.epoch = epoch;
+    entry.hash = hash;
+    entry.context = context;
+    entry.value = value;
+  }
+
+ private:
+  struct Entry {
+    uint32_t epoch;  // 0 for an unused entry.
+    size_t hash;
+    const mirror::Object* context;
+    mirror::Object* value;
+  };
+
+  static Atomic<uint32_t> epoch_;
+
+  Entry entries_[kNumEntries];
+
+  DISALLOW_COPY_AND_ASSIGN(LookupCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_LOOKUP_CACHE_H_
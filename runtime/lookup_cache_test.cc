@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lookup_cache.h"
+
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "intern_table.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/string-inl.h"
+#include "scoped_thread_state_change.h"
+#include "transaction.h"
+#include "utf.h"
+
+namespace art {
+
+// The cache only compares and returns references, so any distinct addresses do as objects.
+static mirror::Object* FakeObject(uintptr_t address) {
+  return reinterpret_cast<mirror::Object*>(address);
+}
+
+TEST(LookupCache, AddAndLookup) {
+  LookupCache cache;
+  mirror::Object* loader = FakeObject(0x1000);
+  EXPECT_EQ(nullptr, cache.Lookup(42u, nullptr));
+
+  cache.Add(42u, nullptr, FakeObject(0x2000), LookupCache::CurrentEpoch());
+  cache.Add(43u, loader, FakeObject(0x3000), LookupCache::CurrentEpoch());
+  EXPECT_EQ(FakeObject(0x2000), cache.Lookup(42u, nullptr));
+  EXPECT_EQ(FakeObject(0x3000), cache.Lookup(43u, loader));
+  // The context must match as well as the hash.
+  EXPECT_EQ(nullptr, cache.Lookup(42u, loader));
+  EXPECT_EQ(nullptr, cache.Lookup(43u, nullptr));
+
+  // Hashes mapping to the same entry replace each other.
+  cache.Add(42u + LookupCache::kNumEntries, nullptr, FakeObject(0x4000),
+            LookupCache::CurrentEpoch());
+  EXPECT_EQ(nullptr, cache.Lookup(42u, nullptr));
+  EXPECT_EQ(FakeObject(0x4000), cache.Lookup(42u + LookupCache::kNumEntries, nullptr));
+}
+
+TEST(LookupCache, Invalidate) {
+  LookupCache cache;
+  uint32_t epoch = LookupCache::CurrentEpoch();
+  cache.Add(42u, nullptr, FakeObject(0x2000), epoch);
+  EXPECT_EQ(FakeObject(0x2000), cache.Lookup(42u, nullptr));
+
+  LookupCache::InvalidateAll();
+  EXPECT_EQ(nullptr, cache.Lookup(42u, nullptr));
+  // An object found before the invalidation isn't added for the new epoch.
+  cache.Add(42u, nullptr, FakeObject(0x2000), epoch);
+  EXPECT_EQ(nullptr, cache.Lookup(42u, nullptr));
+}
+
+class LookupCacheRuntimeTest : public CommonRuntimeTest {
+ protected:
+  static mirror::Object* LookupClass(Thread* self, const char* descriptor,
+                                     mirror::ClassLoader* class_loader) {
+    return self->GetClassLookupCache()->Lookup(ComputeModifiedUtf8Hash(descriptor), class_loader);
+  }
+
+  static mirror::Object* LookupIntern(Thread* self, const char* utf8) {
+    return self->GetInternLookupCache()->Lookup(ComputeModifiedUtf8Hash(utf8), nullptr);
+  }
+
+  // Checks that a collection drops the cached interns, and that interning again finds the
+  // string wherever it moved to.
+  void CheckCollectionInvalidates() {
+    Thread* self = Thread::Current();
+    InternTable* intern_table = Runtime::Current()->GetInternTable();
+    ScopedObjectAccess soa(self);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::String> s(hs.NewHandle(intern_table->InternStrong("lookup cache")));
+    ASSERT_TRUE(s.Get() != nullptr);
+    EXPECT_EQ(s.Get(), LookupIntern(self, "lookup cache"));
+
+    const uint32_t epoch = LookupCache::CurrentEpoch();
+    Runtime::Current()->GetHeap()->CollectGarbage(false);
+    EXPECT_NE(epoch, LookupCache::CurrentEpoch());
+    EXPECT_EQ(nullptr, LookupIntern(self, "lookup cache"));
+    EXPECT_EQ(s.Get(), intern_table->InternStrong("lookup cache"));
+    EXPECT_EQ(s.Get(), LookupIntern(self, "lookup cache"));
+  }
+};
+
+TEST_F(LookupCacheRuntimeTest, FindClassHits) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> class_loader(hs.NewHandle<mirror::ClassLoader>(nullptr));
+  // Classes are cached when found in the class table.
+  mirror::Class* klass = class_linker_->FindClass(self, "Ljava/lang/String;", class_loader);
+  ASSERT_TRUE(klass != nullptr);
+  EXPECT_EQ(klass, LookupClass(self, "Ljava/lang/String;", nullptr));
+  EXPECT_EQ(klass, class_linker_->FindClass(self, "Ljava/lang/String;", class_loader));
+  // Only for the class loader they were found with.
+  StackHandleScope<1> hs2(self);
+  Handle<mirror::ClassLoader> other_loader(
+      hs2.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("Main"))));
+  EXPECT_EQ(nullptr, LookupClass(self, "Ljava/lang/String;", other_loader.Get()));
+}
+
+TEST_F(LookupCacheRuntimeTest, InternStrongHits) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  InternTable* intern_table = Runtime::Current()->GetInternTable();
+  mirror::String* s = intern_table->InternStrong("lookup cache");
+  ASSERT_TRUE(s != nullptr);
+  EXPECT_EQ(s, LookupIntern(self, "lookup cache"));
+  EXPECT_EQ(s, intern_table->InternStrong("lookup cache"));
+}
+
+TEST_F(LookupCacheRuntimeTest, RemoveStrongInvalidates) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  InternTable* intern_table = Runtime::Current()->GetInternTable();
+  // Aborting a transaction removes the strong interns added during it.
+  Transaction transaction;
+  Runtime::Current()->EnterTransactionMode(&transaction);
+  mirror::String* s = intern_table->InternStrong("lookup cache");
+  Runtime::Current()->ExitTransactionMode();
+  ASSERT_TRUE(s != nullptr);
+  EXPECT_EQ(s, LookupIntern(self, "lookup cache"));
+
+  transaction.Abort();
+  EXPECT_EQ(nullptr, LookupIntern(self, "lookup cache"));
+}
+
+TEST_F(LookupCacheRuntimeTest, RemoveClassInvalidates) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("Main"))));
+  // The class is loaded by the first lookup, and only found in the class table by the second.
+  mirror::Class* klass = class_linker_->FindClass(self, "LMain;", class_loader);
+  ASSERT_TRUE(klass != nullptr);
+  EXPECT_EQ(klass, class_linker_->FindClass(self, "LMain;", class_loader));
+  EXPECT_EQ(klass, LookupClass(self, "LMain;", class_loader.Get()));
+
+  EXPECT_TRUE(class_linker_->RemoveClass("LMain;", class_loader.Get()));
+  EXPECT_EQ(nullptr, LookupClass(self, "LMain;", class_loader.Get()));
+}
+
+class LookupCacheSemiSpaceTest : public LookupCacheRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair("-Xgc:SS", nullptr));
+  }
+};
+
+TEST_F(LookupCacheSemiSpaceTest, MarkingPhaseInvalidates) {
+  CheckCollectionInvalidates();
+}
+
+class LookupCacheMarkCompactTest : public LookupCacheRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair("-Xgc:MC", nullptr));
+  }
+};
+
+TEST_F(LookupCacheMarkCompactTest, MarkingPhaseInvalidates) {
+  CheckCollectionInvalidates();
+}
+
+}  // namespace art
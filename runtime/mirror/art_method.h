@@ -128,6 +128,13 @@ class MANAGED ArtMethod FINAL : public Object {
     return (GetAccessFlags() & mask) == mask;
   }
 
+  // A critical native is called without the JNIEnv* and jclass arguments, see
+  // ClassLinker::GetNativeMethodAnnotationFlags().
+  bool IsCriticalNative() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    uint32_t mask = kAccCriticalNative | kAccNative;
+    return (GetAccessFlags() & mask) == mask;
+  }
+
   bool IsAbstract() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     return (GetAccessFlags() & kAccAbstract) != 0;
   }
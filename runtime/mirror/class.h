@@ -643,6 +643,10 @@ class MANAGED Class FINAL : public Object {
 
   void SetClassLoader(ClassLoader* new_cl) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  static MemberOffset ClassLoaderOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(Class, class_loader_));
+  }
+
   static MemberOffset DexCacheOffset() {
     return MemberOffset(OFFSETOF_MEMBER(Class, dex_cache_));
   }
@@ -171,6 +171,24 @@ int32_t Object::IdentityHashCode() const {
         current_this = h_this.Get();
         break;
       }
+      case LockWord::kBiased: {
+        // Only the thread the lock is biased towards may replace the lock word, anybody else has
+        // to revoke the bias first.
+        Thread* self = Thread::Current();
+        if (lw.ThinLockOwner() == self->GetThreadId()) {
+          LockWord hash_word(LockWord::FromHashCode(GenerateIdentityHashCode()));
+          if (current_this->CasLockWordWeakRelaxed(lw, hash_word)) {
+            return hash_word.GetHashCode();
+          }
+        } else {
+          StackHandleScope<1> hs(self);
+          Handle<mirror::Object> h_this(hs.NewHandle(current_this));
+          Monitor::RevokeBias(self, h_this, lw);
+          // A GC may have occurred when we switched to kBlocked.
+          current_this = h_this.Get();
+        }
+        break;
+      }
       case LockWord::kFatLocked: {
         // Already inflated, return the has stored in the monitor.
         Monitor* monitor = lw.FatLockMonitor();
@@ -16,8 +16,10 @@
 
 #include "monitor.h"
 
+#include <unistd.h>
 #include <vector>
 
+#include "barrier.h"
 #include "base/mutex.h"
 #include "base/stl_util.h"
 #include "class_linker.h"
@@ -28,6 +30,7 @@
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "monitor_contention_profiler.h"
 #include "scoped_thread_state_change.h"
 #include "thread.h"
 #include "thread_list.h"
@@ -67,6 +70,12 @@ static constexpr uint64_t kLongWaitMs = 100;
 
 bool (*Monitor::is_sensitive_thread_hook_)() = NULL;
 uint32_t Monitor::lock_profiling_threshold_ = 0;
+bool Monitor::adaptive_spinning_ = false;
+
+bool Monitor::ShouldRecordLockingMethod() {
+  return lock_profiling_threshold_ != 0 ||
+      Runtime::Current()->GetMonitorContentionProfiler() != nullptr;
+}
 
 bool Monitor::IsSensitiveThread() {
   if (is_sensitive_thread_hook_ != NULL) {
@@ -78,6 +87,7 @@ bool Monitor::IsSensitiveThread() {
 void Monitor::Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)()) {
   lock_profiling_threshold_ = lock_profiling_threshold;
   is_sensitive_thread_hook_ = is_sensitive_thread_hook;
+  adaptive_spinning_ = sysconf(_SC_NPROCESSORS_CONF) > 1;
 }
 
 Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code)
@@ -91,6 +101,8 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       hash_code_(hash_code),
       locking_method_(NULL),
       locking_dex_pc_(0),
+      acquire_time_ns_(0),
+      average_hold_time_ns_(kMaxAdaptiveSpinNs / 4),
       monitor_id_(MonitorPool::ComputeMonitorId(this, self)) {
 #ifdef __LP64__
   DCHECK(false) << "Should not be reached in 64b";
@@ -114,6 +126,8 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       hash_code_(hash_code),
       locking_method_(NULL),
       locking_dex_pc_(0),
+      acquire_time_ns_(0),
+      average_hold_time_ns_(kMaxAdaptiveSpinNs / 4),
       monitor_id_(id) {
 #ifdef __LP64__
   next_free_ = nullptr;
@@ -153,7 +167,9 @@ bool Monitor::Install(Thread* self) {
       // The owner_ is suspended but another thread beat us to install a monitor.
       return false;
     }
-    case LockWord::kUnlocked: {
+    case LockWord::kUnlocked:
+      // Fall-through.
+    case LockWord::kBiased: {
       LOG(FATAL) << "Inflating unlocked lock word";
       break;
     }
@@ -165,8 +181,11 @@ bool Monitor::Install(Thread* self) {
   LockWord fat(this);
   // Publish the updated lock word, which may race with other threads.
   bool success = GetObject()->CasLockWordWeakSequentiallyConsistent(lw, fat);
+  if (success && owner_ != nullptr) {
+    acquire_time_ns_ = NanoTime();
+  }
   // Lock profiling.
-  if (success && owner_ != nullptr && lock_profiling_threshold_ != 0) {
+  if (success && owner_ != nullptr && ShouldRecordLockingMethod()) {
     // Do not abort on dex pc errors. This can easily happen when we want to dump a stack trace on
     // abort.
     locking_method_ = owner_->GetCurrentMethod(&locking_dex_pc_, false);
@@ -222,15 +241,24 @@ void Monitor::SetObject(mirror::Object* object) {
   obj_ = GcRoot<mirror::Object>(object);
 }
 
+void Monitor::SpinWhileOwned(Thread* self, uint64_t spin_ns) {
+  const uint64_t deadline_ns = NanoTime() + spin_ns;
+  // Racy reads of owner_ are fine, the lock is taken again before relying on it.
+  while (GetOwner() != nullptr && !self->TestAllFlags() && NanoTime() < deadline_ns) {
+  }
+}
+
 void Monitor::Lock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
+  bool spun = false;
   while (true) {
     if (owner_ == nullptr) {  // Unowned.
       owner_ = self;
       CHECK_EQ(lock_count_, 0);
+      acquire_time_ns_ = NanoTime();
       // When debugging, save the current monitor holder for future
       // acquisition failures to use in sampled logging.
-      if (lock_profiling_threshold_ != 0) {
+      if (ShouldRecordLockingMethod()) {
         locking_method_ = self->GetCurrentMethod(&locking_dex_pc_);
       }
       return;
@@ -238,7 +266,17 @@ void Monitor::Lock(Thread* self) {
       lock_count_++;
       return;
     }
-    // Contended.
+    // Contended. If the lock is usually held briefly, spin once hoping the owner releases it
+    // before paying for blocking. Mutators are runnable, so the monitor can't be deflated.
+    if (!spun && adaptive_spinning_ && average_hold_time_ns_ <= kMaxAdaptiveSpinNs) {
+      spun = true;
+      const uint64_t max_spin_ns = kMaxAdaptiveSpinNs;
+      const uint64_t spin_ns = std::min(2 * average_hold_time_ns_, max_spin_ns);
+      monitor_lock_.Unlock(self);
+      SpinWhileOwned(self, spin_ns);
+      monitor_lock_.Lock(self);
+      continue;
+    }
     const bool log_contention = (lock_profiling_threshold_ != 0);
     uint64_t wait_start_ms = log_contention ? MilliTime() : 0;
     mirror::ArtMethod* owners_method = locking_method_;
@@ -247,12 +285,25 @@ void Monitor::Lock(Thread* self) {
     size_t num_waiters = num_waiters_;
     ++num_waiters_;
     monitor_lock_.Unlock(self);  // Let go of locks in order.
+    // Resolve the sites while methods can't move.
+    MonitorContentionProfiler* const profiler = Runtime::Current()->GetMonitorContentionProfiler();
+    MonitorContentionProfiler::Site waiter_site = { nullptr, 0u, 0u };
+    MonitorContentionProfiler::Site owner_site = { nullptr, 0u, 0u };
+    if (profiler != nullptr) {
+      uint32_t dex_pc;
+      mirror::ArtMethod* method = self->GetCurrentMethod(&dex_pc);
+      waiter_site = MonitorContentionProfiler::MakeSite(method, dex_pc);
+      owner_site = MonitorContentionProfiler::MakeSite(owners_method, owners_dex_pc);
+    }
+    uint64_t wait_ns = 0;
     self->SetMonitorEnterObject(GetObject());
     {
       ScopedThreadStateChange tsc(self, kBlocked);  // Change to blocked and give up mutator_lock_.
       MutexLock mu2(self, monitor_lock_);  // Reacquire monitor_lock_ without mutator_lock_ for Wait.
       if (owner_ != NULL) {  // Did the owner_ give the lock up?
+        const uint64_t wait_start_ns = NanoTime();
         monitor_contenders_.Wait(self);  // Still contended so wait.
+        wait_ns = NanoTime() - wait_start_ns;
         // Woken from contention.
         if (log_contention) {
           uint64_t wait_ms = MilliTime() - wait_start_ms;
@@ -278,6 +329,9 @@ void Monitor::Lock(Thread* self) {
       }
     }
     self->SetMonitorEnterObject(nullptr);
+    if (profiler != nullptr && wait_ns != 0) {
+      profiler->RecordContention(waiter_site, owner_site, wait_ns);
+    }
     monitor_lock_.Lock(self);  // Reacquire locks in order.
     --num_waiters_;
   }
@@ -378,6 +432,9 @@ bool Monitor::Unlock(Thread* self) {
   if (owner == self) {
     // We own the monitor, so nobody else can be in here.
     if (lock_count_ == 0) {
+      // Update the moving average of hold times that contenders base their spinning on.
+      const uint64_t hold_time_ns = NanoTime() - acquire_time_ns_;
+      average_hold_time_ns_ = (7 * average_hold_time_ns_ + hold_time_ns) / 8;
       owner_ = NULL;
       locking_method_ = NULL;
       locking_dex_pc_ = 0;
@@ -577,7 +634,7 @@ void Monitor::NotifyAll(Thread* self) {
   }
 }
 
-bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
+bool Monitor::Deflate(Thread* self, mirror::Object* obj, bool deflate_owned) {
   DCHECK(obj != nullptr);
   // Don't need volatile since we only deflate with mutators suspended.
   LockWord lw(obj->GetLockWord(false));
@@ -592,6 +649,10 @@ bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
     }
     Thread* owner = monitor->owner_;
     if (owner != nullptr) {
+      // A held monitor is likely to be contended again soon.
+      if (!deflate_owned) {
+        return false;
+      }
       // Can't deflate if we are locked and have a hash code.
       if (monitor->HasHashCode()) {
         return false;
@@ -671,6 +732,79 @@ void Monitor::InflateThinLocked(Thread* self, Handle<mirror::Object> obj, LockWo
   }
 }
 
+// Clears the bias of obj's lock word towards the thread with the given id, which is either self,
+// suspended or no longer alive. Returns false if the lock word no longer has that bias.
+static bool DoRevokeBias(Thread* owner, mirror::Object* obj, uint32_t owner_thread_id)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  while (true) {
+    LockWord lock_word = obj->GetLockWord(true);
+    if (!lock_word.IsBiased() || lock_word.ThinLockOwner() != owner_thread_id) {
+      return false;
+    }
+    if (obj->CasLockWordWeakSequentiallyConsistent(lock_word, lock_word.RevokeBias())) {
+      if (owner != nullptr) {
+        owner->RecordBiasRevocation();
+      }
+      return true;
+    }
+  }
+}
+
+void Monitor::RevokeBias(Thread* self, Handle<mirror::Object> obj, LockWord lock_word) {
+  DCHECK(lock_word.IsBiased());
+  const uint32_t owner_thread_id = lock_word.ThinLockOwner();
+  DCHECK_NE(owner_thread_id, self->GetThreadId());
+  // The owner re-locks and unlocks a biased lock with plain stores, so the bias can only be
+  // revoked by the owner itself or while it's suspended. Ask the owner to do it at its next
+  // suspend check.
+  class RevokeBiasClosure : public Closure {
+   public:
+    RevokeBiasClosure(Handle<mirror::Object> obj, uint32_t owner_thread_id)
+        : obj_(obj), owner_thread_id_(owner_thread_id), barrier_(0) {}
+
+    void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+      DoRevokeBias(thread, obj_.Get(), owner_thread_id_);
+      barrier_.Pass(Thread::Current());
+    }
+
+    void WaitForOwner(Thread* self) {
+      ScopedThreadStateChange tsc(self, kBlocked);
+      barrier_.Increment(self, 1);
+    }
+
+   private:
+    Handle<mirror::Object> const obj_;
+    const uint32_t owner_thread_id_;
+    Barrier barrier_;
+  };
+
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  self->SetMonitorEnterObject(obj.Get());
+  RevokeBiasClosure closure(obj, owner_thread_id);
+  if (thread_list->RequestCheckpointOnThread(owner_thread_id, &closure)) {
+    closure.WaitForOwner(self);
+  } else {
+    // The owner isn't runnable, suspend it so it can't become runnable while we revoke.
+    bool timed_out;
+    Thread* owner;
+    {
+      ScopedThreadStateChange tsc(self, kBlocked);
+      owner = thread_list->SuspendThreadByThreadId(owner_thread_id, false, &timed_out);
+    }
+    if (owner != nullptr) {
+      DoRevokeBias(owner, obj.Get(), owner_thread_id);
+      thread_list->Resume(owner, false);
+    } else if (!timed_out) {
+      // The owner may have died, in which case nobody else can take the bias from us.
+      MutexLock mu(self, *Locks::thread_list_lock_);
+      if (!thread_list->ContainsThreadId(owner_thread_id)) {
+        DoRevokeBias(nullptr, obj.Get(), owner_thread_id);
+      }
+    }
+  }
+  self->SetMonitorEnterObject(nullptr);
+}
+
 // Fool annotalysis into thinking that the lock on obj is acquired.
 static mirror::Object* FakeLock(mirror::Object* obj)
     EXCLUSIVE_LOCK_FUNCTION(obj) NO_THREAD_SAFETY_ANALYSIS {
@@ -683,42 +817,78 @@ static mirror::Object* FakeUnlock(mirror::Object* obj)
   return obj;
 }
 
+void Monitor::RecordThinLockContention(Thread* self, uint64_t spin_ns) {
+  uint32_t dex_pc;
+  mirror::ArtMethod* method = self->GetCurrentMethod(&dex_pc);
+  Runtime::Current()->GetMonitorContentionProfiler()->RecordThinLockContention(
+      MonitorContentionProfiler::MakeSite(method, dex_pc), spin_ns);
+}
+
 mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
   DCHECK(self != NULL);
   DCHECK(obj != NULL);
   obj = FakeLock(obj);
   uint32_t thread_id = self->GetThreadId();
+  const bool bias_locks =
+      (self->GetThinLockAcquireWord() & LockWord::kThinLockBiasMaskShifted) != 0;
   size_t contention_count = 0;
+  // When profiling contention, the time since this thread found the lock thin locked by another.
+  uint64_t thin_contention_start_ns = 0u;
   StackHandleScope<1> hs(self);
   Handle<mirror::Object> h_obj(hs.NewHandle(obj));
   while (true) {
     LockWord lock_word = h_obj->GetLockWord(true);
+    if (UNLIKELY(thin_contention_start_ns != 0u) &&
+        (lock_word.GetState() != LockWord::kThinLocked ||
+         lock_word.ThinLockOwner() == thread_id)) {
+      // The owner released the lock or it was inflated, stop counting spinning time.
+      RecordThinLockContention(self, NanoTime() - thin_contention_start_ns);
+      thin_contention_start_ns = 0u;
+    }
     switch (lock_word.GetState()) {
       case LockWord::kUnlocked: {
-        LockWord thin_locked(LockWord::FromThinLockId(thread_id, 0));
+        // Bias the lock towards us unless we've had too many biases revoked.
+        LockWord thin_locked(LockWord::FromThinLockId(thread_id, 0, bias_locks));
         if (h_obj->CasLockWordWeakSequentiallyConsistent(lock_word, thin_locked)) {
           // CasLockWord enforces more than the acquire ordering we need here.
           return h_obj.Get();  // Success!
         }
         continue;  // Go again.
       }
+      case LockWord::kBiased: {
+        if (lock_word.ThinLockOwner() == thread_id) {
+          // Reserved for us, nobody else may write the lock word.
+          h_obj->SetLockWord(LockWord::FromThinLockId(thread_id, 0, true), true);
+          return h_obj.Get();  // Success!
+        }
+        RevokeBias(self, h_obj, lock_word);
+        continue;  // Start from the beginning.
+      }
       case LockWord::kThinLocked: {
         uint32_t owner_thread_id = lock_word.ThinLockOwner();
         if (owner_thread_id == thread_id) {
           // We own the lock, increase the recursion count.
           uint32_t new_count = lock_word.ThinLockCount() + 1;
           if (LIKELY(new_count <= LockWord::kThinLockMaxCount)) {
-            LockWord thin_locked(LockWord::FromThinLockId(thread_id, new_count));
+            LockWord thin_locked(LockWord::FromThinLockId(thread_id, new_count,
+                                                          lock_word.IsBiased()));
             h_obj->SetLockWord(thin_locked, true);
             return h_obj.Get();  // Success!
           } else {
             // We'd overflow the recursion count, so inflate the monitor.
             InflateThinLocked(self, h_obj, lock_word, 0);
           }
+        } else if (lock_word.IsBiased()) {
+          // The owner will release the lock without telling anybody, revoke the bias first.
+          RevokeBias(self, h_obj, lock_word);
         } else {
           // Contention.
           contention_count++;
           Runtime* runtime = Runtime::Current();
+          if (thin_contention_start_ns == 0u &&
+              UNLIKELY(runtime->GetMonitorContentionProfiler() != nullptr)) {
+            thin_contention_start_ns = NanoTime();
+          }
           if (contention_count <= runtime->GetMaxSpinsBeforeThinkLockInflation()) {
             // TODO: Consider switching the thread state to kBlocked when we are yielding.
             // Use sched_yield instead of NanoSleep since NanoSleep can wait much longer than the
@@ -760,6 +930,8 @@ bool Monitor::MonitorExit(Thread* self, mirror::Object* obj) {
     case LockWord::kHashCode:
       // Fall-through.
     case LockWord::kUnlocked:
+      // Fall-through.
+    case LockWord::kBiased:
       FailedUnlock(h_obj.Get(), self, nullptr, nullptr);
       return false;  // Failure.
     case LockWord::kThinLocked: {
@@ -775,8 +947,12 @@ bool Monitor::MonitorExit(Thread* self, mirror::Object* obj) {
         // We own the lock, decrease the recursion count.
         if (lock_word.ThinLockCount() != 0) {
           uint32_t new_count = lock_word.ThinLockCount() - 1;
-          LockWord thin_locked(LockWord::FromThinLockId(thread_id, new_count));
+          LockWord thin_locked(LockWord::FromThinLockId(thread_id, new_count,
+                                                        lock_word.IsBiased()));
           h_obj->SetLockWord(thin_locked, true);
+        } else if (lock_word.IsBiased()) {
+          // Keep the lock reserved for us.
+          h_obj->SetLockWord(LockWord::FromBiasedThreadId(thread_id), true);
         } else {
           h_obj->SetLockWord(LockWord(), true);
         }
@@ -804,6 +980,8 @@ void Monitor::Wait(Thread* self, mirror::Object *obj, int64_t ms, int32_t ns,
       case LockWord::kHashCode:
         // Fall-through.
       case LockWord::kUnlocked:
+        // Fall-through.
+      case LockWord::kBiased:
         ThrowIllegalMonitorStateExceptionF("object not locked by thread before wait()");
         return;  // Failure.
       case LockWord::kThinLocked: {
@@ -839,6 +1017,8 @@ void Monitor::DoNotify(Thread* self, mirror::Object* obj, bool notify_all) {
     case LockWord::kHashCode:
       // Fall-through.
     case LockWord::kUnlocked:
+      // Fall-through.
+    case LockWord::kBiased:
       ThrowIllegalMonitorStateExceptionF("object not locked by thread before notify()");
       return;  // Failure.
     case LockWord::kThinLocked: {
@@ -875,6 +1055,8 @@ uint32_t Monitor::GetLockOwnerThreadId(mirror::Object* obj) {
     case LockWord::kHashCode:
       // Fall-through.
     case LockWord::kUnlocked:
+      // Fall-through.
+    case LockWord::kBiased:
       return ThreadList::kInvalidThreadId;
     case LockWord::kThinLocked:
       return lock_word.ThinLockOwner();
@@ -1021,6 +1203,8 @@ bool Monitor::IsValidLockWord(LockWord lock_word) {
       // Nothing to check.
       return true;
     case LockWord::kThinLocked:
+      // Fall-through.
+    case LockWord::kBiased:
       // Basic sanity check of owner.
       return lock_word.ThinLockOwner() != ThreadList::kInvalidThreadId;
     case LockWord::kFatLocked: {
@@ -1075,7 +1259,8 @@ uint32_t Monitor::GetOwnerThreadId() {
 
 MonitorList::MonitorList()
     : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock", kMonitorListLock),
-      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
+      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_),
+      num_inflated_(0), num_deflated_(0) {
 }
 
 MonitorList::~MonitorList() {
@@ -1106,6 +1291,7 @@ void MonitorList::Add(Monitor* m) {
     monitor_add_condition_.WaitHoldingLocks(self);
   }
   list_.push_front(m);
+  ++num_inflated_;
 }
 
 void MonitorList::SweepMonitorList(IsMarkedCallback* callback, void* arg) {
@@ -1130,15 +1316,17 @@ void MonitorList::SweepMonitorList(IsMarkedCallback* callback, void* arg) {
 }
 
 struct MonitorDeflateArgs {
-  MonitorDeflateArgs() : self(Thread::Current()), deflate_count(0) {}
+  explicit MonitorDeflateArgs(bool deflate_owned_in)
+      : self(Thread::Current()), deflate_owned(deflate_owned_in), deflate_count(0) {}
   Thread* const self;
+  const bool deflate_owned;
   size_t deflate_count;
 };
 
 static mirror::Object* MonitorDeflateCallback(mirror::Object* object, void* arg)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   MonitorDeflateArgs* args = reinterpret_cast<MonitorDeflateArgs*>(arg);
-  if (Monitor::Deflate(args->self, object)) {
+  if (Monitor::Deflate(args->self, object, args->deflate_owned)) {
     DCHECK_NE(object->GetLockWord(true).GetState(), LockWord::kFatLocked);
     ++args->deflate_count;
     // If we deflated, return nullptr so that the monitor gets removed from the array.
@@ -1147,19 +1335,29 @@ static mirror::Object* MonitorDeflateCallback(mirror::Object* object, void* arg)
   return object;  // Monitor was not deflated.
 }
 
-size_t MonitorList::DeflateMonitors() {
-  MonitorDeflateArgs args;
+size_t MonitorList::DeflateMonitors(bool deflate_owned) {
+  MonitorDeflateArgs args(deflate_owned);
   Locks::mutator_lock_->AssertExclusiveHeld(args.self);
   SweepMonitorList(MonitorDeflateCallback, &args);
+  MutexLock mu(args.self, monitor_list_lock_);
+  num_deflated_ += args.deflate_count;
   return args.deflate_count;
 }
 
+void MonitorList::DumpForSigQuit(std::ostream& os) {
+  MutexLock mu(Thread::Current(), monitor_list_lock_);
+  os << "Monitors: " << list_.size() << " inflated; " << num_inflated_ << " total inflated; "
+     << num_deflated_ << " total deflated\n";
+}
+
 MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(NULL), entry_count_(0) {
   DCHECK(obj != nullptr);
   LockWord lock_word = obj->GetLockWord(true);
   switch (lock_word.GetState()) {
     case LockWord::kUnlocked:
       // Fall-through.
+    case LockWord::kBiased:
+      // Fall-through.
     case LockWord::kForwardingAddress:
       // Fall-through.
     case LockWord::kHashCode:
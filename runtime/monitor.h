@@ -36,6 +36,7 @@ namespace art {
 
 class LockWord;
 template<class T> class Handle;
+class MonitorTest_SpinWhileOwned_Test;
 class Thread;
 class StackVisitor;
 typedef uint32_t MonitorId;
@@ -51,6 +52,10 @@ class Monitor {
   // a lock word. See Runtime::max_spins_before_thin_lock_inflation_.
   constexpr static size_t kDefaultMaxSpinsBeforeThinLockInflation = 50;
 
+  // Contenders for an inflated monitor spin for up to twice its average hold time, capped at
+  // this, before blocking. Blocking and being woken up again costs about as much.
+  constexpr static uint64_t kMaxAdaptiveSpinNs = 20 * 1000;
+
   ~Monitor();
 
   static bool IsSensitiveThread();
@@ -126,9 +131,18 @@ class Monitor {
   static void InflateThinLocked(Thread* self, Handle<mirror::Object> obj, LockWord lock_word,
                                 uint32_t hash_code) NO_THREAD_SAFETY_ANALYSIS;
 
-  static bool Deflate(Thread* self, mirror::Object* obj)
+  // Deflate the monitor of obj, if any, back to a thin lock word. Monitors with waiters, or held
+  // monitors if deflate_owned is false, are left alone. Returns false if obj is still fat locked.
+  // Mutators must be suspended.
+  static bool Deflate(Thread* self, mirror::Object* obj, bool deflate_owned = true)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Revoke the bias of a lock word biased towards another thread, which is made to do so at a
+  // checkpoint or suspended. The owner keeps holding the lock if it did. May fail spuriously, the
+  // caller should re-read the lock word following the call.
+  static void RevokeBias(Thread* self, Handle<mirror::Object> obj, LockWord lock_word)
+      NO_THREAD_SAFETY_ANALYSIS;
+
  private:
   explicit Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code)
         SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -156,6 +170,11 @@ class Monitor {
   static void Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Records time spent spinning on a thin lock held by another thread with the contention
+  // profiler, which must be enabled.
+  static void RecordThinLockContention(Thread* self, uint64_t spin_ns)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void LogContentionEvent(Thread* self, uint32_t wait_ms, uint32_t sample_percent,
                           const char* owner_filename, uint32_t owner_line_number)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -167,6 +186,11 @@ class Monitor {
   void Lock(Thread* self)
       LOCKS_EXCLUDED(monitor_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Busy wait for up to spin_ns while the monitor is owned. Gives up early if self is asked to
+  // suspend or run a checkpoint.
+  void SpinWhileOwned(Thread* self, uint64_t spin_ns)
+      LOCKS_EXCLUDED(monitor_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool Unlock(Thread* thread)
       LOCKS_EXCLUDED(monitor_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -213,8 +237,13 @@ class Monitor {
 
   uint32_t GetOwnerThreadId();
 
+  // Whether the method acquiring a monitor is recorded, for contention logging and profiling.
+  static bool ShouldRecordLockingMethod();
+
   static bool (*is_sensitive_thread_hook_)();
   static uint32_t lock_profiling_threshold_;
+  // Spinning can only pay off with more than one processor.
+  static bool adaptive_spinning_;
 
   Mutex monitor_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
@@ -246,6 +275,11 @@ class Monitor {
   mirror::ArtMethod* locking_method_ GUARDED_BY(monitor_lock_);
   uint32_t locking_dex_pc_ GUARDED_BY(monitor_lock_);
 
+  // When the owner acquired the lock, and a moving average of how long the lock is held, which
+  // contenders use to decide how long to spin.
+  uint64_t acquire_time_ns_ GUARDED_BY(monitor_lock_);
+  uint64_t average_hold_time_ns_ GUARDED_BY(monitor_lock_);
+
   // The denser encoded version of this monitor as stored in the lock word.
   MonitorId monitor_id_;
 
@@ -258,6 +292,7 @@ class Monitor {
   friend class MonitorList;
   friend class MonitorPool;
   friend class mirror::Object;
+  ART_FRIEND_TEST(MonitorTest, SpinWhileOwned);
   DISALLOW_COPY_AND_ASSIGN(Monitor);
 };
 
@@ -272,10 +307,13 @@ class MonitorList {
       LOCKS_EXCLUDED(monitor_list_lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void DisallowNewMonitors() LOCKS_EXCLUDED(monitor_list_lock_);
   void AllowNewMonitors() LOCKS_EXCLUDED(monitor_list_lock_);
-  // Returns how many monitors were deflated.
-  size_t DeflateMonitors() LOCKS_EXCLUDED(monitor_list_lock_)
+  // Deflates the monitors without waiters, which are returned to the MonitorPool. Monitors that
+  // are held are only deflated if deflate_owned. Returns how many monitors were deflated.
+  size_t DeflateMonitors(bool deflate_owned) LOCKS_EXCLUDED(monitor_list_lock_)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  void DumpForSigQuit(std::ostream& os) LOCKS_EXCLUDED(monitor_list_lock_);
+
   typedef std::list<Monitor*, TrackingAllocator<Monitor*, kAllocatorTagMonitorList>> Monitors;
 
  private:
@@ -288,6 +326,10 @@ class MonitorList {
   ConditionVariable monitor_add_condition_ GUARDED_BY(monitor_list_lock_);
   Monitors list_ GUARDED_BY(monitor_list_lock_);
 
+  // How many monitors were ever added to the list, and how many of those were deflated.
+  size_t num_inflated_ GUARDED_BY(monitor_list_lock_);
+  size_t num_deflated_ GUARDED_BY(monitor_list_lock_);
+
   friend class Monitor;
   DISALLOW_COPY_AND_ASSIGN(MonitorList);
 };
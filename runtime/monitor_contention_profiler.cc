@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_contention_profiler.h"
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+#include "dex_file.h"
+#include "mirror/art_method-inl.h"
+#include "utils.h"
+
+namespace art {
+
+constexpr MonitorContentionProfiler::Site MonitorContentionProfiler::kThinLockOwnerSite;
+
+MonitorContentionProfiler::MonitorContentionProfiler() : num_dropped_(0) {
+  static_assert(kEntryFree == 0, "Entries must start out free");
+}
+
+MonitorContentionProfiler::Site MonitorContentionProfiler::MakeSite(mirror::ArtMethod* method,
+                                                                    uint32_t dex_pc) {
+  if (method == nullptr || method->IsRuntimeMethod() || method->IsProxyMethod()) {
+    return Site { nullptr, 0u, 0u };
+  }
+  return Site { method->GetDexFile(), method->GetDexMethodIndex(), dex_pc };
+}
+
+size_t MonitorContentionProfiler::Hash(const Site& waiter_site, const Site& owner_site) {
+  size_t hash = reinterpret_cast<uintptr_t>(waiter_site.dex_file);
+  hash = hash * 31 + waiter_site.method_idx;
+  hash = hash * 31 + waiter_site.dex_pc;
+  hash = hash * 31 + reinterpret_cast<uintptr_t>(owner_site.dex_file);
+  hash = hash * 31 + owner_site.method_idx;
+  hash = hash * 31 + owner_site.dex_pc;
+  return hash;
+}
+
+MonitorContentionProfiler::Entry* MonitorContentionProfiler::FindOrClaimEntry(
+    const Site& waiter_site, const Site& owner_site) {
+  size_t index = Hash(waiter_site, owner_site) % kNumEntries;
+  for (size_t i = 0; i != kMaxProbes; ++i, index = (index + 1) % kNumEntries) {
+    Entry* entry = &entries_[index];
+    uint32_t state = entry->state.LoadSequentiallyConsistent();
+    if (state == kEntryFree) {
+      if (entry->state.CompareExchangeStrongSequentiallyConsistent(kEntryFree, kEntryClaimed)) {
+        entry->waiter_site = waiter_site;
+        entry->owner_site = owner_site;
+        entry->state.StoreSequentiallyConsistent(kEntryReady);
+        return entry;
+      }
+      state = entry->state.LoadSequentiallyConsistent();
+    }
+    // Another thread is just writing the sites, wait for it to compare them.
+    while (state == kEntryClaimed) {
+      state = entry->state.LoadSequentiallyConsistent();
+    }
+    if (entry->waiter_site == waiter_site && entry->owner_site == owner_site) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+void MonitorContentionProfiler::RecordContention(const Site& waiter_site, const Site& owner_site,
+                                                 uint64_t wait_ns) {
+  Entry* entry = FindOrClaimEntry(waiter_site, owner_site);
+  if (entry == nullptr) {
+    num_dropped_.FetchAndAddSequentiallyConsistent(1u);
+    return;
+  }
+  entry->count.FetchAndAddSequentiallyConsistent(1u);
+  entry->total_wait_ns.FetchAndAddSequentiallyConsistent(wait_ns);
+  uint64_t max_wait_ns = entry->max_wait_ns.LoadRelaxed();
+  while (wait_ns > max_wait_ns &&
+         !entry->max_wait_ns.CompareExchangeWeakRelaxed(max_wait_ns, wait_ns)) {
+    max_wait_ns = entry->max_wait_ns.LoadRelaxed();
+  }
+}
+
+void MonitorContentionProfiler::RecordThinLockContention(const Site& waiter_site,
+                                                         uint64_t spin_ns) {
+  RecordContention(waiter_site, kThinLockOwnerSite, spin_ns);
+}
+
+void MonitorContentionProfiler::DumpSite(std::ostream& os, const Site& site) {
+  if (site.dex_file == nullptr) {
+    os << "<unknown>";
+  } else {
+    os << PrettyMethod(site.method_idx, *site.dex_file) << " @ dex pc 0x" << std::hex
+       << site.dex_pc << std::dec;
+  }
+}
+
+void MonitorContentionProfiler::Dump(std::ostream& os) {
+  std::vector<const Entry*> entries;
+  uint64_t total_count = 0;
+  uint64_t total_wait_ns = 0;
+  for (const Entry& entry : entries_) {
+    if (entry.state.LoadSequentiallyConsistent() == kEntryReady) {
+      entries.push_back(&entry);
+      total_count += entry.count.LoadRelaxed();
+      total_wait_ns += entry.total_wait_ns.LoadRelaxed();
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry* lhs, const Entry* rhs) {
+    return lhs->total_wait_ns.LoadRelaxed() > rhs->total_wait_ns.LoadRelaxed();
+  });
+  os << "Monitor contention: " << total_count << " contended enters waiting "
+     << PrettyDuration(total_wait_ns) << " at " << entries.size() << " sites; "
+     << num_dropped_.LoadRelaxed() << " not recorded\n";
+  const size_t max_dumped_entries = kMaxDumpedEntries;
+  for (size_t i = 0; i != std::min(entries.size(), max_dumped_entries); ++i) {
+    const Entry* entry = entries[i];
+    os << "  " << PrettyDuration(entry->total_wait_ns.LoadRelaxed()) << " in "
+       << entry->count.LoadRelaxed() << " waits, max "
+       << PrettyDuration(entry->max_wait_ns.LoadRelaxed()) << ", at ";
+    DumpSite(os, entry->waiter_site);
+    if (entry->owner_site == kThinLockOwnerSite) {
+      os << "\n    spinning on a thin lock\n";
+    } else {
+      os << "\n    owner locked at ";
+      DumpSite(os, entry->owner_site);
+      os << "\n";
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_MONITOR_CONTENTION_PROFILER_H_
+#define ART_RUNTIME_MONITOR_CONTENTION_PROFILER_H_
+
+#include <stdint.h>
+#include <iosfwd>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class DexFile;
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+// Records how long threads wait to enter contended monitors, aggregated by the site of the
+// monitor-enter and the site at which the owner acquired the monitor. Thin locks don't know where
+// they were acquired, time spent spinning on them is aggregated by the waiter's site only. The
+// table has a fixed size and is updated without locks. Contention between sites that don't fit
+// into the table is only counted.
+class MonitorContentionProfiler {
+ public:
+  // A dex pc within a method, identified by dex file and method index as methods may move.
+  struct Site {
+    const DexFile* dex_file;
+    uint32_t method_idx;
+    uint32_t dex_pc;
+
+    bool operator==(const Site& other) const {
+      return dex_file == other.dex_file && method_idx == other.method_idx &&
+          dex_pc == other.dex_pc;
+    }
+  };
+
+  MonitorContentionProfiler();
+
+  // Returns the site of dex_pc in method, which may be nullptr if unknown.
+  static Site MakeSite(mirror::ArtMethod* method, uint32_t dex_pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Record that a thread entering a monitor at waiter_site waited wait_ns for the owner, which
+  // had acquired the monitor at owner_site.
+  void RecordContention(const Site& waiter_site, const Site& owner_site, uint64_t wait_ns);
+
+  // Record that a thread entering a monitor at waiter_site spent spin_ns spinning on a thin lock
+  // held by another thread, until it got the lock or inflated it.
+  void RecordThinLockContention(const Site& waiter_site, uint64_t spin_ns);
+
+  // Dump the sites with the longest total waits.
+  void Dump(std::ostream& os);
+
+ private:
+  static constexpr size_t kNumEntries = 1024;
+  // How many entries are probed for a pair of sites before giving up.
+  static constexpr size_t kMaxProbes = 16;
+  static constexpr size_t kMaxDumpedEntries = 20;
+
+  enum EntryState : uint32_t {
+    kEntryFree,
+    kEntryClaimed,  // Sites being written by the thread that claimed the entry.
+    kEntryReady,
+  };
+
+  struct Entry {
+    Atomic<uint32_t> state;
+    Site waiter_site;
+    Site owner_site;
+    Atomic<uint64_t> count;
+    Atomic<uint64_t> total_wait_ns;
+    Atomic<uint64_t> max_wait_ns;
+  };
+
+  // The owner site of thin lock contention, which can't be a real site as it has no dex file.
+  static constexpr Site kThinLockOwnerSite = { nullptr, 0xffffffffu, 0xffffffffu };
+
+  static size_t Hash(const Site& waiter_site, const Site& owner_site);
+  static void DumpSite(std::ostream& os, const Site& site);
+
+  // Returns the entry for the pair of sites, claiming a free one if needed, or nullptr if the
+  // probed entries are all taken by other sites.
+  Entry* FindOrClaimEntry(const Site& waiter_site, const Site& owner_site);
+
+  Entry entries_[kNumEntries];
+  Atomic<uint64_t> num_dropped_;
+
+  DISALLOW_COPY_AND_ASSIGN(MonitorContentionProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_MONITOR_CONTENTION_PROFILER_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_contention_profiler.h"
+
+#include <unistd.h>
+
+#include <sstream>
+
+#include "barrier.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/string-inl.h"
+#include "monitor.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+namespace art {
+
+class MonitorContentionProfilerTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair("-XX:ProfileMonitorContention", nullptr));
+  }
+};
+
+TEST_F(MonitorContentionProfilerTest, AggregatesBySites) {
+  const DexFile* dex_file = java_lang_dex_file_;
+  const MonitorContentionProfiler::Site waiter_site = { dex_file, 0u, 4u };
+  const MonitorContentionProfiler::Site other_waiter_site = { dex_file, 1u, 8u };
+  const MonitorContentionProfiler::Site owner_site = { dex_file, 0u, 0u };
+  const MonitorContentionProfiler::Site unknown_site = { nullptr, 0u, 0u };
+
+  MonitorContentionProfiler profiler;
+  profiler.RecordContention(waiter_site, owner_site, 3000u);
+  profiler.RecordContention(waiter_site, owner_site, 5000u);
+  profiler.RecordContention(other_waiter_site, unknown_site, 1000u);
+
+  std::ostringstream oss;
+  profiler.Dump(oss);
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("3 contended enters waiting 9us")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("at 2 sites; 0 not recorded")) << dump;
+  // The sites with the longest total wait come first.
+  size_t first = dump.find("8us in 2 waits, max 5us, at " +
+                           PrettyMethod(0u, *dex_file) + " @ dex pc 0x4");
+  size_t second = dump.find("1us in 1 waits, max 1us, at " +
+                            PrettyMethod(1u, *dex_file) + " @ dex pc 0x8");
+  ASSERT_NE(std::string::npos, first) << dump;
+  ASSERT_NE(std::string::npos, second) << dump;
+  EXPECT_LT(first, second);
+  EXPECT_NE(std::string::npos, dump.find("owner locked at <unknown>")) << dump;
+}
+
+// Takes a thin lock and holds it for a while after passing the barrier.
+class HoldLockTask : public Task {
+ public:
+  HoldLockTask(Handle<mirror::String> object, Barrier* barrier)
+      : object_(object), barrier_(barrier) {}
+
+  void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    {
+      ScopedObjectAccess soa(self);
+      Monitor::MonitorEnter(self, object_.Get());
+    }
+    barrier_->Pass(self);
+    {
+      // Sleep suspendable, the waiter suspends us to revoke a bias or to inflate the lock.
+      ScopedThreadStateChange tsc(self, kSleeping);
+      usleep(100 * 1000);
+    }
+    ScopedObjectAccess soa(self);
+    Monitor::MonitorExit(self, object_.Get());
+  }
+
+  void Finalize() {
+  }
+
+ private:
+  Handle<mirror::String> object_;
+  Barrier* barrier_;
+};
+
+TEST_F(MonitorContentionProfilerTest, ThinLockContentionIsRecorded) {
+  Thread* self = Thread::Current();
+  StackHandleScope<1> hs(self);
+  Handle<mirror::String> object;
+  {
+    ScopedObjectAccess soa(self);
+    object = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+  }
+
+  Barrier barrier(2);
+  HoldLockTask task(object, &barrier);
+  ThreadPool thread_pool("Monitor contention profiler test thread pool", 1);
+  thread_pool.AddTask(self, &task);
+  thread_pool.StartWorkers(self);
+  barrier.Pass(self);
+  {
+    // The lock is thin locked by the worker, spin on it until it is released or inflated.
+    ScopedObjectAccess soa(self);
+    Monitor::MonitorEnter(self, object.Get());
+    Monitor::MonitorExit(self, object.Get());
+  }
+  thread_pool.Wait(self, false, false);
+  thread_pool.StopWorkers(self);
+
+  std::ostringstream oss;
+  Runtime::Current()->GetMonitorContentionProfiler()->Dump(oss);
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("in 1 waits")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("spinning on a thin lock")) << dump;
+}
+
+}  // namespace art
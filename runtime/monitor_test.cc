@@ -25,6 +25,7 @@
 #include "mirror/class-inl.h"
 #include "mirror/string-inl.h"  // Strings are easiest to allocate
 #include "scoped_thread_state_change.h"
+#include "thread_list.h"
 #include "thread_pool.h"
 #include "utils.h"
 
@@ -377,4 +378,245 @@ TEST_F(MonitorTest, CheckExceptionsWait3) {
                   "Monitor test thread pool 3");
 }
 
+class LockBiasedTask : public Task {
+ public:
+  explicit LockBiasedTask(MonitorTest* monitor_test) : monitor_test_(monitor_test) {}
+
+  void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    thread_id_ = self->GetThreadId();
+    // The lock is biased towards the main thread, which is suspended to revoke the bias.
+    Monitor::MonitorEnter(self, monitor_test_->object_.Get());
+    locked_word_ = monitor_test_->object_->GetLockWord(true);
+    Monitor::MonitorExit(self, monitor_test_->object_.Get());
+    unlocked_word_ = monitor_test_->object_->GetLockWord(true);
+  }
+
+  void Finalize() {
+  }
+
+  uint32_t thread_id_ = 0;
+  LockWord locked_word_;
+  LockWord unlocked_word_;
+
+ private:
+  MonitorTest* monitor_test_;
+};
+
+TEST_F(MonitorTest, RevokeBias) {
+  Thread* self = Thread::Current();
+  if (!Runtime::Current()->UseBiasedLocking()) {
+    return;
+  }
+  StackHandleScope<1> hs(self);
+  {
+    ScopedObjectAccess soa(self);
+    object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+    Monitor::MonitorEnter(self, object_.Get());
+    LockWord lock_word = object_->GetLockWord(true);
+    EXPECT_EQ(LockWord::LockState::kThinLocked, lock_word.GetState());
+    EXPECT_TRUE(lock_word.IsBiased());
+    EXPECT_EQ(0U, lock_word.ThinLockCount());
+    Monitor::MonitorExit(self, object_.Get());
+    lock_word = object_->GetLockWord(true);
+    EXPECT_EQ(LockWord::LockState::kBiased, lock_word.GetState());
+    EXPECT_EQ(self->GetThreadId(), lock_word.ThinLockOwner());
+  }
+
+  LockBiasedTask task(this);
+  ThreadPool thread_pool("Monitor test thread pool 4", 1);
+  thread_pool.AddTask(self, &task);
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, true, false);
+  thread_pool.StopWorkers(self);
+
+  // After the revocation the lock is biased towards the thread that took it.
+  EXPECT_EQ(LockWord::LockState::kThinLocked, task.locked_word_.GetState());
+  EXPECT_EQ(task.thread_id_, task.locked_word_.ThinLockOwner());
+  EXPECT_EQ(LockWord::LockState::kBiased, task.unlocked_word_.GetState());
+  EXPECT_EQ(task.thread_id_, task.unlocked_word_.ThinLockOwner());
+}
+
+// Biases the lock towards the worker, then stays runnable until told to stop so that a bias
+// revocation has to go through a checkpoint.
+class HoldBiasTask : public Task {
+ public:
+  explicit HoldBiasTask(MonitorTest* monitor_test)
+      : monitor_test_(monitor_test), ready_(false), stop_(false), saw_checkpoint_(false) {}
+
+  void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    thread_id_ = self->GetThreadId();
+    Monitor::MonitorEnter(self, monitor_test_->object_.Get());
+    Monitor::MonitorExit(self, monitor_test_->object_.Get());
+    unlocked_word_ = monitor_test_->object_->GetLockWord(true);
+    ready_.StoreSequentiallyConsistent(true);
+    while (!stop_.LoadSequentiallyConsistent()) {
+      if (self->ReadFlag(kCheckpointRequest)) {
+        saw_checkpoint_ = true;
+      }
+      self->CheckSuspend();
+    }
+  }
+
+  void Finalize() {
+  }
+
+  uint32_t thread_id_ = 0;
+  LockWord unlocked_word_;
+  Atomic<bool> ready_;
+  Atomic<bool> stop_;
+  bool saw_checkpoint_;
+
+ private:
+  MonitorTest* monitor_test_;
+};
+
+TEST_F(MonitorTest, RevokeBiasOfRunnableOwner) {
+  Thread* self = Thread::Current();
+  if (!Runtime::Current()->UseBiasedLocking()) {
+    return;
+  }
+  StackHandleScope<1> hs(self);
+  {
+    ScopedObjectAccess soa(self);
+    object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+  }
+
+  HoldBiasTask task(this);
+  ThreadPool thread_pool("Monitor test thread pool 5", 1);
+  thread_pool.AddTask(self, &task);
+  thread_pool.StartWorkers(self);
+  while (!task.ready_.LoadSequentiallyConsistent()) {
+    sched_yield();
+  }
+  EXPECT_EQ(LockWord::LockState::kBiased, task.unlocked_word_.GetState());
+  EXPECT_EQ(task.thread_id_, task.unlocked_word_.ThinLockOwner());
+
+  {
+    // The owner is runnable, so it revokes its own bias in a checkpoint.
+    ScopedObjectAccess soa(self);
+    Monitor::MonitorEnter(self, object_.Get());
+    LockWord lock_word = object_->GetLockWord(true);
+    EXPECT_EQ(LockWord::LockState::kThinLocked, lock_word.GetState());
+    EXPECT_EQ(self->GetThreadId(), lock_word.ThinLockOwner());
+    Monitor::MonitorExit(self, object_.Get());
+  }
+
+  task.stop_.StoreSequentiallyConsistent(true);
+  thread_pool.Wait(self, true, false);
+  thread_pool.StopWorkers(self);
+  EXPECT_TRUE(task.saw_checkpoint_);
+}
+
+TEST_F(MonitorTest, RevokeBiasOfDeadOwner) {
+  Thread* self = Thread::Current();
+  if (!Runtime::Current()->UseBiasedLocking()) {
+    return;
+  }
+  StackHandleScope<1> hs(self);
+  {
+    ScopedObjectAccess soa(self);
+    object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+  }
+
+  LockBiasedTask task(this);
+  {
+    ThreadPool thread_pool("Monitor test thread pool 6", 1);
+    thread_pool.AddTask(self, &task);
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, true, false);
+    thread_pool.StopWorkers(self);
+  }
+  // Destroying the pool joined the worker, leaving the lock biased towards a dead thread.
+  EXPECT_EQ(LockWord::LockState::kBiased, task.unlocked_word_.GetState());
+  EXPECT_EQ(task.thread_id_, task.unlocked_word_.ThinLockOwner());
+
+  ScopedObjectAccess soa(self);
+  Monitor::MonitorEnter(self, object_.Get());
+  LockWord lock_word = object_->GetLockWord(true);
+  EXPECT_EQ(LockWord::LockState::kThinLocked, lock_word.GetState());
+  EXPECT_EQ(self->GetThreadId(), lock_word.ThinLockOwner());
+  Monitor::MonitorExit(self, object_.Get());
+}
+
+TEST_F(MonitorTest, SpinWhileOwned) {
+  Thread* self = Thread::Current();
+  StackHandleScope<1> hs(self);
+  ScopedObjectAccess soa(self);
+  object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+  // Inflate the lock by asking for the hash code while holding it.
+  Monitor::MonitorEnter(self, object_.Get());
+  object_->IdentityHashCode();
+  LockWord lock_word = object_->GetLockWord(true);
+  ASSERT_EQ(LockWord::LockState::kFatLocked, lock_word.GetState());
+  Monitor* monitor = lock_word.FatLockMonitor();
+
+  // A contender spins for the whole time while the monitor stays owned.
+  const uint64_t spin_ns = MsToNs(5);
+  uint64_t start_ns = NanoTime();
+  monitor->SpinWhileOwned(self, spin_ns);
+  EXPECT_GE(NanoTime() - start_ns, spin_ns);
+
+  // And stops as soon as it's released.
+  Monitor::MonitorExit(self, object_.Get());
+  const uint64_t long_spin_ns = MsToNs(60 * 1000);
+  start_ns = NanoTime();
+  monitor->SpinWhileOwned(self, long_spin_ns);
+  EXPECT_LT(NanoTime() - start_ns, long_spin_ns);
+}
+
+class MonitorNoBiasTest : public MonitorTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions *options) OVERRIDE {
+    MonitorTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-XX:DisableBiasedLocking", nullptr));
+  }
+};
+
+TEST_F(MonitorNoBiasTest, LocksAreNotBiased) {
+  Thread* self = Thread::Current();
+  ASSERT_FALSE(Runtime::Current()->UseBiasedLocking());
+  StackHandleScope<1> hs(self);
+  ScopedObjectAccess soa(self);
+  object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+  Monitor::MonitorEnter(self, object_.Get());
+  LockWord lock_word = object_->GetLockWord(true);
+  EXPECT_EQ(LockWord::LockState::kThinLocked, lock_word.GetState());
+  EXPECT_FALSE(lock_word.IsBiased());
+  Monitor::MonitorExit(self, object_.Get());
+  EXPECT_EQ(LockWord::LockState::kUnlocked, object_->GetLockWord(true).GetState());
+}
+
+TEST_F(MonitorTest, DeflateIdleMonitors) {
+  Thread* self = Thread::Current();
+  StackHandleScope<2> hs(self);
+  {
+    ScopedObjectAccess soa(self);
+    object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+    second_object_ = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "hello, world!"));
+    // Inflate both locks by asking for the hash codes while holding them.
+    Monitor::MonitorEnter(self, object_.Get());
+    object_->IdentityHashCode();
+    Monitor::MonitorExit(self, object_.Get());
+    Monitor::MonitorEnter(self, second_object_.Get());
+    second_object_->IdentityHashCode();
+    EXPECT_EQ(LockWord::LockState::kFatLocked, object_->GetLockWord(true).GetState());
+    EXPECT_EQ(LockWord::LockState::kFatLocked, second_object_->GetLockWord(true).GetState());
+  }
+
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll("monitor test");
+  // Only the monitor that isn't held is deflated, keeping its hash code.
+  EXPECT_LE(1U, Runtime::Current()->GetMonitorList()->DeflateMonitors(false));
+  thread_list->ResumeAll();
+
+  {
+    ScopedObjectAccess soa(self);
+    EXPECT_EQ(LockWord::LockState::kHashCode, object_->GetLockWord(true).GetState());
+    EXPECT_EQ(LockWord::LockState::kFatLocked, second_object_->GetLockWord(true).GetState());
+    Monitor::MonitorExit(self, second_object_.Get());
+  }
+}
+
 }  // namespace art
@@ -25,7 +25,7 @@
 namespace art {
 
 const uint8_t OatHeader::kOatMagic[] = { 'o', 'a', 't', '\n' };
-const uint8_t OatHeader::kOatVersion[] = { '0', '5', '1', '\0' };
+const uint8_t OatHeader::kOatVersion[] = { '0', '5', '5', '\0' };
 
 static size_t ComputeOatHeaderSize(const SafeMap<std::string, std::string>* variable_data) {
   size_t estimate = 0U;
@@ -478,6 +478,12 @@ bool OatHeader::IsPic() const {
   return (pic_string != nullptr && strncmp(pic_string, kTrue, sizeof(kTrue)) == 0);
 }
 
+bool OatHeader::MayHaveLinkerPatches() const {
+  const char* patches_string = GetStoreValueByKey(OatHeader::kLinkerPatchesKey);
+  static const char kFalse[] = "false";
+  return (patches_string == nullptr || strncmp(patches_string, kFalse, sizeof(kFalse)) != 0);
+}
+
 void OatHeader::Flatten(const SafeMap<std::string, std::string>* key_value_store) {
   char* data_ptr = reinterpret_cast<char*>(&key_value_store_);
   if (key_value_store != nullptr) {
@@ -38,6 +38,8 @@ class PACKED(4) OatHeader {
   static constexpr const char* kDex2OatCmdLineKey = "dex2oat-cmdline";
   static constexpr const char* kDex2OatHostKey = "dex2oat-host";
   static constexpr const char* kPicKey = "pic";
+  static constexpr const char* kLinkerPatchesKey = "linker-patches";
+  static constexpr const char* kCompilerOptionsKey = "compiler-options";
 
   static OatHeader* Create(InstructionSet instruction_set,
                            const InstructionSetFeatures* instruction_set_features,
@@ -107,6 +109,8 @@ class PACKED(4) OatHeader {
 
   size_t GetHeaderSize() const;
   bool IsPic() const;
+  // Returns true unless the oat file records that none of its methods had linker patches.
+  bool MayHaveLinkerPatches() const;
 
  private:
   OatHeader(InstructionSet instruction_set,
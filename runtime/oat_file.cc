@@ -33,7 +33,9 @@
 #include "mirror/object-inl.h"
 #include "os.h"
 #include "runtime.h"
+#include "type_lookup_table.h"
 #include "utils.h"
+#include "verifier/verifier_deps.h"
 #include "vmap_table.h"
 
 namespace art {
@@ -307,6 +309,49 @@ bool OatFile::Setup(std::string* error_msg) {
       return false;
     }
 
+    uint32_t lookup_table_offset = *reinterpret_cast<const uint32_t*>(oat);
+    if (UNLIKELY(lookup_table_offset > Size() || !IsAligned<4>(lookup_table_offset))) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with invalid "
+                                "type lookup table offset %ud (size %zd)", GetLocation().c_str(), i,
+                                dex_file_location.c_str(), lookup_table_offset, Size());
+      return false;
+    }
+    oat += sizeof(lookup_table_offset);
+    if (UNLIKELY(oat > End())) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' truncated "
+                                "after type lookup table offset", GetLocation().c_str(), i,
+                                dex_file_location.c_str());
+      return false;
+    }
+    const uint8_t* lookup_table_data =
+        (lookup_table_offset != 0u) ? Begin() + lookup_table_offset : nullptr;
+
+    uint32_t verifier_deps_offset = *reinterpret_cast<const uint32_t*>(oat);
+    if (UNLIKELY(verifier_deps_offset > Size() - 2 * sizeof(uint32_t) ||
+                 !IsAligned<4>(verifier_deps_offset))) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with invalid "
+                                "verifier deps offset %ud (size %zd)", GetLocation().c_str(), i,
+                                dex_file_location.c_str(), verifier_deps_offset, Size());
+      return false;
+    }
+    oat += sizeof(verifier_deps_offset);
+    if (UNLIKELY(oat > End())) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' truncated "
+                                "after verifier deps offset", GetLocation().c_str(), i,
+                                dex_file_location.c_str());
+      return false;
+    }
+    const uint8_t* verifier_deps_data =
+        (verifier_deps_offset != 0u) ? Begin() + verifier_deps_offset : nullptr;
+    if (UNLIKELY(verifier_deps_data != nullptr &&
+                 verifier::VerifierDeps::EncodedSize(verifier_deps_data) >
+                     static_cast<size_t>(End() - verifier_deps_data))) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with truncated "
+                                "verifier deps", GetLocation().c_str(), i,
+                                dex_file_location.c_str());
+      return false;
+    }
+
     const uint8_t* dex_file_pointer = Begin() + dex_file_offset;
     if (UNLIKELY(!DexFile::IsMagicValid(dex_file_pointer))) {
       *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with invalid "
@@ -321,6 +366,14 @@ bool OatFile::Setup(std::string* error_msg) {
       return false;
     }
     const DexFile::Header* header = reinterpret_cast<const DexFile::Header*>(dex_file_pointer);
+    if (UNLIKELY(lookup_table_data != nullptr &&
+                 lookup_table_data + TypeLookupTable::RawDataLength(header->class_defs_size_) >
+                     End())) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with truncated "
+                                "type lookup table", GetLocation().c_str(), i,
+                                dex_file_location.c_str());
+      return false;
+    }
     const uint32_t* methods_offsets_pointer = reinterpret_cast<const uint32_t*>(oat);
 
     oat += (sizeof(*methods_offsets_pointer) * header->class_defs_size_);
@@ -339,6 +392,8 @@ bool OatFile::Setup(std::string* error_msg) {
                                               canonical_location,
                                               dex_file_checksum,
                                               dex_file_pointer,
+                                              lookup_table_data,
+                                              verifier_deps_data,
                                               methods_offsets_pointer);
     oat_dex_files_storage_.push_back(oat_dex_file);
 
@@ -439,35 +494,39 @@ const OatFile::OatDexFile* OatFile::GetOatDexFile(const char* dex_location,
   return NULL;
 }
 
-OatFile::OatDexFile::OatDexFile(const OatFile* oat_file,
-                                const std::string& dex_file_location,
-                                const std::string& canonical_dex_file_location,
-                                uint32_t dex_file_location_checksum,
-                                const uint8_t* dex_file_pointer,
-                                const uint32_t* oat_class_offsets_pointer)
+OatDexFile::OatDexFile(const OatFile* oat_file,
+                       const std::string& dex_file_location,
+                       const std::string& canonical_dex_file_location,
+                       uint32_t dex_file_location_checksum,
+                       const uint8_t* dex_file_pointer,
+                       const uint8_t* lookup_table_data,
+                       const uint8_t* verifier_deps_data,
+                       const uint32_t* oat_class_offsets_pointer)
     : oat_file_(oat_file),
       dex_file_location_(dex_file_location),
       canonical_dex_file_location_(canonical_dex_file_location),
       dex_file_location_checksum_(dex_file_location_checksum),
       dex_file_pointer_(dex_file_pointer),
+      lookup_table_data_(lookup_table_data),
+      verifier_deps_data_(verifier_deps_data),
       oat_class_offsets_pointer_(oat_class_offsets_pointer) {}
 
-OatFile::OatDexFile::~OatDexFile() {}
+OatDexFile::~OatDexFile() {}
 
-size_t OatFile::OatDexFile::FileSize() const {
+size_t OatDexFile::FileSize() const {
   return reinterpret_cast<const DexFile::Header*>(dex_file_pointer_)->file_size_;
 }
 
-const DexFile* OatFile::OatDexFile::OpenDexFile(std::string* error_msg) const {
+const DexFile* OatDexFile::OpenDexFile(std::string* error_msg) const {
   return DexFile::Open(dex_file_pointer_, FileSize(), dex_file_location_,
-                       dex_file_location_checksum_, error_msg);
+                       dex_file_location_checksum_, this, error_msg);
 }
 
-uint32_t OatFile::OatDexFile::GetOatClassOffset(uint16_t class_def_index) const {
+uint32_t OatDexFile::GetOatClassOffset(uint16_t class_def_index) const {
   return oat_class_offsets_pointer_[class_def_index];
 }
 
-OatFile::OatClass OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) const {
+OatFile::OatClass OatDexFile::GetOatClass(uint16_t class_def_index) const {
   uint32_t oat_class_offset = GetOatClassOffset(class_def_index);
 
   const uint8_t* oat_class_pointer = oat_file_->Begin() + oat_class_offset;
@@ -502,12 +561,12 @@ OatFile::OatClass OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) con
     CHECK_LE(methods_pointer, oat_file_->End()) << oat_file_->GetLocation();
   }
 
-  return OatClass(oat_file_,
-                  status,
-                  type,
-                  bitmap_size,
-                  reinterpret_cast<const uint32_t*>(bitmap_pointer),
-                  reinterpret_cast<const OatMethodOffsets*>(methods_pointer));
+  return OatFile::OatClass(oat_file_,
+                           status,
+                           type,
+                           bitmap_size,
+                           reinterpret_cast<const uint32_t*>(bitmap_pointer),
+                           reinterpret_cast<const OatMethodOffsets*>(methods_pointer));
 }
 
 OatFile::OatClass::OatClass(const OatFile* oat_file,
@@ -71,6 +71,7 @@ ParsedOptions::ParsedOptions()
     foreground_heap_growth_multiplier_(gc::Heap::kDefaultHeapGrowthMultiplier),
     parallel_gc_threads_(1),
     conc_gc_threads_(0),                            // Only the main GC thread, no workers.
+    app_class_preload_threads_(0),                  // 0 means no class preloading.
     collector_type_(                                // The default GC type is set in makefiles.
 #if ART_DEFAULT_GC_TYPE_IS_CMS
         gc::kCollectorTypeCMS),
@@ -92,8 +93,10 @@ ParsedOptions::ParsedOptions()
                                                     // normal collector transition.
     stack_size_(0),                                 // 0 means default.
     max_spins_before_thin_lock_inflation_(Monitor::kDefaultMaxSpinsBeforeThinLockInflation),
+    use_biased_locking_(true),
     low_memory_mode_(false),
     lock_profiling_threshold_(0),
+    profile_monitor_contention_(false),
     method_trace_(false),
     method_trace_file_("/data/method-trace-file.bin"),
     method_trace_file_size_(10 * MB),
@@ -378,6 +381,10 @@ bool ParsedOptions::Parse(const RuntimeOptions& options, bool ignore_unrecognize
       if (!ParseUnsignedInteger(option, '=', &conc_gc_threads_)) {
         return false;
       }
+    } else if (StartsWith(option, "-XX:AppClassPreloadThreads=")) {
+      if (!ParseUnsignedInteger(option, '=', &app_class_preload_threads_)) {
+        return false;
+      }
     } else if (StartsWith(option, "-Xss")) {
       size_t size = ParseMemoryOption(option.substr(strlen("-Xss")).c_str(), 1);
       if (size == 0) {
@@ -414,6 +421,12 @@ bool ParsedOptions::Parse(const RuntimeOptions& options, bool ignore_unrecognize
       use_homogeneous_space_compaction_for_oom_ = true;
     } else if (option == "-XX:DisableHSpaceCompactForOOM") {
       use_homogeneous_space_compaction_for_oom_ = false;
+    } else if (option == "-XX:UseBiasedLocking") {
+      use_biased_locking_ = true;
+    } else if (option == "-XX:DisableBiasedLocking") {
+      use_biased_locking_ = false;
+    } else if (option == "-XX:ProfileMonitorContention") {
+      profile_monitor_contention_ = true;
     } else if (StartsWith(option, "-D")) {
       properties_.push_back(option.substr(strlen("-D")));
     } else if (StartsWith(option, "-Xjnitrace:")) {
@@ -805,7 +818,11 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:+DisableExplicitGC\n");
   UsageMessage(stream, "  -XX:ParallelGCThreads=integervalue\n");
   UsageMessage(stream, "  -XX:ConcGCThreads=integervalue\n");
+  UsageMessage(stream, "  -XX:AppClassPreloadThreads=integervalue\n");
   UsageMessage(stream, "  -XX:MaxSpinsBeforeThinLockInflation=integervalue\n");
+  UsageMessage(stream, "  -XX:UseBiasedLocking\n");
+  UsageMessage(stream, "  -XX:DisableBiasedLocking\n");
+  UsageMessage(stream, "  -XX:ProfileMonitorContention\n");
   UsageMessage(stream, "  -XX:LongPauseLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:LongGCLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:DumpGCPerformanceOnShutdown\n");
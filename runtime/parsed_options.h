@@ -79,12 +79,15 @@ class ParsedOptions {
   double foreground_heap_growth_multiplier_;
   unsigned int parallel_gc_threads_;
   unsigned int conc_gc_threads_;
+  unsigned int app_class_preload_threads_;
   gc::CollectorType collector_type_;
   gc::CollectorType background_collector_type_;
   size_t stack_size_;
   unsigned int max_spins_before_thin_lock_inflation_;
+  bool use_biased_locking_;
   bool low_memory_mode_;
   unsigned int lock_profiling_threshold_;
+  bool profile_monitor_contention_;
   std::string stack_trace_file_;
   bool method_trace_;
   std::string method_trace_file_;
@@ -69,6 +69,7 @@
 #include "mirror/stack_trace_element.h"
 #include "mirror/throwable.h"
 #include "monitor.h"
+#include "monitor_contention_profiler.h"
 #include "native_bridge_art_interface.h"
 #include "native/dalvik_system_DexFile.h"
 #include "native/dalvik_system_VMDebug.h"
@@ -140,8 +141,11 @@ Runtime::Runtime()
       default_stack_size_(0),
       heap_(nullptr),
       max_spins_before_thin_lock_inflation_(Monitor::kDefaultMaxSpinsBeforeThinLockInflation),
+      use_biased_locking_(true),
+      app_class_preload_threads_(0),
       monitor_list_(nullptr),
       monitor_pool_(nullptr),
+      monitor_contention_profiler_(nullptr),
       thread_list_(nullptr),
       intern_table_(nullptr),
       class_linker_(nullptr),
@@ -210,6 +214,7 @@ Runtime::~Runtime() {
   // Make sure to let the GC complete if it is running.
   heap_->WaitForGcToComplete(gc::kGcCauseBackground, self);
   heap_->DeleteThreadPool();
+  class_linker_->StopClassPreloader();
 
   // Make sure our internal threads are dead before we start tearing down things they're using.
   Dbg::StopJdwp();
@@ -223,6 +228,7 @@ Runtime::~Runtime() {
 
   delete monitor_list_;
   delete monitor_pool_;
+  delete monitor_contention_profiler_;
   delete class_linker_;
   delete heap_;
   delete intern_table_;
@@ -731,9 +737,14 @@ bool Runtime::Init(const RuntimeOptions& raw_options, bool ignore_unrecognized)
   image_location_ = options->image_;
 
   max_spins_before_thin_lock_inflation_ = options->max_spins_before_thin_lock_inflation_;
+  use_biased_locking_ = options->use_biased_locking_;
+  app_class_preload_threads_ = options->app_class_preload_threads_;
 
   monitor_list_ = new MonitorList;
   monitor_pool_ = MonitorPool::Create();
+  if (options->profile_monitor_contention_) {
+    monitor_contention_profiler_ = new MonitorContentionProfiler;
+  }
   thread_list_ = new ThreadList;
   intern_table_ = new InternTable;
 
@@ -1032,6 +1043,10 @@ void Runtime::RegisterRuntimeNativeMethods(JNIEnv* env) {
 void Runtime::DumpForSigQuit(std::ostream& os) {
   GetClassLinker()->DumpForSigQuit(os);
   GetInternTable()->DumpForSigQuit(os);
+  GetMonitorList()->DumpForSigQuit(os);
+  if (monitor_contention_profiler_ != nullptr) {
+    monitor_contention_profiler_->Dump(os);
+  }
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
   TrackedAllocators::Dump(os);
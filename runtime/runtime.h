@@ -61,6 +61,7 @@ class ClassLinker;
 class DexFile;
 class InternTable;
 class JavaVMExt;
+class MonitorContentionProfiler;
 class MonitorList;
 class MonitorPool;
 class NullPointerHandler;
@@ -240,6 +241,14 @@ class Runtime {
     return max_spins_before_thin_lock_inflation_;
   }
 
+  bool UseBiasedLocking() const {
+    return use_biased_locking_;
+  }
+
+  size_t GetAppClassPreloadThreads() const {
+    return app_class_preload_threads_;
+  }
+
   MonitorList* GetMonitorList() const {
     return monitor_list_;
   }
@@ -248,6 +257,11 @@ class Runtime {
     return monitor_pool_;
   }
 
+  // Returns nullptr unless monitor contention is profiled.
+  MonitorContentionProfiler* GetMonitorContentionProfiler() const {
+    return monitor_contention_profiler_;
+  }
+
   // Is the given object the special object used to mark a cleared JNI weak global?
   bool IsClearedJniWeakGlobal(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -556,8 +570,17 @@ class Runtime {
 
   // The number of spins that are done before thread suspension is used to forcibly inflate.
   size_t max_spins_before_thin_lock_inflation_;
+
+  // Whether locks are biased towards the first thread locking them, see LockWord.
+  bool use_biased_locking_;
+
+  // The number of threads used to preload the classes listed in the application's apk. 0 disables
+  // class preloading.
+  size_t app_class_preload_threads_;
+
   MonitorList* monitor_list_;
   MonitorPool* monitor_pool_;
+  MonitorContentionProfiler* monitor_contention_profiler_;
 
   ThreadList* thread_list_;
 
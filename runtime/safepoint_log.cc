@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "safepoint_log.h"
+
+#include <algorithm>
+#include <ostream>
+
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+constexpr size_t SafepointLog::kNumEntries;
+
+SafepointLog::SafepointLog() : lock_("safepoint log lock"), num_recorded_(0) {
+}
+
+void SafepointLog::Record(const Entry& entry) {
+  MutexLock mu(Thread::Current(), lock_);
+  entries_[num_recorded_ % kNumEntries] = entry;
+  ++num_recorded_;
+}
+
+void SafepointLog::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (num_recorded_ == 0) {
+    return;
+  }
+  os << "Recent safepoints (" << num_recorded_ << " requested):\n";
+  uint64_t num_dumped = std::min<uint64_t>(num_recorded_, kNumEntries);
+  for (uint64_t i = 1; i <= num_dumped; ++i) {
+    const Entry& entry = entries_[(num_recorded_ - i) % kNumEntries];
+    os << "  " << (entry.is_checkpoint ? "checkpoint" : "suspend all") << " for " << entry.cause
+       << " by ";
+    if (entry.requester_tid != 0) {
+      os << "tid=" << entry.requester_tid;
+    } else {
+      os << "<unattached thread>";
+    }
+    os << " took " << PrettyDuration(entry.duration_ns);
+    if (entry.straggler_tid == 0) {
+      os << ", no thread waited for\n";
+      continue;
+    }
+    os << ", last tid=" << entry.straggler_tid << " moved to " << entry.straggler_state;
+    if (entry.straggler_dex_file != nullptr) {
+      os << " in " << PrettyMethod(entry.straggler_method_idx, *entry.straggler_dex_file);
+      if (entry.straggler_in_fast_native) {
+        os << " (fast native)";
+      }
+    }
+    os << "\n";
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_SAFEPOINT_LOG_H_
+#define ART_RUNTIME_SAFEPOINT_LOG_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <iosfwd>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "thread_state.h"
+
+namespace art {
+
+class DexFile;
+
+// Remembers the most recent requests to bring threads to a safepoint, by suspending all of them
+// or by running a checkpoint, along with the thread each request waited for the longest. Used to
+// find code that is slow to reach suspend points, such as loops without suspend checks or long
+// running fast natives.
+class SafepointLog {
+ public:
+  struct Entry {
+    // Why the safepoint was requested, a string literal.
+    const char* cause;
+    bool is_checkpoint;
+    // Tid of the requesting thread, 0 if it isn't attached.
+    pid_t requester_tid;
+    // Time until the last thread acknowledged the request.
+    uint64_t duration_ns;
+    // Tid of the last thread to acknowledge the request, 0 if none was waited for.
+    pid_t straggler_tid;
+    // The state the straggler moved into to acknowledge the request. It ran until then, so this
+    // is what it did next rather than what held it up: kNative for a thread that was about to
+    // call a regular native method, kSuspended for one that reached a suspend check.
+    ThreadState straggler_state;
+    // The method the straggler acknowledged a SuspendAll in, by dex file and method index as the
+    // log outlives the pause. Null if it wasn't in a method or the request was a checkpoint.
+    const DexFile* straggler_dex_file;
+    uint32_t straggler_method_idx;
+    // Whether that method is a fast native. These stay runnable while they run and acknowledge
+    // the request only once they return, so a long running one holds up the whole safepoint.
+    bool straggler_in_fast_native;
+  };
+
+  static constexpr size_t kNumEntries = 32;
+
+  SafepointLog();
+
+  void Record(const Entry& entry) LOCKS_EXCLUDED(lock_);
+
+  // Dump the recorded requests, most recent first.
+  void Dump(std::ostream& os) LOCKS_EXCLUDED(lock_);
+
+ private:
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  Entry entries_[kNumEntries] GUARDED_BY(lock_);
+  uint64_t num_recorded_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(SafepointLog);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_SAFEPOINT_LOG_H_
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "safepoint_log.h"
+
+#include <sched.h>
+#include <sstream>
+
+#include "atomic.h"
+#include "barrier.h"
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change.h"
+#include "thread_list.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class SafepointLogTest : public CommonRuntimeTest {};
+
+TEST_F(SafepointLogTest, DumpsMostRecentFirst) {
+  const DexFile* dex_file = java_lang_dex_file_;
+  SafepointLog log;
+  log.Record({ "GC pause", false, 1, 3000000u, 7, kSuspended, dex_file, 0u, true });
+  log.Record({ "thread dump", true, 2, 2000u, 0, kSuspended, nullptr, 0u, false });
+  log.Record({ "trace", false, 0, 1000u, 8, kNative, nullptr, 0u, false });
+
+  std::ostringstream oss;
+  log.Dump(oss);
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("Recent safepoints (3 requested)")) << dump;
+  size_t unattached = dump.find(
+      "suspend all for trace by <unattached thread> took 1us, last tid=8 moved to Native\n");
+  size_t checkpoint = dump.find("checkpoint for thread dump by tid=2 took 2us, no thread waited for");
+  size_t suspend_all = dump.find(
+      "suspend all for GC pause by tid=1 took 3ms, last tid=7 moved to Suspended in " +
+      PrettyMethod(0u, *dex_file) + " (fast native)\n");
+  ASSERT_NE(std::string::npos, unattached) << dump;
+  ASSERT_NE(std::string::npos, checkpoint) << dump;
+  ASSERT_NE(std::string::npos, suspend_all) << dump;
+  EXPECT_LT(unattached, checkpoint);
+  EXPECT_LT(checkpoint, suspend_all);
+}
+
+TEST_F(SafepointLogTest, KeepsOnlyMostRecent) {
+  SafepointLog log;
+  log.Record({ "first", false, 1, 1000u, 0, kSuspended, nullptr, 0u, false });
+  for (size_t i = 0; i != SafepointLog::kNumEntries; ++i) {
+    log.Record({ "later", false, 1, 1000u, 0, kSuspended, nullptr, 0u, false });
+  }
+
+  std::ostringstream oss;
+  log.Dump(oss);
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("Recent safepoints (33 requested)")) << dump;
+  EXPECT_EQ(std::string::npos, dump.find("first")) << dump;
+}
+
+// Stays runnable until stopped, polling for suspension as compiled code does at suspend checks.
+class SpinTask : public Task {
+ public:
+  SpinTask() : running_(false), stop_(false), tid_(0) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    tid_ = self->GetTid();
+    running_.StoreSequentiallyConsistent(true);
+    while (!stop_.LoadSequentiallyConsistent()) {
+      self->AllowThreadSuspension();
+    }
+  }
+
+  Atomic<bool> running_;
+  Atomic<bool> stop_;
+  pid_t tid_;
+};
+
+// Returns the line of the dump of the runtime's safepoint log that starts with prefix.
+static std::string FindSafepointLogLine(const std::string& prefix) {
+  std::ostringstream oss;
+  Runtime::Current()->GetThreadList()->GetSafepointLog()->Dump(oss);
+  std::string dump = oss.str();
+  size_t start = dump.find("  " + prefix);
+  if (start == std::string::npos) {
+    return "";
+  }
+  return dump.substr(start + 2, dump.find('\n', start) - start - 2);
+}
+
+TEST_F(SafepointLogTest, SuspendAllIsRecorded) {
+  Thread* self = Thread::Current();
+  SpinTask task;
+  ThreadPool thread_pool("Safepoint log test thread pool", 1);
+  thread_pool.AddTask(self, &task);
+  thread_pool.StartWorkers(self);
+  while (!task.running_.LoadSequentiallyConsistent()) {
+    sched_yield();
+  }
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll("safepoint log test");
+  thread_list->ResumeAll();
+  task.stop_.StoreSequentiallyConsistent(true);
+  thread_pool.Wait(self, true, false);
+  thread_pool.StopWorkers(self);
+
+  // The worker was the only runnable thread. It acknowledged at its suspend check, outside of
+  // any method.
+  std::string line = FindSafepointLogLine(
+      StringPrintf("suspend all for safepoint log test by tid=%d took ", self->GetTid()));
+  ASSERT_FALSE(line.empty());
+  EXPECT_NE(std::string::npos,
+            line.find(StringPrintf(", last tid=%d moved to Suspended", task.tid_))) << line;
+  EXPECT_EQ(std::string::npos, line.find(" in ")) << line;
+}
+
+class PassBarrierClosure : public Closure {
+ public:
+  PassBarrierClosure() : barrier_(0) {}
+
+  void Run(Thread* thread ATTRIBUTE_UNUSED) OVERRIDE {
+    barrier_.Pass(Thread::Current());
+  }
+
+  Barrier barrier_;
+};
+
+TEST_F(SafepointLogTest, RunCheckpointIsRecorded) {
+  Thread* self = Thread::Current();
+  PassBarrierClosure checkpoint;
+  size_t count = Runtime::Current()->GetThreadList()->RunCheckpoint(&checkpoint,
+                                                                   "safepoint log test");
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    checkpoint.barrier_.Increment(self, count);
+  }
+
+  std::string line = FindSafepointLogLine(
+      StringPrintf("checkpoint for safepoint log test by tid=%d took ", self->GetTid()));
+  EXPECT_FALSE(line.empty());
+}
+
+}  // namespace art
@@ -25,6 +25,8 @@
 #include "base/mutex-inl.h"
 #include "gc/heap.h"
 #include "jni_env_ext.h"
+#include "runtime.h"
+#include "thread_list.h"
 
 namespace art {
 
@@ -129,6 +131,10 @@ inline void Thread::TransitionFromRunnableToSuspended(ThreadState new_state) {
       break;
     }
   }
+  if (UNLIKELY((new_state_and_flags.as_struct.flags & kSuspendRequest) != 0)) {
+    // Let a SuspendAll waiting for us know who it was waiting for.
+    Runtime::Current()->GetThreadList()->NoteSuspendRequestResponse(this);
+  }
   // Release share on mutator_lock_.
   Locks::mutator_lock_->SharedUnlock(this);
 }
@@ -49,6 +49,7 @@
 #include "handle_scope.h"
 #include "indirect_reference_table-inl.h"
 #include "jni_internal.h"
+#include "lock_word.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class_loader.h"
@@ -374,6 +375,9 @@ bool Thread::Init(ThreadList* thread_list, JavaVMExt* java_vm) {
   DCHECK_EQ(Thread::Current(), this);
 
   tls32_.thin_lock_thread_id = thread_list->AllocThreadId(this);
+  tls32_.thin_lock_acquire_word =
+      LockWord::FromThinLockId(tls32_.thin_lock_thread_id, 0u,
+                               Runtime::Current()->UseBiasedLocking()).GetValue();
 
   tlsPtr_.jni_env = new JNIEnvExt(this, java_vm);
   thread_list->Register(this);
@@ -723,6 +727,18 @@ bool Thread::RequestCheckpoint(Closure* function) {
   return success;
 }
 
+void Thread::RecordBiasRevocation() {
+  // Revocations are expensive, so stop biasing new locks towards a thread whose locks keep being
+  // taken by other threads. Only the revocation reaching the limit changes the acquire word, and
+  // it runs while this thread is at a checkpoint or suspended.
+  static constexpr int32_t kMaxBiasRevocations = 64;
+  if (bias_revocations_.FetchAndAddSequentiallyConsistent(1) + 1 == kMaxBiasRevocations) {
+    tls32_.thin_lock_acquire_word = LockWord::FromThinLockId(GetThreadId(), 0u).GetValue();
+    VLOG(monitor) << "Disabled biased locking for " << *this << " after "
+                  << kMaxBiasRevocations << " revocations";
+  }
+}
+
 void Thread::FullSuspendCheck() {
   VLOG(threads) << this << " self-suspending";
   ATRACE_BEGIN("Full suspend check");
@@ -1092,7 +1108,8 @@ void Thread::Shutdown() {
   }
 }
 
-Thread::Thread(bool daemon) : tls32_(daemon), wait_monitor_(nullptr), interrupted_(false) {
+Thread::Thread(bool daemon)
+    : tls32_(daemon), wait_monitor_(nullptr), interrupted_(false), bias_revocations_(0) {
   wait_mutex_ = new Mutex("a thread wait mutex");
   wait_cond_ = new ConditionVariable("a thread wait condition variable", *wait_mutex_);
   tlsPtr_.debug_invoke_req = new DebugInvokeReq;
@@ -1841,6 +1858,7 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   DO_THREAD_OFFSET(JniEnvOffset<ptr_size>(), "jni_env")
   DO_THREAD_OFFSET(SelfOffset<ptr_size>(), "self")
   DO_THREAD_OFFSET(StackEndOffset<ptr_size>(), "stack_end")
+  DO_THREAD_OFFSET(ThinLockAcquireWordOffset<ptr_size>(), "thin_lock_acquire_word")
   DO_THREAD_OFFSET(ThinLockIdOffset<ptr_size>(), "thin_lock_thread_id")
   DO_THREAD_OFFSET(TopOfManagedStackOffset<ptr_size>(), "top_quick_frame_method")
   DO_THREAD_OFFSET(TopShadowFrameOffset<ptr_size>(), "top_shadow_frame")
@@ -1929,6 +1947,9 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   QUICK_ENTRY_POINT_INFO(pJniMethodEndSynchronized)
   QUICK_ENTRY_POINT_INFO(pJniMethodEndWithReference)
   QUICK_ENTRY_POINT_INFO(pJniMethodEndWithReferenceSynchronized)
+  QUICK_ENTRY_POINT_INFO(pJniMethodFastStart)
+  QUICK_ENTRY_POINT_INFO(pJniMethodFastEnd)
+  QUICK_ENTRY_POINT_INFO(pJniMethodFastEndWithReference)
   QUICK_ENTRY_POINT_INFO(pQuickGenericJniTrampoline)
   QUICK_ENTRY_POINT_INFO(pLockObject)
   QUICK_ENTRY_POINT_INFO(pUnlockObject)
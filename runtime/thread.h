@@ -36,6 +36,7 @@
 #include "globals.h"
 #include "handle_scope.h"
 #include "jvalue.h"
+#include "lookup_cache.h"
 #include "object_callbacks.h"
 #include "offsets.h"
 #include "runtime_stats.h"
@@ -286,6 +287,15 @@ class Thread {
     return tls32_.thin_lock_thread_id;
   }
 
+  // The lock word to install when locking an unlocked object, see thin_lock_acquire_word.
+  uint32_t GetThinLockAcquireWord() const {
+    return tls32_.thin_lock_acquire_word;
+  }
+
+  // Called when a lock biased towards this thread had its bias revoked by another thread. Stops
+  // biasing new locks towards this thread once that happened too often.
+  void RecordBiasRevocation();
+
   pid_t GetTid() const {
     return tls32_.tid;
   }
@@ -502,6 +512,13 @@ class Thread {
         OFFSETOF_MEMBER(tls_32bit_sized_values, thin_lock_thread_id));
   }
 
+  template<size_t pointer_size>
+  static ThreadOffset<pointer_size> ThinLockAcquireWordOffset() {
+    return ThreadOffset<pointer_size>(
+        OFFSETOF_MEMBER(Thread, tls32_) +
+        OFFSETOF_MEMBER(tls_32bit_sized_values, thin_lock_acquire_word));
+  }
+
   template<size_t pointer_size>
   static ThreadOffset<pointer_size> ThreadFlagsOffset() {
     return ThreadOffset<pointer_size>(
@@ -761,6 +778,16 @@ class Thread {
     tlsPtr_.held_mutexes[level] = mutex;
   }
 
+  // Strong interns recently looked up by InternTable::InternStrong.
+  LookupCache* GetInternLookupCache() {
+    return &intern_lookup_cache_;
+  }
+
+  // Classes recently found by ClassLinker::FindClass, with their class loader as context.
+  LookupCache* GetClassLookupCache() {
+    return &class_lookup_cache_;
+  }
+
   void RunCheckpointFunction();
 
   bool ReadFlag(ThreadFlag flag) const {
@@ -959,7 +986,7 @@ class Thread {
       suspend_count(0), debug_suspend_count(0), thin_lock_thread_id(0), tid(0),
       daemon(is_daemon), throwing_OutOfMemoryError(false), no_thread_suspension(0),
       thread_exit_check_count(0), is_exception_reported_to_instrumentation_(false),
-      handling_signal_(false), padding_(0) {
+      handling_signal_(false), thin_lock_acquire_word(0) {
     }
 
     union StateAndFlags state_and_flags;
@@ -1003,8 +1030,10 @@ class Thread {
     // True if signal is being handled by this thread.
     bool32_t handling_signal_;
 
-    // Padding to make the size aligned to 8.  Remove this if we add another 32 bit field.
-    int32_t padding_;
+    // The lock word this thread stores into an unlocked object to lock it: biased towards the
+    // thread and held once, or a plain thin lock once biased locking is disabled for the thread.
+    // Its low bits are the thin lock thread id so the lock fast paths can compare owners with it.
+    uint32_t thin_lock_acquire_word;
   } tls32_;
 
   struct PACKED(8) tls_64bit_sized_values {
@@ -1162,6 +1191,12 @@ class Thread {
   // Thread "interrupted" status; stays raised until queried or thrown.
   bool interrupted_ GUARDED_BY(wait_mutex_);
 
+  // Number of locks biased towards this thread that other threads had to revoke.
+  AtomicInteger bias_revocations_;
+
+  LookupCache intern_lookup_cache_;
+  LookupCache class_lookup_cache_;
+
   friend class Dbg;  // For SetStateUnsafe.
   friend class gc::collector::SemiSpace;  // For getting stack traces.
   friend class Runtime;  // For CreatePeer.
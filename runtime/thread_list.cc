@@ -33,9 +33,11 @@
 #include "debugger.h"
 #include "jni_internal.h"
 #include "lock_word.h"
+#include "mirror/art_method-inl.h"
 #include "monitor.h"
 #include "scoped_thread_state_change.h"
 #include "thread.h"
+#include "thread_pool.h"
 #include "trace.h"
 #include "utils.h"
 #include "well_known_classes.h"
@@ -43,9 +45,19 @@
 namespace art {
 
 static constexpr uint64_t kLongThreadSuspendThreshold = MsToNs(5);
+// Time-to-safepoint histogram buckets, in microseconds.
+static constexpr uint64_t kSuspendAllBucketSize = 50;
+static constexpr size_t kSuspendAllBucketCount = 64;
+
+constexpr size_t ThreadList::kMinParallelCheckpoints;
 
 ThreadList::ThreadList()
     : suspend_all_count_(0), debug_suspend_all_count_(0),
+      suspend_all_straggler_(nullptr),
+      suspend_all_histogram_lock_("suspend all histogram lock"),
+      suspend_all_histogram_("suspend all time-to-safepoint", kSuspendAllBucketSize,
+                             kSuspendAllBucketCount),
+      slowest_suspend_all_ns_(0), slowest_suspend_all_straggler_tid_(0),
       thread_exit_cond_("thread exit condition variable", *Locks::thread_list_lock_) {
   CHECK(Monitor::IsValidLockWord(LockWord::FromThinLockId(kMaxThreadId, 1)));
 }
@@ -83,6 +95,15 @@ bool ThreadList::Contains(pid_t tid) {
   return false;
 }
 
+bool ThreadList::ContainsThreadId(uint32_t thread_id) {
+  for (const auto& thread : list_) {
+    if (thread->GetThreadId() == thread_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
 pid_t ThreadList::GetLockOwner() {
   return Locks::thread_list_lock_->GetExclusiveOwnerTid();
 }
@@ -97,10 +118,28 @@ void ThreadList::DumpNativeStacks(std::ostream& os) {
 }
 
 void ThreadList::DumpForSigQuit(std::ostream& os) {
+  DumpSuspendAllTimes(os);
+  safepoint_log_.Dump(os);
   Dump(os);
   DumpUnattachedThreads(os);
 }
 
+void ThreadList::DumpSuspendAllTimes(std::ostream& os) {
+  MutexLock mu(Thread::Current(), suspend_all_histogram_lock_);
+  if (suspend_all_histogram_.SampleSize() == 0) {
+    return;
+  }
+  Histogram<uint64_t>::CumulativeData cumulative_data;
+  suspend_all_histogram_.CreateHistogram(&cumulative_data);
+  suspend_all_histogram_.PrintConfidenceIntervals(os, 0.99, cumulative_data);
+  os << "Slowest suspend all: " << PrettyDuration(slowest_suspend_all_ns_) << " waiting for ";
+  if (slowest_suspend_all_straggler_tid_ != 0) {
+    os << "tid=" << slowest_suspend_all_straggler_tid_ << "\n";
+  } else {
+    os << "<no runnable thread>\n";
+  }
+}
+
 static void DumpUnattachedThread(std::ostream& os, pid_t tid) NO_THREAD_SAFETY_ANALYSIS {
   // TODO: No thread safety analysis as DumpState with a NULL thread won't access fields, should
   // refactor DumpState to avoid skipping analysis.
@@ -185,7 +224,7 @@ void ThreadList::Dump(std::ostream& os) {
     os << "DALVIK THREADS (" << list_.size() << "):\n";
   }
   DumpCheckpoint checkpoint(&os);
-  size_t threads_running_checkpoint = RunCheckpoint(&checkpoint);
+  size_t threads_running_checkpoint = RunCheckpoint(&checkpoint, "thread dump");
   checkpoint.WaitForThreadsToRunThroughCheckpoint(threads_running_checkpoint);
 }
 
@@ -236,8 +275,80 @@ static void ThreadSuspendSleep(useconds_t* delay_us, useconds_t* total_delay_us)
   }
 }
 
-size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
+static std::string DescribeThread(Thread* thread) {
+  if (thread == nullptr) {
+    return "<unattached thread>";
+  }
+  std::string name;
+  thread->GetThreadName(name);
+  return StringPrintf("\"%s\" tid=%d", name.c_str(), thread->GetTid());
+}
+
+// How long RunCheckpoint waited for a thread to suspend, and the thread if it had to wait.
+struct CheckpointWait {
+  CheckpointWait() : wait_ns(0), tid(0), state(kSuspended) {}
+
+  uint64_t wait_ns;
+  pid_t tid;
+  ThreadState state;
+};
+
+// Run the checkpoint of a thread whose suspend count was raised by RunCheckpoint once it is
+// suspended, then lower the count again.
+static void RunCheckpointOnSuspendedThread(Thread* self, Closure* checkpoint_function,
+                                           Thread* thread, CheckpointWait* wait)
+    LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_) {
+  if (!thread->IsSuspended()) {
+    // Wait until the thread is suspended.
+    uint64_t start_ns = NanoTime();
+    useconds_t total_delay_us = 0;
+    do {
+      useconds_t delay_us = 100;
+      ThreadSuspendSleep(&delay_us, &total_delay_us);
+    } while (!thread->IsSuspended());
+    wait->wait_ns = NanoTime() - start_ns;
+    wait->tid = thread->GetTid();
+    wait->state = thread->GetState();
+    // Shouldn't need to wait for longer than 1000 microseconds.
+    constexpr useconds_t kLongWaitThresholdUS = 1000;
+    if (UNLIKELY(total_delay_us > kLongWaitThresholdUS)) {
+      LOG(WARNING) << "Waited " << total_delay_us << " us for thread suspend of " << *thread;
+    }
+  }
+  // We know for sure that the thread is suspended at this point.
+  checkpoint_function->Run(thread);
+  {
+    MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
+    thread->ModifySuspendCount(self, -1, false);
+  }
+}
+
+// Runs the checkpoint of a suspended thread on a thread pool worker.
+class SuspendedThreadCheckpointTask : public Task {
+ public:
+  SuspendedThreadCheckpointTask(Closure* checkpoint_function, Thread* thread,
+                                CheckpointWait* wait)
+      : checkpoint_function_(checkpoint_function), thread_(thread), wait_(wait) {
+  }
+
+  virtual void Run(Thread* self) OVERRIDE {
+    RunCheckpointOnSuspendedThread(self, checkpoint_function_, thread_, wait_);
+  }
+
+  virtual void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  Closure* const checkpoint_function_;
+  Thread* const thread_;
+  CheckpointWait* const wait_;
+};
+
+size_t ThreadList::RunCheckpoint(Closure* checkpoint_function, const char* cause,
+                                 ThreadPool* thread_pool) {
   Thread* self = Thread::Current();
+  uint64_t start_ns = NanoTime();
   Locks::mutator_lock_->AssertNotExclusiveHeld(self);
   Locks::thread_list_lock_->AssertNotHeld(self);
   Locks::thread_suspend_count_lock_->AssertNotHeld(self);
@@ -275,32 +386,49 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
     }
   }
 
-  // Run the checkpoint on ourself while we wait for threads to suspend.
-  checkpoint_function->Run(self);
-
-  // Run the checkpoint on the suspended threads.
-  for (const auto& thread : suspended_count_modified_threads) {
-    if (!thread->IsSuspended()) {
-      // Wait until the thread is suspended.
-      useconds_t total_delay_us = 0;
-      do {
-        useconds_t delay_us = 100;
-        ThreadSuspendSleep(&delay_us, &total_delay_us);
-      } while (!thread->IsSuspended());
-      // Shouldn't need to wait for longer than 1000 microseconds.
-      constexpr useconds_t kLongWaitThresholdUS = 1000;
-      if (UNLIKELY(total_delay_us > kLongWaitThresholdUS)) {
-        LOG(WARNING) << "Waited " << total_delay_us << " us for thread suspend!";
-      }
+  std::vector<CheckpointWait> waits(suspended_count_modified_threads.size());
+  if (thread_pool != nullptr && thread_pool->GetThreadCount() != 0 &&
+      suspended_count_modified_threads.size() >= kMinParallelCheckpoints) {
+    // Hand the suspended threads to the workers, which wait for them to suspend independently so
+    // that one slow thread doesn't hold up the checkpoints of all the others.
+    for (size_t i = 0; i != suspended_count_modified_threads.size(); ++i) {
+      thread_pool->AddTask(self, new SuspendedThreadCheckpointTask(
+          checkpoint_function, suspended_count_modified_threads[i], &waits[i]));
     }
-    // We know for sure that the thread is suspended at this point.
-    checkpoint_function->Run(thread);
-    {
-      MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
-      thread->ModifySuspendCount(self, -1, false);
+    thread_pool->SetMaxActiveWorkers(thread_pool->GetThreadCount());
+    thread_pool->StartWorkers(self);
+    // Run the checkpoint on ourself while the workers wait for threads to suspend. The tasks are
+    // left to the workers, so that a slow thread doesn't hold up this one either.
+    checkpoint_function->Run(self);
+    thread_pool->Wait(self, false, true);
+    thread_pool->StopWorkers(self);
+  } else {
+    // Run the checkpoint on ourself while we wait for threads to suspend.
+    checkpoint_function->Run(self);
+
+    // Run the checkpoint on the suspended threads.
+    for (size_t i = 0; i != suspended_count_modified_threads.size(); ++i) {
+      RunCheckpointOnSuspendedThread(self, checkpoint_function,
+                                     suspended_count_modified_threads[i], &waits[i]);
     }
   }
 
+  // Runnable threads acknowledge the checkpoint by themselves, the straggler is the suspended
+  // thread we waited for the longest.
+  SafepointLog::Entry entry = { cause, true, self != nullptr ? self->GetTid() : 0,
+                                NanoTime() - start_ns, 0, kSuspended, nullptr, 0u, false };
+  const CheckpointWait* slowest_wait = nullptr;
+  for (const CheckpointWait& wait : waits) {
+    if (wait.wait_ns != 0 && (slowest_wait == nullptr || wait.wait_ns > slowest_wait->wait_ns)) {
+      slowest_wait = &wait;
+    }
+  }
+  if (slowest_wait != nullptr) {
+    entry.straggler_tid = slowest_wait->tid;
+    entry.straggler_state = slowest_wait->state;
+  }
+  safepoint_log_.Record(entry);
+
   {
     // Imitate ResumeAll, threads may be waiting on Thread::resume_cond_ since we raised their
     // suspend count. Now the suspend_count_ is lowered so we must do the broadcast.
@@ -340,13 +468,70 @@ size_t ThreadList::RunCheckpointOnRunnableThreads(Closure* checkpoint_function)
   return count;
 }
 
-void ThreadList::SuspendAll() {
+bool ThreadList::RequestCheckpointOnThread(uint32_t thread_id, Closure* checkpoint_function) {
+  Thread* self = Thread::Current();
+  CHECK_NE(self->GetThreadId(), thread_id);
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
+  for (const auto& thread : list_) {
+    if (thread->GetThreadId() == thread_id) {
+      return thread->RequestCheckpoint(checkpoint_function);
+    }
+  }
+  return false;
+}
+
+void ThreadList::RecordSuspendAllTime(Thread* self, const char* cause, uint64_t duration_ns) {
+  SafepointLog::Entry entry = { cause, false, self != nullptr ? self->GetTid() : 0, duration_ns,
+                                0, kSuspended, nullptr, 0u, false };
+  // The straggler is still where it acknowledged the suspension, as all threads are, and cannot
+  // unregister until ResumeAll.
+  Thread* straggler = suspend_all_straggler_.LoadRelaxed();
+  if (straggler != nullptr) {
+    entry.straggler_tid = straggler->GetTid();
+    entry.straggler_state = straggler->GetState();
+    mirror::ArtMethod* method = straggler->GetCurrentMethod(nullptr, false);
+    if (method != nullptr) {
+      entry.straggler_in_fast_native = method->IsFastNative();
+      method = method->GetInterfaceMethodIfProxy();
+      entry.straggler_dex_file = method->GetDexFile();
+      entry.straggler_method_idx = method->GetDexMethodIndex();
+    }
+  }
+  if (UNLIKELY(duration_ns > kLongThreadSuspendThreshold)) {
+    // Rare enough to spend the time to describe the straggler.
+    std::ostringstream description;
+    if (straggler == nullptr) {
+      description << "<no runnable thread>";
+    } else {
+      description << DescribeThread(straggler) << " after moving to " << entry.straggler_state;
+      if (entry.straggler_dex_file != nullptr) {
+        description << " in "
+                    << PrettyMethod(entry.straggler_method_idx, *entry.straggler_dex_file);
+        if (entry.straggler_in_fast_native) {
+          description << " (fast native)";
+        }
+      }
+    }
+    LOG(WARNING) << "Suspending all threads for " << cause << " took: "
+                 << PrettyDuration(duration_ns) << " waiting for " << description.str();
+  }
+  safepoint_log_.Record(entry);
+  MutexLock mu(self, suspend_all_histogram_lock_);
+  suspend_all_histogram_.AddValue(duration_ns / 1000);
+  if (duration_ns > slowest_suspend_all_ns_) {
+    slowest_suspend_all_ns_ = duration_ns;
+    slowest_suspend_all_straggler_tid_ = entry.straggler_tid;
+  }
+}
+
+void ThreadList::SuspendAll(const char* cause) {
   Thread* self = Thread::Current();
 
   if (self != nullptr) {
-    VLOG(threads) << *self << " SuspendAll starting...";
+    VLOG(threads) << *self << " SuspendAll for " << cause << " starting...";
   } else {
-    VLOG(threads) << "Thread[null] SuspendAll starting...";
+    VLOG(threads) << "Thread[null] SuspendAll for " << cause << " starting...";
   }
   ATRACE_BEGIN("Suspending mutator threads");
   uint64_t start_time = NanoTime();
@@ -362,6 +547,7 @@ void ThreadList::SuspendAll() {
     MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
     // Update global suspend all state for attaching threads.
     ++suspend_all_count_;
+    suspend_all_straggler_.StoreRelaxed(nullptr);
     // Increment everybody's suspend count (except our own).
     for (const auto& thread : list_) {
       if (thread == self) {
@@ -382,10 +568,7 @@ void ThreadList::SuspendAll() {
   Locks::mutator_lock_->ExclusiveLock(self);
 #endif
 
-  uint64_t end_time = NanoTime();
-  if (end_time - start_time > kLongThreadSuspendThreshold) {
-    LOG(WARNING) << "Suspending all threads took: " << PrettyDuration(end_time - start_time);
-  }
+  RecordSuspendAllTime(self, cause, NanoTime() - start_time);
 
   if (kDebugLocking) {
     // Debug check that all threads are suspended.
@@ -17,16 +17,21 @@
 #ifndef ART_RUNTIME_THREAD_LIST_H_
 #define ART_RUNTIME_THREAD_LIST_H_
 
+#include "atomic.h"
+#include "base/histogram.h"
 #include "base/mutex.h"
 #include "jni.h"
 #include "object_callbacks.h"
+#include "safepoint_log.h"
 
 #include <bitset>
 #include <list>
+#include <string>
 
 namespace art {
 class Closure;
 class Thread;
+class ThreadPool;
 class TimingLogger;
 
 class ThreadList {
@@ -34,12 +39,15 @@ class ThreadList {
   static const uint32_t kMaxThreadId = 0xFFFF;
   static const uint32_t kInvalidThreadId = 0;
   static const uint32_t kMainThreadId = 1;
+  // RunCheckpoint only hands the checkpoints of suspended threads to a thread pool when there are
+  // at least this many, as waking up the workers would cost more than it saves.
+  static constexpr size_t kMinParallelCheckpoints = 16;
 
   explicit ThreadList();
   ~ThreadList();
 
   void DumpForSigQuit(std::ostream& os)
-      LOCKS_EXCLUDED(Locks::thread_list_lock_);
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, suspend_all_histogram_lock_);
   // For thread suspend timeout dumps.
   void Dump(std::ostream& os)
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
@@ -54,8 +62,9 @@ class ThreadList {
   void Resume(Thread* thread, bool for_debugger = false)
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_);
 
-  // Suspends all threads and gets exclusive access to the mutator_lock_.
-  void SuspendAll()
+  // Suspends all threads and gets exclusive access to the mutator_lock_. The cause is a string
+  // literal recorded in the safepoint log.
+  void SuspendAll(const char* cause)
       EXCLUSIVE_LOCK_FUNCTION(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
                      Locks::thread_suspend_count_lock_);
@@ -85,8 +94,12 @@ class ThreadList {
   Thread* FindThreadByThreadId(uint32_t thin_lock_id);
 
   // Run a checkpoint on threads, running threads are not suspended but run the checkpoint inside
-  // of the suspend check. Returns how many checkpoints we should expect to run.
-  size_t RunCheckpoint(Closure* checkpoint_function)
+  // of the suspend check. Returns how many checkpoints we should expect to run. If a thread pool
+  // owned by the caller is given, the checkpoints of threads which are already suspended are run
+  // in parallel by its workers rather than one after another by the caller. The cause is a string
+  // literal recorded in the safepoint log.
+  size_t RunCheckpoint(Closure* checkpoint_function, const char* cause,
+                       ThreadPool* thread_pool = nullptr)
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
                      Locks::thread_suspend_count_lock_);
 
@@ -94,6 +107,26 @@ class ThreadList {
   LOCKS_EXCLUDED(Locks::thread_list_lock_,
                  Locks::thread_suspend_count_lock_);
 
+  // Request a checkpoint on the runnable thread with the given thread id. Returns false if there
+  // is no such thread or it isn't runnable, in which case the checkpoint won't be run.
+  bool RequestCheckpointOnThread(uint32_t thread_id, Closure* checkpoint_function)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_,
+                     Locks::thread_suspend_count_lock_);
+
+  // Called by a thread leaving the runnable state while its suspension is requested. The last
+  // thread to do so holds up a SuspendAll the longest and is reported as its straggler.
+  void NoteSuspendRequestResponse(Thread* self) {
+    suspend_all_straggler_.StoreRelaxed(self);
+  }
+
+  // The most recent SuspendAll and checkpoint requests.
+  SafepointLog* GetSafepointLog() {
+    return &safepoint_log_;
+  }
+
+  // Whether a live thread has the given thread id.
+  bool ContainsThreadId(uint32_t thread_id) EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_);
+
   // Suspends all threads
   void SuspendAllForDebugger()
       LOCKS_EXCLUDED(Locks::mutator_lock_,
@@ -157,6 +190,14 @@ class ThreadList {
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
                      Locks::thread_suspend_count_lock_);
 
+  // Record how long a SuspendAll took to reach the safepoint and which thread it waited for. Runs
+  // while all threads are suspended, so only the straggler's top frame is looked up, and only
+  // pauses above kLongThreadSuspendThreshold spend the time to name it.
+  void RecordSuspendAllTime(Thread* self, const char* cause, uint64_t duration_ns)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, suspend_all_histogram_lock_);
+  void DumpSuspendAllTimes(std::ostream& os) LOCKS_EXCLUDED(suspend_all_histogram_lock_);
+
   std::bitset<kMaxThreadId> allocated_ids_ GUARDED_BY(Locks::allocated_thread_ids_lock_);
 
   // The actual list of all threads.
@@ -166,6 +207,20 @@ class ThreadList {
   int suspend_all_count_ GUARDED_BY(Locks::thread_suspend_count_lock_);
   int debug_suspend_all_count_ GUARDED_BY(Locks::thread_suspend_count_lock_);
 
+  // The last thread to respond to a suspend request, null if none since SuspendAll started. A
+  // thread stored after SuspendAll raised the suspend counts cannot unregister before ResumeAll,
+  // so the pointer is valid while SuspendAll records its straggler.
+  Atomic<Thread*> suspend_all_straggler_;
+
+  // Time-to-safepoint of SuspendAll in microseconds, and the slowest one's straggler.
+  Mutex suspend_all_histogram_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  Histogram<uint64_t> suspend_all_histogram_ GUARDED_BY(suspend_all_histogram_lock_);
+  uint64_t slowest_suspend_all_ns_ GUARDED_BY(suspend_all_histogram_lock_);
+  pid_t slowest_suspend_all_straggler_tid_ GUARDED_BY(suspend_all_histogram_lock_);
+
+  // The most recent SuspendAll and checkpoint requests.
+  SafepointLog safepoint_log_;
+
   // Signaled when threads terminate. Used to determine when all non-daemons have terminated.
   ConditionVariable thread_exit_cond_ GUARDED_BY(Locks::thread_list_lock_);
 
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thread_list.h"
+
+#include <pthread.h>
+
+#include <map>
+#include <vector>
+
+#include "barrier.h"
+#include "common_runtime_test.h"
+#include "java_vm_ext.h"
+#include "thread-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class ThreadListTest : public CommonRuntimeTest {};
+
+// Counts how often the checkpoint ran for each thread, and on which threads it ran.
+class CountingCheckpoint : public Closure {
+ public:
+  CountingCheckpoint() : lock_("counting checkpoint lock") {}
+
+  void Run(Thread* thread) OVERRIDE {
+    Thread* self = Thread::Current();
+    MutexLock mu(self, lock_);
+    ++runs_[thread];
+    run_by_[thread] = self;
+  }
+
+  size_t GetRuns(Thread* thread) {
+    MutexLock mu(Thread::Current(), lock_);
+    return runs_[thread];
+  }
+
+  Thread* GetRunBy(Thread* thread) {
+    MutexLock mu(Thread::Current(), lock_);
+    return run_by_[thread];
+  }
+
+  size_t GetNumThreads() {
+    MutexLock mu(Thread::Current(), lock_);
+    return runs_.size();
+  }
+
+ private:
+  Mutex lock_;
+  std::map<Thread*, size_t> runs_ GUARDED_BY(lock_);
+  std::map<Thread*, Thread*> run_by_ GUARDED_BY(lock_);
+};
+
+// Attaches, leaving the thread in the native state and so suspended as far as checkpoints go,
+// and waits until the test is done with it.
+struct AttachedThreadArgs {
+  Barrier* attached;
+  Barrier* finished;
+};
+
+static void* AttachAndWait(void* arg) {
+  AttachedThreadArgs* args = reinterpret_cast<AttachedThreadArgs*>(arg);
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  JNIEnv* env;
+  CHECK_EQ(JNI_OK, vm->AttachCurrentThread(&env, nullptr));
+  Thread* self = Thread::Current();
+  args->attached->Pass(self);
+  args->finished->Increment(self, 0);
+  CHECK_EQ(JNI_OK, vm->DetachCurrentThread());
+  return nullptr;
+}
+
+static void AddThread(Thread* thread, void* arg) {
+  reinterpret_cast<std::vector<Thread*>*>(arg)->push_back(thread);
+}
+
+TEST_F(ThreadListTest, ParallelCheckpointRunsOncePerThread) {
+  Thread* self = Thread::Current();
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  const size_t num_threads = 2 * ThreadList::kMinParallelCheckpoints;
+  Barrier attached(0);
+  Barrier finished(1);
+  AttachedThreadArgs args = { &attached, &finished };
+  std::vector<pthread_t> pthreads(num_threads);
+  for (pthread_t& pthread : pthreads) {
+    CHECK_PTHREAD_CALL(pthread_create, (&pthread, nullptr, AttachAndWait, &args),
+                       "attached thread");
+  }
+  attached.Increment(self, num_threads);
+
+  std::unique_ptr<ThreadPool> thread_pool(new ThreadPool("checkpoint thread pool", 4));
+  std::vector<Thread*> threads;
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    thread_list->ForEach(AddThread, &threads);
+  }
+  ASSERT_GE(threads.size(), num_threads + 1);
+
+  // None of the threads is runnable, so all but this one have their checkpoints run by the
+  // thread pool.
+  CountingCheckpoint checkpoint;
+  EXPECT_EQ(threads.size(),
+            thread_list->RunCheckpoint(&checkpoint, "test", thread_pool.get()));
+  EXPECT_EQ(threads.size(), checkpoint.GetNumThreads());
+  for (Thread* thread : threads) {
+    EXPECT_EQ(1u, checkpoint.GetRuns(thread)) << *thread;
+    if (thread == self) {
+      EXPECT_EQ(self, checkpoint.GetRunBy(thread));
+    } else {
+      EXPECT_NE(self, checkpoint.GetRunBy(thread)) << *thread;
+    }
+  }
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
+    for (Thread* thread : threads) {
+      EXPECT_EQ(0, thread->GetSuspendCount()) << *thread;
+    }
+  }
+
+  thread_pool.reset();
+  finished.Pass(self);
+  for (pthread_t& pthread : pthreads) {
+    CHECK_PTHREAD_CALL(pthread_join, (pthread, nullptr), "attached thread");
+  }
+}
+
+}  // namespace art
@@ -315,7 +315,7 @@ void* Trace::RunSamplingThread(void* arg) {
       }
     }
 
-    runtime->GetThreadList()->SuspendAll();
+    runtime->GetThreadList()->SuspendAll("trace sampling");
     {
       MutexLock mu(self, *Locks::thread_list_lock_);
       runtime->GetThreadList()->ForEach(GetSample, the_trace);
@@ -369,7 +369,7 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
   // Enable count of allocs if specified in the flags.
   bool enable_stats = false;
 
-  runtime->GetThreadList()->SuspendAll();
+  runtime->GetThreadList()->SuspendAll("trace start");
 
   // Create Trace object.
   {
@@ -404,7 +404,7 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
 void Trace::Stop() {
   bool stop_alloc_counting = false;
   Runtime* runtime = Runtime::Current();
-  runtime->GetThreadList()->SuspendAll();
+  runtime->GetThreadList()->SuspendAll("trace stop");
   Trace* the_trace = NULL;
   pthread_t sampling_pthread = 0U;
   {
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "type_lookup_table.h"
+
+#include <memory>
+
+#include "common_runtime_test.h"
+#include "dex_file-inl.h"
+#include "scoped_thread_state_change.h"
+#include "utf-inl.h"
+#include "utils.h"
+
+namespace art {
+
+class TypeLookupTableTest : public CommonRuntimeTest {};
+
+TEST_F(TypeLookupTableTest, CreateLookupTable) {
+  ScopedObjectAccess soa(Thread::Current());
+  std::unique_ptr<const DexFile> dex_file(OpenTestDexFile("Interfaces"));
+  ASSERT_TRUE(dex_file.get() != nullptr);
+  std::unique_ptr<TypeLookupTable> table(TypeLookupTable::Create(*dex_file));
+  ASSERT_TRUE(table.get() != nullptr);
+  ASSERT_NE(0u, table->RawDataLength());
+  EXPECT_EQ(TypeLookupTable::RawDataLength(*dex_file), table->RawDataLength());
+  EXPECT_GE(table->Size(), dex_file->NumClassDefs());
+  EXPECT_TRUE(IsPowerOfTwo(table->Size()));
+}
+
+TEST_F(TypeLookupTableTest, Find) {
+  ScopedObjectAccess soa(Thread::Current());
+  std::unique_ptr<const DexFile> dex_file(OpenTestDexFile("Interfaces"));
+  ASSERT_TRUE(dex_file.get() != nullptr);
+  std::unique_ptr<TypeLookupTable> table(TypeLookupTable::Create(*dex_file));
+  ASSERT_TRUE(table.get() != nullptr);
+  for (size_t i = 0; i < dex_file->NumClassDefs(); ++i) {
+    const char* descriptor = dex_file->GetClassDescriptor(dex_file->GetClassDef(i));
+    uint32_t hash = ComputeModifiedUtf8Hash(descriptor);
+    EXPECT_EQ(i, table->Lookup(descriptor, hash)) << descriptor;
+  }
+  const char* missing = "LInterfaces$Missing;";
+  EXPECT_EQ(DexFile::kDexNoIndex, table->Lookup(missing, ComputeModifiedUtf8Hash(missing)));
+}
+
+TEST_F(TypeLookupTableTest, OpenFromRawData) {
+  ScopedObjectAccess soa(Thread::Current());
+  std::unique_ptr<const DexFile> dex_file(OpenTestDexFile("Interfaces"));
+  ASSERT_TRUE(dex_file.get() != nullptr);
+  std::unique_ptr<TypeLookupTable> table(TypeLookupTable::Create(*dex_file));
+  ASSERT_TRUE(table.get() != nullptr);
+  // Reopen the table over the raw data, as DexFile does for the copy mapped from an oat file.
+  std::unique_ptr<TypeLookupTable> opened(TypeLookupTable::Open(table->RawData(), *dex_file));
+  ASSERT_TRUE(opened.get() != nullptr);
+  EXPECT_EQ(table->Size(), opened->Size());
+  EXPECT_EQ(table->RawData(), opened->RawData());
+  for (size_t i = 0; i < dex_file->NumClassDefs(); ++i) {
+    const char* descriptor = dex_file->GetClassDescriptor(dex_file->GetClassDef(i));
+    EXPECT_EQ(i, opened->Lookup(descriptor, ComputeModifiedUtf8Hash(descriptor))) << descriptor;
+  }
+}
+
+}  // namespace art
@@ -210,6 +210,17 @@ uint64_t ThreadCpuNanoTime() {
 #endif
 }
 
+uint64_t ProcessCpuNanoTime() {
+#if defined(HAVE_POSIX_CLOCKS)
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return static_cast<uint64_t>(now.tv_sec) * UINT64_C(1000000000) + now.tv_nsec;
+#else
+  UNIMPLEMENTED(WARNING);
+  return -1;
+#endif
+}
+
 void NanoSleep(uint64_t ns) {
   timespec tm;
   tm.tv_sec = 0;
@@ -50,6 +50,10 @@ inline MethodReference MethodVerifier::GetMethodReference() const {
   return MethodReference(dex_file_, dex_method_idx_);
 }
 
+inline uint16_t MethodVerifier::GetClassDefIndex() const {
+  return dex_file_->GetIndexForClassDef(*class_def_);
+}
+
 inline uint32_t MethodVerifier::GetAccessFlags() const {
   return method_access_flags_;
 }
@@ -66,6 +70,10 @@ inline bool MethodVerifier::HasFailures() const {
   return !failure_messages_.empty();
 }
 
+inline bool MethodVerifier::HasNonResolutionSoftFailures() const {
+  return have_non_resolution_soft_failure_;
+}
+
 inline const RegType& MethodVerifier::ResolveCheckedClass(uint32_t class_idx) {
   DCHECK(!HasFailures());
   const RegType& result = ResolveClassAndCheckAccess(class_idx);
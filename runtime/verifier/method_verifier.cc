@@ -362,6 +362,7 @@ MethodVerifier::MethodVerifier(Thread* self,
       monitor_enter_dex_pcs_(nullptr),
       have_pending_hard_failure_(false),
       have_pending_runtime_throw_failure_(false),
+      have_non_resolution_soft_failure_(false),
       new_instance_count_(0),
       monitor_enter_count_(0),
       can_load_classes_(can_load_classes),
@@ -551,6 +552,7 @@ std::ostream& MethodVerifier::Fail(VerifyError error) {
       break;
       // Indication that verification should be retried at runtime.
     case VERIFY_ERROR_BAD_CLASS_SOFT:
+      have_non_resolution_soft_failure_ = true;
       if (!allow_soft_failures_) {
         have_pending_hard_failure_ = true;
       }
@@ -232,10 +232,12 @@ class MethodVerifier {
   mirror::ClassLoader* GetClassLoader() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::DexCache* GetDexCache() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   MethodReference GetMethodReference() const;
+  uint16_t GetClassDefIndex() const;
   uint32_t GetAccessFlags() const;
   bool HasCheckCasts() const;
   bool HasVirtualOrInterfaceInvokes() const;
   bool HasFailures() const;
+  bool HasNonResolutionSoftFailures() const;
   const RegType& ResolveCheckedClass(uint32_t class_idx)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -696,6 +698,9 @@ class MethodVerifier {
   // to be unreachable. This is set by Fail and used to ensure we don't process unreachable
   // instructions that would hard fail the verification.
   bool have_pending_runtime_throw_failure_;
+  // Was a soft failure reported for a reason other than a class, field or method that could not be
+  // resolved or accessed? Such failures may become hard failures when verifying again at runtime.
+  bool have_non_resolution_soft_failure_;
 
   // Info message log use primarily for verifier diagnostics.
   std::ostringstream info_messages_;
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "verifier_deps.h"
+
+#include <string.h>
+
+#include "class_linker.h"
+#include "dex_file-inl.h"
+#include "handle_scope-inl.h"
+#include "leb128.h"
+#include "method_verifier-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/dex_cache.h"
+#include "mirror/iftable-inl.h"
+#include "reg_type-inl.h"
+#include "reg_type_cache-inl.h"
+#include "runtime.h"
+#include "thread.h"
+
+namespace art {
+namespace verifier {
+
+// Returns the index of the type with the given descriptor in dex_file, or DexFile::kDexNoIndex if
+// dex_file doesn't refer to it.
+static uint32_t FindTypeIndex(const DexFile& dex_file, const char* descriptor) {
+  const DexFile::StringId* string_id = dex_file.FindStringId(descriptor);
+  if (string_id == nullptr) {
+    return DexFile::kDexNoIndex;
+  }
+  const DexFile::TypeId* type_id = dex_file.FindTypeId(dex_file.GetIndexForStringId(*string_id));
+  if (type_id == nullptr) {
+    return DexFile::kDexNoIndex;
+  }
+  return dex_file.GetIndexForTypeId(*type_id);
+}
+
+// Appends klass to hierarchy unless it is a boot class. Returns false if it has no dex file.
+static bool AddHierarchyClass(mirror::Class* klass, const DexFile* dex_file,
+                              std::vector<VerifierDeps::HierarchyClass>* hierarchy,
+                              bool* other_dex_file) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (klass->GetClassLoader() == nullptr) {
+    return true;
+  }
+  if (klass->IsProxyClass() || klass->GetDexCache() == nullptr) {
+    return false;
+  }
+  const DexFile& defining_dex_file = *klass->GetDexCache()->GetDexFile();
+  if (dex_file != nullptr && &defining_dex_file != dex_file) {
+    *other_dex_file = true;
+  }
+  std::string temp;
+  hierarchy->push_back(VerifierDeps::HierarchyClass {klass->GetDescriptor(&temp),
+                                                     defining_dex_file.GetLocationChecksum()});
+  return true;
+}
+
+bool VerifierDeps::GetHierarchy(mirror::Class* klass, const DexFile* dex_file,
+                                std::vector<HierarchyClass>* hierarchy, bool* other_dex_file) {
+  hierarchy->clear();
+  while (klass->IsArrayClass()) {
+    klass = klass->GetComponentType();
+  }
+  if (klass->IsPrimitive()) {
+    return true;
+  }
+  if (!klass->IsResolved() || klass->IsErroneous()) {
+    return false;
+  }
+  for (mirror::Class* c = klass; c != nullptr; c = c->GetSuperClass()) {
+    if (!AddHierarchyClass(c, dex_file, hierarchy, other_dex_file)) {
+      return false;
+    }
+  }
+  for (int32_t i = 0, count = klass->GetIfTableCount(); i != count; ++i) {
+    if (!AddHierarchyClass(klass->GetIfTable()->GetInterface(i), dex_file, hierarchy,
+                           other_dex_file)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void VerifierDeps::RecordMethodDependencies(MethodVerifier* verifier, ClassDeps* deps) {
+  if (verifier->HasFailures()) {
+    deps->has_soft_failures = true;
+    if (verifier->HasNonResolutionSoftFailures()) {
+      deps->is_recordable = false;
+    }
+  }
+  if (!deps->is_recordable) {
+    return;
+  }
+  const DexFile& dex_file = *verifier->GetMethodReference().dex_file;
+  RegTypeCache* reg_types = verifier->GetRegTypeCache();
+  for (size_t id = 0, size = reg_types->GetCacheSize(); id != size; ++id) {
+    const RegType& reg_type = reg_types->GetFromId(id);
+    if (reg_type.IsUnresolvedTypes()) {
+      if (reg_type.IsUnresolvedMergedReference() || reg_type.IsUnresolvedSuperClass()) {
+        // Derived from other unresolved types which are in the cache themselves.
+        continue;
+      }
+      uint32_t type_idx = FindTypeIndex(dex_file, reg_type.GetDescriptor().c_str());
+      if (type_idx == DexFile::kDexNoIndex) {
+        deps->is_recordable = false;
+        return;
+      }
+      deps->unresolved_types.insert(type_idx);
+    } else if (reg_type.HasClass()) {
+      // Even a class of this dex file depends on other dex files if one of its superclasses or
+      // interfaces is defined there.
+      std::vector<HierarchyClass> hierarchy;
+      bool other_dex_file = false;
+      if (!GetHierarchy(reg_type.GetClass(), &dex_file, &hierarchy, &other_dex_file)) {
+        deps->is_recordable = false;
+        return;
+      }
+      if (!other_dex_file) {
+        continue;
+      }
+      uint32_t type_idx = FindTypeIndex(dex_file, reg_type.GetDescriptor().c_str());
+      if (type_idx == DexFile::kDexNoIndex) {
+        deps->is_recordable = false;
+        return;
+      }
+      deps->resolved_types.insert(ResolvedType {type_idx, std::move(hierarchy)});
+    }
+  }
+}
+
+void VerifierDeps::Encode(const DexFileDeps& deps, std::vector<uint8_t>* out) {
+  std::vector<std::pair<uint16_t, const ClassDeps*>> classes;
+  for (const auto& entry : deps) {
+    if (entry.second.is_recordable) {
+      classes.emplace_back(entry.first, &entry.second);
+    }
+  }
+  const size_t start = out->size();
+  const size_t index_size = 2 * sizeof(uint32_t) * (1 + classes.size());
+  out->resize(start + index_size);
+  Leb128Encoder encoder(out);
+  uint32_t* index = reinterpret_cast<uint32_t*>(&(*out)[start]);
+  index[1] = classes.size();
+  for (size_t i = 0; i != classes.size(); ++i) {
+    const ClassDeps& class_deps = *classes[i].second;
+    // The encoder may reallocate, don't hold on to the index while pushing.
+    uint32_t offset = out->size() - start;
+    encoder.PushBackUnsigned(class_deps.has_soft_failures ? kHasSoftFailures : 0u);
+    encoder.PushBackUnsigned(class_deps.unresolved_types.size());
+    encoder.InsertBackUnsigned(class_deps.unresolved_types.begin(),
+                               class_deps.unresolved_types.end());
+    encoder.PushBackUnsigned(class_deps.resolved_types.size());
+    for (const ResolvedType& resolved_type : class_deps.resolved_types) {
+      encoder.PushBackUnsigned(resolved_type.type_idx);
+      encoder.PushBackUnsigned(resolved_type.hierarchy.size());
+      for (const HierarchyClass& hierarchy_class : resolved_type.hierarchy) {
+        encoder.PushBackUnsigned(hierarchy_class.descriptor.size());
+        out->insert(out->end(), hierarchy_class.descriptor.begin(),
+                    hierarchy_class.descriptor.end());
+        encoder.PushBackUnsigned(hierarchy_class.location_checksum);
+      }
+    }
+    index = reinterpret_cast<uint32_t*>(&(*out)[start]);
+    index[2 + 2 * i] = classes[i].first;
+    index[2 + 2 * i + 1] = offset;
+  }
+  index = reinterpret_cast<uint32_t*>(&(*out)[start]);
+  index[0] = out->size() - start;
+}
+
+uint32_t VerifierDeps::EncodedSize(const uint8_t* data) {
+  return reinterpret_cast<const uint32_t*>(data)[0];
+}
+
+bool VerifierDeps::Decode(const uint8_t* data, uint16_t class_def_index, ClassDeps* deps) {
+  const uint32_t* index = reinterpret_cast<const uint32_t*>(data);
+  const uint32_t size = index[0];
+  const uint32_t num_classes = index[1];
+  // Binary search the sorted index.
+  const uint32_t* entries = index + 2;
+  uint32_t lo = 0;
+  uint32_t hi = num_classes;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    uint32_t mid_class_def_index = entries[2 * mid];
+    if (mid_class_def_index < class_def_index) {
+      lo = mid + 1;
+    } else if (mid_class_def_index > class_def_index) {
+      hi = mid;
+    } else {
+      uint32_t offset = entries[2 * mid + 1];
+      if (UNLIKELY(offset >= size)) {
+        LOG(WARNING) << "Invalid verifier dependencies offset " << offset << " size " << size;
+        return false;
+      }
+      const uint8_t* ptr = data + offset;
+      deps->has_soft_failures = (DecodeUnsignedLeb128(&ptr) & kHasSoftFailures) != 0u;
+      deps->is_recordable = true;
+      for (uint32_t i = 0, n = DecodeUnsignedLeb128(&ptr); i != n; ++i) {
+        deps->unresolved_types.insert(DecodeUnsignedLeb128(&ptr));
+      }
+      for (uint32_t i = 0, n = DecodeUnsignedLeb128(&ptr); i != n; ++i) {
+        ResolvedType resolved_type;
+        resolved_type.type_idx = DecodeUnsignedLeb128(&ptr);
+        resolved_type.hierarchy.resize(DecodeUnsignedLeb128(&ptr));
+        for (HierarchyClass& hierarchy_class : resolved_type.hierarchy) {
+          uint32_t length = DecodeUnsignedLeb128(&ptr);
+          hierarchy_class.descriptor.assign(reinterpret_cast<const char*>(ptr), length);
+          ptr += length;
+          hierarchy_class.location_checksum = DecodeUnsignedLeb128(&ptr);
+        }
+        deps->resolved_types.insert(std::move(resolved_type));
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool VerifierDeps::DependenciesHold(Thread* self, const DexFile& dex_file,
+                                    Handle<mirror::ClassLoader> class_loader,
+                                    const ClassDeps& deps) {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  for (uint32_t type_idx : deps.unresolved_types) {
+    const char* descriptor = dex_file.StringByTypeIdx(type_idx);
+    mirror::Class* klass = class_linker->FindClass(self, descriptor, class_loader);
+    if (klass != nullptr) {
+      VLOG(verifier) << "Verifier dependency " << descriptor << " now resolves";
+      return false;
+    }
+    self->ClearException();
+  }
+  std::vector<HierarchyClass> hierarchy;
+  for (const ResolvedType& resolved_type : deps.resolved_types) {
+    const char* descriptor = dex_file.StringByTypeIdx(resolved_type.type_idx);
+    mirror::Class* klass = class_linker->FindClass(self, descriptor, class_loader);
+    if (klass == nullptr) {
+      self->ClearException();
+      VLOG(verifier) << "Verifier dependency " << descriptor << " no longer resolves";
+      return false;
+    }
+    if (!GetHierarchy(klass, nullptr, &hierarchy, nullptr) ||
+        hierarchy != resolved_type.hierarchy) {
+      VLOG(verifier) << "Verifier dependency " << descriptor << " resolves to a different class";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace verifier
+}  // namespace art
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
+#define ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "safe_map.h"
+
+namespace art {
+
+class DexFile;
+template<class T> class Handle;
+namespace mirror {
+  class Class;
+  class ClassLoader;
+}  // namespace mirror
+
+namespace verifier {
+
+class MethodVerifier;
+
+/*
+ * The class resolution assumptions a compile time verification result relies on.
+ *
+ * A class whose verification soft failed at compile time is normally verified again from scratch
+ * at runtime, as the missing types may be available by then. Boot classes cannot change without
+ * invalidating the oat file and classes of the same dex file are fixed, so the only inputs that can
+ * differ are the types that did not resolve and the application classes defined by other dex files.
+ * The latter are reached through the hierarchy of a resolved type: the verifier's assignability
+ * checks walk its superclasses and interfaces, and field and method resolution searches the same
+ * classes. A type whose hierarchy contains a class of another dex file is recorded together with
+ * the non-boot classes of that hierarchy and the location checksums of their dex files, which also
+ * covers the members and access flags those classes define. If no recorded type resolves
+ * differently at runtime, the verifier would reach the same result again and the class can be
+ * marked verified without running it.
+ *
+ * The dependencies of all classes of a dex file are written into the oat file as follows, all
+ * integers after the sorted index being unsigned LEB128:
+ *
+ *   uint32_t size                  total size of the data in bytes
+ *   uint32_t num_classes
+ *   { uint32_t class_def_index; uint32_t offset; } x num_classes
+ *   flags num_unresolved { type_idx } num_resolved { type_idx num_hierarchy_classes
+ *       { descriptor_length descriptor location_checksum } }  per class
+ */
+class VerifierDeps {
+ public:
+  // A class the verification result depends on. It is named by descriptor as the class' dex file
+  // need not refer to it.
+  struct HierarchyClass {
+    std::string descriptor;
+    // Location checksum of the dex file defining the class.
+    uint32_t location_checksum;
+
+    bool operator==(const HierarchyClass& other) const {
+      return location_checksum == other.location_checksum && descriptor == other.descriptor;
+    }
+  };
+
+  struct ResolvedType {
+    uint32_t type_idx;
+    // The non-boot classes among the type, its superclasses and its interfaces, in that order.
+    // The type's element class stands in for an array type.
+    std::vector<HierarchyClass> hierarchy;
+
+    // A type resolves to a single class at a time, so its index identifies it.
+    bool operator<(const ResolvedType& other) const {
+      return type_idx < other.type_idx;
+    }
+  };
+
+  struct ClassDeps {
+    ClassDeps() : has_soft_failures(false), is_recordable(true) {}
+
+    // Whether verification of the class' own methods soft failed, as opposed to the class only
+    // needing runtime verification because of its super class.
+    bool has_soft_failures;
+    // False if the verifier reached a result that doesn't only depend on type resolution, or
+    // a dependency cannot be expressed as a type of the class' dex file.
+    bool is_recordable;
+    std::set<uint32_t> unresolved_types;
+    std::set<ResolvedType> resolved_types;
+  };
+
+  typedef SafeMap<uint16_t, ClassDeps> DexFileDeps;
+
+  // Adds the dependencies of the method verified by verifier to deps.
+  static void RecordMethodDependencies(MethodVerifier* verifier, ClassDeps* deps)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Appends the encoding of the recordable classes in deps to out.
+  static void Encode(const DexFileDeps& deps, std::vector<uint8_t>* out);
+
+  // Returns the size of the encoded data starting at data.
+  static uint32_t EncodedSize(const uint8_t* data);
+
+  // Decodes the dependencies of the class with the given class def index from data. Returns
+  // false if data holds no dependencies for the class.
+  static bool Decode(const uint8_t* data, uint16_t class_def_index, ClassDeps* deps);
+
+  // Returns true if all of the types in deps resolve through class_loader to the same classes,
+  // with the same hierarchies, as they did at compile time.
+  static bool DependenciesHold(Thread* self, const DexFile& dex_file,
+                               Handle<mirror::ClassLoader> class_loader, const ClassDeps& deps)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static constexpr uint32_t kHasSoftFailures = 1;
+
+  // Fills hierarchy with the non-boot classes of the hierarchy of klass. Returns false if one of
+  // them is not resolved or has no dex file, in which case it cannot be recorded or compared. If
+  // dex_file is not null, sets *other_dex_file when a class is defined by a different dex file.
+  static bool GetHierarchy(mirror::Class* klass, const DexFile* dex_file,
+                           std::vector<HierarchyClass>* hierarchy, bool* other_dex_file)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(VerifierDeps);
+};
+
+}  // namespace verifier
+}  // namespace art
+
+#endif  // ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
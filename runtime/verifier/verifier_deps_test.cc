@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "verifier_deps.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+namespace verifier {
+
+TEST(VerifierDepsTest, EncodeDecode) {
+  VerifierDeps::DexFileDeps deps;
+  VerifierDeps::ClassDeps first;
+  first.has_soft_failures = true;
+  first.unresolved_types.insert(3u);
+  first.unresolved_types.insert(300u);
+  VerifierDeps::ResolvedType resolved_type;
+  resolved_type.type_idx = 7u;
+  resolved_type.hierarchy.push_back(VerifierDeps::HierarchyClass {"LSub;", 0x12345678u});
+  resolved_type.hierarchy.push_back(VerifierDeps::HierarchyClass {"LBase;", 0xdeadbeefu});
+  first.resolved_types.insert(resolved_type);
+  deps.Put(2u, first);
+  VerifierDeps::ClassDeps not_recordable;
+  not_recordable.is_recordable = false;
+  not_recordable.unresolved_types.insert(1u);
+  deps.Put(5u, not_recordable);
+  VerifierDeps::ClassDeps no_types;
+  deps.Put(9u, no_types);
+
+  std::vector<uint8_t> data;
+  VerifierDeps::Encode(deps, &data);
+  ASSERT_EQ(data.size(), VerifierDeps::EncodedSize(&data[0]));
+
+  VerifierDeps::ClassDeps decoded;
+  ASSERT_TRUE(VerifierDeps::Decode(&data[0], 2u, &decoded));
+  EXPECT_TRUE(decoded.has_soft_failures);
+  EXPECT_EQ(first.unresolved_types, decoded.unresolved_types);
+  ASSERT_EQ(1u, decoded.resolved_types.size());
+  EXPECT_EQ(7u, decoded.resolved_types.begin()->type_idx);
+  EXPECT_TRUE(resolved_type.hierarchy == decoded.resolved_types.begin()->hierarchy);
+
+  VerifierDeps::ClassDeps decoded_no_types;
+  ASSERT_TRUE(VerifierDeps::Decode(&data[0], 9u, &decoded_no_types));
+  EXPECT_FALSE(decoded_no_types.has_soft_failures);
+  EXPECT_TRUE(decoded_no_types.unresolved_types.empty());
+  EXPECT_TRUE(decoded_no_types.resolved_types.empty());
+
+  // Classes that are not recorded, or not recordable, must be verified from scratch.
+  VerifierDeps::ClassDeps missing;
+  EXPECT_FALSE(VerifierDeps::Decode(&data[0], 5u, &missing));
+  EXPECT_FALSE(VerifierDeps::Decode(&data[0], 0u, &missing));
+  EXPECT_FALSE(VerifierDeps::Decode(&data[0], 10u, &missing));
+}
+
+}  // namespace verifier
+}  // namespace art
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+import dalvik.annotation.optimization.CriticalNative;
+import dalvik.annotation.optimization.FastNative;
+
 class MyClassNatives {
     native void throwException();
     native void foo();
@@ -98,4 +101,19 @@ class MyClassNatives {
     static native boolean returnTrue();
     static native boolean returnFalse();
     static native int returnInt();
+
+    @FastNative native int fastFooI(int x);
+    @FastNative static native int fastSbar(int count);
+    @FastNative native Object fastFooO(Object x);
+    @FastNative synchronized native long fastFooJJ_synchronized(long x, long y);
+
+    @CriticalNative static native double criticalFooDD(double x, double y);
+    @CriticalNative static native long criticalStackArgs(int i1, long l1, float f1, double d1,
+        int i2, long l2, float f2, double d2, int i3, long l3, float f3, double d3, int i4, long l4,
+        float f4, double d4, int i5, long l5, float f5, double d5, int i6, long l6, float f6,
+        double d6, int i7, long l7, float f7, double d7, int i8, long l8, float f8, double d8);
+    // @CriticalNative is ignored on these, they are regular natives.
+    @CriticalNative native int criticalIgnoredInstance(int x);
+    @CriticalNative static synchronized native int criticalIgnoredSynchronized(int x);
+    @CriticalNative static native int criticalIgnoredObject(Object x);
 }
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compiled with VerifierDepsLib or VerifierDepsLib2 ahead of it in the class path, which define
+// Base and Final in its place.
+class VerifierDeps {
+    static void takeException(Exception e) {
+    }
+
+    // Verifies only while Base, the superclass of Sub, is an Exception.
+    static void passSub() {
+        takeException(new Sub());
+    }
+
+    // Broken does not link against a final Final, which soft fails verification.
+    static Final newBroken() {
+        return new Broken();
+    }
+}
+
+class Sub extends Base {
+}
+
+class Base extends Exception {
+}
+
+class Final {
+}
+
+class Broken extends Final {
+}